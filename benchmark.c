@@ -0,0 +1,1136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include "dberror.h"
+#include "expr.h"
+#include "record_mgr.h"
+#include "tables.h"
+
+#define BENCH_TABLE "bench_table"
+#define BENCH_JOIN_LEFT "bench_join_l"
+#define BENCH_JOIN_RIGHT "bench_join_r"
+#define BENCH_WAL "bench_wal"
+#define BENCH_CHECKPOINT "bench_ckpt"
+#define BENCH_MVCC "bench_mvcc"
+#define BENCH_LOCKS "bench_locks"
+#define BENCH_CHECKSUMS "bench_crc"
+#define BENCH_PLAIN "bench_plain"
+#define BENCH_COMPRESSED "bench_lz"
+#define BENCH_ROWS "bench_rows"
+#define BENCH_PAX "bench_pax"
+#define BENCH_DICTIONARY "bench_dict"
+
+// helper methods
+static Schema *benchSchema(void);
+static Record *benchRecord(Schema *schema, int a, char *b, int c);
+static double elapsedMs(struct timespec *start);
+static void check(RC rc, char *what);
+
+// benchmarks
+static void benchLookups(int numRecords, int numLookups);
+static void benchParallelScan(int numRecords);
+static void benchJoins(int numLeft, int numRight);
+static void benchWal(int numRecords);
+static void benchCheckpoints(int numRecords);
+static void benchSnapshotScans(int numRecords, int numTransfers);
+static void benchLockContention(int numRecords, int numTransfers);
+static void benchPageVerify(int numRecords, int numReads);
+static void benchCompression(int numRecords, int numReads);
+static void benchColumnarAggregates(int numRecords, int numRuns);
+static void benchDictionaryScans(int numRecords, int numRuns);
+
+// main method
+int main(int argc, char **argv)
+{
+	int numRecords = argc > 1 ? atoi(argv[1]) : 10000;
+	int numLookups = argc > 2 ? atoi(argv[2]) : 1000;
+	int numScanRecords = argc > 3 ? atoi(argv[3]) : 100000;
+	int numJoinLeft = argc > 4 ? atoi(argv[4]) : 1000000;
+	int numJoinRight = argc > 5 ? atoi(argv[5]) : 100000;
+	int numWalRecords = argc > 6 ? atoi(argv[6]) : 2000;
+	int numCheckpointRecords = argc > 7 ? atoi(argv[7]) : 200000;
+	int numMvccRecords = argc > 8 ? atoi(argv[8]) : 100000;
+	int numTransfers = argc > 9 ? atoi(argv[9]) : 20000;
+	int numHotRecords = argc > 10 ? atoi(argv[10]) : 16;
+	int numContendedTransfers = argc > 11 ? atoi(argv[11]) : 20000;
+	int numChecksumRecords = argc > 12 ? atoi(argv[12]) : 200000;
+	int numChecksumReads = argc > 13 ? atoi(argv[13]) : 200000;
+	int numArchiveRecords = argc > 14 ? atoi(argv[14]) : 200000;
+	int numArchiveReads = argc > 15 ? atoi(argv[15]) : 200000;
+	int numOrderRecords = argc > 16 ? atoi(argv[16]) : 200000;
+	int numAggregateRuns = argc > 17 ? atoi(argv[17]) : 5;
+	int numStatusRecords = argc > 18 ? atoi(argv[18]) : 200000;
+	int numStatusScans = argc > 19 ? atoi(argv[19]) : 5;
+
+	benchLookups(numRecords, numLookups);
+	benchParallelScan(numScanRecords);
+	benchJoins(numJoinLeft, numJoinRight);
+	benchWal(numWalRecords);
+	benchCheckpoints(numCheckpointRecords);
+	benchSnapshotScans(numMvccRecords, numTransfers);
+	benchLockContention(numHotRecords, numContendedTransfers);
+	benchPageVerify(numChecksumRecords, numChecksumReads);
+	benchCompression(numArchiveRecords, numArchiveReads);
+	benchColumnarAggregates(numOrderRecords, numAggregateRuns);
+	benchDictionaryScans(numStatusRecords, numStatusScans);
+
+	return 0;
+}
+
+/*
+    # point lookups on attribute c of the testSchema table shape through
+    # a full table scan, a B+-tree index and a hash index
+*/
+static void benchLookups(int numRecords, int numLookups)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	char *names[] = {"aaaa", "bbbb", "cccc", "dddd", "eeee"};
+	char *paths[] = {"full scan", "B+-tree", "hash"};
+	struct timespec start;
+	Record *r;
+	Value *key;
+	int i, path, scanLookups;
+	double ms;
+
+	check(initRecordManager(NULL), "initRecordManager");
+	check(createTable(BENCH_TABLE, schema), "createTable");
+	check(openTable(table, BENCH_TABLE), "openTable");
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < numRecords; i++)
+	{
+		r = benchRecord(schema, i, names[i % 5], i);
+		check(insertRecord(table, r), "insertRecord");
+		freeRecord(r);
+	}
+	printf("inserted %d records in %.1f ms\n", numRecords, elapsedMs(&start));
+
+	// a full scan per lookup is slow, keep its sample small
+	scanLookups = numLookups < 50 ? numLookups : 50;
+	check(createRecord(&r, schema), "createRecord");
+	printf("%-10s %10s %14s\n", "path", "lookups", "us/lookup");
+	for (path = 0; path < 3; path++)
+	{
+		if (path == 1)
+			check(createIndex(table, 2), "createIndex");
+		else if (path == 2)
+		{
+			check(dropIndex(table, 2), "dropIndex");
+			check(createHashIndex(table, 2), "createHashIndex");
+		}
+
+		int lookups = path == 0 ? scanLookups : numLookups;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < lookups; i++)
+		{
+			MAKE_VALUE(key, DT_INT, (int)(((long)i * 7919) % numRecords));
+			check(getRecordByValue(table, 2, key, r), "getRecordByValue");
+			freeVal(key);
+		}
+		ms = elapsedMs(&start);
+		printf("%-10s %10d %14.2f\n", paths[path], lookups, ms * 1000.0 / lookups);
+	}
+	freeRecord(r);
+
+	check(closeTable(table), "closeTable");
+	check(deleteTable(BENCH_TABLE), "deleteTable");
+	shutdownRecordManager();
+	free(table);
+	freeSchema(schema);
+}
+
+// per-worker match counts, padded so that workers do not share cache lines
+typedef struct WorkerCount
+{
+	long count;
+	char pad[56];
+} WorkerCount;
+
+static RC countMatch(Record *record, int worker, void *context)
+{
+	((WorkerCount *)context)[worker].count++;
+	return RC_OK;
+}
+
+/*
+    # throughput of parallelScan over a table that is already in the buffer pool,
+    # for 1, 2, 4, ... worker threads, best of five runs each
+*/
+static void benchParallelScan(int numRecords)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	RM_Options options = {2048, 0};
+	RM_ParallelScanStats stats;
+	WorkerCount counts[64];
+	Expr *sel, *left, *right;
+	Record *r;
+	char bound[16];
+	double best, single = 0;
+	int i, workers, run, maxWorkers = 16;
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(createTable(BENCH_TABLE, schema), "createTable");
+	check(openTable(table, BENCH_TABLE), "openTable");
+	for (i = 0; i < numRecords; i++)
+	{
+		r = benchRecord(schema, i, "aaaa", i % 100);
+		check(insertRecord(table, r), "insertRecord");
+		freeRecord(r);
+	}
+
+	printf("\nparallel scan of %d cached records, c < 50\n", numRecords);
+	printf("%-8s %10s %14s %9s %7s\n", "workers", "ms", "records/s", "speedup", "steals");
+	sprintf(bound, "i%d", 50);
+	for (workers = 1; workers <= maxWorkers; workers *= 2)
+	{
+		best = -1;
+		// the first run of one worker also loads the table into the pool
+		for (run = 0; run < (workers == 1 ? 6 : 5); run++)
+		{
+			MAKE_ATTRREF(left, 2);
+			MAKE_CONS(right, stringToValue(bound));
+			MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+			memset(counts, 0, sizeof(counts));
+			check(parallelScan(table, sel, workers, countMatch, counts, &stats), "parallelScan");
+			freeExpr(sel);
+			if ((workers > 1 || run > 0) && (best < 0 || stats.elapsedMs < best))
+				best = stats.elapsedMs;
+		}
+		if (workers == 1)
+			single = best;
+		printf("%-8d %10.2f %14.0f %8.2fx %7d\n", workers, best, numRecords / (best / 1000.0), single / best, stats.steals);
+	}
+
+	check(closeTable(table), "closeTable");
+	check(deleteTable(BENCH_TABLE), "deleteTable");
+	shutdownRecordManager();
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # left.c = right.a between a table of numLeft and one of numRight records,
+    # every left record matches one right record through the primary key of right
+*/
+static void benchJoins(int numLeft, int numRight)
+{
+	RM_TableData *left = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *right = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema(), *joined;
+	RM_Options options = {4096, 0};
+	RM_JoinHandle join;
+	JoinMethod methods[] = {JOIN_INDEX_NESTED_LOOP, JOIN_HASH, JOIN_HASH};
+	int memoryPages[] = {0, 16384, 64};
+	struct timespec start;
+	Record *r;
+	char *plan;
+	double ms;
+	int i, m, count;
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(createTable(BENCH_JOIN_LEFT, schema), "createTable");
+	check(openTable(left, BENCH_JOIN_LEFT), "openTable");
+	check(createTable(BENCH_JOIN_RIGHT, schema), "createTable");
+	check(openTable(right, BENCH_JOIN_RIGHT), "openTable");
+	for (i = 0; i < numLeft; i++)
+	{
+		r = benchRecord(schema, i, "llll", i % numRight);
+		check(insertRecord(left, r), "insertRecord");
+		freeRecord(r);
+	}
+	for (i = 0; i < numRight; i++)
+	{
+		r = benchRecord(schema, i, "rrrr", i);
+		check(insertRecord(right, r), "insertRecord");
+		freeRecord(r);
+	}
+
+	printf("\njoin of %d x %d records on left.c = right.a\n", numLeft, numRight);
+	printf("%-10s %12s %14s  %s\n", "ms", "matches", "records/s", "plan");
+	for (m = 0; m < 3; m++)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		check(startJoin(left, 2, right, 0, methods[m], memoryPages[m], &join), "startJoin");
+		check(getJoinSchema(&join, &joined), "getJoinSchema");
+		check(createRecord(&r, joined), "createRecord");
+		for (count = 0; nextJoin(&join, r) == RC_OK; count++)
+			;
+		ms = elapsedMs(&start);
+		check(explainJoin(&join, &plan), "explainJoin");
+		printf("%-10.2f %12d %14.0f  %s\n", ms, count, count / (ms / 1000.0), plan);
+		free(plan);
+		freeRecord(r);
+		check(closeJoin(&join), "closeJoin");
+	}
+
+	check(closeTable(left), "closeTable");
+	check(closeTable(right), "closeTable");
+	check(deleteTable(BENCH_JOIN_LEFT), "deleteTable");
+	check(deleteTable(BENCH_JOIN_RIGHT), "deleteTable");
+	shutdownRecordManager();
+	free(left);
+	free(right);
+	freeSchema(schema);
+}
+
+/*
+    # durable inserts: every insert logged and synced before it returns, synced once per
+    # transaction of 100 inserts, logged and synced by the group commit thread, and not logged at all
+*/
+static void benchWal(int numRecords)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	WalMode modes[] = {WAL_OFF, WAL_SYNC, WAL_SYNC, WAL_GROUP_COMMIT};
+	int batches[] = {0, 0, 100, 0};
+	char *modeNames[] = {"off", "sync", "sync, tx 100", "group commit"};
+	RM_Options options = {1024, 0};
+	struct timespec start;
+	LogStats stats;
+	Record *r;
+	double ms;
+	int i, m;
+
+	printf("\n%d inserts with the write-ahead log\n", numRecords);
+	printf("%-14s %10s %14s %8s %16s\n", "log", "ms", "records/s", "fsyncs", "records/fsync");
+	for (m = 0; m < 4; m++)
+	{
+		options.walMode = modes[m];
+		check(initRecordManager(&options), "initRecordManager");
+		check(createTable(BENCH_WAL, schema), "createTable");
+		check(openTable(table, BENCH_WAL), "openTable");
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < numRecords; i++)
+		{
+			if (batches[m] > 0 && i % batches[m] == 0)
+				check(beginTransaction(), "beginTransaction");
+			r = benchRecord(schema, i, "wwww", i % 100);
+			check(insertRecord(table, r), "insertRecord");
+			freeRecord(r);
+			if (batches[m] > 0 && (i % batches[m] == batches[m] - 1 || i == numRecords - 1))
+				check(commitTransaction(), "commitTransaction");
+		}
+		// group commit has to catch up before the inserts count as durable
+		check(syncLog(), "syncLog");
+		ms = elapsedMs(&start);
+		check(getLogStats(&stats), "getLogStats");
+		printf("%-14s %10.2f %14.0f %8ld %16.1f\n", modeNames[m], ms, numRecords / (ms / 1000.0), stats.syncs,
+				stats.syncs ? (double)stats.records / stats.syncs : 0.0);
+
+		check(closeTable(table), "closeTable");
+		check(deleteTable(BENCH_WAL), "deleteTable");
+		shutdownRecordManager();
+	}
+
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # a process inserting with the given options that crashes at the end, it prints the insert
+    # time, the slowest insert and how much of the log recovery will have to read
+*/
+static void insertAndCrash(RM_Options *options, Schema *schema, int numRecords)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	struct timespec start, one;
+	LogStats stats;
+	Record *r;
+	double ms, slowest = 0;
+	int i;
+
+	check(initRecordManager(options), "initRecordManager");
+	check(createTable(BENCH_CHECKPOINT, schema), "createTable");
+	check(openTable(table, BENCH_CHECKPOINT), "openTable");
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < numRecords; i++)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &one);
+		r = benchRecord(schema, i, "cccc", i % 100);
+		check(insertRecord(table, r), "insertRecord");
+		freeRecord(r);
+		if ((ms = elapsedMs(&one)) > slowest)
+			slowest = ms;
+	}
+	check(syncLog(), "syncLog");
+	ms = elapsedMs(&start);
+	check(getLogStats(&stats), "getLogStats");
+	printf("%10.2f %12.3f %14ld %9d", ms, slowest, stats.size / 1024, stats.segments);
+	fflush(stdout);
+	_exit(0);
+}
+
+/*
+    # inserts into a table that is never closed and crashes, then recovers it: without checkpoints
+    # redo reads the whole log, with them only what came after the last one
+*/
+static void benchCheckpoints(int numRecords)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	int intervals[] = {-1, 100, -1};
+	long logBytes[] = {-1, -1, 1024 * 1024};
+	char *modeNames[] = {"none", "every 100 ms", "every 1 MB"};
+	RM_Options options = {1024, 0, WAL_GROUP_COMMIT, 0, 0, 0, 0, 256 * 1024};
+	struct timespec start;
+	pid_t child;
+	double ms;
+	int m, status, tuples;
+
+	printf("\n%d inserts and a crash, then recovery\n", numRecords);
+	printf("%-14s %10s %12s %14s %9s %12s\n", "checkpoints", "insert ms", "slowest ms", "log kept KB", "segments",
+			"recovery ms");
+	for (m = 0; m < 3; m++)
+	{
+		options.checkpointMs = intervals[m];
+		options.checkpointLogBytes = logBytes[m];
+		printf("%-14s ", modeNames[m]);
+		fflush(stdout);
+		if ((child = fork()) == 0)
+			insertAndCrash(&options, schema, numRecords);
+		waitpid(child, &status, 0);
+		if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+			exit(1);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		check(initRecordManager(NULL), "initRecordManager");
+		ms = elapsedMs(&start);
+		check(openTable(table, BENCH_CHECKPOINT), "openTable");
+		tuples = getNumTuples(table);
+		printf(" %12.2f%s\n", ms, tuples == numRecords ? "" : "  (records lost)");
+
+		check(closeTable(table), "closeTable");
+		check(deleteTable(BENCH_CHECKPOINT), "deleteTable");
+		shutdownRecordManager();
+	}
+
+	free(table);
+	freeSchema(schema);
+}
+
+typedef struct SnapshotScanner
+{
+	RM_TableData *table;
+	Schema *schema;
+	long total;		// sum of c every scan must see
+	volatile int done;
+	int scans;
+	int inconsistent;	// scans whose sum of c was not total
+	double ms;
+} SnapshotScanner;
+
+// scans the whole table over and over until the writer is done
+static void *scanUntilDone(void *arg)
+{
+	SnapshotScanner *sc = (SnapshotScanner *)arg;
+	RM_ScanHandle scan;
+	struct timespec start;
+	Expr *all;
+	Record *r;
+	Value *c;
+	long sum;
+	RC rc;
+
+	check(createRecord(&r, sc->schema), "createRecord");
+	MAKE_CONS(all, stringToValue("btrue"));
+	while (!sc->done)
+	{
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		check(startScan(sc->table, &scan, all), "startScan");
+		sum = 0;
+		while ((rc = next(&scan, r)) == RC_OK)
+		{
+			getAttr(r, sc->schema, 2, &c);
+			sum += c->v.intV;
+			freeVal(c);
+		}
+		if (rc != RC_RM_NO_MORE_TUPLES)
+			check(rc, "next");
+		check(closeScan(&scan), "closeScan");
+		sc->ms += elapsedMs(&start);
+		sc->scans++;
+		if (sum != sc->total)
+			sc->inconsistent++;
+	}
+	freeExpr(all);
+	freeRecord(r);
+	return NULL;
+}
+
+/*
+    # moves one unit of c between two random records, one transaction per transfer
+*/
+static void transfer(RM_TableData *table, Schema *schema, RID *rids, int numRecords, Record *r)
+{
+	int from = rand() % numRecords, to = (from + 1 + rand() % (numRecords - 1)) % numRecords, k;
+	Value *c;
+
+	check(beginTransaction(), "beginTransaction");
+	for (k = 0; k < 2; k++)
+	{
+		check(getRecord(table, rids[k == 0 ? from : to], r), "getRecord");
+		getAttr(r, schema, 2, &c);
+		c->v.intV += k == 0 ? -1 : 1;
+		check(setAttr(r, schema, 2, c), "setAttr");
+		freeVal(c);
+		check(updateRecord(table, r), "updateRecord");
+	}
+	check(commitTransaction(), "commitTransaction");
+}
+
+/*
+    # transfers between the records of a table alone and while another thread scans it over and
+    # over; every scan has to see the same sum of c, the vacuum afterwards drops the older versions
+*/
+static void benchSnapshotScans(int numRecords, int numTransfers)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	RM_Options options = {4096, 0, WAL_OFF};
+	RID *rids = (RID *)malloc(sizeof(RID) * numRecords);
+	SnapshotScanner sc;
+	RM_VacuumStats stats;
+	struct timespec start;
+	pthread_t thread;
+	Record *r;
+	double ms;
+	int i, m;
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(createTable(BENCH_MVCC, schema), "createTable");
+	check(openTable(table, BENCH_MVCC), "openTable");
+	for (i = 0; i < numRecords; i++)
+	{
+		r = benchRecord(schema, i, "mmmm", 100);
+		check(insertRecord(table, r), "insertRecord");
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	printf("\n%d transfers between %d records, with and without full scans alongside\n", numTransfers, numRecords);
+	printf("%-10s %10s %14s %7s %12s %13s %10s\n", "scans", "ms", "transfers/s", "scans", "ms per scan",
+			"inconsistent", "vacuumed");
+	check(createRecord(&r, schema), "createRecord");
+	srand(42);
+	for (m = 0; m < 2; m++)
+	{
+		memset(&sc, 0, sizeof(sc));
+		sc.table = table;
+		sc.schema = schema;
+		sc.total = 100L * numRecords;
+		if (m == 1)
+			pthread_create(&thread, NULL, scanUntilDone, &sc);
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < numTransfers; i++)
+			transfer(table, schema, rids, numRecords, r);
+		ms = elapsedMs(&start);
+		sc.done = 1;
+		if (m == 1)
+			pthread_join(thread, NULL);
+
+		check(vacuumTable(table, 0, FALSE, &stats), "vacuumTable");
+		printf("%-10s %10.2f %14.0f %7d %12.2f %13d %10d\n", m == 0 ? "none" : "alongside", ms,
+				numTransfers / (ms / 1000.0), sc.scans, sc.scans ? sc.ms / sc.scans : 0.0, sc.inconsistent,
+				stats.versionsRemoved);
+	}
+	freeRecord(r);
+
+	check(closeTable(table), "closeTable");
+	check(deleteTable(BENCH_MVCC), "deleteTable");
+	shutdownRecordManager();
+	free(rids);
+	free(table);
+	freeSchema(schema);
+}
+
+// one thread of benchLockContention
+typedef struct ContendedWriter
+{
+	RM_TableData *table;
+	Schema *schema;
+	RID *rids;
+	int numRecords;
+	int numTransfers;
+	unsigned int seed;
+	int retries;		// transactions aborted on a conflict, deadlock or timeout
+} ContendedWriter;
+
+// transfers between random hot records, retrying the transactions that have to be aborted
+static void *transferContended(void *arg)
+{
+	ContendedWriter *w = (ContendedWriter *)arg;
+	Record *r;
+	Value *c;
+	RC rc;
+	int i, k, rid[2];
+
+	check(createRecord(&r, w->schema), "createRecord");
+	for (i = 0; i < w->numTransfers;)
+	{
+		rid[0] = rand_r(&w->seed) % w->numRecords;
+		rid[1] = (rid[0] + 1 + rand_r(&w->seed) % (w->numRecords - 1)) % w->numRecords;
+		check(beginTransaction(), "beginTransaction");
+		for (k = 0, rc = RC_OK; k < 2 && rc == RC_OK; k++)
+		{
+			check(getRecord(w->table, w->rids[rid[k]], r), "getRecord");
+			getAttr(r, w->schema, 2, &c);
+			c->v.intV += k == 0 ? -1 : 1;
+			check(setAttr(r, w->schema, 2, c), "setAttr");
+			freeVal(c);
+			rc = updateRecord(w->table, r);
+		}
+		if (rc == RC_OK)
+		{
+			check(commitTransaction(), "commitTransaction");
+			i++;
+			continue;
+		}
+		if (rc != RC_TX_CONFLICT && rc != RC_LOCK_DEADLOCK && rc != RC_LOCK_TIMEOUT)
+			check(rc, "updateRecord");
+		check(abortTransaction(), "abortTransaction");
+		w->retries++;
+	}
+	freeRecord(r);
+	return NULL;
+}
+
+/*
+    # transfers between a few hot records by 1 to 8 threads, with one lock shard and with the
+    # default ones; the sum of c must be the same afterwards
+*/
+static void benchLockContention(int numRecords, int numTransfers)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	RM_Options options = {4096, 0, WAL_OFF};
+	RID *rids = (RID *)malloc(sizeof(RID) * numRecords);
+	ContendedWriter writers[8];
+	pthread_t threads[8];
+	int numThreads[] = {1, 2, 4, 8}, shards[] = {1, 0};
+	struct timespec start;
+	LockStats stats;
+	Record *r;
+	Value *c;
+	long sum;
+	double ms;
+	int i, t, s, retries;
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(createTable(BENCH_LOCKS, schema), "createTable");
+	check(openTable(table, BENCH_LOCKS), "openTable");
+	for (i = 0; i < numRecords; i++)
+	{
+		r = benchRecord(schema, i, "llll", 100);
+		check(insertRecord(table, r), "insertRecord");
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	check(closeTable(table), "closeTable");
+	shutdownRecordManager();
+
+	printf("\n%d transfers between %d hot records, one transaction each\n", numTransfers, numRecords);
+	printf("%-8s %7s %10s %10s %8s %10s %8s %10s\n", "threads", "shards", "ms", "tx/s", "waits", "deadlocks",
+			"retries", "sum ok");
+	for (t = 0; t < 4; t++)
+	{
+		for (s = 0; s < 2; s++)
+		{
+			options.lockShards = shards[s];
+			check(initRecordManager(&options), "initRecordManager");
+			check(openTable(table, BENCH_LOCKS), "openTable");
+			clock_gettime(CLOCK_MONOTONIC, &start);
+			for (i = 0; i < numThreads[t]; i++)
+			{
+				writers[i].table = table;
+				writers[i].schema = schema;
+				writers[i].rids = rids;
+				writers[i].numRecords = numRecords;
+				writers[i].numTransfers = numTransfers / numThreads[t];
+				writers[i].seed = 42 + i;
+				writers[i].retries = 0;
+				pthread_create(&threads[i], NULL, transferContended, &writers[i]);
+			}
+			for (i = 0, retries = 0; i < numThreads[t]; i++)
+			{
+				pthread_join(threads[i], NULL);
+				retries += writers[i].retries;
+			}
+			ms = elapsedMs(&start);
+			check(getLockStats(&stats), "getLockStats");
+
+			check(createRecord(&r, schema), "createRecord");
+			for (i = 0, sum = 0; i < numRecords; i++)
+			{
+				check(getRecord(table, rids[i], r), "getRecord");
+				getAttr(r, schema, 2, &c);
+				sum += c->v.intV;
+				freeVal(c);
+			}
+			freeRecord(r);
+			printf("%-8d %7s %10.2f %10.0f %8ld %10ld %8d %10s\n", numThreads[t], s == 0 ? "1" : "default", ms,
+					numThreads[t] * (numTransfers / numThreads[t]) / (ms / 1000.0), stats.waits, stats.deadlocks,
+					retries, sum == 100L * numRecords ? "yes" : "NO");
+			check(closeTable(table), "closeTable");
+			shutdownRecordManager();
+		}
+	}
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(deleteTable(BENCH_LOCKS), "deleteTable");
+	shutdownRecordManager();
+	free(rids);
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # random record reads through a buffer pool much smaller than the table, so that nearly every
+    # read is a page read from the file system cache, with page checksums not checked, checked on
+    # the first read of every page and checked on every read
+*/
+static void benchPageVerify(int numRecords, int numReads)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema = benchSchema();
+	RM_Options options = {16, 0, WAL_OFF};
+	PageVerify modes[] = {PAGE_VERIFY_OFF, PAGE_VERIFY_LAZY, PAGE_VERIFY_ALWAYS};
+	char *names[] = {"off", "lazy", "always"};
+	RID *rids = (RID *)malloc(sizeof(RID) * numRecords);
+	char page[PAGE_SIZE];
+	struct timespec start;
+	unsigned int crc = 0;
+	Record *r;
+	double ms;
+	int i, m;
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(createTable(BENCH_CHECKSUMS, schema), "createTable");
+	check(openTable(table, BENCH_CHECKSUMS), "openTable");
+	for (i = 0; i < numRecords; i++)
+	{
+		r = benchRecord(schema, i, "cccc", i);
+		check(insertRecord(table, r), "insertRecord");
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	check(closeTable(table), "closeTable");
+	shutdownRecordManager();
+
+	memset(page, 7, PAGE_SIZE);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+	for (i = 0; i < 100000; i++)
+		crc = crc32c(crc, page, PAGE_SIZE);
+	ms = elapsedMs(&start);
+	printf("\nCRC32C (%s) of a page: %.2f us, %.0f MB/s (%08x)\n", crc32cImplementation(), ms * 10.0 / 1000.0,
+			100000.0 * PAGE_SIZE / (1024 * 1024) / (ms / 1000.0), crc);
+
+	printf("%d random reads of %d records through a pool of %d pages\n", numReads, numRecords, options.poolPages);
+	printf("%-8s %10s %12s\n", "verify", "ms", "reads/s");
+	check(createRecord(&r, schema), "createRecord");
+	for (m = 0; m < 3; m++)
+	{
+		options.pageVerify = modes[m];
+		check(initRecordManager(&options), "initRecordManager");
+		check(openTable(table, BENCH_CHECKSUMS), "openTable");
+		srand(42);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < numReads; i++)
+			check(getRecord(table, rids[rand() % numRecords], r), "getRecord");
+		ms = elapsedMs(&start);
+		printf("%-8s %10.2f %12.0f\n", names[m], ms, numReads / (ms / 1000.0));
+		check(closeTable(table), "closeTable");
+		shutdownRecordManager();
+	}
+	freeRecord(r);
+
+	check(initRecordManager(&options), "initRecordManager");
+	check(deleteTable(BENCH_CHECKSUMS), "deleteTable");
+	shutdownRecordManager();
+	free(rids);
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # an archive table, a int key and b char(64) of a few strings padded to their length, plain and
+    # compressed: size on disk, loading, a full scan and random record reads through a pool of 16
+    # pages, every page read from the file system cache
+*/
+static void benchCompression(int numRecords, int numReads)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	char *attrNames[] = {"a", "b"};
+	DataType dt[] = {DT_INT, DT_STRING};
+	int sizes[] = {0, 64};
+	int keys[] = {0};
+	Schema *schema = createSchema(2, attrNames, dt, sizes, 1, keys);
+	RM_Options options = {16, 0, WAL_OFF};
+	RM_TableOptions tableOptions[] = {{FALSE}, {TRUE}};
+	char *names[] = {BENCH_PLAIN, BENCH_COMPRESSED};
+	char *regions[] = {"shipped from the north warehouse", "shipped from the south warehouse",
+			"returned to the east warehouse", "held at the west warehouse"};
+	RID *rids = (RID *)malloc(sizeof(RID) * numRecords);
+	double loadMs, scanMs, readMs;
+	char padded[65];
+	struct timespec start;
+	struct stat st;
+	long fileSizes[2];
+	Expr *all;
+	Record *r;
+	Value *v;
+	int i, t, n;
+
+	printf("\n%d archive records, char(64) of %d distinct strings padded to their length\n", numRecords, 4);
+	printf("%-11s %10s %10s %10s %12s\n", "table", "MB", "load ms", "scan ms", "reads/s");
+	check(initRecordManager(&options), "initRecordManager");
+	check(createRecord(&r, schema), "createRecord");
+	for (t = 0; t < 2; t++)
+	{
+		check(createTableWithOptions(names[t], schema, &tableOptions[t]), "createTable");
+		check(openTable(table, names[t]), "openTable");
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < numRecords; i++)
+		{
+			snprintf(padded, sizeof(padded), "%-64s", regions[i % 4]);
+			MAKE_VALUE(v, DT_INT, i);
+			check(setAttr(r, schema, 0, v), "setAttr");
+			freeVal(v);
+			MAKE_STRING_VALUE(v, padded);
+			check(setAttr(r, schema, 1, v), "setAttr");
+			freeVal(v);
+			check(insertRecord(table, r), "insertRecord");
+			rids[i] = r->id;
+		}
+		check(closeTable(table), "closeTable");
+		loadMs = elapsedMs(&start);
+		fileSizes[t] = stat(names[t], &st) == 0 ? (long)st.st_size : 0;
+
+		check(openTable(table, names[t]), "openTable");
+		MAKE_CONS(all, stringToValue("btrue"));
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		check(startScan(table, sc, all), "startScan");
+		for (n = 0; next(sc, r) == RC_OK; n++)
+			;
+		check(closeScan(sc), "closeScan");
+		scanMs = elapsedMs(&start);
+		freeExpr(all);
+		if (n != numRecords)
+			printf("scan of %s returned %d records\n", names[t], n);
+
+		srand(42);
+		clock_gettime(CLOCK_MONOTONIC, &start);
+		for (i = 0; i < numReads; i++)
+			check(getRecord(table, rids[rand() % numRecords], r), "getRecord");
+		readMs = elapsedMs(&start);
+		check(closeTable(table), "closeTable");
+
+		printf("%-11s %10.2f %10.2f %10.2f %12.0f\n", tableOptions[t].compressed ? "compressed" : "plain",
+				fileSizes[t] / (1024.0 * 1024.0), loadMs, scanMs, numReads / (readMs / 1000.0));
+	}
+	printf("compressed to %.1f%% of the plain table, %.1fx smaller\n", 100.0 * fileSizes[1] / fileSizes[0],
+			(double)fileSizes[0] / fileSizes[1]);
+	freeRecord(r);
+
+	for (t = 0; t < 2; t++)
+		check(deleteTable(names[t]), "deleteTable");
+	shutdownRecordManager();
+	free(rids);
+	free(sc);
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # single-column aggregates over an order table of eight attributes in the row layout and in
+    # the PAX layout, both cached in the buffer pool; best of numRuns runs with one worker
+*/
+static void benchColumnarAggregates(int numRecords, int numRuns)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *attrNames[] = {"id", "customer", "status", "qty", "price", "region", "note", "day"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_STRING, DT_INT, DT_FLOAT, DT_STRING, DT_STRING, DT_INT};
+	int sizes[] = {0, 24, 8, 0, 0, 12, 40, 0};
+	int keys[] = {0};
+	Schema *schema = createSchema(8, attrNames, dt, sizes, 1, keys);
+	RM_Options options = {0, 0, WAL_OFF};
+	RM_TableOptions tableOptions[] = {{FALSE, TABLE_LAYOUT_ROWS}, {FALSE, TABLE_LAYOUT_PAX}};
+	char *names[] = {BENCH_ROWS, BENCH_PAX};
+	RM_Aggregate queries[][1] = {{{AGG_COUNT, -1}}, {{AGG_SUM, 3}}, {{AGG_AVG, 4}}, {{AGG_MIN, 7}}};
+	char *labels[] = {"COUNT(*)", "SUM(qty)", "AVG(price)", "MIN(day)"};
+	char *statuses[] = {"open", "shipped", "billed", "closed"};
+	char *regions[] = {"north", "south", "east", "west"};
+	double best[2][4], ms;
+	int sums[2] = {0, 0};
+	char text[64];
+	struct timespec start;
+	struct stat st;
+	long fileSizes[2];
+	RM_AggResult *res;
+	Record *r;
+	Value *v;
+	int i, t, q, run;
+
+	// a pool just large enough for either table, the frames of a page are looked up one by one
+	options.poolPages = 64 + numRecords / 30;
+	printf("\nsingle-column aggregates over %d cached order records of 8 attributes, best of %d runs\n", numRecords, numRuns);
+	check(initRecordManager(&options), "initRecordManager");
+	check(createRecord(&r, schema), "createRecord");
+	for (t = 0; t < 2; t++)
+	{
+		check(createTableWithOptions(names[t], schema, &tableOptions[t]), "createTable");
+		check(openTable(table, names[t]), "openTable");
+		for (i = 0; i < numRecords; i++)
+		{
+			MAKE_VALUE(v, DT_INT, i);
+			check(setAttr(r, schema, 0, v), "setAttr");
+			freeVal(v);
+			snprintf(text, sizeof(text), "customer %d", i % 5000);
+			MAKE_STRING_VALUE(v, text);
+			check(setAttr(r, schema, 1, v), "setAttr");
+			freeVal(v);
+			MAKE_STRING_VALUE(v, statuses[i % 4]);
+			check(setAttr(r, schema, 2, v), "setAttr");
+			freeVal(v);
+			MAKE_VALUE(v, DT_INT, 1 + i % 9);
+			check(setAttr(r, schema, 3, v), "setAttr");
+			freeVal(v);
+			MAKE_VALUE(v, DT_FLOAT, (float)(i % 1000) / 10);
+			check(setAttr(r, schema, 4, v), "setAttr");
+			freeVal(v);
+			MAKE_STRING_VALUE(v, regions[i % 4]);
+			check(setAttr(r, schema, 5, v), "setAttr");
+			freeVal(v);
+			snprintf(text, sizeof(text), "deliver to door %d", i % 97);
+			MAKE_STRING_VALUE(v, text);
+			check(setAttr(r, schema, 6, v), "setAttr");
+			freeVal(v);
+			MAKE_VALUE(v, DT_INT, 20000 + i % 365);
+			check(setAttr(r, schema, 7, v), "setAttr");
+			freeVal(v);
+			check(insertRecord(table, r), "insertRecord");
+		}
+
+		// the first run also loads the table into the pool
+		for (q = 0; q < 4; q++)
+		{
+			best[t][q] = -1;
+			for (run = 0; run < numRuns + (q == 0 ? 1 : 0); run++)
+			{
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				check(aggregateScan(table, NULL, -1, 1, queries[q], 1, &res), "aggregateScan");
+				ms = elapsedMs(&start);
+				if (q == 1)
+					sums[t] = res->groups[0].values[0]->v.intV;
+				freeAggResult(res);
+				if ((q > 0 || run > 0) && (best[t][q] < 0 || ms < best[t][q]))
+					best[t][q] = ms;
+			}
+		}
+		check(closeTable(table), "closeTable");
+		fileSizes[t] = stat(names[t], &st) == 0 ? (long)st.st_size : 0;
+	}
+	freeRecord(r);
+	if (sums[0] != sums[1])
+		printf("SUM(qty) differs: %d in rows, %d in PAX\n", sums[0], sums[1]);
+
+	printf("%-11s %10s %10s %9s\n", "aggregate", "rows ms", "PAX ms", "speedup");
+	for (q = 0; q < 4; q++)
+		printf("%-11s %10.2f %10.2f %8.2fx\n", labels[q], best[0][q], best[1][q], best[0][q] / best[1][q]);
+	printf("on disk: rows %.2f MB, PAX %.2f MB\n", fileSizes[0] / (1024.0 * 1024.0), fileSizes[1] / (1024.0 * 1024.0));
+
+	for (t = 0; t < 2; t++)
+		check(deleteTable(names[t]), "deleteTable");
+	shutdownRecordManager();
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # equality scans of the strings of an order table stored as text and as dictionary codes, both
+    # cached in the buffer pool; best of numRuns runs of a sequential scan
+*/
+static void benchDictionaryScans(int numRecords, int numRuns)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *attrNames[] = {"id", "status", "qty", "region", "carrier"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT, DT_STRING, DT_STRING};
+	int sizes[] = {0, 20, 0, 24, 32};
+	int keys[] = {0};
+	Schema *schema = createSchema(5, attrNames, dt, sizes, 1, keys);
+	RM_Options options = {0, 0, WAL_OFF};
+	bool encoded[] = {FALSE, TRUE, FALSE, TRUE, TRUE};
+	RM_TableOptions tableOptions[] = {{FALSE, TABLE_LAYOUT_ROWS}, {FALSE, TABLE_LAYOUT_ROWS, encoded}};
+	char *names[] = {BENCH_PLAIN, BENCH_DICTIONARY};
+	char *queries[][2] = {{"sawaiting shipment", NULL}, {"scentral warehouse north", "sexpress freight company"}};
+	int attrs[][2] = {{1, -1}, {3, 4}};
+	char *labels[] = {"status", "region and carrier"};
+	char *statuses[] = {"awaiting payment", "awaiting shipment", "shipped", "delivered", "returned"};
+	char *regions[] = {"north", "south", "east", "west"};
+	char *carriers[] = {"express", "standard", "economy"};
+	double best[2][2], ms;
+	int matches[2][2];
+	char text[64];
+	struct timespec start;
+	struct stat st;
+	long fileSizes[2];
+	RM_ScanHandle sc;
+	Expr *sel, *conds[2], *left, *right;
+	Record *r;
+	Value *v;
+	int i, t, q, k, run, count;
+
+	options.poolPages = 64 + numRecords / 40;
+	printf("\nequality scans of %d cached order records with strings as text and as dictionary codes, best of %d runs\n",
+			numRecords, numRuns);
+	check(initRecordManager(&options), "initRecordManager");
+	check(createRecord(&r, schema), "createRecord");
+	for (t = 0; t < 2; t++)
+	{
+		check(createTableWithOptions(names[t], schema, &tableOptions[t]), "createTable");
+		check(openTable(table, names[t]), "openTable");
+		for (i = 0; i < numRecords; i++)
+		{
+			MAKE_VALUE(v, DT_INT, i);
+			check(setAttr(r, schema, 0, v), "setAttr");
+			freeVal(v);
+			MAKE_STRING_VALUE(v, statuses[i % 5]);
+			check(setAttr(r, schema, 1, v), "setAttr");
+			freeVal(v);
+			MAKE_VALUE(v, DT_INT, 1 + i % 9);
+			check(setAttr(r, schema, 2, v), "setAttr");
+			freeVal(v);
+			snprintf(text, sizeof(text), "central warehouse %s", regions[i % 4]);
+			MAKE_STRING_VALUE(v, text);
+			check(setAttr(r, schema, 3, v), "setAttr");
+			freeVal(v);
+			snprintf(text, sizeof(text), "%s freight company", carriers[i % 3]);
+			MAKE_STRING_VALUE(v, text);
+			check(setAttr(r, schema, 4, v), "setAttr");
+			freeVal(v);
+			check(insertRecord(table, r), "insertRecord");
+		}
+
+		// the first run also loads the table into the pool
+		for (q = 0; q < 2; q++)
+		{
+			best[t][q] = -1;
+			for (run = 0; run < numRuns + (q == 0 ? 1 : 0); run++)
+			{
+				for (k = 0; k < 2 && attrs[q][k] >= 0; k++)
+				{
+					MAKE_ATTRREF(left, attrs[q][k]);
+					MAKE_CONS(right, stringToValue(queries[q][k]));
+					MAKE_BINOP_EXPR(conds[k], left, right, OP_COMP_EQUAL);
+				}
+				if (k == 1)
+					sel = conds[0];
+				else
+					MAKE_BINOP_EXPR(sel, conds[0], conds[1], OP_BOOL_AND);
+				clock_gettime(CLOCK_MONOTONIC, &start);
+				check(startScan(table, &sc, sel), "startScan");
+				for (count = 0; next(&sc, r) == RC_OK; count++)
+					;
+				check(closeScan(&sc), "closeScan");
+				ms = elapsedMs(&start);
+				freeExpr(sel);
+				matches[t][q] = count;
+				if ((q > 0 || run > 0) && (best[t][q] < 0 || ms < best[t][q]))
+					best[t][q] = ms;
+			}
+		}
+		check(closeTable(table), "closeTable");
+		fileSizes[t] = stat(names[t], &st) == 0 ? (long)st.st_size : 0;
+	}
+	freeRecord(r);
+
+	printf("%-20s %8s %10s %10s %9s\n", "condition", "matches", "text ms", "codes ms", "speedup");
+	for (q = 0; q < 2; q++)
+	{
+		if (matches[0][q] != matches[1][q])
+			printf("matches differ: %d as text, %d as codes\n", matches[0][q], matches[1][q]);
+		printf("%-20s %8d %10.2f %10.2f %8.2fx\n", labels[q], matches[1][q], best[0][q], best[1][q],
+				best[0][q] / best[1][q]);
+	}
+	printf("on disk: text %.2f MB, codes %.2f MB\n", fileSizes[0] / (1024.0 * 1024.0), fileSizes[1] / (1024.0 * 1024.0));
+
+	for (t = 0; t < 2; t++)
+		check(deleteTable(names[t]), "deleteTable");
+	shutdownRecordManager();
+	free(table);
+	freeSchema(schema);
+}
+
+/*
+    # same shape as testSchema in test_assign3_1.c: a int key, b char(4), c int
+*/
+static Schema *benchSchema(void)
+{
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT};
+	int sizes[] = {0, 4, 0};
+	int i;
+	char **cpNames = (char **)malloc(sizeof(char *) * 3);
+	DataType *cpDt = (DataType *)malloc(sizeof(DataType) * 3);
+	int *cpSizes = (int *)malloc(sizeof(int) * 3);
+	int *cpKeys = (int *)malloc(sizeof(int));
+
+	for (i = 0; i < 3; i++)
+	{
+		cpNames[i] = (char *)malloc(2);
+		strcpy(cpNames[i], names[i]);
+	}
+	memcpy(cpDt, dt, sizeof(DataType) * 3);
+	memcpy(cpSizes, sizes, sizeof(int) * 3);
+	cpKeys[0] = 0;
+
+	return createSchema(3, cpNames, cpDt, cpSizes, 1, cpKeys);
+}
+
+static Record *benchRecord(Schema *schema, int a, char *b, int c)
+{
+	Record *result;
+	Value *value;
+
+	check(createRecord(&result, schema), "createRecord");
+
+	MAKE_VALUE(value, DT_INT, a);
+	check(setAttr(result, schema, 0, value), "setAttr");
+	freeVal(value);
+
+	MAKE_STRING_VALUE(value, b);
+	check(setAttr(result, schema, 1, value), "setAttr");
+	freeVal(value);
+
+	MAKE_VALUE(value, DT_INT, c);
+	check(setAttr(result, schema, 2, value), "setAttr");
+	freeVal(value);
+
+	return result;
+}
+
+static double elapsedMs(struct timespec *start)
+{
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+static void check(RC rc, char *what)
+{
+	if (rc != RC_OK)
+	{
+		printf("%s failed with rc %d\n", what, rc);
+		exit(1);
+	}
+}
@@ -0,0 +1,1019 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "btree_mgr.h"
+#include "dberror.h"
+
+/*
+    # On-disk layout of a B+-tree index file
+
+    # Page 0 holds the BTreeMeta block. Every other page is one node that starts
+    # with a header of three ints: isLeaf, numKeys and next (the right sibling of
+    # a leaf, -1 otherwise).
+
+    # Entries are (key, RID) pairs. Ordering by key first and RID second makes every
+    # entry unique, so an attribute may hold duplicate keys and a single duplicate
+    # can still be located and deleted.
+
+    # Leaf:     header | entry[0 .. maxKeys-1]
+    # Internal: header | entry[0 .. maxKeys-1] | child[0 .. maxKeys]
+    #           every entry of child[i + 1] is >= entry[i]
+*/
+
+#define BT_POOL_SIZE 64
+#define NODE_HEADER_SIZE (3 * (int)sizeof(int))
+
+typedef struct BTreeMeta
+{
+    int rootPage;
+    int numNodes;
+    int numEntries;
+    int keyType;
+    int keyLength;
+    int maxKeys;
+    int numPages;
+} BTreeMeta;
+
+typedef struct BTreeMgmt
+{
+    BM_BufferPool bp;
+    BTreeMeta meta;
+    int keySize;
+    int entrySize;
+} BTreeMgmt;
+
+typedef struct BTreeScanMgmt
+{
+    int leafPage;
+    int pos;
+    bool hasHigh;
+    char *highKey;
+    bool hasLast;
+    char *lastEntry; // (key, RID) returned last, to find the cursor again after the leaf changed
+} BTreeScanMgmt;
+
+// node header access
+static int nodeGet(char *node, int field)
+{
+    int value;
+    memcpy(&value, node + field * sizeof(int), sizeof(int));
+    return value;
+}
+
+static void nodeSet(char *node, int field, int value)
+{
+    memcpy(node + field * sizeof(int), &value, sizeof(int));
+}
+
+#define NODE_IS_LEAF 0
+#define NODE_NUM_KEYS 1
+#define NODE_NEXT 2
+
+static char *nodeEntry(BTreeMgmt *t, char *node, int i)
+{
+    return node + NODE_HEADER_SIZE + i * t->entrySize;
+}
+
+static int nodeChild(BTreeMgmt *t, char *node, int i)
+{
+    int child;
+    memcpy(&child, node + NODE_HEADER_SIZE + t->meta.maxKeys * t->entrySize + i * sizeof(int), sizeof(int));
+    return child;
+}
+
+static void setNodeChild(BTreeMgmt *t, char *node, int i, int child)
+{
+    memcpy(node + NODE_HEADER_SIZE + t->meta.maxKeys * t->entrySize + i * sizeof(int), &child, sizeof(int));
+}
+
+static int keySizeOf(DataType keyType, int keyLength)
+{
+    switch (keyType)
+    {
+    case DT_INT:
+        return sizeof(int);
+    case DT_FLOAT:
+        return sizeof(float);
+    case DT_BOOL:
+        return sizeof(bool);
+    case DT_STRING:
+        return keyLength;
+    default:
+        return -1;
+    }
+}
+
+static int compareKeys(BTreeMgmt *t, char *a, char *b)
+{
+    switch (t->meta.keyType)
+    {
+    case DT_INT:
+    {
+        int l, r;
+        memcpy(&l, a, sizeof(int));
+        memcpy(&r, b, sizeof(int));
+        return (l > r) - (l < r);
+    }
+    case DT_FLOAT:
+    {
+        float l, r;
+        memcpy(&l, a, sizeof(float));
+        memcpy(&r, b, sizeof(float));
+        return (l > r) - (l < r);
+    }
+    case DT_BOOL:
+    {
+        bool l, r;
+        memcpy(&l, a, sizeof(bool));
+        memcpy(&r, b, sizeof(bool));
+        return (l > r) - (l < r);
+    }
+    default:
+        return strncmp(a, b, t->keySize);
+    }
+}
+
+// compares (key, RID) pairs
+static int compareEntries(BTreeMgmt *t, char *a, char *b)
+{
+    RID l, r;
+    int cmp = compareKeys(t, a, b);
+
+    if (cmp != 0)
+        return cmp;
+    memcpy(&l, a + t->keySize, sizeof(RID));
+    memcpy(&r, b + t->keySize, sizeof(RID));
+    if (l.page != r.page)
+        return (l.page > r.page) - (l.page < r.page);
+    return (l.slot > r.slot) - (l.slot < r.slot);
+}
+
+// first position whose entry is >= probe
+static int lowerBound(BTreeMgmt *t, char *node, char *probe)
+{
+    int low = 0, high = nodeGet(node, NODE_NUM_KEYS);
+
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (compareEntries(t, nodeEntry(t, node, mid), probe) < 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+// number of separators <= probe, i.e. the child that may contain probe
+static int upperBound(BTreeMgmt *t, char *node, char *probe)
+{
+    int low = 0, high = nodeGet(node, NODE_NUM_KEYS);
+
+    while (low < high)
+    {
+        int mid = (low + high) / 2;
+        if (compareEntries(t, nodeEntry(t, node, mid), probe) <= 0)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+    return low;
+}
+
+/*
+    # serializes a Value into the fixed-size key format of the tree
+*/
+static RC valueToKey(BTreeMgmt *t, Value *value, char *key)
+{
+    if (value->dt != (DataType)t->meta.keyType)
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+    memset(key, 0, t->keySize);
+    switch (value->dt)
+    {
+    case DT_INT:
+        memcpy(key, &value->v.intV, sizeof(int));
+        break;
+    case DT_FLOAT:
+        memcpy(key, &value->v.floatV, sizeof(float));
+        break;
+    case DT_BOOL:
+        memcpy(key, &value->v.boolV, sizeof(bool));
+        break;
+    case DT_STRING:
+        strncpy(key, value->v.stringV, t->keySize);
+        break;
+    }
+    return RC_OK;
+}
+
+static void makeEntry(BTreeMgmt *t, char *entry, RID rid)
+{
+    memcpy(entry + t->keySize, &rid, sizeof(RID));
+}
+
+static RC writeMeta(BTreeMgmt *t)
+{
+    BM_PageHandle page;
+    RC status = pinPage(&t->bp, &page, 0);
+
+    if (status != RC_OK)
+        return status;
+    memcpy(page.data, &t->meta, sizeof(BTreeMeta));
+    markDirty(&t->bp, &page);
+    return unpinPage(&t->bp, &page);
+}
+
+/*
+    # appends a fresh node to the index file and returns it pinned
+*/
+static RC allocateNode(BTreeMgmt *t, bool isLeaf, BM_PageHandle *page)
+{
+    RC status = pinPage(&t->bp, page, t->meta.numPages);
+
+    if (status != RC_OK)
+        return status;
+
+    t->meta.numPages++;
+    t->meta.numNodes++;
+    memset(page->data, 0, PAGE_SIZE);
+    nodeSet(page->data, NODE_IS_LEAF, isLeaf);
+    nodeSet(page->data, NODE_NUM_KEYS, 0);
+    nodeSet(page->data, NODE_NEXT, -1);
+    return markDirty(&t->bp, page);
+}
+
+/* Index manager */
+
+RC initIndexManager(void *mgmtData)
+{
+    (void)mgmtData;
+    initStorageManager();
+    return RC_OK;
+}
+
+RC shutdownIndexManager()
+{
+    return RC_OK;
+}
+
+/*
+    # creates the index file with its meta page and an empty root leaf
+*/
+RC createBtree(char *idxId, DataType keyType, int keyLength, int n)
+{
+    SM_FileHandle fHandle;
+    BTreeMeta meta;
+    char page[PAGE_SIZE];
+    RC status;
+    int keySize = keySizeOf(keyType, keyLength);
+
+    if (idxId == NULL)
+        return RC_NULL_ARGUMENT;
+    if (keySize <= 0)
+        return RC_RM_UNKOWN_DATATYPE;
+
+    // internal nodes hold maxKeys entries plus maxKeys + 1 child pointers
+    int maxFanOut = (PAGE_SIZE - NODE_HEADER_SIZE - (int)sizeof(int)) / (keySize + (int)sizeof(RID) + (int)sizeof(int));
+    if (n > maxFanOut || maxFanOut < 2)
+        return RC_IM_N_TO_LAGE;
+
+    meta.rootPage = 1;
+    meta.numNodes = 1;
+    meta.numEntries = 0;
+    meta.keyType = keyType;
+    meta.keyLength = keyLength;
+    meta.maxKeys = (n <= 0) ? maxFanOut : (n < 2 ? 2 : n);
+    meta.numPages = 2;
+
+    if ((status = createPageFile(idxId)) != RC_OK)
+        return status;
+    if ((status = openPageFile(idxId, &fHandle)) != RC_OK)
+        return status;
+
+    memset(page, 0, PAGE_SIZE);
+    memcpy(page, &meta, sizeof(BTreeMeta));
+    status = writeBlock(0, &fHandle, page);
+
+    // empty root leaf
+    memset(page, 0, PAGE_SIZE);
+    nodeSet(page, NODE_IS_LEAF, 1);
+    nodeSet(page, NODE_NUM_KEYS, 0);
+    nodeSet(page, NODE_NEXT, -1);
+    if (status == RC_OK)
+        status = ensureCapacity(2, &fHandle);
+    if (status == RC_OK)
+        status = writeBlock(1, &fHandle, page);
+
+    closePageFile(&fHandle);
+    return status;
+}
+
+RC openBtree(BTreeHandle **tree, char *idxId)
+{
+    BM_PageHandle page;
+    BTreeHandle *handle;
+    BTreeMgmt *t;
+    RC status;
+
+    if (tree == NULL || idxId == NULL)
+        return RC_NULL_ARGUMENT;
+
+    handle = (BTreeHandle *)malloc(sizeof(BTreeHandle));
+    t = (BTreeMgmt *)malloc(sizeof(BTreeMgmt));
+    if (handle == NULL || t == NULL)
+    {
+        free(handle);
+        free(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    handle->idxId = (char *)malloc(strlen(idxId) + 1);
+    strcpy(handle->idxId, idxId);
+
+    // the pool keeps a pointer to the file name, so it uses the handle's copy
+    if ((status = initBufferPool(&t->bp, handle->idxId, BT_POOL_SIZE, RS_LRU, NULL)) != RC_OK ||
+        (status = pinPage(&t->bp, &page, 0)) != RC_OK)
+    {
+        free(handle->idxId);
+        free(handle);
+        free(t);
+        return status;
+    }
+    memcpy(&t->meta, page.data, sizeof(BTreeMeta));
+    unpinPage(&t->bp, &page);
+
+    t->keySize = keySizeOf(t->meta.keyType, t->meta.keyLength);
+    t->entrySize = t->keySize + sizeof(RID);
+
+    handle->keyType = t->meta.keyType;
+    handle->mgmtData = t;
+    *tree = handle;
+    return RC_OK;
+}
+
+RC closeBtree(BTreeHandle *tree)
+{
+    BTreeMgmt *t;
+    RC status;
+
+    if (tree == NULL)
+        return RC_NULL_ARGUMENT;
+
+    t = tree->mgmtData;
+    writeMeta(t);
+    status = shutdownBufferPool(&t->bp);
+
+    free(tree->idxId);
+    free(t);
+    free(tree);
+    return status;
+}
+
+RC deleteBtree(char *idxId)
+{
+    return destroyPageFile(idxId);
+}
+
+RC getNumNodes(BTreeHandle *tree, int *result)
+{
+    *result = ((BTreeMgmt *)tree->mgmtData)->meta.numNodes;
+    return RC_OK;
+}
+
+RC getNumEntries(BTreeHandle *tree, int *result)
+{
+    *result = ((BTreeMgmt *)tree->mgmtData)->meta.numEntries;
+    return RC_OK;
+}
+
+RC getKeyType(BTreeHandle *tree, DataType *result)
+{
+    *result = tree->keyType;
+    return RC_OK;
+}
+
+/*
+    # descends from the root to the leaf that may contain probe
+    # a NULL probe follows the leftmost path
+*/
+static RC findLeaf(BTreeMgmt *t, char *probe, int *leafPage)
+{
+    BM_PageHandle page;
+    int pageNum = t->meta.rootPage;
+    RC status;
+
+    while (1)
+    {
+        if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+            return status;
+
+        if (nodeGet(page.data, NODE_IS_LEAF))
+        {
+            unpinPage(&t->bp, &page);
+            *leafPage = pageNum;
+            return RC_OK;
+        }
+
+        int child = (probe == NULL) ? 0 : upperBound(t, page.data, probe);
+        int next = nodeChild(t, page.data, child);
+        unpinPage(&t->bp, &page);
+        pageNum = next;
+    }
+}
+
+/*
+    # positions (leafPage, pos) on the first entry >= probe, walking right
+    # through empty or exhausted leaves; leafPage is -1 past the last entry
+*/
+static RC seekFirst(BTreeMgmt *t, char *probe, int *leafPage, int *pos)
+{
+    BM_PageHandle page;
+    RC status;
+
+    if ((status = findLeaf(t, probe, leafPage)) != RC_OK)
+        return status;
+
+    while (*leafPage != -1)
+    {
+        if ((status = pinPage(&t->bp, &page, *leafPage)) != RC_OK)
+            return status;
+
+        *pos = (probe == NULL) ? 0 : lowerBound(t, page.data, probe);
+        if (*pos < nodeGet(page.data, NODE_NUM_KEYS))
+        {
+            unpinPage(&t->bp, &page);
+            return RC_OK;
+        }
+
+        int next = nodeGet(page.data, NODE_NEXT);
+        unpinPage(&t->bp, &page);
+        *leafPage = next;
+    }
+    return RC_OK;
+}
+
+RC findKey(BTreeHandle *tree, Value *key, RID *result)
+{
+    BTreeMgmt *t = tree->mgmtData;
+    BM_PageHandle page;
+    int leafPage, pos;
+    bool found;
+    RC status;
+
+    char *probe = (char *)malloc(t->entrySize);
+    RID minRid = {INT_MIN, INT_MIN};
+
+    if ((status = valueToKey(t, key, probe)) != RC_OK)
+    {
+        free(probe);
+        return status;
+    }
+    makeEntry(t, probe, minRid);
+
+    if ((status = seekFirst(t, probe, &leafPage, &pos)) != RC_OK || leafPage == -1)
+    {
+        free(probe);
+        return status != RC_OK ? status : RC_IM_KEY_NOT_FOUND;
+    }
+
+    if ((status = pinPage(&t->bp, &page, leafPage)) != RC_OK)
+    {
+        free(probe);
+        return status;
+    }
+    char *entry = nodeEntry(t, page.data, pos);
+    found = compareKeys(t, entry, probe) == 0;
+    if (found)
+        memcpy(result, entry + t->keySize, sizeof(RID));
+    unpinPage(&t->bp, &page);
+
+    free(probe);
+    return found ? RC_OK : RC_IM_KEY_NOT_FOUND;
+}
+
+/*
+    # inserts entry into the leaf at pageNum, splitting it when it is full
+    # on a split *splitPage is the new right sibling and splitEntry its separator
+*/
+static RC insertIntoLeaf(BTreeMgmt *t, int pageNum, char *entry, int *splitPage, char *splitEntry)
+{
+    BM_PageHandle page, sibling;
+    RC status;
+
+    if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+        return status;
+
+    int numKeys = nodeGet(page.data, NODE_NUM_KEYS);
+    int pos = lowerBound(t, page.data, entry);
+
+    if (pos < numKeys && compareEntries(t, nodeEntry(t, page.data, pos), entry) == 0)
+    {
+        unpinPage(&t->bp, &page);
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+
+    *splitPage = -1;
+    if (numKeys < t->meta.maxKeys)
+    {
+        memmove(nodeEntry(t, page.data, pos + 1), nodeEntry(t, page.data, pos), (numKeys - pos) * t->entrySize);
+        memcpy(nodeEntry(t, page.data, pos), entry, t->entrySize);
+        nodeSet(page.data, NODE_NUM_KEYS, numKeys + 1);
+        markDirty(&t->bp, &page);
+        return unpinPage(&t->bp, &page);
+    }
+
+    // gather the maxKeys + 1 entries in order, then split them in half
+    int total = numKeys + 1;
+    int leftCount = (total + 1) / 2;
+    char *all = (char *)malloc(total * t->entrySize);
+
+    memcpy(all, nodeEntry(t, page.data, 0), pos * t->entrySize);
+    memcpy(all + pos * t->entrySize, entry, t->entrySize);
+    memcpy(all + (pos + 1) * t->entrySize, nodeEntry(t, page.data, pos), (numKeys - pos) * t->entrySize);
+
+    if ((status = allocateNode(t, true, &sibling)) != RC_OK)
+    {
+        free(all);
+        unpinPage(&t->bp, &page);
+        return status;
+    }
+
+    memcpy(nodeEntry(t, page.data, 0), all, leftCount * t->entrySize);
+    nodeSet(page.data, NODE_NUM_KEYS, leftCount);
+    memcpy(nodeEntry(t, sibling.data, 0), all + leftCount * t->entrySize, (total - leftCount) * t->entrySize);
+    nodeSet(sibling.data, NODE_NUM_KEYS, total - leftCount);
+
+    nodeSet(sibling.data, NODE_NEXT, nodeGet(page.data, NODE_NEXT));
+    nodeSet(page.data, NODE_NEXT, sibling.pageNum);
+
+    memcpy(splitEntry, nodeEntry(t, sibling.data, 0), t->entrySize);
+    *splitPage = sibling.pageNum;
+
+    free(all);
+    markDirty(&t->bp, &page);
+    unpinPage(&t->bp, &sibling);
+    return unpinPage(&t->bp, &page);
+}
+
+/*
+    # adds separator/child (the result of a split below) to the internal node at
+    # pageNum, splitting the node itself when it is full
+*/
+static RC insertIntoInternal(BTreeMgmt *t, int pageNum, int childPos, char *separator, int child,
+                             int *splitPage, char *splitEntry)
+{
+    BM_PageHandle page, sibling;
+    RC status;
+    int i;
+
+    if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+        return status;
+
+    int numKeys = nodeGet(page.data, NODE_NUM_KEYS);
+    *splitPage = -1;
+
+    if (numKeys < t->meta.maxKeys)
+    {
+        memmove(nodeEntry(t, page.data, childPos + 1), nodeEntry(t, page.data, childPos), (numKeys - childPos) * t->entrySize);
+        memcpy(nodeEntry(t, page.data, childPos), separator, t->entrySize);
+        for (i = numKeys; i > childPos; i--)
+            setNodeChild(t, page.data, i + 1, nodeChild(t, page.data, i));
+        setNodeChild(t, page.data, childPos + 1, child);
+        nodeSet(page.data, NODE_NUM_KEYS, numKeys + 1);
+        markDirty(&t->bp, &page);
+        return unpinPage(&t->bp, &page);
+    }
+
+    // maxKeys + 1 separators and maxKeys + 2 children in order
+    int total = numKeys + 1;
+    char *keys = (char *)malloc(total * t->entrySize);
+    int *children = (int *)malloc((total + 1) * sizeof(int));
+
+    memcpy(keys, nodeEntry(t, page.data, 0), childPos * t->entrySize);
+    memcpy(keys + childPos * t->entrySize, separator, t->entrySize);
+    memcpy(keys + (childPos + 1) * t->entrySize, nodeEntry(t, page.data, childPos), (numKeys - childPos) * t->entrySize);
+    for (i = 0; i <= childPos; i++)
+        children[i] = nodeChild(t, page.data, i);
+    children[childPos + 1] = child;
+    for (i = childPos + 1; i <= numKeys; i++)
+        children[i + 1] = nodeChild(t, page.data, i);
+
+    if ((status = allocateNode(t, false, &sibling)) != RC_OK)
+    {
+        free(keys);
+        free(children);
+        unpinPage(&t->bp, &page);
+        return status;
+    }
+
+    // the middle separator moves up instead of being copied
+    int leftCount = total / 2;
+    int rightCount = total - leftCount - 1;
+
+    memcpy(nodeEntry(t, page.data, 0), keys, leftCount * t->entrySize);
+    for (i = 0; i <= leftCount; i++)
+        setNodeChild(t, page.data, i, children[i]);
+    nodeSet(page.data, NODE_NUM_KEYS, leftCount);
+
+    memcpy(nodeEntry(t, sibling.data, 0), keys + (leftCount + 1) * t->entrySize, rightCount * t->entrySize);
+    for (i = 0; i <= rightCount; i++)
+        setNodeChild(t, sibling.data, i, children[leftCount + 1 + i]);
+    nodeSet(sibling.data, NODE_NUM_KEYS, rightCount);
+
+    memcpy(splitEntry, keys + leftCount * t->entrySize, t->entrySize);
+    *splitPage = sibling.pageNum;
+
+    free(keys);
+    free(children);
+    markDirty(&t->bp, &page);
+    unpinPage(&t->bp, &sibling);
+    return unpinPage(&t->bp, &page);
+}
+
+static RC insertIntoNode(BTreeMgmt *t, int pageNum, char *entry, int *splitPage, char *splitEntry)
+{
+    BM_PageHandle page;
+    RC status;
+
+    if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+        return status;
+
+    if (nodeGet(page.data, NODE_IS_LEAF))
+    {
+        unpinPage(&t->bp, &page);
+        return insertIntoLeaf(t, pageNum, entry, splitPage, splitEntry);
+    }
+
+    int childPos = upperBound(t, page.data, entry);
+    int child = nodeChild(t, page.data, childPos);
+    unpinPage(&t->bp, &page);
+
+    int childSplit;
+    char *childSeparator = (char *)malloc(t->entrySize);
+
+    status = insertIntoNode(t, child, entry, &childSplit, childSeparator);
+    *splitPage = -1;
+    if (status == RC_OK && childSplit != -1)
+        status = insertIntoInternal(t, pageNum, childPos, childSeparator, childSplit, splitPage, splitEntry);
+
+    free(childSeparator);
+    return status;
+}
+
+/*
+    # inserts (key, rid); the same key may be inserted for different RIDs
+    # returns RC_IM_KEY_ALREADY_EXISTS if exactly this pair is already indexed
+*/
+RC insertKey(BTreeHandle *tree, Value *key, RID rid)
+{
+    BTreeMgmt *t = tree->mgmtData;
+    BM_PageHandle root;
+    int splitPage;
+    RC status;
+
+    char *entry = (char *)malloc(t->entrySize);
+    char *splitEntry = (char *)malloc(t->entrySize);
+
+    if ((status = valueToKey(t, key, entry)) != RC_OK)
+        goto done;
+    makeEntry(t, entry, rid);
+
+    if ((status = insertIntoNode(t, t->meta.rootPage, entry, &splitPage, splitEntry)) != RC_OK)
+        goto done;
+
+    // the root split, grow the tree by one level
+    if (splitPage != -1)
+    {
+        if ((status = allocateNode(t, false, &root)) != RC_OK)
+            goto done;
+        memcpy(nodeEntry(t, root.data, 0), splitEntry, t->entrySize);
+        setNodeChild(t, root.data, 0, t->meta.rootPage);
+        setNodeChild(t, root.data, 1, splitPage);
+        nodeSet(root.data, NODE_NUM_KEYS, 1);
+        t->meta.rootPage = root.pageNum;
+        unpinPage(&t->bp, &root);
+    }
+
+    t->meta.numEntries++;
+    status = writeMeta(t);
+
+done:
+    free(entry);
+    free(splitEntry);
+    return status;
+}
+
+/*
+    # removes the entry at pos of the given leaf
+    # nodes are not merged on underflow; an empty leaf stays in the sibling
+    # chain until the index is rebuilt, which keeps deletes to a single page write
+*/
+static RC removeFromLeaf(BTreeMgmt *t, int leafPage, int pos)
+{
+    BM_PageHandle page;
+    RC status;
+
+    if ((status = pinPage(&t->bp, &page, leafPage)) != RC_OK)
+        return status;
+
+    int numKeys = nodeGet(page.data, NODE_NUM_KEYS);
+    memmove(nodeEntry(t, page.data, pos), nodeEntry(t, page.data, pos + 1), (numKeys - pos - 1) * t->entrySize);
+    nodeSet(page.data, NODE_NUM_KEYS, numKeys - 1);
+    markDirty(&t->bp, &page);
+    unpinPage(&t->bp, &page);
+
+    t->meta.numEntries--;
+    return writeMeta(t);
+}
+
+RC deleteEntry(BTreeHandle *tree, Value *key, RID rid)
+{
+    BTreeMgmt *t = tree->mgmtData;
+    BM_PageHandle page;
+    int leafPage, pos;
+    bool found;
+    RC status;
+
+    char *entry = (char *)malloc(t->entrySize);
+    if ((status = valueToKey(t, key, entry)) != RC_OK)
+    {
+        free(entry);
+        return status;
+    }
+    makeEntry(t, entry, rid);
+
+    if ((status = findLeaf(t, entry, &leafPage)) != RC_OK || (status = pinPage(&t->bp, &page, leafPage)) != RC_OK)
+    {
+        free(entry);
+        return status;
+    }
+    pos = lowerBound(t, page.data, entry);
+    found = pos < nodeGet(page.data, NODE_NUM_KEYS) && compareEntries(t, nodeEntry(t, page.data, pos), entry) == 0;
+    unpinPage(&t->bp, &page);
+    free(entry);
+
+    if (!found)
+        return RC_IM_KEY_NOT_FOUND;
+    return removeFromLeaf(t, leafPage, pos);
+}
+
+/*
+    # removes the first entry with the given key
+*/
+RC deleteKey(BTreeHandle *tree, Value *key)
+{
+    RID rid;
+    RC status = findKey(tree, key, &rid);
+
+    if (status != RC_OK)
+        return status;
+    return deleteEntry(tree, key, rid);
+}
+
+/* Scans */
+
+RC openTreeScan(BTreeHandle *tree, BT_ScanHandle **handle)
+{
+    return openTreeRangeScan(tree, NULL, NULL, handle);
+}
+
+/*
+    # opens a cursor over the entries with low <= key <= high in key order
+    # a NULL bound leaves that side of the range open
+*/
+RC openTreeRangeScan(BTreeHandle *tree, Value *low, Value *high, BT_ScanHandle **handle)
+{
+    BTreeMgmt *t = tree->mgmtData;
+    BTreeScanMgmt *scan;
+    char *probe = NULL;
+    RC status;
+
+    scan = (BTreeScanMgmt *)calloc(1, sizeof(BTreeScanMgmt));
+    if (scan == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if ((scan->lastEntry = (char *)malloc(t->entrySize)) == NULL)
+    {
+        free(scan);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    if (high != NULL)
+    {
+        scan->highKey = (char *)malloc(t->keySize);
+        scan->hasHigh = true;
+        if ((status = valueToKey(t, high, scan->highKey)) != RC_OK)
+            goto fail;
+    }
+
+    if (low != NULL)
+    {
+        RID minRid = {INT_MIN, INT_MIN};
+        probe = (char *)malloc(t->entrySize);
+        if ((status = valueToKey(t, low, probe)) != RC_OK)
+            goto fail;
+        makeEntry(t, probe, minRid);
+    }
+
+    if ((status = seekFirst(t, probe, &scan->leafPage, &scan->pos)) != RC_OK)
+        goto fail;
+    free(probe);
+
+    *handle = (BT_ScanHandle *)malloc(sizeof(BT_ScanHandle));
+    (*handle)->tree = tree;
+    (*handle)->mgmtData = scan;
+    return RC_OK;
+
+fail:
+    free(probe);
+    free(scan->highKey);
+    free(scan->lastEntry);
+    free(scan);
+    return status;
+}
+
+/*
+    # puts the cursor of a scan back just past the entry it returned last, if inserts or deletes
+    # of the caller moved that entry within its leaf or to another leaf since
+*/
+static RC resumeScan(BTreeMgmt *t, BTreeScanMgmt *scan)
+{
+    BM_PageHandle page;
+    bool moved;
+    RC status;
+
+    if (!scan->hasLast || scan->leafPage == -1)
+        return RC_OK;
+    if ((status = pinPage(&t->bp, &page, scan->leafPage)) != RC_OK)
+        return status;
+    moved = scan->pos == 0 || scan->pos > nodeGet(page.data, NODE_NUM_KEYS) ||
+            compareEntries(t, nodeEntry(t, page.data, scan->pos - 1), scan->lastEntry) != 0;
+    unpinPage(&t->bp, &page);
+    if (!moved)
+        return RC_OK;
+
+    // Entries are unique, the one returned last is skipped if it is still in the tree
+    if ((status = seekFirst(t, scan->lastEntry, &scan->leafPage, &scan->pos)) != RC_OK || scan->leafPage == -1)
+        return status;
+    if ((status = pinPage(&t->bp, &page, scan->leafPage)) != RC_OK)
+        return status;
+    if (compareEntries(t, nodeEntry(t, page.data, scan->pos), scan->lastEntry) == 0)
+        scan->pos++;
+    return unpinPage(&t->bp, &page);
+}
+
+RC nextEntry(BT_ScanHandle *handle, RID *result)
+{
+    BTreeMgmt *t = handle->tree->mgmtData;
+    BTreeScanMgmt *scan = handle->mgmtData;
+    BM_PageHandle page;
+    RC status;
+
+    if ((status = resumeScan(t, scan)) != RC_OK)
+        return status;
+    while (scan->leafPage != -1)
+    {
+        if ((status = pinPage(&t->bp, &page, scan->leafPage)) != RC_OK)
+            return status;
+
+        if (scan->pos >= nodeGet(page.data, NODE_NUM_KEYS))
+        {
+            scan->leafPage = nodeGet(page.data, NODE_NEXT);
+            scan->pos = 0;
+            unpinPage(&t->bp, &page);
+            continue;
+        }
+
+        char *entry = nodeEntry(t, page.data, scan->pos);
+        if (scan->hasHigh && compareKeys(t, entry, scan->highKey) > 0)
+        {
+            scan->leafPage = -1;
+            unpinPage(&t->bp, &page);
+            break;
+        }
+
+        memcpy(result, entry + t->keySize, sizeof(RID));
+        memcpy(scan->lastEntry, entry, t->entrySize);
+        scan->hasLast = true;
+        scan->pos++;
+        return unpinPage(&t->bp, &page);
+    }
+
+    return RC_IM_NO_MORE_ENTRIES;
+}
+
+RC closeTreeScan(BT_ScanHandle *handle)
+{
+    BTreeScanMgmt *scan;
+
+    if (handle == NULL)
+        return RC_NULL_ARGUMENT;
+
+    scan = handle->mgmtData;
+    free(scan->highKey);
+    free(scan->lastEntry);
+    free(scan);
+    free(handle);
+    return RC_OK;
+}
+
+/* Debugging */
+
+static void appendKey(BTreeMgmt *t, char *entry, char **buf, int *len, int *cap)
+{
+    char tmp[PAGE_SIZE];
+    RID rid;
+
+    switch (t->meta.keyType)
+    {
+    case DT_INT:
+    {
+        int v;
+        memcpy(&v, entry, sizeof(int));
+        sprintf(tmp, "%d", v);
+        break;
+    }
+    case DT_FLOAT:
+    {
+        float v;
+        memcpy(&v, entry, sizeof(float));
+        sprintf(tmp, "%f", v);
+        break;
+    }
+    case DT_BOOL:
+    {
+        bool v;
+        memcpy(&v, entry, sizeof(bool));
+        sprintf(tmp, "%s", v ? "true" : "false");
+        break;
+    }
+    default:
+        sprintf(tmp, "%.*s", t->keySize, entry);
+        break;
+    }
+    memcpy(&rid, entry + t->keySize, sizeof(RID));
+    sprintf(tmp + strlen(tmp), "@%d.%d", rid.page, rid.slot);
+
+    int add = strlen(tmp);
+    while (*len + add + 64 > *cap)
+    {
+        *cap *= 2;
+        *buf = realloc(*buf, *cap);
+    }
+    memcpy(*buf + *len, tmp, add + 1);
+    *len += add;
+}
+
+static void printNode(BTreeMgmt *t, int pageNum, char **buf, int *len, int *cap)
+{
+    BM_PageHandle page;
+    int i;
+
+    if (pinPage(&t->bp, &page, pageNum) != RC_OK)
+        return;
+
+    char *node = (char *)malloc(PAGE_SIZE);
+    memcpy(node, page.data, PAGE_SIZE);
+    unpinPage(&t->bp, &page);
+
+    int numKeys = nodeGet(node, NODE_NUM_KEYS);
+    bool leaf = nodeGet(node, NODE_IS_LEAF);
+
+    *len += sprintf(*buf + *len, "(%d)[", pageNum);
+    for (i = 0; i < numKeys; i++)
+    {
+        if (!leaf)
+            *len += sprintf(*buf + *len, "%d,", nodeChild(t, node, i));
+        appendKey(t, nodeEntry(t, node, i), buf, len, cap);
+        if (leaf || i < numKeys - 1)
+            *len += sprintf(*buf + *len, ",");
+    }
+    if (!leaf)
+        *len += sprintf(*buf + *len, ",%d", nodeChild(t, node, numKeys));
+    else
+        *len += sprintf(*buf + *len, "%d", nodeGet(node, NODE_NEXT));
+    *len += sprintf(*buf + *len, "]\n");
+
+    if (!leaf)
+        for (i = 0; i <= numKeys; i++)
+            printNode(t, nodeChild(t, node, i), buf, len, cap);
+    free(node);
+}
+
+/*
+    # returns one line per node in depth-first order: (page)[child,key,child,...]
+    # for internal nodes and (page)[key,key,...,next] for leaves
+*/
+char *printTree(BTreeHandle *tree)
+{
+    BTreeMgmt *t = tree->mgmtData;
+    int cap = PAGE_SIZE, len = 0;
+    char *buf = (char *)malloc(cap);
+
+    buf[0] = '\0';
+    printNode(t, t->meta.rootPage, &buf, &len, &cap);
+    return buf;
+}
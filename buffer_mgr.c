@@ -2,347 +2,927 @@
 #include <stdlib.h>
 #include <string.h>
 #include <limits.h>
+#include <pthread.h>
 #include "buffer_mgr.h"
 #include "storage_mgr.h"
 
 #define RC_STRATEGY_NOT_IMPLEMENTED 5
+// Unchanged runs shorter than this between two changed byte ranges of a page are logged
+// with them, which is cheaper than the header of another range
+#define CHANGE_GAP 16
+
+struct PoolMgmt;
 
 typedef struct MemoryBlock
 {
     SM_PageHandle content;
+    struct PoolMgmt *owner; // pool whose page file the frame holds a page of
     PageNumber id;
     int is_dirty;
     int pin_count;
     int lru_counter;
     int freq_counter;
+    long lsn; // log record of the last change of the page, 0 if it has none
+    long rec_lsn; // log record of the first change since the page was last written, 0 if it has none
 } MemorySlot;
 
-static int cache_size, disk_accesses;
-static int disk_updates, hit_pos;
-static int circular_counter;
+// Page pinned during an operation whose changes are logged, with its bytes from before
+typedef struct PageCapture
+{
+    PageNumber pageNum;
+    char *before;
+    bool changed;
+} PageCapture;
+
+// Bookkeeping of a single buffer pool, stored in BM_BufferPool.mgmtData so that
+// several pools (a table and its indexes) can be open at the same time
+// A pool attached to a shared pool has no frames of its own, it uses the frames and
+// replacement state of the shared pool and only keeps its page file and I/O counts
+typedef struct PoolMgmt
+{
+    MemorySlot *slots;
+    int disk_accesses;
+    int disk_updates;
+    int hit_pos;
+    int circular_counter;
+    char *page_file;
+    SM_FileHandle file_handle;
+    bool file_open;
+    struct PoolMgmt *frames; // pool owning the frames, the pool itself unless it is attached
+    int num_attached;        // pools attached to this one
+    pthread_mutex_t lock;    // serializes access to the frames, only used in the pool owning them
+    BM_LogFlush log_flush;   // called before a frame of the pool with an LSN is written
+    bool capturing;          // between beginPageChanges and endPageChanges
+    long capture_lsn;        // end of the log at beginPageChanges
+    PageCapture *captured;
+    int num_captured;
+    int max_captured;
+    BM_PageChange *changes;
+    int num_changes;
+    int max_changes;
+} PoolMgmt;
+
+/*
+    # Opens the page file of the pool on first use and keeps it open
+    # until the pool is shut down
+*/
+static RC openPoolFile(PoolMgmt *pool)
+{
+    if (pool->file_open)
+        return RC_OK;
+    if (pool->page_file == NULL)
+        return RC_FILE_NOT_FOUND;
 
-void copyMemorySlot(MemorySlot *target, int pos, MemorySlot *source)
+    RC status = openPageFile(pool->page_file, &pool->file_handle);
+    if (status == RC_OK)
+        pool->file_open = true;
+    return status;
+}
+
+/*
+    # True if frame i is part of the view of pool: every frame for a pool with its own
+    # frames, only the frames holding its pages for an attached pool
+*/
+static bool inPool(PoolMgmt *pool, int i)
 {
-    target[pos].content = source->content;
-    target[pos].is_dirty = source->is_dirty;
-    target[pos].pin_count = source->pin_count;
-    target[pos].id = source->id;
-    target[pos].lru_counter = source->lru_counter;
-    target[pos].freq_counter = source->freq_counter;
+    return pool->frames == pool || pool->frames->slots[i].owner == pool;
 }
 
-void flushMemorySlot(BM_BufferPool *const bm, MemorySlot *slot, int index)
+/*
+    # Index of the frame holding page pageNum of pool, or -1
+*/
+static int findFrame(BM_BufferPool *const bm, PoolMgmt *pool, PageNumber pageNum)
 {
-    SM_FileHandle file_handle;
-    openPageFile(bm->pageFile, &file_handle);
-    writeBlock(slot[index].id, &file_handle, slot[index].content);
-    disk_updates++;
+    MemorySlot *slots = pool->frames->slots;
+
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (slots[i].id == pageNum && slots[i].id != NO_PAGE && slots[i].owner == pool)
+            return i;
+    }
+    return -1;
+}
+
+/*
+    # Writes frame index back to the page file of the pool owning it,
+    # which for a shared pool need not be the pool that asked for the write
+*/
+RC flushMemorySlot(PoolMgmt *frames, int index)
+{
+    PoolMgmt *owner = frames->slots[index].owner;
+    RC status = openPoolFile(owner);
+    if (status != RC_OK)
+        return status;
+
+    // Write-ahead rule: the log record of the last change goes to disk before the page
+    if (frames->slots[index].lsn > 0 && owner->log_flush != NULL &&
+        (status = owner->log_flush(frames->slots[index].lsn)) != RC_OK)
+        return status;
+
+    status = writeBlock(frames->slots[index].id, &owner->file_handle, frames->slots[index].content);
+    if (status != RC_OK)
+        return status;
+
+    frames->slots[index].is_dirty = 0;
+    frames->slots[index].rec_lsn = 0;
+    owner->disk_updates++;
+    if (frames != owner)
+        frames->disk_updates++;
+    return RC_OK;
 }
 
-void FirstInFirstOutReplacement(BM_BufferPool *const bm, MemorySlot *new_slot)
+int FirstInFirstOutReplacement(BM_BufferPool *const bm, PoolMgmt *pool)
 {
-    int current_pos = disk_accesses % cache_size;
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    int current_pos = pool->disk_accesses % bm->numPages;
 
-    for (int i = 0; i < cache_size; i++)
+    for (int i = 0; i < bm->numPages; i++)
     {
-        if (slots[current_pos].pin_count == 0)
-        {
-            if (slots[current_pos].is_dirty)
-                flushMemorySlot(bm, slots, current_pos);
-            copyMemorySlot(slots, current_pos, new_slot);
-            return;
-        }
-        current_pos = (current_pos + 1) % cache_size;
+        if (pool->slots[current_pos].pin_count == 0)
+            return current_pos;
+        current_pos = (current_pos + 1) % bm->numPages;
     }
+    return -1;
 }
 
-void LeastRecentlyUsedReplacement(BM_BufferPool *const bm, MemorySlot *new_slot)
+int LeastRecentlyUsedReplacement(BM_BufferPool *const bm, PoolMgmt *pool)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
     int index = -1;
     int min_counter = INT_MAX;
 
-    for (int j = 0; j < cache_size; j++)
+    for (int j = 0; j < bm->numPages; j++)
     {
-        if (slots[j].pin_count == 0 && slots[j].lru_counter < min_counter)
+        if (pool->slots[j].pin_count == 0 && pool->slots[j].lru_counter < min_counter)
         {
-            min_counter = slots[j].lru_counter;
+            min_counter = pool->slots[j].lru_counter;
             index = j;
         }
     }
-
-    if (index != -1)
-    {
-        if (slots[index].is_dirty)
-            flushMemorySlot(bm, slots, index);
-        copyMemorySlot(slots, index, new_slot);
-    }
+    return index;
 }
 
-void ClockReplacement(BM_BufferPool *const bm, MemorySlot *new_slot)
+int ClockReplacement(BM_BufferPool *const bm, PoolMgmt *pool)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
-
-    while (1)
+    // Two full sweeps clear every reference bit, after that only pinned frames remain
+    for (int i = 0; i < 2 * bm->numPages; i++)
     {
-        circular_counter %= cache_size;
+        int pos = pool->circular_counter;
+        pool->circular_counter = (pool->circular_counter + 1) % bm->numPages;
 
-        if (slots[circular_counter].lru_counter != 0)
-            slots[circular_counter].lru_counter = 0;
-        else if (slots[circular_counter].is_dirty)
-            flushMemorySlot(bm, slots, circular_counter);
+        if (pool->slots[pos].pin_count != 0)
+            continue;
+        if (pool->slots[pos].lru_counter != 0)
+            pool->slots[pos].lru_counter = 0;
         else
-        {
-            copyMemorySlot(slots, circular_counter, new_slot);
-            circular_counter++;
-            break;
-        }
-        circular_counter++;
+            return pos;
     }
+    return -1;
 }
 
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
                   const int numPages, ReplacementStrategy strategy,
                   void *stratData)
 {
-    MemorySlot *slots = malloc(sizeof(MemorySlot) * numPages);
-    if (!slots)
+    PoolMgmt *pool = malloc(sizeof(PoolMgmt));
+    if (!pool)
         return RC_FAILED_BUFF_POOL_INIT;
 
-    cache_size = numPages;
+    pool->slots = malloc(sizeof(MemorySlot) * numPages);
+    if (!pool->slots)
+    {
+        free(pool);
+        return RC_FAILED_BUFF_POOL_INIT;
+    }
+
     bm->pageFile = (char *)pageFileName;
     bm->numPages = numPages;
     bm->strategy = strategy;
 
-    for (int i = 0; i < cache_size; i++)
+    for (int i = 0; i < numPages; i++)
     {
-        slots[i].id = NO_PAGE;
-        slots[i].lru_counter = 0;
-        slots[i].freq_counter = 0;
-        slots[i].is_dirty = 0;
-        slots[i].pin_count = 0;
-        slots[i].content = NULL;
+        pool->slots[i].id = NO_PAGE;
+        pool->slots[i].owner = pool;
+        pool->slots[i].lru_counter = 0;
+        pool->slots[i].freq_counter = 0;
+        pool->slots[i].is_dirty = 0;
+        pool->slots[i].pin_count = 0;
+        pool->slots[i].content = NULL;
+        pool->slots[i].lsn = 0;
+        pool->slots[i].rec_lsn = 0;
     }
 
-    bm->mgmtData = slots;
-    circular_counter = 0;
-    disk_updates = 0;
-    disk_accesses = 0;
-
+    pool->circular_counter = 0;
+    pool->disk_updates = 0;
+    pool->disk_accesses = 0;
+    pool->hit_pos = 0;
+    pool->page_file = (char *)pageFileName;
+    pool->file_open = false;
+    pool->frames = pool;
+    pool->num_attached = 0;
+    pool->log_flush = NULL;
+    pool->capturing = false;
+    pool->captured = NULL;
+    pool->num_captured = 0;
+    pool->max_captured = 0;
+    pool->changes = NULL;
+    pool->num_changes = 0;
+    pool->max_changes = 0;
+    pthread_mutex_init(&pool->lock, NULL);
+
+    bm->mgmtData = pool;
     return RC_OK;
 }
 
-RC shutdownBufferPool(BM_BufferPool *const bm)
+/*
+    # Opens a pool on pageFileName that has no frames of its own and competes for the
+    # frames of shared with every other pool attached to it, under the strategy of shared
+    # shared is a pool set up with initBufferPool, its page file may be NULL
+*/
+RC attachBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
+                    BM_BufferPool *const shared)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
-    forceFlushPool(bm);
-
-    for (int i = 0; i < cache_size; i++)
-    {
-        if (slots[i].pin_count != 0)
-            return RC_PAGE_PINNED;
-    }
+    PoolMgmt *frames = (PoolMgmt *)shared->mgmtData;
+    PoolMgmt *pool = calloc(1, sizeof(PoolMgmt));
+    if (!pool)
+        return RC_FAILED_BUFF_POOL_INIT;
 
-    free(slots);
-    bm->mgmtData = NULL;
+    bm->pageFile = (char *)pageFileName;
+    bm->numPages = shared->numPages;
+    bm->strategy = shared->strategy;
+
+    pool->slots = frames->slots;
+    pool->page_file = (char *)pageFileName;
+    pool->file_open = false;
+    pool->frames = frames;
+    pthread_mutex_lock(&frames->lock);
+    frames->num_attached++;
+    pthread_mutex_unlock(&frames->lock);
+
+    bm->mgmtData = pool;
     return RC_OK;
 }
 
-RC forceFlushPool(BM_BufferPool *const bm)
+/*
+    # Writes every unpinned dirty frame of the pool back, the caller holds the lock of the frames
+*/
+static RC flushPool(BM_BufferPool *const bm, PoolMgmt *pool)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    MemorySlot *slots = pool->frames->slots;
 
-    for (int i = 0; i < cache_size; i++)
+    for (int i = 0; i < bm->numPages; i++)
     {
-        if (slots[i].is_dirty && slots[i].pin_count == 0)
+        if (inPool(pool, i) && slots[i].is_dirty && slots[i].pin_count == 0)
         {
-            flushMemorySlot(bm, slots, i);
-            slots[i].is_dirty = 0;
+            RC status = flushMemorySlot(pool->frames, i);
+            if (status != RC_OK)
+                return status;
         }
     }
 
     return RC_OK;
 }
 
-RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
+RC shutdownBufferPool(BM_BufferPool *const bm)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    PoolMgmt *frames = pool->frames;
+    MemorySlot *slots = frames->slots;
 
-    for (int i = 0; i < cache_size; i++)
+    pthread_mutex_lock(&frames->lock);
+    flushPool(bm, pool);
+
+    // The frames of a shared pool stay in use until every attached pool is shut down
+    if (pool->num_attached > 0)
     {
-        if (slots[i].id == page->pageNum)
+        pthread_mutex_unlock(&frames->lock);
+        return RC_PAGE_PINNED;
+    }
+
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (inPool(pool, i) && slots[i].pin_count != 0)
         {
-            slots[i].is_dirty = 1;
-            return RC_OK;
+            pthread_mutex_unlock(&frames->lock);
+            return RC_PAGE_PINNED;
+        }
+    }
+
+    if (frames != pool)
+    {
+        // Hand the frames of the pages of an attached pool back to the shared pool
+        for (int i = 0; i < bm->numPages; i++)
+        {
+            if (slots[i].owner == pool)
+            {
+                slots[i].id = NO_PAGE;
+                slots[i].is_dirty = 0;
+                slots[i].lsn = 0;
+                slots[i].rec_lsn = 0;
+                slots[i].owner = frames;
+            }
         }
+        frames->num_attached--;
+        pthread_mutex_unlock(&frames->lock);
+    }
+    else
+    {
+        for (int i = 0; i < bm->numPages; i++)
+            free(slots[i].content);
+        free(pool->slots);
+        pthread_mutex_unlock(&pool->lock);
+        pthread_mutex_destroy(&pool->lock);
     }
 
-    return RC_ERROR;
+    if (pool->file_open)
+        closePageFile(&pool->file_handle);
+
+    for (int i = 0; i < pool->max_captured; i++)
+        free(pool->captured[i].before);
+    free(pool->captured);
+    free(pool->changes);
+    free(pool);
+    bm->mgmtData = NULL;
+    return RC_OK;
 }
 
-RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
+RC forceFlushPool(BM_BufferPool *const bm)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    RC status = flushPool(bm, pool);
+    pthread_mutex_unlock(&pool->frames->lock);
+    return status;
+}
+
+/*
+    # forceFlushPool that also waits until the page file of the pool is on disk
+*/
+RC syncPool(BM_BufferPool *const bm)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    RC status = flushPool(bm, pool);
+    if (status == RC_OK && (status = openPoolFile(pool)) == RC_OK)
+        status = syncPageFile(&pool->file_handle);
+    pthread_mutex_unlock(&pool->frames->lock);
+    return status;
+}
+
+RC markDirty(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    int i = findFrame(bm, pool, page->pageNum);
+    if (i != -1)
+        pool->frames->slots[i].is_dirty = 1;
+    pthread_mutex_unlock(&pool->frames->lock);
+
+    return i == -1 ? RC_ERROR : RC_OK;
+}
 
-    for (int i = 0; i < cache_size; i++)
+/*
+    # drops a page the current operation only read from its captured pages together with the extra
+    # pin, so that reading many pages does not pin them all; the caller holds the lock of the frames
+*/
+static void releaseUnchanged(PoolMgmt *pool, MemorySlot *slot)
+{
+    for (int i = 0; i < pool->num_captured; i++)
     {
-        if (slots[i].id == page->pageNum)
-        {
-            slots[i].pin_count--;
-            return RC_OK;
-        }
+        PageCapture *capture = &pool->captured[i];
+        if (capture->pageNum != slot->id)
+            continue;
+        if (memcmp(capture->before, slot->content, PAGE_SIZE) != 0)
+            return;
+
+        // The last capture takes the place, the copy buffers stay with the pool
+        PageCapture last = pool->captured[pool->num_captured - 1];
+        pool->captured[pool->num_captured - 1] = *capture;
+        *capture = last;
+        pool->num_captured--;
+        slot->pin_count--;
+        return;
     }
+}
+
+RC unpinPage(BM_BufferPool *const bm, BM_PageHandle *const page)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    int i = findFrame(bm, pool, page->pageNum);
+    if (i != -1 && pool->frames->slots[i].pin_count > 0)
+        pool->frames->slots[i].pin_count--;
+    if (i != -1 && pool->capturing && pool->frames->slots[i].pin_count == 1)
+        releaseUnchanged(pool, &pool->frames->slots[i]);
+    pthread_mutex_unlock(&pool->frames->lock);
     return RC_OK; // Consider returning an error if the page was not found
 }
 
 RC forcePage(BM_BufferPool *const bm, BM_PageHandle *const page)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    RC status = RC_OK; // Consider returning an error if the page was not found
+
+    pthread_mutex_lock(&pool->frames->lock);
+    int i = findFrame(bm, pool, page->pageNum);
+    if (i != -1)
+        status = flushMemorySlot(pool->frames, i);
+    pthread_mutex_unlock(&pool->frames->lock);
+    return status;
+}
 
-    for (int i = 0; i < cache_size; i++)
+/*
+    # keeps a copy of a frame as it is before the changes of the current operation and an extra
+    # pin on it until endPageChanges, the caller holds the lock of the frames
+*/
+static RC capturePage(PoolMgmt *pool, MemorySlot *slot)
+{
+    for (int i = 0; i < pool->num_captured; i++)
     {
-        if (page->pageNum == slots[i].id)
-        {
-            flushMemorySlot(bm, slots, i);
-            slots[i].is_dirty = 0;
+        if (pool->captured[i].pageNum == slot->id)
             return RC_OK;
-        }
     }
 
-    return RC_OK; // Consider returning an error if the page was not found
+    if (pool->num_captured == pool->max_captured)
+    {
+        int max = pool->max_captured > 0 ? 2 * pool->max_captured : 8;
+        PageCapture *grown = realloc(pool->captured, sizeof(PageCapture) * max);
+        if (!grown)
+            return RC_MEM_ALLOCATION_FAIL;
+        for (int i = pool->max_captured; i < max; i++)
+            grown[i].before = NULL;
+        pool->captured = grown;
+        pool->max_captured = max;
+    }
+
+    PageCapture *capture = &pool->captured[pool->num_captured];
+    if (capture->before == NULL && (capture->before = malloc(PAGE_SIZE)) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(capture->before, slot->content, PAGE_SIZE);
+    capture->pageNum = slot->id;
+    capture->changed = false;
+    slot->pin_count++;
+    pool->num_captured++;
+    return RC_OK;
 }
 
-RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
-           const PageNumber pageNum)
+/*
+    # pinPage for a caller holding the lock of the frames
+*/
+static RC pinPageLocked(BM_BufferPool *const bm, BM_PageHandle *const page,
+                        const PageNumber pageNum)
 {
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
-    SM_FileHandle file_handle;
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    PoolMgmt *frames = pool->frames;
+    MemorySlot *slots = frames->slots;
+    RC status;
 
-    for (int i = 0; i < cache_size; i++)
+    int hit = findFrame(bm, pool, pageNum);
+    if (hit != -1)
     {
-        if (slots[i].id == pageNum)
+        slots[hit].pin_count++;
+        frames->hit_pos++;
+        slots[hit].lru_counter = (bm->strategy == RS_LRU) ? frames->hit_pos : 1;
+        page->data = slots[hit].content;
+        page->pageNum = pageNum;
+        if (pool->capturing && (status = capturePage(pool, &slots[hit])) != RC_OK)
         {
-            slots[i].pin_count++;
-            hit_pos++;
-            slots[i].lru_counter = (bm->strategy == RS_LRU) ? hit_pos : 1;
-            page->data = slots[i].content;
-            page->pageNum = pageNum;
-            return RC_OK;
+            slots[hit].pin_count--;
+            return status;
         }
+        return RC_OK;
     }
 
-    int empty_slot = -1;
-    for (int i = 0; i < cache_size; i++)
+    // Prefer an empty frame, otherwise ask the replacement strategy for a victim
+    int frame = -1;
+    for (int i = 0; i < bm->numPages; i++)
     {
         if (slots[i].id == NO_PAGE)
         {
-            empty_slot = i;
+            frame = i;
             break;
         }
     }
 
-    if (empty_slot != -1)
+    if (frame == -1)
     {
-        openPageFile(bm->pageFile, &file_handle);
-        slots[empty_slot].content = (SM_PageHandle)malloc(PAGE_SIZE);
-        readBlock(pageNum, &file_handle, slots[empty_slot].content);
-        slots[empty_slot].pin_count = 1;
-        slots[empty_slot].id = pageNum;
-        slots[empty_slot].freq_counter = 0;
-        disk_accesses++;
-        hit_pos++;
-        slots[empty_slot].lru_counter = (bm->strategy == RS_LRU) ? hit_pos : 1;
-        page->pageNum = pageNum;
-        page->data = slots[empty_slot].content;
-        return RC_OK;
+        switch (bm->strategy)
+        {
+        case RS_FIFO:
+            frame = FirstInFirstOutReplacement(bm, frames);
+            break;
+        case RS_LRU:
+            frame = LeastRecentlyUsedReplacement(bm, frames);
+            break;
+        case RS_CLOCK:
+            frame = ClockReplacement(bm, frames);
+            break;
+        default:
+            return RC_STRATEGY_NOT_IMPLEMENTED;
+        }
+
+        // Every frame is pinned
+        if (frame == -1)
+            return RC_ERROR;
+
+        if (slots[frame].is_dirty && (status = flushMemorySlot(frames, frame)) != RC_OK)
+            return status;
+        slots[frame].id = NO_PAGE;
     }
 
-    // Memory allocation for new slot
-    MemorySlot *new_slot = (MemorySlot *)malloc(sizeof(MemorySlot));
-    if (!new_slot)
-        return RC_MEM_ALLOCATION_FAIL; // Handle allocation failure
+    if ((status = openPoolFile(pool)) != RC_OK)
+        return status;
+
+    // Pinning a page past the end of the file appends empty pages up to it
+    if (pageNum >= pool->file_handle.totalNumPages &&
+        (status = ensureCapacity(pageNum + 1, &pool->file_handle)) != RC_OK)
+        return status;
 
-    openPageFile(bm->pageFile, &file_handle);
-    new_slot->content = (SM_PageHandle)malloc(PAGE_SIZE);
-    if (!new_slot->content)
+    if (slots[frame].content == NULL)
     {
-        free(new_slot); // Clean up if allocation fails
-        return RC_MEM_ALLOCATION_FAIL;
+        slots[frame].content = (SM_PageHandle)malloc(PAGE_SIZE);
+        if (!slots[frame].content)
+            return RC_MEM_ALLOCATION_FAIL;
     }
 
-    readBlock(pageNum, &file_handle, new_slot->content);
-    new_slot->id = pageNum;
-    new_slot->pin_count = 1;
-    new_slot->is_dirty = 0;
-    new_slot->freq_counter = 0;
-    hit_pos++;
-    disk_accesses++;
-    new_slot->lru_counter = (bm->strategy == RS_LRU) ? hit_pos : 1;
-
-    // Call the replacement strategy
-    switch (bm->strategy)
+    if ((status = readBlock(pageNum, &pool->file_handle, slots[frame].content)) != RC_OK)
     {
-    case RS_FIFO:
-        FirstInFirstOutReplacement(bm, new_slot);
-        break;
-    case RS_LRU:
-        LeastRecentlyUsedReplacement(bm, new_slot);
-        break;
-    case RS_CLOCK:
-        ClockReplacement(bm, new_slot);
-        break;
-    default:
-        free(new_slot->content);
-        free(new_slot);
-        return RC_STRATEGY_NOT_IMPLEMENTED;
+        slots[frame].id = NO_PAGE;
+        return status;
     }
 
-    page->pageNum = pageNum;
-    page->data = new_slot->content;
+    slots[frame].id = pageNum;
+    slots[frame].owner = pool;
+    slots[frame].pin_count = 1;
+    slots[frame].is_dirty = 0;
+    slots[frame].freq_counter = 0;
+    slots[frame].lsn = 0;
+    slots[frame].rec_lsn = 0;
+    pool->disk_accesses++;
+    if (frames != pool)
+        frames->disk_accesses++;
+    frames->hit_pos++;
+    slots[frame].lru_counter = (bm->strategy == RS_LRU) ? frames->hit_pos : 1;
 
+    page->pageNum = pageNum;
+    page->data = slots[frame].content;
+    if (pool->capturing && (status = capturePage(pool, &slots[frame])) != RC_OK)
+    {
+        slots[frame].pin_count--;
+        return status;
+    }
     return RC_OK;
 }
 
+RC pinPage(BM_BufferPool *const bm, BM_PageHandle *const page,
+           const PageNumber pageNum)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    RC status = pinPageLocked(bm, page, pageNum);
+    pthread_mutex_unlock(&pool->frames->lock);
+    return status;
+}
+
 PageNumber *getFrameContents(BM_BufferPool *const bm)
 {
-    PageNumber *frame_contents = (PageNumber *)malloc(sizeof(PageNumber) * cache_size);
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    PageNumber *frame_contents = (PageNumber *)malloc(sizeof(PageNumber) * bm->numPages);
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
 
-    for (int i = 0; i < cache_size; i++)
-        frame_contents[i] = slots[i].id;
+    for (int i = 0; i < bm->numPages; i++)
+        frame_contents[i] = inPool(pool, i) ? pool->frames->slots[i].id : NO_PAGE;
 
     return frame_contents;
 }
 
 bool *getDirtyFlags(BM_BufferPool *const bm)
 {
-    bool *dirty_flags = malloc(sizeof(bool) * cache_size);
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    bool *dirty_flags = malloc(sizeof(bool) * bm->numPages);
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
 
-    for (int i = 0; i < cache_size; i++)
-        dirty_flags[i] = slots[i].is_dirty;
+    for (int i = 0; i < bm->numPages; i++)
+        dirty_flags[i] = inPool(pool, i) && pool->frames->slots[i].is_dirty;
 
     return dirty_flags;
 }
 
 int *getFixCounts(BM_BufferPool *const bm)
 {
-    int *fix_counts = malloc(sizeof(int) * cache_size);
-    MemorySlot *slots = (MemorySlot *)bm->mgmtData;
+    int *fix_counts = malloc(sizeof(int) * bm->numPages);
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
 
-    for (int i = 0; i < cache_size; i++)
-        fix_counts[i] = slots[i].pin_count;
+    for (int i = 0; i < bm->numPages; i++)
+        fix_counts[i] = inPool(pool, i) ? pool->frames->slots[i].pin_count : 0;
 
     return fix_counts;
 }
 
 int getNumReadIO(BM_BufferPool *const bm)
 {
-    return disk_accesses; // Simplified return
+    return ((PoolMgmt *)bm->mgmtData)->disk_accesses;
 }
 
 int getNumWriteIO(BM_BufferPool *const bm)
 {
-    return disk_updates;
+    return ((PoolMgmt *)bm->mgmtData)->disk_updates;
+}
+
+/*
+    # Returns the number of pages in the pool's page file, or -1 if it cannot be opened
+*/
+int getNumFilePages(BM_BufferPool *const bm)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    int numPages = -1;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    if (openPoolFile(pool) == RC_OK)
+        numPages = pool->file_handle.totalNumPages;
+    pthread_mutex_unlock(&pool->frames->lock);
+    return numPages;
+}
+
+/*
+    # Drops the frames of the pages at and after numPages and shortens the page file to numPages pages
+    # Fails with RC_PAGE_PINNED, before changing anything, if one of those pages is pinned
+*/
+RC truncatePool(BM_BufferPool *const bm, const int numPages)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    MemorySlot *slots = pool->frames->slots;
+    RC status;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (slots[i].owner == pool && slots[i].id >= numPages && slots[i].pin_count != 0)
+        {
+            pthread_mutex_unlock(&pool->frames->lock);
+            return RC_PAGE_PINNED;
+        }
+    }
+
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (slots[i].owner == pool && slots[i].id >= numPages)
+        {
+            slots[i].id = NO_PAGE;
+            slots[i].is_dirty = 0;
+            slots[i].lsn = 0;
+            slots[i].rec_lsn = 0;
+        }
+    }
+
+    if ((status = openPoolFile(pool)) == RC_OK)
+        status = truncatePageFile(numPages, &pool->file_handle);
+    pthread_mutex_unlock(&pool->frames->lock);
+    return status;
+}
+
+/*
+    # Sets the function that makes the log durable before a frame of the pool is written
+*/
+RC setLogFlush(BM_BufferPool *const bm, BM_LogFlush logFlush)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    pool->log_flush = logFlush;
+    pthread_mutex_unlock(&pool->frames->lock);
+    return RC_OK;
+}
+
+/*
+    # Starts an operation whose changes are logged: from now on every page of the pool that is
+    # pinned is copied first and stays pinned until endPageChanges
+    # lsn is the end of the log, the record of the changes will come after it
+*/
+RC beginPageChanges(BM_BufferPool *const bm, long lsn)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    pool->capturing = true;
+    pool->capture_lsn = lsn;
+    pool->num_captured = 0;
+    pool->num_changes = 0;
+    pthread_mutex_unlock(&pool->frames->lock);
+    return RC_OK;
+}
+
+/*
+    # Adds a byte range of a page to the changes of the pool, the caller holds the lock of the frames
+*/
+static RC addPageChange(PoolMgmt *pool, PageNumber pageNum, char *content, int from, int to)
+{
+    if (pool->num_changes == pool->max_changes)
+    {
+        int max = pool->max_changes > 0 ? 2 * pool->max_changes : 16;
+        BM_PageChange *grown = realloc(pool->changes, sizeof(BM_PageChange) * max);
+        if (!grown)
+            return RC_MEM_ALLOCATION_FAIL;
+        pool->changes = grown;
+        pool->max_changes = max;
+    }
+
+    BM_PageChange *change = &pool->changes[pool->num_changes++];
+    change->pageNum = pageNum;
+    change->offset = from;
+    change->length = to - from;
+    change->data = content + from;
+    return RC_OK;
+}
+
+/*
+    # Returns the byte ranges the current operation changed in the pages it pinned, as they are now
+    # the data of the changes points into the frames, which stay pinned until endPageChanges
+*/
+RC getPageChanges(BM_BufferPool *const bm, BM_PageChange **changes, int *numChanges)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    MemorySlot *slots = pool->frames->slots;
+    RC status = RC_OK;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    pool->num_changes = 0;
+    for (int c = 0; c < pool->num_captured && status == RC_OK; c++)
+    {
+        PageCapture *capture = &pool->captured[c];
+        int i = findFrame(bm, pool, capture->pageNum);
+        if (i == -1)
+            continue;
+
+        char *before = capture->before, *after = slots[i].content;
+        int pos = 0;
+        while (pos < PAGE_SIZE && status == RC_OK)
+        {
+            // Skip equal words, then grow the range until CHANGE_GAP equal bytes follow it
+            while (pos + (int)sizeof(long) <= PAGE_SIZE && memcmp(before + pos, after + pos, sizeof(long)) == 0)
+                pos += sizeof(long);
+            while (pos < PAGE_SIZE && before[pos] == after[pos])
+                pos++;
+            if (pos == PAGE_SIZE)
+                break;
+
+            int start = pos, end = pos + 1;
+            for (pos = end; pos < PAGE_SIZE && pos - end < CHANGE_GAP; pos++)
+            {
+                if (before[pos] != after[pos])
+                    end = pos + 1;
+            }
+            status = addPageChange(pool, capture->pageNum, after, start, end);
+            capture->changed = true;
+        }
+    }
+    pthread_mutex_unlock(&pool->frames->lock);
+
+    *changes = pool->changes;
+    *numChanges = pool->num_changes;
+    return status;
+}
+
+/*
+    # Ends the operation begun by beginPageChanges: the frames it changed get lsn, the LSN of the
+    # log record holding the changes (0 if they were not logged), and lose their extra pin
+*/
+RC endPageChanges(BM_BufferPool *const bm, long lsn)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    MemorySlot *slots = pool->frames->slots;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    for (int c = 0; c < pool->num_captured; c++)
+    {
+        int i = findFrame(bm, pool, pool->captured[c].pageNum);
+        if (i == -1)
+            continue;
+        if (lsn > 0 && pool->captured[c].changed)
+        {
+            slots[i].lsn = lsn;
+            if (slots[i].rec_lsn == 0)
+                slots[i].rec_lsn = lsn;
+        }
+        if (slots[i].pin_count > 0)
+            slots[i].pin_count--;
+    }
+    pool->capturing = false;
+    pool->num_captured = 0;
+    pool->num_changes = 0;
+    pthread_mutex_unlock(&pool->frames->lock);
+    return RC_OK;
+}
+
+static int compareDirtyPages(const void *a, const void *b)
+{
+    return ((BM_DirtyPage *)a)->pageNum - ((BM_DirtyPage *)b)->pageNum;
+}
+
+/*
+    # Collects the dirty pages of the pool sorted by page number, the caller frees *pages; a page the
+    # running operation changed but endPageChanges did not stamp yet gets the LSN the operation began at,
+    # any other page changed without a log record gets 0
+*/
+static RC collectDirtyPages(BM_BufferPool *const bm, PoolMgmt *pool, BM_DirtyPage **pages, int *numPages)
+{
+    MemorySlot *slots = pool->frames->slots;
+    int num = 0;
+
+    *pages = malloc((bm->numPages > 0 ? bm->numPages : 1) * sizeof(BM_DirtyPage));
+    if (*pages == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (int i = 0; i < bm->numPages; i++)
+    {
+        if (!inPool(pool, i) || slots[i].id == NO_PAGE || !slots[i].is_dirty)
+            continue;
+        long recLsn = slots[i].rec_lsn;
+        if (recLsn == 0 && pool->capturing)
+        {
+            for (int c = 0; c < pool->num_captured; c++)
+            {
+                if (pool->captured[c].pageNum == slots[i].id)
+                    recLsn = pool->capture_lsn;
+            }
+        }
+        (*pages)[num].pageNum = slots[i].id;
+        (*pages)[num].recLsn = recLsn;
+        num++;
+    }
+    qsort(*pages, num, sizeof(BM_DirtyPage), compareDirtyPages);
+    *numPages = num;
+    return RC_OK;
+}
+
+/*
+    # Returns the dirty pages of the pool sorted by page number with the LSN of the first change since
+    # each was last written (0 for a change without a log record), the caller frees *pages
+*/
+RC getDirtyPages(BM_BufferPool *const bm, BM_DirtyPage **pages, int *numPages)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+
+    pthread_mutex_lock(&pool->frames->lock);
+    RC status = collectDirtyPages(bm, pool, pages, numPages);
+    pthread_mutex_unlock(&pool->frames->lock);
+    return status;
+}
+
+/*
+    # Writes back the dirty pages of the pool first changed before the log record at before, in page
+    # number order, and waits until the page file is on disk; unlike forceFlushPool it takes the lock
+    # of the frames for one page at a time and syncs the log and the file without it, so pinning and
+    # changing pages goes on meanwhile; pages pinned or changed again since are left for later
+*/
+RC flushDirtyPages(BM_BufferPool *const bm, long before)
+{
+    PoolMgmt *pool = (PoolMgmt *)bm->mgmtData;
+    PoolMgmt *frames = pool->frames;
+    BM_DirtyPage *pages;
+    long maxLsn = 0;
+    int numPages, written = 0;
+    RC status;
+
+    pthread_mutex_lock(&frames->lock);
+    status = collectDirtyPages(bm, pool, &pages, &numPages);
+    if (status == RC_OK)
+        status = openPoolFile(pool);
+    for (int i = 0; status == RC_OK && i < bm->numPages; i++)
+    {
+        if (inPool(pool, i) && frames->slots[i].is_dirty && frames->slots[i].lsn > maxLsn)
+            maxLsn = frames->slots[i].lsn;
+    }
+    pthread_mutex_unlock(&frames->lock);
+    if (status != RC_OK)
+    {
+        free(pages);
+        return status;
+    }
+
+    // Make the log durable for all of them up front, not under the lock for each page
+    if (maxLsn > 0 && pool->log_flush != NULL && (status = pool->log_flush(maxLsn)) != RC_OK)
+    {
+        free(pages);
+        return status;
+    }
+
+    for (int p = 0; p < numPages && status == RC_OK; p++)
+    {
+        if (pages[p].recLsn >= before && pages[p].recLsn != 0)
+            continue;
+        pthread_mutex_lock(&frames->lock);
+        int i = findFrame(bm, pool, pages[p].pageNum);
+        if (i != -1 && frames->slots[i].is_dirty && frames->slots[i].pin_count == 0 && frames->slots[i].lsn <= maxLsn)
+        {
+            status = flushMemorySlot(frames, i);
+            written++;
+        }
+        pthread_mutex_unlock(&frames->lock);
+    }
+    free(pages);
+
+    if (status == RC_OK && written > 0)
+        status = syncPageFile(&pool->file_handle);
+    return status;
 }
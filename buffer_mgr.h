@@ -33,6 +33,23 @@ typedef struct BM_PageHandle {
 	char *data;
 } BM_PageHandle;
 
+// A byte range of a page as it is after a logged operation
+typedef struct BM_PageChange {
+	PageNumber pageNum;
+	int offset;
+	int length;
+	char *data;
+} BM_PageChange;
+
+// A dirty page and the LSN of the first log record that changed it since it was last written
+typedef struct BM_DirtyPage {
+	PageNumber pageNum;
+	long recLsn;
+} BM_DirtyPage;
+
+// Makes the write-ahead log durable up to and including the record at lsn
+typedef RC (*BM_LogFlush)(long lsn);
+
 // convenience macros
 #define MAKE_POOL()					\
 		((BM_BufferPool *) malloc (sizeof(BM_BufferPool)))
@@ -44,8 +61,11 @@ typedef struct BM_PageHandle {
 RC initBufferPool(BM_BufferPool *const bm, const char *const pageFileName, 
 		const int numPages, ReplacementStrategy strategy,
 		void *stratData);
+RC attachBufferPool(BM_BufferPool *const bm, const char *const pageFileName,
+		BM_BufferPool *const shared);
 RC shutdownBufferPool(BM_BufferPool *const bm);
 RC forceFlushPool(BM_BufferPool *const bm);
+RC syncPool(BM_BufferPool *const bm);
 
 // Buffer Manager Interface Access Pages
 RC markDirty (BM_BufferPool *const bm, BM_PageHandle *const page);
@@ -53,6 +73,20 @@ RC unpinPage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC forcePage (BM_BufferPool *const bm, BM_PageHandle *const page);
 RC pinPage (BM_BufferPool *const bm, BM_PageHandle *const page, 
 		const PageNumber pageNum);
+RC truncatePool (BM_BufferPool *const bm, const int numPages);
+
+// Write-ahead logging
+// The pages pinned between beginPageChanges and endPageChanges stay pinned until
+// endPageChanges stamps the frames of the changed ones with the LSN of the log record
+// describing the changes; a frame is only written back once logFlush returned for its LSN
+RC setLogFlush (BM_BufferPool *const bm, BM_LogFlush logFlush);
+RC beginPageChanges (BM_BufferPool *const bm, long lsn);
+RC getPageChanges (BM_BufferPool *const bm, BM_PageChange **changes, int *numChanges);
+RC endPageChanges (BM_BufferPool *const bm, long lsn);
+
+// Checkpoints
+RC getDirtyPages (BM_BufferPool *const bm, BM_DirtyPage **pages, int *numPages);
+RC flushDirtyPages (BM_BufferPool *const bm, long before);
 
 // Statistics Interface
 PageNumber *getFrameContents (BM_BufferPool *const bm);
@@ -60,5 +94,6 @@ bool *getDirtyFlags (BM_BufferPool *const bm);
 int *getFixCounts (BM_BufferPool *const bm);
 int getNumReadIO (BM_BufferPool *const bm);
 int getNumWriteIO (BM_BufferPool *const bm);
+int getNumFilePages (BM_BufferPool *const bm);
 
 #endif
@@ -38,6 +38,14 @@ typedef int RC;
 #define RC_BUFF_SHUTDOWN_FAILED 435
 #define CREATE_RECORD_FAILED 440
 #define RC_TYPE_MISMATCH 445
+#define RC_NOT_NULL_VIOLATION 450
+#define RC_VALUE_OUT_OF_RANGE 455
+#define RC_TX_ACTIVE 460
+#define RC_TX_NOT_ACTIVE 465
+#define RC_LOCK_DEADLOCK 470
+#define RC_LOCK_TIMEOUT 475
+#define RC_TX_CONFLICT 480
+#define RC_PAGE_CORRUPTED 485
 
 /* holder for error messages */
 extern char *RC_message;
@@ -1,18 +1,37 @@
 #include <string.h>
 #include <stdlib.h>
+#include <time.h>
 
 #include "dberror.h"
 #include "record_mgr.h"
 #include "expr.h"
 #include "tables.h"
 
+/*
+	# a comparison with a NULL operand is unknown, which is a NULL boolean
+	# returns true if that decided the result
+*/
+static bool nullComparison(Value *left, Value *right, Value *result)
+{
+	if (!left->isNull && (right == NULL || !right->isNull))
+		return false;
+
+	result->dt = DT_BOOL;
+	result->isNull = TRUE;
+	result->v.boolV = FALSE;
+	return true;
+}
+
 // implementations
 RC valueEquals(Value *left, Value *right, Value *result)
 {
 	if (left->dt != right->dt)
 		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "equality comparison only supported for values of the same datatype");
+	if (nullComparison(left, right, result))
+		return RC_OK;
 
 	result->dt = DT_BOOL;
+	result->isNull = FALSE;
 
 	switch (left->dt)
 	{
@@ -37,8 +56,11 @@ RC valueSmaller(Value *left, Value *right, Value *result)
 {
 	if (left->dt != right->dt)
 		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "equality comparison only supported for values of the same datatype");
+	if (nullComparison(left, right, result))
+		return RC_OK;
 
 	result->dt = DT_BOOL;
+	result->isNull = FALSE;
 
 	switch (left->dt)
 	{
@@ -50,6 +72,7 @@ RC valueSmaller(Value *left, Value *right, Value *result)
 		break;
 	case DT_BOOL:
 		result->v.boolV = (left->v.boolV < right->v.boolV);
+		break;
 	case DT_STRING:
 		result->v.boolV = (strcmp(left->v.stringV, right->v.stringV) < 0);
 		break;
@@ -58,118 +81,951 @@ RC valueSmaller(Value *left, Value *right, Value *result)
 	return RC_OK;
 }
 
+/*
+	# three-way comparison shared by the ordering operators
+	# cmp is negative, zero or positive like strcmp
+	# NULLs have no order, callers check for them before comparing
+*/
+RC valueCompare(Value *left, Value *right, int *cmp)
+{
+	if (left->dt != right->dt)
+		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+
+	switch (left->dt)
+	{
+	case DT_INT:
+		*cmp = (left->v.intV > right->v.intV) - (left->v.intV < right->v.intV);
+		break;
+	case DT_FLOAT:
+		*cmp = (left->v.floatV > right->v.floatV) - (left->v.floatV < right->v.floatV);
+		break;
+	case DT_BOOL:
+		*cmp = (left->v.boolV > right->v.boolV) - (left->v.boolV < right->v.boolV);
+		break;
+	case DT_STRING:
+		*cmp = strcmp(left->v.stringV, right->v.stringV);
+		break;
+	default:
+		THROW(RC_RM_UNKOWN_DATATYPE, "comparison on unknown datatype");
+	}
+
+	return RC_OK;
+}
+
+RC valueSmallerEqual(Value *left, Value *right, Value *result)
+{
+	int cmp;
+	RC rc;
+
+	if (left->dt != right->dt)
+		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+	if (nullComparison(left, right, result))
+		return RC_OK;
+	if ((rc = valueCompare(left, right, &cmp)) != RC_OK)
+		return rc;
+	result->dt = DT_BOOL;
+	result->isNull = FALSE;
+	result->v.boolV = (cmp <= 0);
+
+	return RC_OK;
+}
+
+RC valueGreater(Value *left, Value *right, Value *result)
+{
+	int cmp;
+	RC rc;
+
+	if (left->dt != right->dt)
+		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+	if (nullComparison(left, right, result))
+		return RC_OK;
+	if ((rc = valueCompare(left, right, &cmp)) != RC_OK)
+		return rc;
+	result->dt = DT_BOOL;
+	result->isNull = FALSE;
+	result->v.boolV = (cmp > 0);
+
+	return RC_OK;
+}
+
+RC valueGreaterEqual(Value *left, Value *right, Value *result)
+{
+	int cmp;
+	RC rc;
+
+	if (left->dt != right->dt)
+		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+	if (nullComparison(left, right, result))
+		return RC_OK;
+	if ((rc = valueCompare(left, right, &cmp)) != RC_OK)
+		return rc;
+	result->dt = DT_BOOL;
+	result->isNull = FALSE;
+	result->v.boolV = (cmp >= 0);
+
+	return RC_OK;
+}
+
+RC valueNotEquals(Value *left, Value *right, Value *result)
+{
+	RC rc = valueEquals(left, right, result);
+	if (rc != RC_OK)
+		return rc;
+	if (!result->isNull)
+		result->v.boolV = !result->v.boolV;
+
+	return RC_OK;
+}
+
+RC valueBetween(Value *input, Value *low, Value *high, Value *result)
+{
+	int lowCmp, highCmp;
+	RC rc;
+
+	if (input->dt != low->dt || input->dt != high->dt)
+		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "comparison only supported for values of the same datatype");
+	if (nullComparison(input, low, result) || nullComparison(input, high, result))
+		return RC_OK;
+	if ((rc = valueCompare(input, low, &lowCmp)) != RC_OK)
+		return rc;
+	if ((rc = valueCompare(input, high, &highCmp)) != RC_OK)
+		return rc;
+	result->dt = DT_BOOL;
+	result->isNull = FALSE;
+	result->v.boolV = (lowCmp >= 0 && highCmp <= 0);
+
+	return RC_OK;
+}
+
+/*
+	# matches str against a LIKE pattern where '%' stands for any run of
+	# characters and '_' for exactly one; backtracks only to the last '%'
+*/
+static bool likeMatch(const char *str, const char *pattern)
+{
+	const char *starPattern = NULL;
+	const char *starStr = NULL;
+
+	while (*str != '\0')
+	{
+		if (*pattern == '%')
+		{
+			starPattern = ++pattern;
+			starStr = str;
+		}
+		else if (*pattern == '_' || *pattern == *str)
+		{
+			pattern++;
+			str++;
+		}
+		else if (starPattern != NULL)
+		{
+			pattern = starPattern;
+			str = ++starStr;
+		}
+		else
+			return false;
+	}
+
+	while (*pattern == '%')
+		pattern++;
+
+	return *pattern == '\0';
+}
+
+RC valueLike(Value *input, Value *pattern, Value *result)
+{
+	if (input->dt != DT_STRING || pattern->dt != DT_STRING)
+		THROW(RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE, "LIKE only supported for string values");
+	if (nullComparison(input, pattern, result))
+		return RC_OK;
+
+	result->dt = DT_BOOL;
+	result->isNull = FALSE;
+	result->v.boolV = likeMatch(input->v.stringV, pattern->v.stringV);
+
+	return RC_OK;
+}
+
+RC valueIsNull(Value *input, Value *result)
+{
+	result->dt = DT_BOOL;
+	result->isNull = FALSE;
+	result->v.boolV = input->isNull;
+
+	return RC_OK;
+}
+
 RC boolNot(Value *input, Value *result)
 {
 	if (input->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean NOT requires boolean input");
 	result->dt = DT_BOOL;
-	result->v.boolV = !(input->v.boolV);
+	result->isNull = input->isNull;
+	result->v.boolV = !input->isNull && !(input->v.boolV);
 
 	return RC_OK;
 }
 
+/*
+	# Kleene AND: FALSE if either side is FALSE, otherwise NULL if either is NULL
+*/
 RC boolAnd(Value *left, Value *right, Value *result)
 {
+	bool leftFalse = !left->isNull && !left->v.boolV;
+	bool rightFalse = !right->isNull && !right->v.boolV;
+
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean AND requires boolean inputs");
-	result->v.boolV = (left->v.boolV && right->v.boolV);
+	result->dt = DT_BOOL;
+	result->isNull = !leftFalse && !rightFalse && (left->isNull || right->isNull);
+	result->v.boolV = !leftFalse && !rightFalse && !result->isNull;
 
 	return RC_OK;
 }
 
+/*
+	# Kleene OR: TRUE if either side is TRUE, otherwise NULL if either is NULL
+*/
 RC boolOr(Value *left, Value *right, Value *result)
 {
+	bool leftTrue = !left->isNull && left->v.boolV;
+	bool rightTrue = !right->isNull && right->v.boolV;
+
 	if (left->dt != DT_BOOL || right->dt != DT_BOOL)
 		THROW(RC_RM_BOOLEAN_EXPR_ARG_IS_NOT_BOOLEAN, "boolean OR requires boolean inputs");
-	result->v.boolV = (left->v.boolV || right->v.boolV);
+	result->dt = DT_BOOL;
+	result->isNull = !leftTrue && !rightTrue && (left->isNull || right->isNull);
+	result->v.boolV = leftTrue || rightTrue;
 
 	return RC_OK;
 }
 
-RC evalExpr(Record *record, Schema *schema, Expr *expr, Value **result)
+// applies a binary comparison operator to two evaluated inputs
+static RC evalComparison(OpType type, Value *lIn, Value *rIn, Value *result)
+{
+	switch (type)
+	{
+	case OP_BOOL_AND:
+		return boolAnd(lIn, rIn, result);
+	case OP_BOOL_OR:
+		return boolOr(lIn, rIn, result);
+	case OP_COMP_EQUAL:
+		return valueEquals(lIn, rIn, result);
+	case OP_COMP_SMALLER:
+		return valueSmaller(lIn, rIn, result);
+	case OP_COMP_SMALLER_EQUAL:
+		return valueSmallerEqual(lIn, rIn, result);
+	case OP_COMP_GREATER:
+		return valueGreater(lIn, rIn, result);
+	case OP_COMP_GREATER_EQUAL:
+		return valueGreaterEqual(lIn, rIn, result);
+	case OP_COMP_NOT_EQUAL:
+		return valueNotEquals(lIn, rIn, result);
+	case OP_COMP_LIKE:
+		return valueLike(lIn, rIn, result);
+	default:
+		THROW(RC_RM_UNKOWN_DATATYPE, "unknown binary operator");
+	}
+}
+
+static RC evalOperator(Record *record, Schema *schema, Operator *op, Value *result)
 {
 	Value *lIn;
 	Value *rIn;
-	MAKE_VALUE(*result, DT_INT, -1);
+	Value *hIn;
+	bool sawNull;
+	RC rc;
+	int i;
 
-	switch (expr->type)
-	{
-	case EXPR_OP:
-	{
-		Operator *op = expr->expr.op;
-		bool twoArgs = (op->type != OP_BOOL_NOT);
-		//      lIn = (Value *) malloc(sizeof(Value));
-		//    rIn = (Value *) malloc(sizeof(Value));
+	if ((rc = evalExpr(record, schema, op->args[0], &lIn)) != RC_OK)
+		return rc;
 
-		CHECK(evalExpr(record, schema, op->args[0], &lIn));
-		if (twoArgs)
-			CHECK(evalExpr(record, schema, op->args[1], &rIn));
+	// short-circuit: the right operand cannot change the outcome, a NULL
+	// left operand still can
+	if ((op->type == OP_BOOL_AND || op->type == OP_BOOL_OR) && lIn->dt == DT_BOOL &&
+		!lIn->isNull && lIn->v.boolV == (op->type == OP_BOOL_OR))
+	{
+		result->dt = DT_BOOL;
+		result->isNull = FALSE;
+		result->v.boolV = lIn->v.boolV;
+		freeVal(lIn);
+		return RC_OK;
+	}
 
-		switch (op->type)
-		{
-		case OP_BOOL_NOT:
-			CHECK(boolNot(lIn, *result));
-			break;
-		case OP_BOOL_AND:
-			CHECK(boolAnd(lIn, rIn, *result));
-			break;
-		case OP_BOOL_OR:
-			CHECK(boolOr(lIn, rIn, *result));
-			break;
-		case OP_COMP_EQUAL:
-			CHECK(valueEquals(lIn, rIn, *result));
-			break;
-		case OP_COMP_SMALLER:
-			CHECK(valueSmaller(lIn, rIn, *result));
-			break;
-		default:
+	switch (op->type)
+	{
+	case OP_BOOL_NOT:
+		rc = boolNot(lIn, result);
+		break;
+	case OP_IS_NULL:
+		rc = valueIsNull(lIn, result);
+		break;
+	case OP_COMP_BETWEEN:
+		if ((rc = evalExpr(record, schema, op->args[1], &rIn)) != RC_OK)
 			break;
+		if ((rc = evalExpr(record, schema, op->args[2], &hIn)) == RC_OK)
+		{
+			rc = valueBetween(lIn, rIn, hIn, result);
+			freeVal(hIn);
 		}
-
-		// cleanup
-		freeVal(lIn);
-		if (twoArgs)
+		freeVal(rIn);
+		break;
+	case OP_COMP_IN:
+		// stop at the first candidate that matches; without a match the
+		// result is NULL if any comparison was
+		result->dt = DT_BOOL;
+		result->isNull = FALSE;
+		result->v.boolV = FALSE;
+		sawNull = false;
+		for (i = 1; i < op->numArgs && !result->v.boolV && rc == RC_OK; i++)
+		{
+			if ((rc = evalExpr(record, schema, op->args[i], &rIn)) != RC_OK)
+				break;
+			rc = valueEquals(lIn, rIn, result);
+			sawNull = sawNull || result->isNull;
 			freeVal(rIn);
+		}
+		result->isNull = !result->v.boolV && sawNull;
+		break;
+	default:
+		if ((rc = evalExpr(record, schema, op->args[1], &rIn)) != RC_OK)
+			break;
+		rc = evalComparison(op->type, lIn, rIn, result);
+		freeVal(rIn);
+		break;
 	}
-	break;
+
+	// cleanup
+	freeVal(lIn);
+	return rc;
+}
+
+RC evalExpr(Record *record, Schema *schema, Expr *expr, Value **result)
+{
+	RC rc = RC_OK;
+	MAKE_VALUE(*result, DT_INT, -1);
+
+	switch (expr->type)
+	{
+	case EXPR_OP:
+		rc = evalOperator(record, schema, expr->expr.op, *result);
+		break;
 	case EXPR_CONST:
 		CPVAL(*result, expr->expr.cons);
 		break;
 	case EXPR_ATTRREF:
 		free(*result);
-		CHECK(getAttr(record, schema, expr->expr.attrRef, result));
+		rc = getAttr(record, schema, expr->expr.attrRef, result);
 		break;
 	}
 
-	return RC_OK;
+	return rc;
 }
 
-RC freeExpr(Expr *expr)
+/* Expression normalization */
+
+static bool isConstExpr(Expr *expr)
+{
+	return expr->type == EXPR_CONST;
+}
+
+static bool isBoolConst(Expr *expr, bool value)
+{
+	return expr->type == EXPR_CONST && expr->expr.cons->dt == DT_BOOL && !expr->expr.cons->isNull &&
+		expr->expr.cons->v.boolV == value;
+}
+
+// operator that yields the negated result, or -1 if there is no direct one
+static int negateComparison(OpType type)
+{
+	switch (type)
+	{
+	case OP_COMP_EQUAL:
+		return OP_COMP_NOT_EQUAL;
+	case OP_COMP_NOT_EQUAL:
+		return OP_COMP_EQUAL;
+	case OP_COMP_SMALLER:
+		return OP_COMP_GREATER_EQUAL;
+	case OP_COMP_SMALLER_EQUAL:
+		return OP_COMP_GREATER;
+	case OP_COMP_GREATER:
+		return OP_COMP_SMALLER_EQUAL;
+	case OP_COMP_GREATER_EQUAL:
+		return OP_COMP_SMALLER;
+	default:
+		return -1;
+	}
+}
+
+// operator to use when the two arguments are swapped, or -1 if not swappable
+static int mirrorComparison(OpType type)
+{
+	switch (type)
+	{
+	case OP_COMP_EQUAL:
+	case OP_COMP_NOT_EQUAL:
+		return type;
+	case OP_COMP_SMALLER:
+		return OP_COMP_GREATER;
+	case OP_COMP_SMALLER_EQUAL:
+		return OP_COMP_GREATER_EQUAL;
+	case OP_COMP_GREATER:
+		return OP_COMP_SMALLER;
+	case OP_COMP_GREATER_EQUAL:
+		return OP_COMP_SMALLER_EQUAL;
+	default:
+		return -1;
+	}
+}
+
+// releases the operator of an expression without touching its arguments
+static void freeOperatorShell(Expr *expr)
+{
+	free(expr->expr.op->args);
+	free(expr->expr.op);
+}
+
+// moves source into the node target (whose operator was already released)
+static void moveExpr(Expr *target, Expr *source)
+{
+	*target = *source;
+	free(source);
+}
+
+// releases everything an expression node owns, but not the node itself
+static void freeExprContents(Expr *expr)
 {
+	int i;
+
 	switch (expr->type)
 	{
 	case EXPR_OP:
+		for (i = 0; i < expr->expr.op->numArgs; i++)
+			freeExpr(expr->expr.op->args[i]);
+		freeOperatorShell(expr);
+		break;
+	case EXPR_CONST:
+		freeVal(expr->expr.cons);
+		break;
+	case EXPR_ATTRREF:
+		break;
+	}
+}
+
+// replaces expr by the constant it evaluates to, if it can be evaluated
+static void foldConstant(Expr *expr)
+{
+	Value *value;
+
+	if (evalExpr(NULL, NULL, expr, &value) != RC_OK)
 	{
-		Operator *op = expr->expr.op;
-		switch (op->type)
+		free(value);
+		return;
+	}
+	freeExprContents(expr);
+	expr->type = EXPR_CONST;
+	expr->expr.cons = value;
+}
+
+// replaces expr by its argument keep, releasing the other arguments
+static void keepArgument(Expr *expr, int keep)
+{
+	Operator *op = expr->expr.op;
+	Expr *kept = op->args[keep];
+	int i;
+
+	for (i = 0; i < op->numArgs; i++)
+		if (i != keep)
+			freeExpr(op->args[i]);
+	freeOperatorShell(expr);
+	moveExpr(expr, kept);
+}
+
+// true if expr is "attr op constant" with the given operator
+static bool isAttrConstComparison(Expr *expr, OpType type)
+{
+	Operator *op;
+
+	if (expr->type != EXPR_OP)
+		return false;
+	op = expr->expr.op;
+	return op->type == type && op->args[0]->type == EXPR_ATTRREF && isConstExpr(op->args[1]);
+}
+
+/*
+	# merges "a >= low AND a <= high" (in either order) into "a BETWEEN low AND high"
+*/
+static void mergeRange(Expr *expr)
+{
+	Operator *op = expr->expr.op;
+	Expr *lowExpr, *highExpr, *attr;
+	Expr **args;
+
+	if (isAttrConstComparison(op->args[0], OP_COMP_GREATER_EQUAL) && isAttrConstComparison(op->args[1], OP_COMP_SMALLER_EQUAL))
+	{
+		lowExpr = op->args[0];
+		highExpr = op->args[1];
+	}
+	else if (isAttrConstComparison(op->args[1], OP_COMP_GREATER_EQUAL) && isAttrConstComparison(op->args[0], OP_COMP_SMALLER_EQUAL))
+	{
+		lowExpr = op->args[1];
+		highExpr = op->args[0];
+	}
+	else
+		return;
+
+	attr = lowExpr->expr.op->args[0];
+	if (attr->expr.attrRef != highExpr->expr.op->args[0]->expr.attrRef ||
+		lowExpr->expr.op->args[1]->expr.cons->dt != highExpr->expr.op->args[1]->expr.cons->dt ||
+		lowExpr->expr.op->args[1]->expr.cons->isNull || highExpr->expr.op->args[1]->expr.cons->isNull)
+		return;
+
+	args = (Expr **)malloc(3 * sizeof(Expr *));
+	args[0] = attr;
+	args[1] = lowExpr->expr.op->args[1];
+	args[2] = highExpr->expr.op->args[1];
+
+	freeExpr(highExpr->expr.op->args[0]);
+	freeOperatorShell(lowExpr);
+	freeOperatorShell(highExpr);
+	free(lowExpr);
+	free(highExpr);
+
+	free(op->args);
+	op->type = OP_COMP_BETWEEN;
+	op->args = args;
+	op->numArgs = 3;
+}
+
+// rewrites NOT(child) in place, pushing the negation as far down as possible
+static void normalizeNot(Expr *expr)
+{
+	Expr *child = expr->expr.op->args[0];
+	Operator *childOp;
+	Expr *negated;
+	int negatedType;
+	int i;
+
+	if (child->type != EXPR_OP)
+		return;
+	childOp = child->expr.op;
+
+	if (childOp->type == OP_BOOL_NOT)
+	{
+		// NOT NOT x => x
+		Expr *grandChild = childOp->args[0];
+		freeOperatorShell(child);
+		free(child);
+		freeOperatorShell(expr);
+		moveExpr(expr, grandChild);
+		return;
+	}
+
+	if (childOp->type == OP_BOOL_AND || childOp->type == OP_BOOL_OR)
+	{
+		// De Morgan: NOT (x AND y) => NOT x OR NOT y
+		for (i = 0; i < childOp->numArgs; i++)
 		{
-		case OP_BOOL_NOT:
-			freeExpr(op->args[0]);
-			break;
-		default:
-			freeExpr(op->args[0]);
-			freeExpr(op->args[1]);
-			break;
+			MAKE_UNOP_EXPR(negated, childOp->args[i], OP_BOOL_NOT);
+			normalizeNot(negated);
+			childOp->args[i] = negated;
+		}
+		childOp->type = (childOp->type == OP_BOOL_AND) ? OP_BOOL_OR : OP_BOOL_AND;
+		freeOperatorShell(expr);
+		moveExpr(expr, child);
+		return;
+	}
+
+	negatedType = negateComparison(childOp->type);
+	if (negatedType >= 0)
+	{
+		childOp->type = (OpType)negatedType;
+		freeOperatorShell(expr);
+		moveExpr(expr, child);
+	}
+}
+
+// normalizes expr and its arguments, see normalizeExpr
+static RC normalizeTree(Expr *expr)
+{
+	Operator *op;
+	bool allConst = true;
+	int mirrored;
+	int i;
+
+	if (expr == NULL)
+		return RC_NULL_ARGUMENT;
+	if (expr->type != EXPR_OP)
+		return RC_OK;
+
+	op = expr->expr.op;
+	if (op->type == OP_BOOL_NOT)
+	{
+		normalizeTree(op->args[0]);
+		normalizeNot(expr);
+		if (expr->type == EXPR_OP && expr->expr.op->type == OP_BOOL_NOT)
+		{
+			if (isConstExpr(expr->expr.op->args[0]))
+				foldConstant(expr);
+			return RC_OK;
+		}
+		// the negation was pushed down, normalize what it turned into
+		return normalizeTree(expr);
+	}
+
+	for (i = 0; i < op->numArgs; i++)
+	{
+		normalizeTree(op->args[i]);
+		allConst = allConst && isConstExpr(op->args[i]);
+	}
+
+	if (allConst)
+	{
+		foldConstant(expr);
+		return RC_OK;
+	}
+
+	switch (op->type)
+	{
+	case OP_BOOL_AND:
+		if (isBoolConst(op->args[0], FALSE) || isBoolConst(op->args[1], TRUE))
+			keepArgument(expr, 0);
+		else if (isBoolConst(op->args[1], FALSE) || isBoolConst(op->args[0], TRUE))
+			keepArgument(expr, 1);
+		else
+			mergeRange(expr);
+		break;
+	case OP_BOOL_OR:
+		if (isBoolConst(op->args[0], TRUE) || isBoolConst(op->args[1], FALSE))
+			keepArgument(expr, 0);
+		else if (isBoolConst(op->args[1], TRUE) || isBoolConst(op->args[0], FALSE))
+			keepArgument(expr, 1);
+		break;
+	case OP_COMP_LIKE:
+		if (isConstExpr(op->args[1]) && op->args[1]->expr.cons->dt == DT_STRING &&
+			strpbrk(op->args[1]->expr.cons->v.stringV, "%_") == NULL)
+			op->type = OP_COMP_EQUAL;
+		break;
+	default:
+		mirrored = mirrorComparison(op->type);
+		if (mirrored >= 0 && isConstExpr(op->args[0]) && op->args[1]->type == EXPR_ATTRREF)
+		{
+			Expr *tmp = op->args[0];
+			op->args[0] = op->args[1];
+			op->args[1] = tmp;
+			op->type = (OpType)mirrored;
+		}
+		break;
+	}
+
+	return RC_OK;
+}
+
+/*
+	# a conjunct "a LIKE 'abc%...'" becomes "a BETWEEN 'abc' AND 'abd' AND a LIKE 'abc%...'":
+	# the range holds every string with the prefix, so an index on a can serve it, and the LIKE
+	# stays to reject the upper bound and what the rest of the pattern rules out
+	# only conjuncts of the top-level AND-chain are rewritten, the range is of no use elsewhere
+*/
+static void prefixRanges(Expr *expr)
+{
+	Operator *op;
+	Expr *like, *attr, *lowExpr, *highExpr, *range, *conj;
+	Value *low, *high;
+	char *pattern;
+	size_t prefix, len;
+
+	if (expr->type != EXPR_OP)
+		return;
+	op = expr->expr.op;
+	if (op->type == OP_BOOL_AND)
+	{
+		prefixRanges(op->args[0]);
+		prefixRanges(op->args[1]);
+		return;
+	}
+	if (op->type != OP_COMP_LIKE || op->args[0]->type != EXPR_ATTRREF || !isConstExpr(op->args[1]) ||
+		op->args[1]->expr.cons->dt != DT_STRING || op->args[1]->expr.cons->isNull)
+		return;
+
+	// the upper bound is the prefix with its last character below the largest one raised by one
+	pattern = op->args[1]->expr.cons->v.stringV;
+	prefix = strcspn(pattern, "%_");
+	for (len = prefix; len > 0 && (unsigned char)pattern[len - 1] == 0xFF; len--)
+		;
+	if (len == 0)
+		return;
+
+	low = (Value *)malloc(sizeof(Value));
+	low->dt = DT_STRING;
+	low->isNull = FALSE;
+	low->v.stringV = (char *)malloc(prefix + 1);
+	memcpy(low->v.stringV, pattern, prefix);
+	low->v.stringV[prefix] = '\0';
+
+	high = (Value *)malloc(sizeof(Value));
+	high->dt = DT_STRING;
+	high->isNull = FALSE;
+	high->v.stringV = (char *)malloc(len + 1);
+	memcpy(high->v.stringV, pattern, len);
+	high->v.stringV[len - 1]++;
+	high->v.stringV[len] = '\0';
+
+	like = (Expr *)malloc(sizeof(Expr));
+	*like = *expr;
+	MAKE_ATTRREF(attr, op->args[0]->expr.attrRef);
+	MAKE_CONS(lowExpr, low);
+	MAKE_CONS(highExpr, high);
+	MAKE_BETWEEN_EXPR(range, attr, lowExpr, highExpr);
+	MAKE_BINOP_EXPR(conj, range, like, OP_BOOL_AND);
+	moveExpr(expr, conj);
+}
+
+/*
+	# rewrites an expression tree in place into a cheaper, equivalent form:
+	#   - operators over constants only are folded into a constant
+	#   - NOT is pushed into comparisons (NOT a < 5 => a >= 5) and through AND/OR
+	#   - constants are moved to the right of comparisons (5 < a => a > 5)
+	#   - AND/OR with a constant operand are simplified
+	#   - a >= x AND a <= y becomes a BETWEEN x AND y
+	#   - LIKE without wildcards becomes an equality, a conjunct LIKE with a fixed prefix
+	#     is also bounded by the range of that prefix
+	# the root node stays at the same address, so callers keep their pointer
+*/
+RC normalizeExpr(Expr *expr)
+{
+	RC status = normalizeTree(expr);
+
+	if (status == RC_OK)
+		prefixRanges(expr);
+	return status;
+}
+
+/* Adaptive conjunct ordering */
+
+#define CONJ_REORDER_INTERVAL 256
+#define CONJ_SAMPLE_MASK 15
+
+static int countConjuncts(Expr *expr)
+{
+	if (expr->type == EXPR_OP && expr->expr.op->type == OP_BOOL_AND)
+		return countConjuncts(expr->expr.op->args[0]) + countConjuncts(expr->expr.op->args[1]);
+	return 1;
+}
+
+static void collectConjuncts(Expr *expr, Expr **conjuncts, int *pos)
+{
+	if (expr->type == EXPR_OP && expr->expr.op->type == OP_BOOL_AND)
+	{
+		collectConjuncts(expr->expr.op->args[0], conjuncts, pos);
+		collectConjuncts(expr->expr.op->args[1], conjuncts, pos);
+	}
+	else
+		conjuncts[(*pos)++] = expr;
+}
+
+/*
+	# flattens the AND-chain of cond into a list of conjuncts
+	# the conjuncts stay owned by cond, which must outlive the conjunction
+*/
+RC buildConjunction(Expr *cond, Conjunction **conj)
+{
+	Conjunction *c;
+	int pos = 0;
+
+	if (cond == NULL || conj == NULL)
+		return RC_NULL_ARGUMENT;
+
+	c = (Conjunction *)malloc(sizeof(Conjunction));
+	if (c == NULL)
+		return RC_MEM_ALLOCATION_FAIL;
+
+	c->numConjuncts = countConjuncts(cond);
+	c->conjuncts = (Expr **)malloc(c->numConjuncts * sizeof(Expr *));
+	c->evaluations = (long *)calloc(c->numConjuncts, sizeof(long));
+	c->passes = (long *)calloc(c->numConjuncts, sizeof(long));
+	c->samples = (long *)calloc(c->numConjuncts, sizeof(long));
+	c->nanos = (double *)calloc(c->numConjuncts, sizeof(double));
+	c->evalCount = 0;
+	c->reorderInterval = CONJ_REORDER_INTERVAL;
+	collectConjuncts(cond, c->conjuncts, &pos);
+
+	*conj = c;
+	return RC_OK;
+}
+
+/*
+	# expected cost of evaluating conjunct i until the first rejection,
+	# cost / (1 - selectivity); lower ranks are evaluated first
+*/
+static double conjunctRank(Conjunction *c, int i)
+{
+	double cost = (c->samples[i] > 0) ? c->nanos[i] / c->samples[i] : 1.0;
+	double selectivity = (c->evaluations[i] > 0) ? (double)c->passes[i] / c->evaluations[i] : 0.5;
+
+	if (selectivity >= 1.0)
+		selectivity = 0.999;
+	return cost / (1.0 - selectivity);
+}
+
+static void swapConjuncts(Conjunction *c, int a, int b)
+{
+	Expr *e = c->conjuncts[a];
+	long l;
+	double d;
+
+	c->conjuncts[a] = c->conjuncts[b];
+	c->conjuncts[b] = e;
+	l = c->evaluations[a], c->evaluations[a] = c->evaluations[b], c->evaluations[b] = l;
+	l = c->passes[a], c->passes[a] = c->passes[b], c->passes[b] = l;
+	l = c->samples[a], c->samples[a] = c->samples[b], c->samples[b] = l;
+	d = c->nanos[a], c->nanos[a] = c->nanos[b], c->nanos[b] = d;
+}
+
+// insertion sort by rank, the list is short and usually almost sorted
+static void reorderConjuncts(Conjunction *c)
+{
+	int i, j;
+
+	for (i = 1; i < c->numConjuncts; i++)
+		for (j = i; j > 0 && conjunctRank(c, j) < conjunctRank(c, j - 1); j--)
+			swapConjuncts(c, j, j - 1);
+}
+
+static double elapsedNanos(struct timespec *start)
+{
+	struct timespec end;
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	return (end.tv_sec - start->tv_sec) * 1e9 + (end.tv_nsec - start->tv_nsec);
+}
+
+/*
+	# evaluates the conjunction on a record, stopping at the first false conjunct
+	# every few evaluations one is timed, and every reorderInterval evaluations the
+	# conjuncts are re-sorted by their observed cost and selectivity
+*/
+RC evalConjunction(Record *record, Schema *schema, Conjunction *conj, bool *result)
+{
+	struct timespec start;
+	bool timed;
+	Value *value;
+	RC rc;
+	int i;
+
+	if (conj == NULL || result == NULL)
+		return RC_NULL_ARGUMENT;
+
+	timed = (conj->evalCount & CONJ_SAMPLE_MASK) == 0;
+	*result = TRUE;
+
+	for (i = 0; i < conj->numConjuncts && *result; i++)
+	{
+		if (timed)
+			clock_gettime(CLOCK_MONOTONIC, &start);
+
+		if ((rc = evalExpr(record, schema, conj->conjuncts[i], &value)) != RC_OK)
+			return rc;
+		if (value->dt != DT_BOOL)
+		{
+			freeVal(value);
+			THROW(RC_RM_EXPR_RESULT_IS_NOT_BOOLEAN, "conjunct did not evaluate to a boolean");
 		}
-		free(op->args);
+		*result = !value->isNull && value->v.boolV;
+		freeVal(value);
+
+		if (timed)
+		{
+			conj->nanos[i] += elapsedNanos(&start);
+			conj->samples[i]++;
+		}
+		conj->evaluations[i]++;
+		if (*result)
+			conj->passes[i]++;
 	}
-	break;
+
+	if (++conj->evalCount % conj->reorderInterval == 0)
+		reorderConjuncts(conj);
+
+	return RC_OK;
+}
+
+/*
+	# makes a deep copy of an expression tree, to be released with freeExpr; callers that
+	# rewrite a condition with normalizeExpr work on a copy to leave the original as it is
+*/
+RC copyExpr(Expr *expr, Expr **copy)
+{
+	Operator *op;
+	Expr *result;
+	RC status;
+	int i;
+
+	if (expr == NULL || copy == NULL)
+		return RC_NULL_ARGUMENT;
+	if ((result = (Expr *) malloc(sizeof(Expr))) == NULL)
+		return RC_MEM_ALLOCATION_FAIL;
+	result->type = expr->type;
+
+	switch (expr->type)
+	{
 	case EXPR_CONST:
-		freeVal(expr->expr.cons);
+		if ((result->expr.cons = (Value *) malloc(sizeof(Value))) == NULL)
+		{
+			free(result);
+			return RC_MEM_ALLOCATION_FAIL;
+		}
+		CPVAL(result->expr.cons, expr->expr.cons);
 		break;
 	case EXPR_ATTRREF:
+		result->expr.attrRef = expr->expr.attrRef;
+		break;
+	case EXPR_OP:
+		op = (Operator *) malloc(sizeof(Operator));
+		if (op == NULL || (op->args = (Expr **) malloc(expr->expr.op->numArgs * sizeof(Expr *))) == NULL)
+		{
+			free(op);
+			free(result);
+			return RC_MEM_ALLOCATION_FAIL;
+		}
+		op->type = expr->expr.op->type;
+		result->expr.op = op;
+		for (i = 0; i < expr->expr.op->numArgs; i++)
+		{
+			// a partial copy is released with the arguments copied so far
+			op->numArgs = i;
+			if ((status = copyExpr(expr->expr.op->args[i], &op->args[i])) != RC_OK)
+			{
+				freeExpr(result);
+				return status;
+			}
+		}
+		op->numArgs = expr->expr.op->numArgs;
 		break;
 	}
+
+	*copy = result;
+	return RC_OK;
+}
+
+RC freeConjunction(Conjunction *conj)
+{
+	if (conj == NULL)
+		return RC_OK;
+
+	free(conj->conjuncts);
+	free(conj->evaluations);
+	free(conj->passes);
+	free(conj->samples);
+	free(conj->nanos);
+	free(conj);
+
+	return RC_OK;
+}
+
+RC freeExpr(Expr *expr)
+{
+	freeExprContents(expr);
 	free(expr);
 
 	return RC_OK;
@@ -177,7 +1033,7 @@ RC freeExpr(Expr *expr)
 
 void freeVal(Value *val)
 {
-	if (val->dt == DT_STRING)
+	if (val->dt == DT_STRING && !val->isNull)
 		free(val->v.stringV);
 	free(val);
 }
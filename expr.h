@@ -26,21 +26,58 @@ typedef enum OpType {
   OP_BOOL_OR,
   OP_BOOL_NOT,
   OP_COMP_EQUAL,
-  OP_COMP_SMALLER
+  OP_COMP_SMALLER,
+  OP_COMP_SMALLER_EQUAL,
+  OP_COMP_GREATER,
+  OP_COMP_GREATER_EQUAL,
+  OP_COMP_NOT_EQUAL,
+  OP_COMP_BETWEEN,   // args: input, low, high (both bounds inclusive)
+  OP_COMP_IN,        // args: input, followed by the list of candidates
+  OP_COMP_LIKE,      // args: input, pattern ('%' any run, '_' one char)
+  OP_IS_NULL         // args: input; the only operator that is never NULL itself
 } OpType;
 
 typedef struct Operator {
   OpType type;
   Expr **args;
+  int numArgs;
 } Operator;
 
+// flattened AND-chain that reorders its conjuncts while a scan runs, so the
+// cheapest and most selective test is evaluated first
+typedef struct Conjunction {
+  int numConjuncts;
+  Expr **conjuncts;     // borrowed from the condition, not owned
+  long *evaluations;    // times each conjunct was evaluated
+  long *passes;         // times it evaluated to true
+  long *samples;        // timed evaluations
+  double *nanos;        // total time of the timed evaluations
+  long evalCount;
+  int reorderInterval;  // evaluations between two reorderings
+} Conjunction;
+
 // expression evaluation methods
+// comparisons follow SQL three-valued logic: a NULL input gives a NULL
+// boolean, AND/OR/NOT use the Kleene truth tables and scans only keep TRUE
 extern RC valueEquals (Value *left, Value *right, Value *result);
 extern RC valueSmaller (Value *left, Value *right, Value *result);
 extern RC boolNot (Value *input, Value *result);
 extern RC boolAnd (Value *left, Value *right, Value *result);
 extern RC boolOr (Value *left, Value *right, Value *result);
+extern RC valueCompare (Value *left, Value *right, int *cmp);
+extern RC valueSmallerEqual (Value *left, Value *right, Value *result);
+extern RC valueGreater (Value *left, Value *right, Value *result);
+extern RC valueGreaterEqual (Value *left, Value *right, Value *result);
+extern RC valueNotEquals (Value *left, Value *right, Value *result);
+extern RC valueBetween (Value *input, Value *low, Value *high, Value *result);
+extern RC valueLike (Value *input, Value *pattern, Value *result);
+extern RC valueIsNull (Value *input, Value *result);
 extern RC evalExpr (Record *record, Schema *schema, Expr *expr, Value **result);
+extern RC normalizeExpr (Expr *expr);
+extern RC copyExpr (Expr *expr, Expr **copy);
+extern RC buildConjunction (Expr *cond, Conjunction **conj);
+extern RC evalConjunction (Record *record, Schema *schema, Conjunction *conj, bool *result);
+extern RC freeConjunction (Conjunction *conj);
 extern RC freeExpr (Expr *expr);
 extern void freeVal(Value *val);
 
@@ -48,8 +85,12 @@ extern void freeVal(Value *val);
 #define CPVAL(_result,_input)						\
   do {									\
     (_result)->dt = _input->dt;						\
-  switch(_input->dt)							\
+    (_result)->isNull = _input->isNull;					\
+  switch(_input->isNull ? -1 : (int) _input->dt)			\
     {									\
+    case -1:								\
+      (_result)->v.stringV = NULL;					\
+      break;								\
     case DT_INT:							\
       (_result)->v.intV = _input->v.intV;					\
       break;								\
@@ -76,6 +117,7 @@ extern void freeVal(Value *val);
       _op->args = (Expr **) malloc(2 * sizeof(Expr*));			\
       _op->args[0] = _left;						\
       _op->args[1] = _right;						\
+      _op->numArgs = 2;							\
     } while (0)
 
 #define MAKE_UNOP_EXPR(_result,_input,_optype)				\
@@ -87,6 +129,38 @@ extern void freeVal(Value *val);
     _op->type = _optype;						\
     _op->args = (Expr **) malloc(sizeof(Expr*));			\
     _op->args[0] = _input;						\
+    _op->numArgs = 1;							\
+  } while (0)
+
+#define MAKE_BETWEEN_EXPR(_result,_input,_low,_high)			\
+  do {									\
+    Operator *_op = (Operator *) malloc(sizeof(Operator));		\
+    _result = (Expr *) malloc(sizeof(Expr));				\
+    _result->type = EXPR_OP;						\
+    _result->expr.op = _op;						\
+    _op->type = OP_COMP_BETWEEN;					\
+    _op->args = (Expr **) malloc(3 * sizeof(Expr*));			\
+    _op->args[0] = _input;						\
+    _op->args[1] = _low;						\
+    _op->args[2] = _high;						\
+    _op->numArgs = 3;							\
+  } while (0)
+
+// _list is an array of _count expressions; ownership of the elements
+// (not the array itself) moves to the new IN expression
+#define MAKE_IN_EXPR(_result,_input,_list,_count)			\
+  do {									\
+    int _i;								\
+    Operator *_op = (Operator *) malloc(sizeof(Operator));		\
+    _result = (Expr *) malloc(sizeof(Expr));				\
+    _result->type = EXPR_OP;						\
+    _result->expr.op = _op;						\
+    _op->type = OP_COMP_IN;						\
+    _op->args = (Expr **) malloc(((_count) + 1) * sizeof(Expr*));	\
+    _op->args[0] = _input;						\
+    for (_i = 0; _i < (_count); _i++)					\
+      _op->args[_i + 1] = (_list)[_i];					\
+    _op->numArgs = (_count) + 1;					\
   } while (0)
 
 #define MAKE_ATTRREF(_result,_attr)					\
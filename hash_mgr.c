@@ -0,0 +1,764 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "storage_mgr.h"
+#include "buffer_mgr.h"
+#include "hash_mgr.h"
+#include "dberror.h"
+
+/*
+    # On-disk layout of an extendible hash index file
+
+    # Page 0 holds the HashMeta block, including the list of pages that store the
+    # directory. The directory maps the low globalDepth bits of a key's hash to the
+    # first page of a bucket.
+
+    # A bucket is a chain of pages. Each page starts with three ints (localDepth, count,
+    # next) followed by (key, RID) entries. A full bucket is split in two by one more hash
+    # bit, doubling the directory only when its local depth reaches the global depth, so
+    # growth never rehashes the whole index. Overflow pages are only chained when every
+    # entry of a bucket has the same hash, e.g. for many RIDs under one key.
+*/
+
+#define HASH_POOL_SIZE 64
+#define HASH_MAX_DEPTH 16
+#define DIR_ENTRIES_PER_PAGE (PAGE_SIZE / (int)sizeof(int))
+#define MAX_DIR_PAGES ((1 << HASH_MAX_DEPTH) / DIR_ENTRIES_PER_PAGE)
+#define BUCKET_HEADER_SIZE (3 * (int)sizeof(int))
+
+#define BUCKET_LOCAL_DEPTH 0
+#define BUCKET_COUNT 1
+#define BUCKET_NEXT 2
+
+typedef struct HashMeta
+{
+    int globalDepth;
+    int numBuckets;
+    int numEntries;
+    int keyType;
+    int keyLength;
+    int numPages;
+    int freePage;
+    int numDirPages;
+    int dirPages[MAX_DIR_PAGES];
+} HashMeta;
+
+typedef struct HashMgmt
+{
+    BM_BufferPool bp;
+    HashMeta meta;
+    int *directory;
+    bool dirDirty;
+    int keySize;
+    int entrySize;
+    int capacity;
+} HashMgmt;
+
+static int bucketGet(char *page, int field)
+{
+    int value;
+    memcpy(&value, page + field * sizeof(int), sizeof(int));
+    return value;
+}
+
+static void bucketSet(char *page, int field, int value)
+{
+    memcpy(page + field * sizeof(int), &value, sizeof(int));
+}
+
+static char *bucketEntry(HashMgmt *t, char *page, int i)
+{
+    return page + BUCKET_HEADER_SIZE + i * t->entrySize;
+}
+
+static int keySizeOf(DataType keyType, int keyLength)
+{
+    switch (keyType)
+    {
+    case DT_INT:
+        return sizeof(int);
+    case DT_FLOAT:
+        return sizeof(float);
+    case DT_BOOL:
+        return sizeof(bool);
+    case DT_STRING:
+        return keyLength;
+    default:
+        return -1;
+    }
+}
+
+static RC valueToKey(HashMgmt *t, Value *value, char *key)
+{
+    if (value->dt != (DataType)t->meta.keyType)
+        return RC_RM_COMPARE_VALUE_OF_DIFFERENT_DATATYPE;
+
+    memset(key, 0, t->keySize);
+    switch (value->dt)
+    {
+    case DT_INT:
+        memcpy(key, &value->v.intV, sizeof(int));
+        break;
+    case DT_FLOAT:
+        memcpy(key, &value->v.floatV, sizeof(float));
+        break;
+    case DT_BOOL:
+        memcpy(key, &value->v.boolV, sizeof(bool));
+        break;
+    case DT_STRING:
+        strncpy(key, value->v.stringV, t->keySize);
+        break;
+    }
+    return RC_OK;
+}
+
+// 32-bit FNV-1a over the fixed-size key bytes
+static unsigned int hashKey(char *key, int size)
+{
+    unsigned int h = 2166136261u;
+
+    for (int i = 0; i < size; i++)
+    {
+        h ^= (unsigned char)key[i];
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int directorySize(HashMgmt *t)
+{
+    return 1 << t->meta.globalDepth;
+}
+
+static int bucketOf(HashMgmt *t, unsigned int h)
+{
+    return t->directory[h & (directorySize(t) - 1)];
+}
+
+static RC writeMeta(HashMgmt *t)
+{
+    BM_PageHandle page;
+    RC status = pinPage(&t->bp, &page, 0);
+
+    if (status != RC_OK)
+        return status;
+    memcpy(page.data, &t->meta, sizeof(HashMeta));
+    markDirty(&t->bp, &page);
+    return unpinPage(&t->bp, &page);
+}
+
+/*
+    # returns a zeroed page, pinned, reusing freed bucket pages before growing the file
+*/
+static RC allocatePage(HashMgmt *t, BM_PageHandle *page)
+{
+    RC status;
+
+    if (t->meta.freePage != -1)
+    {
+        if ((status = pinPage(&t->bp, page, t->meta.freePage)) != RC_OK)
+            return status;
+        t->meta.freePage = bucketGet(page->data, BUCKET_NEXT);
+    }
+    else
+    {
+        if ((status = pinPage(&t->bp, page, t->meta.numPages)) != RC_OK)
+            return status;
+        t->meta.numPages++;
+    }
+
+    memset(page->data, 0, PAGE_SIZE);
+    bucketSet(page->data, BUCKET_NEXT, -1);
+    return markDirty(&t->bp, page);
+}
+
+static RC freePage(HashMgmt *t, int pageNum)
+{
+    BM_PageHandle page;
+    RC status = pinPage(&t->bp, &page, pageNum);
+
+    if (status != RC_OK)
+        return status;
+    memset(page.data, 0, PAGE_SIZE);
+    bucketSet(page.data, BUCKET_NEXT, t->meta.freePage);
+    t->meta.freePage = pageNum;
+    markDirty(&t->bp, &page);
+    return unpinPage(&t->bp, &page);
+}
+
+/*
+    # stores the in-memory directory in its pages, adding pages as it grows
+*/
+static RC writeDirectory(HashMgmt *t)
+{
+    BM_PageHandle page;
+    int total = directorySize(t);
+    int needed = (total + DIR_ENTRIES_PER_PAGE - 1) / DIR_ENTRIES_PER_PAGE;
+    RC status;
+
+    while (t->meta.numDirPages < needed)
+    {
+        if ((status = allocatePage(t, &page)) != RC_OK)
+            return status;
+        t->meta.dirPages[t->meta.numDirPages++] = page.pageNum;
+        unpinPage(&t->bp, &page);
+    }
+
+    for (int i = 0; i < needed; i++)
+    {
+        int count = total - i * DIR_ENTRIES_PER_PAGE;
+        if (count > DIR_ENTRIES_PER_PAGE)
+            count = DIR_ENTRIES_PER_PAGE;
+
+        if ((status = pinPage(&t->bp, &page, t->meta.dirPages[i])) != RC_OK)
+            return status;
+        memcpy(page.data, t->directory + i * DIR_ENTRIES_PER_PAGE, count * sizeof(int));
+        markDirty(&t->bp, &page);
+        unpinPage(&t->bp, &page);
+    }
+
+    t->dirDirty = false;
+    return writeMeta(t);
+}
+
+/* Index manager */
+
+/*
+    # creates the index file with a single empty bucket and a one-entry directory
+*/
+RC createHash(char *idxId, DataType keyType, int keyLength)
+{
+    SM_FileHandle fHandle;
+    HashMeta meta;
+    char page[PAGE_SIZE];
+    int bucketPage = 1;
+    RC status;
+
+    if (idxId == NULL)
+        return RC_NULL_ARGUMENT;
+    if (keySizeOf(keyType, keyLength) <= 0 || keySizeOf(keyType, keyLength) + (int)sizeof(RID) > PAGE_SIZE - BUCKET_HEADER_SIZE)
+        return RC_RM_UNKOWN_DATATYPE;
+
+    memset(&meta, 0, sizeof(HashMeta));
+    meta.globalDepth = 0;
+    meta.numBuckets = 1;
+    meta.numEntries = 0;
+    meta.keyType = keyType;
+    meta.keyLength = keyLength;
+    meta.numPages = 3;
+    meta.freePage = -1;
+    meta.numDirPages = 1;
+    meta.dirPages[0] = 2;
+
+    if ((status = createPageFile(idxId)) != RC_OK)
+        return status;
+    if ((status = openPageFile(idxId, &fHandle)) != RC_OK)
+        return status;
+
+    if ((status = ensureCapacity(meta.numPages, &fHandle)) == RC_OK)
+    {
+        memset(page, 0, PAGE_SIZE);
+        memcpy(page, &meta, sizeof(HashMeta));
+        status = writeBlock(0, &fHandle, page);
+    }
+
+    // empty bucket with local depth 0
+    memset(page, 0, PAGE_SIZE);
+    bucketSet(page, BUCKET_NEXT, -1);
+    if (status == RC_OK)
+        status = writeBlock(1, &fHandle, page);
+
+    // directory with its single entry
+    memset(page, 0, PAGE_SIZE);
+    memcpy(page, &bucketPage, sizeof(int));
+    if (status == RC_OK)
+        status = writeBlock(2, &fHandle, page);
+
+    closePageFile(&fHandle);
+    return status;
+}
+
+RC openHash(HashHandle **hash, char *idxId)
+{
+    BM_PageHandle page;
+    HashHandle *handle;
+    HashMgmt *t;
+    RC status;
+
+    if (hash == NULL || idxId == NULL)
+        return RC_NULL_ARGUMENT;
+
+    handle = (HashHandle *)malloc(sizeof(HashHandle));
+    t = (HashMgmt *)calloc(1, sizeof(HashMgmt));
+    if (handle == NULL || t == NULL)
+    {
+        free(handle);
+        free(t);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    handle->idxId = (char *)malloc(strlen(idxId) + 1);
+    strcpy(handle->idxId, idxId);
+
+    // the pool keeps a pointer to the file name, so it uses the handle's copy
+    if ((status = initBufferPool(&t->bp, handle->idxId, HASH_POOL_SIZE, RS_LRU, NULL)) != RC_OK ||
+        (status = pinPage(&t->bp, &page, 0)) != RC_OK)
+    {
+        free(handle->idxId);
+        free(handle);
+        free(t);
+        return status;
+    }
+    memcpy(&t->meta, page.data, sizeof(HashMeta));
+    unpinPage(&t->bp, &page);
+
+    t->keySize = keySizeOf(t->meta.keyType, t->meta.keyLength);
+    t->entrySize = t->keySize + sizeof(RID);
+    t->capacity = (PAGE_SIZE - BUCKET_HEADER_SIZE) / t->entrySize;
+
+    int total = directorySize(t);
+    t->directory = (int *)malloc(total * sizeof(int));
+    for (int i = 0; i < t->meta.numDirPages; i++)
+    {
+        int count = total - i * DIR_ENTRIES_PER_PAGE;
+        if (count > DIR_ENTRIES_PER_PAGE)
+            count = DIR_ENTRIES_PER_PAGE;
+
+        if ((status = pinPage(&t->bp, &page, t->meta.dirPages[i])) != RC_OK)
+        {
+            shutdownBufferPool(&t->bp);
+            free(t->directory);
+            free(handle->idxId);
+            free(handle);
+            free(t);
+            return status;
+        }
+        memcpy(t->directory + i * DIR_ENTRIES_PER_PAGE, page.data, count * sizeof(int));
+        unpinPage(&t->bp, &page);
+    }
+
+    handle->keyType = t->meta.keyType;
+    handle->mgmtData = t;
+    *hash = handle;
+    return RC_OK;
+}
+
+RC closeHash(HashHandle *hash)
+{
+    HashMgmt *t;
+    RC status;
+
+    if (hash == NULL)
+        return RC_NULL_ARGUMENT;
+
+    t = hash->mgmtData;
+    if (t->dirDirty)
+        writeDirectory(t);
+    else
+        writeMeta(t);
+    status = shutdownBufferPool(&t->bp);
+
+    free(t->directory);
+    free(hash->idxId);
+    free(t);
+    free(hash);
+    return status;
+}
+
+RC deleteHash(char *idxId)
+{
+    return destroyPageFile(idxId);
+}
+
+RC getHashNumEntries(HashHandle *hash, int *result)
+{
+    *result = ((HashMgmt *)hash->mgmtData)->meta.numEntries;
+    return RC_OK;
+}
+
+RC getHashNumBuckets(HashHandle *hash, int *result)
+{
+    *result = ((HashMgmt *)hash->mgmtData)->meta.numBuckets;
+    return RC_OK;
+}
+
+RC getHashGlobalDepth(HashHandle *hash, int *result)
+{
+    *result = ((HashMgmt *)hash->mgmtData)->meta.globalDepth;
+    return RC_OK;
+}
+
+/*
+    # reads every entry of the bucket chain starting at firstPage
+    # returns the entries and the pages of the chain in malloc'ed arrays
+*/
+static RC readChain(HashMgmt *t, int firstPage, char **entries, int *count, int **pages, int *numPages)
+{
+    BM_PageHandle page;
+    int pageNum = firstPage, cap = 4;
+    RC status;
+
+    *entries = NULL;
+    *count = 0;
+    *numPages = 0;
+    *pages = (int *)malloc(cap * sizeof(int));
+
+    while (pageNum != -1)
+    {
+        if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+            return status;
+
+        int n = bucketGet(page.data, BUCKET_COUNT);
+        *entries = (char *)realloc(*entries, (*count + n + 1) * t->entrySize);
+        memcpy(*entries + *count * t->entrySize, bucketEntry(t, page.data, 0), n * t->entrySize);
+        *count += n;
+
+        if (*numPages == cap)
+        {
+            cap *= 2;
+            *pages = (int *)realloc(*pages, cap * sizeof(int));
+        }
+        (*pages)[(*numPages)++] = pageNum;
+
+        int next = bucketGet(page.data, BUCKET_NEXT);
+        unpinPage(&t->bp, &page);
+        pageNum = next;
+    }
+    return RC_OK;
+}
+
+/*
+    # writes entries as a bucket chain, reusing the given pages first and freeing the ones left over
+    # returns the first page of the chain, which is pages[0] when pages are given
+*/
+static RC writeChain(HashMgmt *t, int *pages, int numPages, int localDepth, char *entries, int count, int *firstPage)
+{
+    BM_PageHandle page, prev;
+    int used = 0, written = 0;
+    bool hasPrev = false;
+    RC status;
+
+    do
+    {
+        if (used < numPages)
+            status = pinPage(&t->bp, &page, pages[used]);
+        else
+            status = allocatePage(t, &page);
+        if (status != RC_OK)
+            return status;
+        used++;
+
+        int n = count - written;
+        if (n > t->capacity)
+            n = t->capacity;
+
+        bucketSet(page.data, BUCKET_LOCAL_DEPTH, localDepth);
+        bucketSet(page.data, BUCKET_COUNT, n);
+        bucketSet(page.data, BUCKET_NEXT, -1);
+        memcpy(bucketEntry(t, page.data, 0), entries + written * t->entrySize, n * t->entrySize);
+        written += n;
+        markDirty(&t->bp, &page);
+
+        if (hasPrev)
+        {
+            bucketSet(prev.data, BUCKET_NEXT, page.pageNum);
+            unpinPage(&t->bp, &prev);
+        }
+        else
+            *firstPage = page.pageNum;
+        prev = page;
+        hasPrev = true;
+    } while (written < count);
+    unpinPage(&t->bp, &prev);
+
+    for (; used < numPages; used++)
+    {
+        if ((status = freePage(t, pages[used])) != RC_OK)
+            return status;
+    }
+    return RC_OK;
+}
+
+/*
+    # splits the bucket starting at bucketPage by its next hash bit
+    # the directory doubles first if the bucket already uses all global bits
+*/
+static RC splitBucket(HashMgmt *t, int bucketPage)
+{
+    BM_PageHandle page;
+    char *entries, *low, *high;
+    int *pages, count, numPages, numLow = 0, numHigh = 0, newPage;
+    RC status;
+
+    if ((status = pinPage(&t->bp, &page, bucketPage)) != RC_OK)
+        return status;
+    int depth = bucketGet(page.data, BUCKET_LOCAL_DEPTH);
+    unpinPage(&t->bp, &page);
+
+    if (depth == t->meta.globalDepth)
+    {
+        int size = directorySize(t);
+        t->directory = (int *)realloc(t->directory, 2 * size * sizeof(int));
+        memcpy(t->directory + size, t->directory, size * sizeof(int));
+        t->meta.globalDepth++;
+    }
+
+    if ((status = readChain(t, bucketPage, &entries, &count, &pages, &numPages)) != RC_OK)
+    {
+        free(entries);
+        free(pages);
+        return status;
+    }
+
+    unsigned int bit = 1u << depth;
+    low = (char *)malloc((count + 1) * t->entrySize);
+    high = (char *)malloc((count + 1) * t->entrySize);
+    for (int i = 0; i < count; i++)
+    {
+        char *entry = entries + i * t->entrySize;
+        if (hashKey(entry, t->keySize) & bit)
+            memcpy(high + numHigh++ * t->entrySize, entry, t->entrySize);
+        else
+            memcpy(low + numLow++ * t->entrySize, entry, t->entrySize);
+    }
+
+    status = writeChain(t, pages, numPages, depth + 1, low, numLow, &bucketPage);
+    if (status == RC_OK)
+        status = writeChain(t, NULL, 0, depth + 1, high, numHigh, &newPage);
+
+    if (status == RC_OK)
+    {
+        // directory slots of the old bucket whose new bit is set move to the new bucket
+        for (int i = 0; i < directorySize(t); i++)
+        {
+            if (t->directory[i] == bucketPage && (i & bit))
+                t->directory[i] = newPage;
+        }
+        t->meta.numBuckets++;
+        t->dirDirty = true;
+    }
+
+    free(entries);
+    free(pages);
+    free(low);
+    free(high);
+    return status;
+}
+
+/*
+    # true if splitting the bucket could separate its entries and the new one,
+    # i.e. they do not all share the hash bits a split can still use
+*/
+static bool splitHelps(HashMgmt *t, int bucketPage, unsigned int h)
+{
+    char *entries;
+    int *pages, count, numPages;
+    unsigned int mask = (1u << HASH_MAX_DEPTH) - 1;
+    bool helps = false;
+
+    if (readChain(t, bucketPage, &entries, &count, &pages, &numPages) == RC_OK)
+    {
+        for (int i = 0; i < count && !helps; i++)
+            helps = (hashKey(entries + i * t->entrySize, t->keySize) & mask) != (h & mask);
+    }
+    free(entries);
+    free(pages);
+    return helps;
+}
+
+/*
+    # adds (key, rid); a key may be stored with any number of RIDs
+    # returns RC_IM_KEY_ALREADY_EXISTS if exactly this pair is already indexed
+*/
+RC hashInsert(HashHandle *hash, Value *key, RID rid)
+{
+    HashMgmt *t = hash->mgmtData;
+    BM_PageHandle page;
+    RC status;
+
+    char *entry = (char *)malloc(t->entrySize);
+    if ((status = valueToKey(t, key, entry)) != RC_OK)
+    {
+        free(entry);
+        return status;
+    }
+    memcpy(entry + t->keySize, &rid, sizeof(RID));
+    unsigned int h = hashKey(entry, t->keySize);
+
+    while (1)
+    {
+        int bucketPage = bucketOf(t, h);
+        int pageNum = bucketPage, freePageNum = -1, lastPage = -1, depth = 0;
+
+        // look for the pair itself and for a page with room in the chain
+        while (pageNum != -1)
+        {
+            if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+                goto done;
+
+            int n = bucketGet(page.data, BUCKET_COUNT);
+            for (int i = 0; i < n; i++)
+            {
+                if (memcmp(bucketEntry(t, page.data, i), entry, t->entrySize) == 0)
+                {
+                    unpinPage(&t->bp, &page);
+                    status = RC_IM_KEY_ALREADY_EXISTS;
+                    goto done;
+                }
+            }
+            if (freePageNum == -1 && n < t->capacity)
+                freePageNum = pageNum;
+            if (pageNum == bucketPage)
+                depth = bucketGet(page.data, BUCKET_LOCAL_DEPTH);
+
+            lastPage = pageNum;
+            pageNum = bucketGet(page.data, BUCKET_NEXT);
+            unpinPage(&t->bp, &page);
+        }
+
+        if (freePageNum == -1)
+        {
+            if (depth < HASH_MAX_DEPTH && splitHelps(t, bucketPage, h))
+            {
+                if ((status = splitBucket(t, bucketPage)) != RC_OK)
+                    goto done;
+                continue;
+            }
+
+            // every entry shares the hash, so chain an overflow page instead
+            BM_PageHandle overflow, last;
+            if ((status = allocatePage(t, &overflow)) != RC_OK)
+                goto done;
+            bucketSet(overflow.data, BUCKET_LOCAL_DEPTH, depth);
+            freePageNum = overflow.pageNum;
+            unpinPage(&t->bp, &overflow);
+
+            if ((status = pinPage(&t->bp, &last, lastPage)) != RC_OK)
+                goto done;
+            bucketSet(last.data, BUCKET_NEXT, freePageNum);
+            markDirty(&t->bp, &last);
+            unpinPage(&t->bp, &last);
+        }
+
+        if ((status = pinPage(&t->bp, &page, freePageNum)) != RC_OK)
+            goto done;
+        int n = bucketGet(page.data, BUCKET_COUNT);
+        memcpy(bucketEntry(t, page.data, n), entry, t->entrySize);
+        bucketSet(page.data, BUCKET_COUNT, n + 1);
+        markDirty(&t->bp, &page);
+        unpinPage(&t->bp, &page);
+
+        t->meta.numEntries++;
+        status = writeMeta(t);
+        break;
+    }
+
+done:
+    free(entry);
+    return status;
+}
+
+/*
+    # removes (key, rid); buckets are not merged when they become empty
+*/
+RC hashDelete(HashHandle *hash, Value *key, RID rid)
+{
+    HashMgmt *t = hash->mgmtData;
+    BM_PageHandle page;
+    RC status;
+
+    char *entry = (char *)malloc(t->entrySize);
+    if ((status = valueToKey(t, key, entry)) != RC_OK)
+    {
+        free(entry);
+        return status;
+    }
+    memcpy(entry + t->keySize, &rid, sizeof(RID));
+
+    int pageNum = bucketOf(t, hashKey(entry, t->keySize));
+    while (pageNum != -1)
+    {
+        if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+            break;
+
+        int n = bucketGet(page.data, BUCKET_COUNT);
+        for (int i = 0; i < n; i++)
+        {
+            if (memcmp(bucketEntry(t, page.data, i), entry, t->entrySize) == 0)
+            {
+                // the last entry of the page fills the gap
+                memcpy(bucketEntry(t, page.data, i), bucketEntry(t, page.data, n - 1), t->entrySize);
+                bucketSet(page.data, BUCKET_COUNT, n - 1);
+                markDirty(&t->bp, &page);
+                unpinPage(&t->bp, &page);
+                free(entry);
+
+                t->meta.numEntries--;
+                return writeMeta(t);
+            }
+        }
+
+        int next = bucketGet(page.data, BUCKET_NEXT);
+        unpinPage(&t->bp, &page);
+        pageNum = next;
+    }
+
+    free(entry);
+    return (status == RC_OK) ? RC_IM_KEY_NOT_FOUND : status;
+}
+
+/*
+    # collects the RIDs stored under key, RC_IM_KEY_NOT_FOUND if there are none
+*/
+RC hashLookup(HashHandle *hash, Value *key, RID **rids, int *numRids)
+{
+    HashMgmt *t = hash->mgmtData;
+    BM_PageHandle page;
+    int cap = 4;
+    RC status;
+
+    char *probe = (char *)malloc(t->keySize);
+    if ((status = valueToKey(t, key, probe)) != RC_OK)
+    {
+        free(probe);
+        return status;
+    }
+
+    *numRids = 0;
+    *rids = (RID *)malloc(cap * sizeof(RID));
+
+    int pageNum = bucketOf(t, hashKey(probe, t->keySize));
+    while (pageNum != -1)
+    {
+        if ((status = pinPage(&t->bp, &page, pageNum)) != RC_OK)
+            break;
+
+        int n = bucketGet(page.data, BUCKET_COUNT);
+        for (int i = 0; i < n; i++)
+        {
+            char *entry = bucketEntry(t, page.data, i);
+            if (memcmp(entry, probe, t->keySize) != 0)
+                continue;
+            if (*numRids == cap)
+            {
+                cap *= 2;
+                *rids = (RID *)realloc(*rids, cap * sizeof(RID));
+            }
+            memcpy(*rids + (*numRids)++, entry + t->keySize, sizeof(RID));
+        }
+
+        int next = bucketGet(page.data, BUCKET_NEXT);
+        unpinPage(&t->bp, &page);
+        pageNum = next;
+    }
+
+    free(probe);
+    if (status != RC_OK || *numRids == 0)
+    {
+        free(*rids);
+        *rids = NULL;
+        *numRids = 0;
+        return (status != RC_OK) ? status : RC_IM_KEY_NOT_FOUND;
+    }
+    return RC_OK;
+}
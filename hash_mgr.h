@@ -0,0 +1,33 @@
+#ifndef HASH_MGR_H
+#define HASH_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// structure for accessing hash indexes
+typedef struct HashHandle
+{
+	DataType keyType;
+	char *idxId;
+	void *mgmtData;
+} HashHandle;
+
+// create, destroy, open, and close an extendible hash index
+// keyLength is only used for DT_STRING keys
+extern RC createHash(char *idxId, DataType keyType, int keyLength);
+extern RC openHash(HashHandle **hash, char *idxId);
+extern RC closeHash(HashHandle *hash);
+extern RC deleteHash(char *idxId);
+
+// access information about a hash index
+extern RC getHashNumEntries(HashHandle *hash, int *result);
+extern RC getHashNumBuckets(HashHandle *hash, int *result);
+extern RC getHashGlobalDepth(HashHandle *hash, int *result);
+
+// index access
+// hashLookup returns every RID stored under key in a malloc'ed array, the caller frees it
+extern RC hashInsert(HashHandle *hash, Value *key, RID rid);
+extern RC hashDelete(HashHandle *hash, Value *key, RID rid);
+extern RC hashLookup(HashHandle *hash, Value *key, RID **rids, int *numRids);
+
+#endif // HASH_MGR_H
@@ -0,0 +1,676 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+#include "lock_mgr.h"
+
+// Defaults of initLockManager
+#define LOCK_SHARDS 64
+#define DEADLOCK_MS 10
+// Buckets of the hash table of each shard
+#define LOCK_BUCKETS 256
+// Locks an owner holds without growing its list
+#define OWNER_INLINE_LOCKS 4
+
+struct OwnerState;
+
+// the request of one owner for one lock; a granted request waiting for a stronger mode has
+// upgrade set to it, upgrade equals mode otherwise
+typedef struct LockRequest
+{
+    struct OwnerState *owner;
+    LockMode mode;
+    LockMode upgrade;
+    bool granted;
+    struct LockRequest *next;
+} LockRequest;
+
+// a table or record somebody holds or waits for, its requests in the order they came:
+// the granted ones first, then the waiting ones, which are granted in that order
+typedef struct LockEntry
+{
+    char *table;
+    RID id;
+    unsigned int hash;
+    LockRequest *queue;
+    struct LockEntry *next; // in its bucket
+} LockEntry;
+
+// a part of the lock table with a mutex of its own, waiters on its locks wait on changed
+typedef struct LockShard
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t changed; // broadcast when a lock of the shard is released or granted
+    LockEntry *buckets[LOCK_BUCKETS];
+    LockStats stats;
+} LockShard;
+
+typedef struct HeldLock
+{
+    LockShard *shard;
+    LockEntry *entry;
+    LockRequest *request;
+} HeldLock;
+
+// an owner: its granted requests, only touched by its own thread, and the request it waits
+// for, which deadlock searches read under the mutexes of every shard
+typedef struct OwnerState
+{
+    HeldLock inlineHeld[OWNER_INLINE_LOCKS];
+    HeldLock *held;
+    int numHeld;
+    int maxHeld;
+    LockEntry *waitingOn;
+    LockRequest *waiting;
+    long visited; // search of the deadlock search that last visited it
+} OwnerState;
+
+// The lock manager of the process
+static struct LockMgr
+{
+    bool started;
+    LockShard *shards;
+    int numShards;
+    int deadlockMs;
+    int timeoutMs;
+    long searches; // deadlock searches so far, under the mutexes of every shard
+} lockMgr;
+
+// compatibility of a held mode (row) with a requested one (column)
+static const bool compatible[4][4] = {
+    // IS     IX     S      X
+    {true, true, true, false},   // IS
+    {true, true, false, false},  // IX
+    {true, false, true, false},  // S
+    {false, false, false, false} // X
+};
+
+/*
+    # the weakest mode covering both, S and IX together take X
+*/
+static LockMode combineModes(LockMode a, LockMode b)
+{
+    if (a == b)
+        return a;
+    if (a == LOCK_IS)
+        return b;
+    if (b == LOCK_IS)
+        return a;
+    return LOCK_X;
+}
+
+/*
+    # FNV-1a over the table name and the RID
+*/
+static unsigned int lockHash(char *table, RID id)
+{
+    unsigned int hash = 2166136261u;
+
+    for (char *c = table; *c != '\0'; c++)
+    {
+        hash ^= (unsigned char)*c;
+        hash *= 16777619u;
+    }
+    hash ^= (unsigned int)id.page;
+    hash *= 16777619u;
+    hash ^= (unsigned int)id.slot;
+    hash *= 16777619u;
+    return hash;
+}
+
+static double msSince(struct timespec *start)
+{
+    struct timespec now;
+
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (now.tv_sec - start->tv_sec) * 1000.0 + (now.tv_nsec - start->tv_nsec) / 1000000.0;
+}
+
+/*
+    # finds the entry of a lock in its shard, creating it if create is set; NULL if there is none
+*/
+static LockEntry *findEntry(LockShard *shard, char *table, RID id, unsigned int hash, bool create)
+{
+    LockEntry **bucket = &shard->buckets[(hash / lockMgr.numShards) % LOCK_BUCKETS];
+
+    for (LockEntry *entry = *bucket; entry != NULL; entry = entry->next)
+        if (entry->hash == hash && entry->id.page == id.page && entry->id.slot == id.slot && strcmp(entry->table, table) == 0)
+            return entry;
+    if (!create)
+        return NULL;
+
+    LockEntry *entry = (LockEntry *)malloc(sizeof(LockEntry));
+    if (entry == NULL || (entry->table = strdup(table)) == NULL)
+    {
+        free(entry);
+        return NULL;
+    }
+    entry->id = id;
+    entry->hash = hash;
+    entry->queue = NULL;
+    entry->next = *bucket;
+    *bucket = entry;
+    return entry;
+}
+
+/*
+    # frees an entry nobody holds or waits for any more
+*/
+static void dropEntryIfUnused(LockShard *shard, LockEntry *entry)
+{
+    if (entry->queue != NULL)
+        return;
+    for (LockEntry **link = &shard->buckets[(entry->hash / lockMgr.numShards) % LOCK_BUCKETS]; *link != NULL;
+         link = &(*link)->next)
+    {
+        if (*link == entry)
+        {
+            *link = entry->next;
+            break;
+        }
+    }
+    free(entry->table);
+    free(entry);
+}
+
+/*
+    # true once the request has the mode it asked for
+*/
+static bool isGranted(LockRequest *request)
+{
+    return request->granted && request->upgrade == request->mode;
+}
+
+/*
+    # true if an upgrade of self to mode goes with every other granted request of the entry
+*/
+static bool upgradable(LockEntry *entry, LockRequest *self, LockMode mode)
+{
+    for (LockRequest *r = entry->queue; r != NULL && r->granted; r = r->next)
+        if (r != self && !compatible[r->mode][mode])
+            return false;
+    return true;
+}
+
+/*
+    # true if a new request for mode goes with the granted requests of the entry and with the
+    # modes pending upgrades wait for, which go first
+*/
+static bool grantable(LockEntry *entry, LockMode mode)
+{
+    for (LockRequest *r = entry->queue; r != NULL && r->granted; r = r->next)
+        if (!compatible[r->mode][mode] || !compatible[r->upgrade][mode])
+            return false;
+    return true;
+}
+
+/*
+    # grants what can be granted after a request of the entry was released or given up: waiting
+    # upgrades first, then the waiting requests in the order they came, up to the first that
+    # has to wait; wakes the waiters of the shard if anything was granted
+*/
+static void grantWaiting(LockShard *shard, LockEntry *entry)
+{
+    bool changed = false;
+    LockRequest *r;
+
+    for (r = entry->queue; r != NULL && r->granted; r = r->next)
+    {
+        if (r->upgrade != r->mode && upgradable(entry, r, r->upgrade))
+        {
+            r->mode = r->upgrade;
+            changed = true;
+        }
+    }
+    for (; r != NULL && grantable(entry, r->mode); r = r->next)
+    {
+        r->granted = true;
+        changed = true;
+    }
+    if (changed)
+        pthread_cond_broadcast(&shard->changed);
+}
+
+/*
+    # takes a request out of its entry, it is freed by the caller
+*/
+static void unlinkRequest(LockEntry *entry, LockRequest *request)
+{
+    for (LockRequest **link = &entry->queue; *link != NULL; link = &(*link)->next)
+    {
+        if (*link == request)
+        {
+            *link = request->next;
+            break;
+        }
+    }
+}
+
+static void lockAllShards(void)
+{
+    for (int i = 0; i < lockMgr.numShards; i++)
+        pthread_mutex_lock(&lockMgr.shards[i].mutex);
+}
+
+static void unlockAllShards(void)
+{
+    for (int i = lockMgr.numShards - 1; i >= 0; i--)
+        pthread_mutex_unlock(&lockMgr.shards[i].mutex);
+}
+
+/*
+    # true if waiting has to wait for the request blocking of the same entry: an upgrade for granted
+    # requests in conflicting modes, a new request also for those that came before it and wait
+*/
+static bool blocks(LockRequest *blocking, LockRequest *waiting)
+{
+    if (blocking->owner == waiting->owner)
+        return false;
+    if (waiting->granted)
+        return blocking->granted && !compatible[blocking->mode][waiting->upgrade];
+    if (!blocking->granted)
+        return true;
+    return !compatible[blocking->mode][waiting->mode] || !compatible[blocking->upgrade][waiting->mode];
+}
+
+/*
+    # depth first search of the waits-for graph: true if owner waits, directly or through the
+    # owners it waits for, for target; under the mutexes of every shard
+*/
+static bool waitsFor(OwnerState *owner, OwnerState *target, long search)
+{
+    LockRequest *waiting = owner->waiting;
+
+    if (waiting == NULL || owner->visited == search)
+        return false;
+    owner->visited = search;
+
+    // A new request waits for requests before it, an upgrade for all granted ones, which come first
+    // and may also have been granted after it
+    for (LockRequest *r = owner->waitingOn->queue; r != NULL; r = r->next)
+    {
+        if (waiting->granted ? !r->granted : r == waiting)
+            break;
+        if (!blocks(r, waiting))
+            continue;
+        if (r->owner == target || waitsFor(r->owner, target, search))
+            return true;
+    }
+    return false;
+}
+
+/*
+    # gives up the request owner waits for, an upgrade falls back to the mode it had
+*/
+static void cancelWait(LockShard *shard, OwnerState *owner)
+{
+    LockEntry *entry = owner->waitingOn;
+    LockRequest *request = owner->waiting;
+
+    owner->waitingOn = NULL;
+    owner->waiting = NULL;
+    if (request->granted)
+        request->upgrade = request->mode;
+    else
+    {
+        unlinkRequest(entry, request);
+        free(request);
+    }
+    grantWaiting(shard, entry);
+    dropEntryIfUnused(shard, entry);
+}
+
+/*
+    # waits, with the mutex of the shard held, until the request of the owner is granted
+    # after deadlockMs the waits-for graph is searched once, with every shard locked so that it
+    # does not change meanwhile; the waiter that closed a cycle gives its request up
+*/
+static RC waitForLock(LockShard *shard, OwnerState *owner, LockRequest *request)
+{
+    struct timespec start, wake;
+    bool searched = false;
+    RC status = RC_OK;
+
+    shard->stats.waits++;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    while (!isGranted(request))
+    {
+        double waited = msSince(&start);
+        if (!searched && waited >= lockMgr.deadlockMs)
+        {
+            searched = true;
+            pthread_mutex_unlock(&shard->mutex);
+            lockAllShards();
+            bool deadlocked = !isGranted(request) && waitsFor(owner, owner, ++lockMgr.searches);
+            if (deadlocked)
+            {
+                cancelWait(shard, owner);
+                shard->stats.deadlocks++;
+            }
+            unlockAllShards();
+            pthread_mutex_lock(&shard->mutex);
+            if (deadlocked)
+            {
+                shard->stats.waitMs += msSince(&start);
+                return RC_LOCK_DEADLOCK;
+            }
+            continue;
+        }
+        if (lockMgr.timeoutMs >= 0 && waited >= lockMgr.timeoutMs)
+        {
+            cancelWait(shard, owner);
+            shard->stats.timeouts++;
+            status = RC_LOCK_TIMEOUT;
+            break;
+        }
+
+        // Sleep until a change of the shard or the next deadline
+        double next = !searched ? lockMgr.deadlockMs : lockMgr.timeoutMs;
+        if (searched && lockMgr.timeoutMs < 0)
+            next = waited + 1000;
+        long ns = (long)((next - waited) * 1000000.0) + 1;
+        clock_gettime(CLOCK_REALTIME, &wake);
+        wake.tv_sec += ns / 1000000000L;
+        wake.tv_nsec += ns % 1000000000L;
+        wake.tv_sec += wake.tv_nsec / 1000000000L;
+        wake.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&shard->changed, &shard->mutex, &wake);
+    }
+
+    owner->waitingOn = NULL;
+    owner->waiting = NULL;
+    shard->stats.waitMs += msSince(&start);
+    return status;
+}
+
+/*
+    # adds a granted request to the locks the owner holds
+*/
+static RC addHeld(OwnerState *owner, LockShard *shard, LockEntry *entry, LockRequest *request)
+{
+    if (owner->numHeld == owner->maxHeld)
+    {
+        int max = owner->maxHeld * 2;
+        HeldLock *grown = (HeldLock *)malloc(max * sizeof(HeldLock));
+        if (grown == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memcpy(grown, owner->held, owner->numHeld * sizeof(HeldLock));
+        if (owner->held != owner->inlineHeld)
+            free(owner->held);
+        owner->held = grown;
+        owner->maxHeld = max;
+    }
+    owner->held[owner->numHeld].shard = shard;
+    owner->held[owner->numHeld].entry = entry;
+    owner->held[owner->numHeld].request = request;
+    owner->numHeld++;
+    return RC_OK;
+}
+
+/*
+    # releases the lock of held, under the mutex of its shard
+*/
+static void releaseHeld(HeldLock *held)
+{
+    unlinkRequest(held->entry, held->request);
+    free(held->request);
+    grantWaiting(held->shard, held->entry);
+    dropEntryIfUnused(held->shard, held->entry);
+}
+
+/*
+    # starts the lock manager with an empty lock table
+*/
+RC initLockManager(int numShards, int deadlockMs, int timeoutMs)
+{
+    if (lockMgr.started)
+        return RC_OK;
+
+    memset(&lockMgr, 0, sizeof(lockMgr));
+    lockMgr.numShards = numShards > 0 ? numShards : LOCK_SHARDS;
+    lockMgr.deadlockMs = deadlockMs > 0 ? deadlockMs : DEADLOCK_MS;
+    lockMgr.timeoutMs = timeoutMs;
+    if ((lockMgr.shards = (LockShard *)calloc(lockMgr.numShards, sizeof(LockShard))) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (int i = 0; i < lockMgr.numShards; i++)
+    {
+        pthread_mutex_init(&lockMgr.shards[i].mutex, NULL);
+        pthread_cond_init(&lockMgr.shards[i].changed, NULL);
+    }
+    lockMgr.started = true;
+    return RC_OK;
+}
+
+/*
+    # stops the lock manager, every owner must have released its locks before
+*/
+RC shutdownLockManager(void)
+{
+    if (!lockMgr.started)
+        return RC_OK;
+
+    for (int i = 0; i < lockMgr.numShards; i++)
+    {
+        LockShard *shard = &lockMgr.shards[i];
+        for (int b = 0; b < LOCK_BUCKETS; b++)
+        {
+            while (shard->buckets[b] != NULL)
+            {
+                LockEntry *entry = shard->buckets[b];
+                shard->buckets[b] = entry->next;
+                while (entry->queue != NULL)
+                {
+                    LockRequest *request = entry->queue;
+                    entry->queue = request->next;
+                    free(request);
+                }
+                free(entry->table);
+                free(entry);
+            }
+        }
+        pthread_mutex_destroy(&shard->mutex);
+        pthread_cond_destroy(&shard->changed);
+    }
+    free(lockMgr.shards);
+    memset(&lockMgr, 0, sizeof(lockMgr));
+    return RC_OK;
+}
+
+RC beginLockOwner(LockOwner *owner)
+{
+    OwnerState *state = (OwnerState *)calloc(1, sizeof(OwnerState));
+
+    if (state == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    state->held = state->inlineHeld;
+    state->maxHeld = OWNER_INLINE_LOCKS;
+    owner->mgmtData = state;
+    return RC_OK;
+}
+
+/*
+    # releases every lock of the owner, the shard of each is locked once for all of its locks
+    # held in a row; the owner ends
+*/
+RC releaseLocks(LockOwner *owner)
+{
+    OwnerState *state = owner->mgmtData;
+
+    if (state == NULL)
+        return RC_OK;
+    for (int i = 0; i < state->numHeld;)
+    {
+        LockShard *shard = state->held[i].shard;
+        pthread_mutex_lock(&shard->mutex);
+        for (; i < state->numHeld && state->held[i].shard == shard; i++)
+            releaseHeld(&state->held[i]);
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    if (state->held != state->inlineHeld)
+        free(state->held);
+    free(state);
+    owner->mgmtData = NULL;
+    return RC_OK;
+}
+
+/*
+    # takes a lock for the owner, waiting while others hold conflicting ones
+    # returns RC_LOCK_DEADLOCK if waiting would never end, the owner should then release its
+    # locks, and RC_LOCK_TIMEOUT after timeoutMs, or right away without wait; the owner keeps
+    # the locks it had in every case
+*/
+RC acquireLock(LockOwner *owner, char *table, RID id, LockMode mode, bool wait)
+{
+    OwnerState *state = owner->mgmtData;
+    unsigned int hash = lockHash(table, id);
+    LockShard *shard = &lockMgr.shards[hash % lockMgr.numShards];
+    LockRequest *request;
+    RC status = RC_OK;
+
+    if (!lockMgr.started || state == NULL)
+        return RC_ERROR;
+
+    pthread_mutex_lock(&shard->mutex);
+    LockEntry *entry = findEntry(shard, table, id, hash, true);
+    if (entry == NULL)
+    {
+        pthread_mutex_unlock(&shard->mutex);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    for (request = entry->queue; request != NULL && request->owner != state; request = request->next)
+        ;
+
+    if (request != NULL)
+    {
+        // Held already: nothing to do if the mode covers the new one, an upgrade otherwise
+        LockMode upgrade = combineModes(request->mode, mode);
+        if (upgrade != request->mode)
+        {
+            request->upgrade = upgrade;
+            if (upgradable(entry, request, upgrade))
+                request->mode = upgrade;
+            else if (!wait)
+            {
+                request->upgrade = request->mode;
+                status = RC_LOCK_TIMEOUT;
+            }
+            else
+            {
+                state->waitingOn = entry;
+                state->waiting = request;
+                status = waitForLock(shard, state, request);
+            }
+            if (status == RC_OK)
+                shard->stats.acquired++;
+        }
+        pthread_mutex_unlock(&shard->mutex);
+        return status;
+    }
+
+    if ((request = (LockRequest *)malloc(sizeof(LockRequest))) == NULL)
+    {
+        dropEntryIfUnused(shard, entry);
+        pthread_mutex_unlock(&shard->mutex);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    request->owner = state;
+    request->mode = mode;
+    request->upgrade = mode;
+    request->next = NULL;
+
+    // Granted right away if nobody waits before it and the holders let it, queued at the end
+    LockRequest **tail = &entry->queue;
+    bool waiters = false;
+    for (; *tail != NULL; tail = &(*tail)->next)
+        waiters = waiters || !(*tail)->granted;
+    request->granted = !waiters && grantable(entry, mode);
+    if (!request->granted && !wait)
+    {
+        free(request);
+        dropEntryIfUnused(shard, entry);
+        pthread_mutex_unlock(&shard->mutex);
+        return RC_LOCK_TIMEOUT;
+    }
+    *tail = request;
+    if (!request->granted)
+    {
+        state->waitingOn = entry;
+        state->waiting = request;
+        status = waitForLock(shard, state, request);
+    }
+    if (status == RC_OK && (status = addHeld(state, shard, entry, request)) != RC_OK)
+    {
+        unlinkRequest(entry, request);
+        free(request);
+        grantWaiting(shard, entry);
+        dropEntryIfUnused(shard, entry);
+    }
+    if (status == RC_OK)
+        shard->stats.acquired++;
+    pthread_mutex_unlock(&shard->mutex);
+    return status;
+}
+
+/*
+    # true if the owner holds a lock on the table or record, in any mode
+*/
+bool holdsLock(LockOwner *owner, char *table, RID id)
+{
+    OwnerState *state = owner->mgmtData;
+
+    if (state == NULL)
+        return false;
+    for (int i = 0; i < state->numHeld; i++)
+    {
+        LockEntry *entry = state->held[i].entry;
+        if (entry->id.page == id.page && entry->id.slot == id.slot && strcmp(entry->table, table) == 0)
+            return true;
+    }
+    return false;
+}
+
+/*
+    # releases one lock of the owner before it ends, for a lock taken on something that turned out
+    # not to be there; returns RC_ERROR if the owner does not hold it
+*/
+RC releaseLock(LockOwner *owner, char *table, RID id)
+{
+    OwnerState *state = owner->mgmtData;
+
+    if (state == NULL)
+        return RC_ERROR;
+    for (int i = state->numHeld - 1; i >= 0; i--)
+    {
+        HeldLock held = state->held[i];
+        if (held.entry->id.page != id.page || held.entry->id.slot != id.slot || strcmp(held.entry->table, table) != 0)
+            continue;
+        pthread_mutex_lock(&held.shard->mutex);
+        releaseHeld(&held);
+        pthread_mutex_unlock(&held.shard->mutex);
+        memmove(&state->held[i], &state->held[i + 1], (state->numHeld - i - 1) * sizeof(HeldLock));
+        state->numHeld--;
+        return RC_OK;
+    }
+    return RC_ERROR;
+}
+
+RC getLockStats(LockStats *stats)
+{
+    if (stats == NULL)
+        return RC_NULL_ARGUMENT;
+
+    memset(stats, 0, sizeof(LockStats));
+    for (int i = 0; i < lockMgr.numShards && lockMgr.started; i++)
+    {
+        LockShard *shard = &lockMgr.shards[i];
+        pthread_mutex_lock(&shard->mutex);
+        stats->acquired += shard->stats.acquired;
+        stats->waits += shard->stats.waits;
+        stats->deadlocks += shard->stats.deadlocks;
+        stats->timeouts += shard->stats.timeouts;
+        stats->waitMs += shard->stats.waitMs;
+        pthread_mutex_unlock(&shard->mutex);
+    }
+    return RC_OK;
+}
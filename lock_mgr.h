@@ -0,0 +1,53 @@
+#ifndef LOCK_MGR_H
+#define LOCK_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+
+// lock modes; IS and IX on a table announce S and X locks on records of it
+typedef enum LockMode
+{
+	LOCK_IS = 0,
+	LOCK_IX = 1,
+	LOCK_S = 2,
+	LOCK_X = 3
+} LockMode;
+
+// what holds and waits for locks: a transaction, or one operation outside of transactions
+// An owner is used by one thread at a time
+typedef struct LockOwner
+{
+	void *mgmtData;
+} LockOwner;
+
+// what the lock manager did since it was started
+typedef struct LockStats
+{
+	long acquired;		// requests granted, upgrades included
+	long waits;		// requests that were not granted right away
+	long deadlocks;		// requests refused to break a deadlock
+	long timeouts;
+	double waitMs;		// time spent waiting by all requests
+} LockStats;
+
+// starting and stopping the lock manager of the process
+// the lock table is split into numShards shards with a mutex each, 0 for the default; a request
+// that waited deadlockMs looks for a cycle in the waits-for graph once and is refused if it closes
+// one, a request that waited timeoutMs gives up (< 0 waits until granted or deadlocked)
+extern RC initLockManager(int numShards, int deadlockMs, int timeoutMs);
+extern RC shutdownLockManager(void);
+
+// owners, releaseLocks releases every lock of the owner and ends it
+extern RC beginLockOwner(LockOwner *owner);
+extern RC releaseLocks(LockOwner *owner);
+
+// locks on a table, named by its page file, with id.page < 0, or on a record of it
+// held until releaseLocks; a lock the owner holds already is upgraded if mode is stronger,
+// without wait a lock that cannot be granted right away is refused with RC_LOCK_TIMEOUT
+extern RC acquireLock(LockOwner *owner, char *table, RID id, LockMode mode, bool wait);
+extern bool holdsLock(LockOwner *owner, char *table, RID id);
+extern RC releaseLock(LockOwner *owner, char *table, RID id);
+
+extern RC getLockStats(LockStats *stats);
+
+#endif // LOCK_MGR_H
@@ -0,0 +1,813 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <pthread.h>
+#include "log_mgr.h"
+
+#define LOG_MAGIC 0x57414C31
+// largest record readLog accepts, a longer length field is a torn write
+#define LOG_MAX_RECORD (64 * 1024 * 1024)
+// size the log file grows to before it becomes a segment, when openLog is given none
+#define LOG_SEGMENT_SIZE (4L * 1024 * 1024)
+
+// first bytes of the log file
+typedef struct LogFileHeader
+{
+    int magic;
+    int unused;
+    LSN base; // LSN of the first record in the file
+} LogFileHeader;
+
+#define LOG_HEADER_SIZE ((long)sizeof(LogFileHeader))
+
+// a record in the log file: this header, the table name, the record data and the page changes,
+// each a LogChangeHeader followed by its bytes; the checksum covers everything after it
+typedef struct LogRecordHeader
+{
+    int length;
+    unsigned int checksum;
+    LSN lsn;
+    int type;
+    int page;
+    int slot;
+    int numPages;
+    long txId;
+    LSN compensates;
+    int nameLength;
+    int dataLength;
+    int numChanges;
+} LogRecordHeader;
+
+typedef struct LogChangeHeader
+{
+    int pageNum;
+    unsigned short offset;
+    unsigned short length;
+} LogChangeHeader;
+
+// an older part of the log, renamed to "<log file>.<base>" once the log file had grown past
+// the segment size; it holds the records from base to the base of the next segment
+typedef struct LogSegment
+{
+    LSN base;
+    char *fileName;
+} LogSegment;
+
+// The log of the process, like the record manager there is only one
+// Appended records collect in buffer until a sync writes them; the thread that syncs
+// takes the whole buffer, so one fsync covers every record appended in the meantime
+static struct LogMgr
+{
+    bool open;
+    FILE *file;
+    char *fileName;
+    LSN base;                // LSN of the first record kept, in the oldest segment
+    LSN fileBase;            // LSN of the first record in the file
+    long segmentSize;        // <= 0: the file never becomes a segment
+    LogSegment *segments;    // oldest first
+    int numSegments;
+    LSN end;                 // LSN of the next record
+    LSN durable;             // every record before it is on disk
+    char *buffer;            // records after the ones being synced
+    int bufferLength;
+    int bufferSize;
+    char *spare;             // records being synced
+    int spareSize;
+    int pending;             // records in buffer
+    bool syncing;
+    bool failed;             // a write of records failed, they and the ones after never reach the disk
+    pthread_mutex_t lock;
+    pthread_cond_t synced;   // broadcast after every sync
+    pthread_cond_t wake;     // wakes the group commit thread
+    pthread_t thread;
+    bool hasThread;
+    bool stopping;
+    int groupSize;
+    int groupDelayMs;
+    LogStats stats;
+} logMgr;
+
+/*
+    # FNV-1a over length bytes
+*/
+static unsigned int logChecksum(char *data, int length)
+{
+    unsigned int hash = 2166136261u;
+
+    for (int i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)data[i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/*
+    # checksum of a serialized record, over the bytes after its checksum field
+*/
+static unsigned int recordChecksum(char *record, int length)
+{
+    int skip = offsetof(LogRecordHeader, lsn);
+    return logChecksum(record + skip, length - skip);
+}
+
+/*
+    # writes the header of a log file whose first record gets LSN base
+*/
+static bool writeHeader(FILE *file, LSN base)
+{
+    LogFileHeader header;
+
+    header.magic = LOG_MAGIC;
+    header.unused = 0;
+    header.base = base;
+    return fseek(file, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, file) == 1 && fflush(file) == 0;
+}
+
+/*
+    # fsyncs the directory of the log, so that created and renamed log files survive a crash
+*/
+static void syncLogDirectory(void)
+{
+    char *slash = strrchr(logMgr.fileName, '/');
+    char *dir = slash == NULL ? strdup(".") : strndup(logMgr.fileName, slash - logMgr.fileName + 1);
+
+    if (dir == NULL)
+        return;
+    int fd = open(dir, O_RDONLY);
+    if (fd >= 0)
+    {
+        fsync(fd);
+        close(fd);
+    }
+    free(dir);
+}
+
+/*
+    # name of the segment of the log in fileName that starts at base, malloc'ed
+*/
+static char *segmentFileName(char *fileName, LSN base)
+{
+    char *name = malloc(strlen(fileName) + 32);
+
+    if (name != NULL)
+        sprintf(name, "%s.%ld", fileName, base);
+    return name;
+}
+
+static int compareSegments(const void *a, const void *b)
+{
+    LSN x = ((LogSegment *)a)->base, y = ((LogSegment *)b)->base;
+    return x < y ? -1 : x > y;
+}
+
+/*
+    # finds the segments of the log in fileName, oldest first
+*/
+static RC listSegments(char *fileName, LogSegment **segments, int *numSegments)
+{
+    char *slash = strrchr(fileName, '/');
+    char *dirName = slash == NULL ? strdup(".") : strndup(fileName, slash - fileName + 1);
+    char *baseName = slash == NULL ? fileName : slash + 1;
+    int prefixLength = strlen(baseName), size = 0;
+    struct dirent *entry;
+
+    *segments = NULL;
+    *numSegments = 0;
+    if (dirName == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    DIR *dir = opendir(dirName);
+    free(dirName);
+    if (dir == NULL)
+        return RC_FILE_NOT_FOUND;
+
+    while ((entry = readdir(dir)) != NULL)
+    {
+        char *end;
+        if (strncmp(entry->d_name, baseName, prefixLength) != 0 || entry->d_name[prefixLength] != '.')
+            continue;
+        LSN base = strtol(entry->d_name + prefixLength + 1, &end, 10);
+        if (end == entry->d_name + prefixLength + 1 || *end != '\0')
+            continue;
+
+        if (*numSegments == size)
+        {
+            size = size > 0 ? size * 2 : 8;
+            LogSegment *grown = realloc(*segments, size * sizeof(LogSegment));
+            if (grown == NULL)
+                break;
+            *segments = grown;
+        }
+        (*segments)[*numSegments].base = base;
+        if (((*segments)[*numSegments].fileName = segmentFileName(fileName, base)) == NULL)
+            break;
+        (*numSegments)++;
+    }
+    closedir(dir);
+    if (entry != NULL)
+    {
+        for (int i = 0; i < *numSegments; i++)
+            free((*segments)[i].fileName);
+        free(*segments);
+        *segments = NULL;
+        *numSegments = 0;
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    if (*numSegments > 1)
+        qsort(*segments, *numSegments, sizeof(LogSegment), compareSegments);
+    return RC_OK;
+}
+
+/*
+    # reads the record expected at lsn from the current position of file into *buffer, growing it
+    # returns RC_RM_NO_MORE_TUPLES at the end of the log, which is also where a torn record starts
+*/
+static RC readRecord(FILE *file, LSN lsn, char **buffer, int *size)
+{
+    LogRecordHeader header;
+
+    if (fread(&header, sizeof(header), 1, file) != 1)
+        return RC_RM_NO_MORE_TUPLES;
+    if (header.lsn != lsn || header.length < (int)sizeof(header) || header.length > LOG_MAX_RECORD)
+        return RC_RM_NO_MORE_TUPLES;
+
+    if (header.length > *size)
+    {
+        char *grown = realloc(*buffer, header.length);
+        if (grown == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        *buffer = grown;
+        *size = header.length;
+    }
+    memcpy(*buffer, &header, sizeof(header));
+    if (header.length > (int)sizeof(header) && fread(*buffer + sizeof(header), header.length - sizeof(header), 1, file) != 1)
+        return RC_RM_NO_MORE_TUPLES;
+    if (recordChecksum(*buffer, header.length) != header.checksum)
+        return RC_RM_NO_MORE_TUPLES;
+    return RC_OK;
+}
+
+/*
+    # checks the records of a log file starting at base up to the first torn or corrupt one
+    # and sets *end to its LSN, file is left positioned there
+*/
+static RC scanFile(FILE *file, LSN base, LSN *end)
+{
+    char *buffer = NULL;
+    int size = 0;
+    RC status;
+
+    *end = base;
+    if (fseek(file, LOG_HEADER_SIZE, SEEK_SET) != 0)
+        return RC_READ_NON_EXISTING_PAGE;
+    while ((status = readRecord(file, *end, &buffer, &size)) == RC_OK)
+        *end += ((LogRecordHeader *)buffer)->length;
+    free(buffer);
+    return status == RC_RM_NO_MORE_TUPLES ? RC_OK : status;
+}
+
+/*
+    # points record at the fields of a serialized record, the changes array is malloc'ed
+    # and its data, like the record data, stays in the buffer
+*/
+static RC parseRecord(char *buffer, LogRecord *record, char *name)
+{
+    LogRecordHeader header;
+
+    memcpy(&header, buffer, sizeof(header));
+    record->lsn = header.lsn;
+    record->type = (LogRecordType)header.type;
+    record->id.page = header.page;
+    record->id.slot = header.slot;
+    record->numPages = header.numPages;
+    record->txId = header.txId;
+    record->compensates = header.compensates;
+    record->numChanges = header.numChanges;
+    memcpy(name, buffer + sizeof(header), header.nameLength);
+    name[header.nameLength] = '\0';
+    record->table = name;
+    record->dataLength = header.dataLength;
+    record->data = header.dataLength > 0 ? buffer + sizeof(header) + header.nameLength : NULL;
+
+    record->changes = malloc((header.numChanges > 0 ? header.numChanges : 1) * sizeof(BM_PageChange));
+    if (record->changes == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    char *pos = buffer + sizeof(header) + header.nameLength + header.dataLength;
+    for (int i = 0; i < header.numChanges; i++)
+    {
+        LogChangeHeader change;
+        memcpy(&change, pos, sizeof(change));
+        pos += sizeof(change);
+        record->changes[i].pageNum = change.pageNum;
+        record->changes[i].offset = change.offset;
+        record->changes[i].length = change.length;
+        record->changes[i].data = pos;
+        pos += change.length;
+    }
+    return RC_OK;
+}
+
+/*
+    # makes the full log file a segment and starts a new one at the durable end of the log
+    # the caller holds the lock and nothing is being synced, so the file is not in use
+*/
+static RC startSegment(void)
+{
+    char *segment = segmentFileName(logMgr.fileName, logMgr.fileBase);
+    LogSegment *grown = realloc(logMgr.segments, (logMgr.numSegments + 1) * sizeof(LogSegment));
+
+    if (segment == NULL || grown == NULL)
+    {
+        free(segment);
+        if (grown != NULL)
+            logMgr.segments = grown;
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    logMgr.segments = grown;
+
+    // Without a log file openLog starts one after the last segment, so a crash in between loses nothing
+    bool renamed = fclose(logMgr.file) == 0 && rename(logMgr.fileName, segment) == 0;
+    FILE *file = renamed ? fopen(logMgr.fileName, "w+b") : NULL;
+    if (file == NULL || !writeHeader(file, logMgr.durable))
+    {
+        // Go on appending to the old file
+        if (file != NULL)
+            fclose(file);
+        if (renamed)
+            rename(segment, logMgr.fileName);
+        if ((logMgr.file = fopen(logMgr.fileName, "r+b")) != NULL)
+            fseek(logMgr.file, 0, SEEK_END);
+        free(segment);
+        return RC_WRITE_FAILED;
+    }
+    logMgr.file = file;
+    syncLogDirectory();
+
+    logMgr.segments[logMgr.numSegments].base = logMgr.fileBase;
+    logMgr.segments[logMgr.numSegments].fileName = segment;
+    logMgr.numSegments++;
+    logMgr.fileBase = logMgr.durable;
+    return RC_OK;
+}
+
+/*
+    # writes the records waiting in the buffer and fsyncs the log until the record at lsn is on disk
+    # the caller holds the lock; while one thread syncs, the others wait for it and then
+    # find their records on disk or sync everything appended while they waited in one go
+    # After a failed write the records of the batch are lost and may be partly in the file, so
+    # every later sync fails as well: records after them would be durable behind a gap
+*/
+static RC syncLocked(LSN lsn)
+{
+    while (logMgr.durable <= lsn && logMgr.durable < logMgr.end)
+    {
+        if (logMgr.failed)
+            return RC_WRITE_FAILED;
+        if (logMgr.syncing)
+        {
+            pthread_cond_wait(&logMgr.synced, &logMgr.lock);
+            continue;
+        }
+
+        // Take the buffer, appends go on into the other one during the write
+        char *records = logMgr.buffer;
+        int length = logMgr.bufferLength, size = logMgr.bufferSize;
+        LSN end = logMgr.end;
+        logMgr.buffer = logMgr.spare;
+        logMgr.bufferSize = logMgr.spareSize;
+        logMgr.bufferLength = 0;
+        logMgr.pending = 0;
+        logMgr.syncing = true;
+        pthread_mutex_unlock(&logMgr.lock);
+
+        bool written = logMgr.file != NULL && fwrite(records, 1, length, logMgr.file) == (size_t)length &&
+                       fflush(logMgr.file) == 0 && fsync(fileno(logMgr.file)) == 0;
+
+        pthread_mutex_lock(&logMgr.lock);
+        logMgr.spare = records;
+        logMgr.spareSize = size;
+        logMgr.syncing = false;
+        logMgr.failed = !written;
+        if (written)
+        {
+            logMgr.durable = end;
+            logMgr.stats.syncs++;
+            // A failed switch is tried again after the next sync
+            if (logMgr.segmentSize > 0 && logMgr.durable - logMgr.fileBase >= logMgr.segmentSize)
+                startSegment();
+        }
+        pthread_cond_broadcast(&logMgr.synced);
+    }
+    return RC_OK;
+}
+
+/*
+    # group commit: syncs the log whenever groupSize records are waiting or groupDelayMs passed
+*/
+static void *groupCommitThread(void *arg)
+{
+    (void)arg;
+    pthread_mutex_lock(&logMgr.lock);
+    while (!logMgr.stopping)
+    {
+        if (logMgr.failed || logMgr.pending < logMgr.groupSize)
+        {
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME, &deadline);
+            deadline.tv_nsec += (long)logMgr.groupDelayMs * 1000000L;
+            deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+            deadline.tv_nsec %= 1000000000L;
+            pthread_cond_timedwait(&logMgr.wake, &logMgr.lock, &deadline);
+        }
+        if (logMgr.bufferLength > 0 && !logMgr.failed)
+            syncLocked(logMgr.end - 1);
+    }
+    pthread_mutex_unlock(&logMgr.lock);
+    return NULL;
+}
+
+static void freeSegments(LogSegment *segments, int numSegments)
+{
+    for (int i = 0; i < numSegments; i++)
+        free(segments[i].fileName);
+    free(segments);
+}
+
+/*
+    # opens the log in fileName and its segments, creating it the first time
+    # the records of the file are checked up to the first torn or corrupt one, which is cut off
+    # together with everything after it, new records are appended in its place
+    # the file becomes a segment once it holds segmentSize bytes, 0 for the default, < 0 never
+*/
+RC openLog(char *fileName, long segmentSize, int groupSize, int groupDelayMs)
+{
+    LogFileHeader header;
+    LogSegment *segments;
+    int numSegments;
+    LSN end = 0;
+    RC status;
+
+    if (logMgr.open)
+        return RC_ERROR;
+    if ((status = listSegments(fileName, &segments, &numSegments)) != RC_OK)
+        return status;
+
+    FILE *file = fopen(fileName, "r+b");
+    if (file == NULL)
+    {
+        // The first open, or a crash right after the file became a segment
+        header.base = LOG_HEADER_SIZE;
+        if (numSegments > 0)
+        {
+            FILE *last = fopen(segments[numSegments - 1].fileName, "rb");
+            status = last != NULL ? scanFile(last, segments[numSegments - 1].base, &header.base) : RC_FILE_NOT_FOUND;
+            if (last != NULL)
+                fclose(last);
+        }
+        if (status == RC_OK && (file = fopen(fileName, "w+b")) == NULL)
+            status = RC_FILE_NOT_FOUND;
+        if (status == RC_OK && !writeHeader(file, header.base))
+            status = RC_WRITE_FAILED;
+    }
+    else if (fread(&header, sizeof(header), 1, file) != 1 || header.magic != LOG_MAGIC)
+        status = RC_FILE_HANDLE_NOT_INIT;
+
+    if (status == RC_OK)
+        status = scanFile(file, header.base, &end);
+    long length = LOG_HEADER_SIZE + (end - header.base);
+    if (status == RC_OK && (ftruncate(fileno(file), length) != 0 || fseek(file, length, SEEK_SET) != 0))
+        status = RC_WRITE_FAILED;
+    if (status != RC_OK)
+    {
+        if (file != NULL)
+            fclose(file);
+        freeSegments(segments, numSegments);
+        return status;
+    }
+
+    memset(&logMgr, 0, sizeof(logMgr));
+    logMgr.file = file;
+    logMgr.fileName = strdup(fileName);
+    logMgr.fileBase = header.base;
+    logMgr.base = numSegments > 0 ? segments[0].base : header.base;
+    logMgr.segmentSize = segmentSize != 0 ? segmentSize : LOG_SEGMENT_SIZE;
+    logMgr.segments = segments;
+    logMgr.numSegments = numSegments;
+    logMgr.end = logMgr.durable = end;
+    logMgr.groupSize = groupSize;
+    logMgr.groupDelayMs = groupDelayMs > 0 ? groupDelayMs : 1;
+    pthread_mutex_init(&logMgr.lock, NULL);
+    pthread_cond_init(&logMgr.synced, NULL);
+    pthread_cond_init(&logMgr.wake, NULL);
+    logMgr.open = true;
+
+    if (groupSize > 0)
+    {
+        if (pthread_create(&logMgr.thread, NULL, groupCommitThread, NULL) != 0)
+        {
+            closeLog();
+            return RC_ERROR;
+        }
+        logMgr.hasThread = true;
+    }
+    return RC_OK;
+}
+
+/*
+    # syncs the records that are still waiting and closes the log
+*/
+RC closeLog(void)
+{
+    if (!logMgr.open)
+        return RC_OK;
+
+    if (logMgr.hasThread)
+    {
+        pthread_mutex_lock(&logMgr.lock);
+        logMgr.stopping = true;
+        pthread_cond_signal(&logMgr.wake);
+        pthread_mutex_unlock(&logMgr.lock);
+        pthread_join(logMgr.thread, NULL);
+    }
+
+    RC status = syncLog();
+    if ((logMgr.file == NULL || fclose(logMgr.file) != 0) && status == RC_OK)
+        status = RC_WRITE_FAILED;
+
+    pthread_mutex_destroy(&logMgr.lock);
+    pthread_cond_destroy(&logMgr.synced);
+    pthread_cond_destroy(&logMgr.wake);
+    free(logMgr.buffer);
+    free(logMgr.spare);
+    free(logMgr.fileName);
+    freeSegments(logMgr.segments, logMgr.numSegments);
+    memset(&logMgr, 0, sizeof(logMgr));
+    return status;
+}
+
+/*
+    # appends a record to the log and sets its LSN, the record is durable once flushLog(lsn) returns
+    # Returns RC_WRITE_FAILED once a write of the log failed, until it is opened again
+*/
+RC appendLog(LogRecord *record)
+{
+    int nameLength = strlen(record->table);
+    int dataLength = record->data != NULL ? record->dataLength : 0;
+    int length = sizeof(LogRecordHeader) + nameLength + dataLength;
+    LogRecordHeader header;
+
+    if (!logMgr.open)
+        return RC_FILE_HANDLE_NOT_INIT;
+    for (int i = 0; i < record->numChanges; i++)
+        length += sizeof(LogChangeHeader) + record->changes[i].length;
+
+    pthread_mutex_lock(&logMgr.lock);
+    if (logMgr.failed)
+    {
+        pthread_mutex_unlock(&logMgr.lock);
+        return RC_WRITE_FAILED;
+    }
+    if (logMgr.bufferLength + length > logMgr.bufferSize)
+    {
+        int size = logMgr.bufferSize > 0 ? logMgr.bufferSize : PAGE_SIZE;
+        while (size < logMgr.bufferLength + length)
+            size *= 2;
+        char *grown = realloc(logMgr.buffer, size);
+        if (grown == NULL)
+        {
+            pthread_mutex_unlock(&logMgr.lock);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        logMgr.buffer = grown;
+        logMgr.bufferSize = size;
+    }
+
+    char *dest = logMgr.buffer + logMgr.bufferLength, *pos;
+    record->lsn = logMgr.end;
+    header.length = length;
+    header.checksum = 0;
+    header.lsn = record->lsn;
+    header.type = record->type;
+    header.page = record->id.page;
+    header.slot = record->id.slot;
+    header.numPages = record->numPages;
+    header.txId = record->txId;
+    header.compensates = record->compensates;
+    header.nameLength = nameLength;
+    header.dataLength = dataLength;
+    header.numChanges = record->numChanges;
+    memcpy(dest, &header, sizeof(header));
+    memcpy(dest + sizeof(header), record->table, nameLength);
+    if (dataLength > 0)
+        memcpy(dest + sizeof(header) + nameLength, record->data, dataLength);
+    pos = dest + sizeof(header) + nameLength + dataLength;
+    for (int i = 0; i < record->numChanges; i++)
+    {
+        LogChangeHeader change;
+        change.pageNum = record->changes[i].pageNum;
+        change.offset = record->changes[i].offset;
+        change.length = record->changes[i].length;
+        memcpy(pos, &change, sizeof(change));
+        memcpy(pos + sizeof(change), record->changes[i].data, change.length);
+        pos += sizeof(change) + change.length;
+    }
+    header.checksum = recordChecksum(dest, length);
+    memcpy(dest + offsetof(LogRecordHeader, checksum), &header.checksum, sizeof(header.checksum));
+
+    logMgr.bufferLength += length;
+    logMgr.end += length;
+    logMgr.stats.records++;
+    logMgr.stats.bytes += length;
+    if (++logMgr.pending >= logMgr.groupSize && logMgr.hasThread)
+        pthread_cond_signal(&logMgr.wake);
+    pthread_mutex_unlock(&logMgr.lock);
+    return RC_OK;
+}
+
+/*
+    # returns once the record at lsn, and every record before it, is on disk
+*/
+RC flushLog(LSN lsn)
+{
+    if (!logMgr.open)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_mutex_lock(&logMgr.lock);
+    RC status = syncLocked(lsn);
+    pthread_mutex_unlock(&logMgr.lock);
+    return status;
+}
+
+/*
+    # returns once every record appended so far is on disk
+*/
+RC syncLog(void)
+{
+    return flushLog(getLogEnd() - 1);
+}
+
+/*
+    # LSN the next record appended will get
+*/
+LSN getLogEnd(void)
+{
+    if (!logMgr.open)
+        return 0;
+
+    pthread_mutex_lock(&logMgr.lock);
+    LSN end = logMgr.end;
+    pthread_mutex_unlock(&logMgr.lock);
+    return end;
+}
+
+/*
+    # calls callback for every record from the one at LSN from (the first one if from is older)
+    # to the end of the log, in log order; the record passed is only valid during the call
+*/
+RC readLog(LSN from, LogRecordCallback callback, void *context)
+{
+    char *buffer = NULL, name[PAGE_SIZE];
+    int size = 0;
+    LogRecord record;
+    RC status;
+
+    if ((status = syncLog()) != RC_OK)
+        return status;
+
+    // Open the files under the lock, one that becomes a segment or is dropped meanwhile stays readable
+    pthread_mutex_lock(&logMgr.lock);
+    int numFiles = logMgr.numSegments + 1;
+    FILE **files = calloc(numFiles, sizeof(FILE *));
+    LSN *bases = malloc((numFiles + 1) * sizeof(LSN));
+    LSN lsn = from > logMgr.base ? from : logMgr.base;
+    if (files == NULL || bases == NULL)
+        status = RC_MEM_ALLOCATION_FAIL;
+    for (int i = 0; status == RC_OK && i < numFiles; i++)
+    {
+        bases[i] = i < logMgr.numSegments ? logMgr.segments[i].base : logMgr.fileBase;
+        bases[i + 1] = i + 1 < logMgr.numSegments ? logMgr.segments[i + 1].base : i + 1 < numFiles ? logMgr.fileBase : logMgr.durable;
+        if (bases[i + 1] <= lsn)
+            continue;
+        files[i] = fopen(i < logMgr.numSegments ? logMgr.segments[i].fileName : logMgr.fileName, "rb");
+        if (files[i] == NULL)
+            status = RC_FILE_NOT_FOUND;
+    }
+    pthread_mutex_unlock(&logMgr.lock);
+
+    for (int i = 0; status == RC_OK && i < numFiles; i++)
+    {
+        if (files[i] == NULL)
+            continue;
+        if (fseek(files[i], LOG_HEADER_SIZE + (lsn - bases[i]), SEEK_SET) != 0)
+            status = RC_READ_NON_EXISTING_PAGE;
+        while (status == RC_OK && lsn < bases[i + 1] && (status = readRecord(files[i], lsn, &buffer, &size)) == RC_OK)
+        {
+            if (((LogRecordHeader *)buffer)->nameLength >= PAGE_SIZE)
+            {
+                status = RC_ERROR;
+                break;
+            }
+            if ((status = parseRecord(buffer, &record, name)) != RC_OK)
+                break;
+            status = callback(&record, context);
+            free(record.changes);
+            lsn += ((LogRecordHeader *)buffer)->length;
+        }
+    }
+
+    for (int i = 0; files != NULL && i < numFiles; i++)
+        if (files[i] != NULL)
+            fclose(files[i]);
+    free(files);
+    free(bases);
+    free(buffer);
+    return status == RC_RM_NO_MORE_TUPLES ? RC_OK : status;
+}
+
+/*
+    # drops the segments holding only records before LSN before, the log file itself is kept
+*/
+RC truncateLog(LSN before)
+{
+    RC status = RC_OK;
+    int dropped = 0;
+
+    if (!logMgr.open)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_mutex_lock(&logMgr.lock);
+    while (dropped < logMgr.numSegments)
+    {
+        LSN next = dropped + 1 < logMgr.numSegments ? logMgr.segments[dropped + 1].base : logMgr.fileBase;
+        if (next > before)
+            break;
+        if (unlink(logMgr.segments[dropped].fileName) != 0)
+        {
+            status = RC_WRITE_FAILED;
+            break;
+        }
+        free(logMgr.segments[dropped].fileName);
+        dropped++;
+    }
+    if (dropped > 0)
+        memmove(logMgr.segments, logMgr.segments + dropped, (logMgr.numSegments - dropped) * sizeof(LogSegment));
+    logMgr.numSegments -= dropped;
+    logMgr.base = logMgr.numSegments > 0 ? logMgr.segments[0].base : logMgr.fileBase;
+    pthread_mutex_unlock(&logMgr.lock);
+    return status;
+}
+
+/*
+    # drops every record, once nothing needs them for recovery any more
+    # LSNs go on from where they were, so that LSNs kept elsewhere stay comparable
+*/
+RC resetLog(void)
+{
+    RC status;
+
+    if (!logMgr.open)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    pthread_mutex_lock(&logMgr.lock);
+    if ((status = syncLocked(logMgr.end - 1)) == RC_OK && logMgr.file != NULL)
+    {
+        for (int i = 0; i < logMgr.numSegments; i++)
+        {
+            unlink(logMgr.segments[i].fileName);
+            free(logMgr.segments[i].fileName);
+        }
+        logMgr.numSegments = 0;
+
+        bool written = ftruncate(fileno(logMgr.file), LOG_HEADER_SIZE) == 0 &&
+                       writeHeader(logMgr.file, logMgr.end) && fsync(fileno(logMgr.file)) == 0;
+        if (written)
+            logMgr.base = logMgr.fileBase = logMgr.end;
+        else
+            status = RC_WRITE_FAILED;
+    }
+    pthread_mutex_unlock(&logMgr.lock);
+    return status;
+}
+
+RC getLogStats(LogStats *stats)
+{
+    if (stats == NULL)
+        return RC_NULL_ARGUMENT;
+    if (!logMgr.open)
+    {
+        memset(stats, 0, sizeof(LogStats));
+        return RC_OK;
+    }
+
+    pthread_mutex_lock(&logMgr.lock);
+    *stats = logMgr.stats;
+    stats->size = logMgr.end - logMgr.base;
+    stats->segments = logMgr.numSegments;
+    pthread_mutex_unlock(&logMgr.lock);
+    return RC_OK;
+}
@@ -0,0 +1,76 @@
+#ifndef LOG_MGR_H
+#define LOG_MGR_H
+
+#include "dberror.h"
+#include "tables.h"
+#include "buffer_mgr.h"
+
+// A log sequence number is the position of a log record in the log, in bytes since the
+// first record ever written; it keeps growing when the log is reset, 0 is no record
+typedef long LSN;
+
+// kinds of log records
+typedef enum LogRecordType
+{
+	LOG_INSERT = 1,
+	LOG_DELETE = 2,
+	LOG_UPDATE = 3,
+	LOG_PAGES = 4,		// page changes outside a record operation: vacuum, free list, index registry
+	LOG_TRUNCATE = 5,	// the table file was cut to numPages pages
+	LOG_COMMIT = 6,		// end of transaction txId, no table
+	LOG_ABORT = 7,		// transaction txId was rolled back, no table
+	LOG_CHECKPOINT = 8	// open tables, their dirty pages and the transactions in progress, no table
+} LogRecordType;
+
+// one log record, changes holds the bytes of the table's pages after the operation (redo),
+// data the record a delete or update of a transaction replaced (undo) or the content of a checkpoint
+typedef struct LogRecord
+{
+	LSN lsn;
+	LogRecordType type;
+	char *table;		// page file of the table
+	RID id;			// record of an insert, delete or update
+	int numPages;		// LOG_TRUNCATE: pages left in the file
+	long txId;		// transaction of the operation, 0 outside of transactions
+	LSN compensates;	// > 0: the operation took back the one logged at this LSN
+	int dataLength;
+	char *data;
+	int numChanges;
+	BM_PageChange *changes;
+} LogRecord;
+
+// what the log did since it was opened
+typedef struct LogStats
+{
+	long records;
+	long bytes;
+	long syncs;		// fsyncs of the log file
+	long size;		// bytes of the records kept, in the log file and its segments
+	int segments;		// older parts of the log kept in files of their own
+} LogStats;
+
+// called by readLog for every record, RC_OK continues reading
+typedef RC (*LogRecordCallback)(LogRecord *record, void *context);
+
+// opening and closing the log of the process
+// once the log file holds segmentSize bytes it is renamed to a segment "<fileName>.<LSN>" and a new
+// one is started, 0 for the default size and < 0 for a single file that only resetLog shortens
+// groupSize > 0 starts a group commit thread that syncs the log once groupSize records wait
+// for it or the oldest waited groupDelayMs, without it records are synced by flushLog only
+extern RC openLog(char *fileName, long segmentSize, int groupSize, int groupDelayMs);
+extern RC closeLog(void);
+
+// writing
+extern RC appendLog(LogRecord *record);
+extern RC flushLog(LSN lsn);
+extern RC syncLog(void);
+extern LSN getLogEnd(void);
+
+// reading and dropping records
+extern RC readLog(LSN from, LogRecordCallback callback, void *context);
+extern RC truncateLog(LSN before);
+extern RC resetLog(void);
+
+extern RC getLogStats(LogStats *stats);
+
+#endif // LOG_MGR_H
@@ -1,6 +1,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include "storage_mgr.h"
 #include "buffer_mgr.h"
 #include "record_mgr.h"
@@ -12,6 +17,15 @@ enum SCAN_MGR_Response
     SCAN_FAIL
 };
 
+// Access paths chosen by startScan
+enum SCAN_ACCESS_PATH
+{
+    SCAN_SEQUENTIAL,
+    SCAN_INDEX_RANGE,
+    SCAN_KEY_LOOKUP,
+    SCAN_HASH_LOOKUP
+};
+
 enum SCHEMA_MGR_Response
 {
     SCHEMA_CREATED,
@@ -45,18 +59,84 @@ enum RECORD_Response
     SHUTDOWN_RECORD_FAILED
 };
 
+// Upper bound of secondary indexes per table, bounded by the space left in the header page
+#define MAX_TABLE_INDEXES 8
+
+// Defaults of the group commit
+#define GROUP_COMMIT_SIZE 256
+#define GROUP_COMMIT_MS 5
+
+// Defaults of the background checkpoints
+#define CHECKPOINT_MS 1000
+#define CHECKPOINT_LOG_BYTES (16L * 1024 * 1024)
+// how often the checkpoint thread looks at the size of the log
+#define CHECKPOINT_POLL_MS 50
+
+// Transaction ids reserved in XID_FILE at a time
+#define TX_ID_BLOCK (1L << 20)
+// Buckets of the version store of a table when it gets its first version
+#define VERSION_BUCKETS 64
+// Default longest wait for a lock
+#define LOCK_TIMEOUT_MS 10000
+
+struct RecordVersion;
+struct PaxLayout;
+struct Dictionary;
+struct CodeFilter;
+
 typedef struct RecordMgr
 {
     BM_PageHandle pageHandle;
-    int scanCount;
-    int record;
-    Expr *condition;
     int countOfTuples;
     int deallocatePage;
-    RID r_id;
     BM_BufferPool bp;
+    int numIndexes;
+    int indexAttrs[MAX_TABLE_INDEXES];
+    IndexKind indexKinds[MAX_TABLE_INDEXES];
+    BTreeHandle *indexes[MAX_TABLE_INDEXES];
+    HashHandle *hashIndexes[MAX_TABLE_INDEXES];
+    int freeListHead;
+    int vacuumCursor;
+    char *fileName;
+    int logDepth; // nesting of beginLogged, the outermost operation writes the log record
+    struct RecordMgr *nextOpen; // in the list of open tables checkpoints write back
+    pthread_rwlock_t latch;     // shared while records are read, exclusive while they change
+    struct RecordVersion **versions; // version store: older versions of records by RID, for snapshots
+    int numVersionBuckets;
+    int numVersions;
+    struct PaxLayout *pax; // minipages of the data pages of a PAX table, NULL for slotted pages
+    struct Dictionary **dictionaries; // by attribute, NULL for those not dictionary encoded; NULL if none is
+    int dictionaryTail;               // last page of the dictionary chain, 0 while it is empty
 } RecordMgr;
 
+// Cursor of one scan, stored in RM_ScanHandle.mgmtData; scans share nothing but
+// the table, so any number of them can interleave, also from different threads
+typedef struct ScanMgr
+{
+    RID r_id;
+    BM_PageHandle pageHandle; // page under the cursor of a sequential scan
+    bool pinned;              // pageHandle is pinned
+    Expr *condition;
+    Conjunction *conjunction;
+    enum SCAN_ACCESS_PATH accessPath;
+    int pathAttr;
+    Value *pathLow;
+    Value *pathHigh;
+    BT_ScanHandle *treeScan;
+    RID *hashRids;
+    int numHashRids;
+    int hashPos;
+    bool lookupDone;
+    int numProjAttrs;         // > 0: next returns only these attributes, in this order
+    int *projAttrs;
+    Schema *projSchema;       // layout of the records next returns for a projected scan
+    Record *scratch;          // full-width record a projected scan decodes into
+    bool *neededAttrs;        // attributes decoded from a stored record, NULL for all
+    struct Snapshot *snapshot; // versions the scan sees, taken when it started
+    struct CodeFilter *codeFilters; // equalities of a sequential scan checked on dictionary codes
+    int numCodeFilters;
+} ScanMgr;
+
 typedef struct controller_state
 {
     enum TABLE_MGR_Response TM_resp;
@@ -68,12 +148,22 @@ typedef struct controller_state
 
 struct Controller
 {
-    RecordMgr *recMgr;
-    RecordMgr *sm;
-    RecordMgr *tm;
-    c_state currState;
+    bool initialized;
+    RM_TableData catalog;
+    bool catalogOpen;
+    BM_BufferPool sharedPool;
+    bool poolShared;
+    int poolPages;
+    WalMode walMode;
+    int openTables;
+    int checkpointMs;
+    long checkpointLogBytes;
 } mgrHandler;
 
+// what the last call of the calling thread reported; scans, reads and writes run on several
+// threads at once, so each thread keeps its own
+static __thread c_state currState;
+
 int indexCount = 1;
 int MAX_COUNT = 1;
 const int MAX_NO_OF_PAGES = 200;
@@ -86,897 +176,8358 @@ void clearMemory(void *ptor)
 
 /* Table and Record Manager Functions */
 
+static RC openCatalog(void);
+static RC closeCatalog(void);
+static RC recoverTables(void);
+static void loadTxIds(void);
+static bool transactionsActive(void);
+static RC startCheckpoints(void);
+static void stopCheckpoints(void);
+
 /*
     # This method is used to initialise a record manager
+    # mgmtData is an optional RM_Options, with sharedPoolPages set every open table
+    # draws on one buffer pool instead of a pool of its own
+    # The tables a crash left behind the write-ahead log are recovered first
+    # The catalog of tables is created on first use and stays open until shutdown
+    # With a log, a background thread takes checkpoints until shutdown
+    # Transaction ids continue after the last block reserved in XID_FILE
+    # The lock manager is started with the lock options
+    # Page checksums are checked on reads as pageVerify says, corrupted pages fail with RC_PAGE_CORRUPTED
 */
 RC initRecordManager(void *mgmtData)
 {
+    RM_Options *options = (RM_Options *)mgmtData;
+    RC status;
+
+    if (mgrHandler.initialized)
+        return RC_OK;
+
     // Initialize storage manager
     initStorageManager();
-    mgrHandler.currState.state = INIT_RECORD_MANAGER;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+    setPageVerify(options != NULL ? options->pageVerify : PAGE_VERIFY_ALWAYS);
+    loadTxIds();
+    mgrHandler.poolPages = (options != NULL && options->poolPages > 0) ? options->poolPages : MAX_NO_OF_PAGES;
+    mgrHandler.poolShared = options != NULL && options->sharedPoolPages > 0;
+    if (mgrHandler.poolShared &&
+        (status = initBufferPool(&mgrHandler.sharedPool, NULL, options->sharedPoolPages, RS_LRU, NULL)) != RC_OK)
+        return status;
+    mgrHandler.initialized = true;
+
+    mgrHandler.walMode = options != NULL ? options->walMode : WAL_GROUP_COMMIT;
+    int groupSize = (options != NULL && options->groupCommitSize > 0) ? options->groupCommitSize : GROUP_COMMIT_SIZE;
+    int groupMs = (options != NULL && options->groupCommitMs > 0) ? options->groupCommitMs : GROUP_COMMIT_MS;
+    long segmentBytes = options != NULL ? options->logSegmentBytes : 0;
+    int lockTimeoutMs = (options != NULL && options->lockTimeoutMs != 0) ? options->lockTimeoutMs : LOCK_TIMEOUT_MS;
+    if ((status = initLockManager(options != NULL ? options->lockShards : 0, 0, lockTimeoutMs)) != RC_OK)
+    {
+        shutdownRecordManager();
+        return status;
+    }
+    mgrHandler.checkpointMs = (options != NULL && options->checkpointMs != 0) ? options->checkpointMs : CHECKPOINT_MS;
+    mgrHandler.checkpointLogBytes = (options != NULL && options->checkpointLogBytes != 0) ? options->checkpointLogBytes
+                                                                                          : CHECKPOINT_LOG_BYTES;
+    if ((status = openLog(WAL_FILE, segmentBytes, mgrHandler.walMode == WAL_GROUP_COMMIT ? groupSize : 0, groupMs)) != RC_OK ||
+        (status = recoverTables()) != RC_OK || (status = openCatalog()) != RC_OK || (status = startCheckpoints()) != RC_OK)
+    {
+        shutdownRecordManager();
+        return status;
+    }
+
+    currState.state = INIT_RECORD_MANAGER;
+    currState.recordUpdatedAt = time(NULL);
     return RC_OK;
 }
 
 /*
     # This method is used to shutdown a record Manger
+    # Every table must be closed before, the frames of a shared pool are still in use otherwise
 */
 RC shutdownRecordManager()
 {
-    if (shutdownBufferPool(&mgrHandler.recMgr->bp) != RC_OK)
+    RC status = RC_OK;
+
+    if (!mgrHandler.initialized)
+        return RC_OK;
+
+    stopCheckpoints();
+    if (mgrHandler.catalogOpen)
+        status = closeCatalog();
+    if (mgrHandler.poolShared && status == RC_OK)
+        status = shutdownBufferPool(&mgrHandler.sharedPool);
+    // With every table closed cleanly and no transaction left to roll back, recovery needs nothing of the log
+    if (status == RC_OK && mgrHandler.openTables == 0 && !transactionsActive())
+        status = resetLog();
+    if (status == RC_OK)
+        status = closeLog();
+    if (status == RC_OK)
+        status = shutdownLockManager();
+    if (status != RC_OK)
     {
-        mgrHandler.currState.state = SHUTDOWN_RECORD_FAILED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
+        currState.state = SHUTDOWN_RECORD_FAILED;
+        currState.recordUpdatedAt = time(NULL);
+        return status;
     }
-    // Prevents memory leaks and ensures that we only free memory that has been allocated
-    free(mgrHandler.recMgr);
+
+    mgrHandler.poolShared = false;
+    mgrHandler.initialized = false;
     return RC_OK;
 }
 
+/* Write-ahead logging */
+
 /*
-    # This function is used to create a table
-    # It is used to store the information about the schema
+    # starts an operation on the table whose page changes go to the log as one record
+    # an operation begun inside another one is part of the outer one
 */
-RC createTable(char *name, Schema *schema)
+static void beginLogged(RecordMgr *rMgr)
+{
+    if (mgrHandler.walMode != WAL_OFF && rMgr->logDepth++ == 0)
+        beginPageChanges(&rMgr->bp, getLogEnd());
+}
+
+/*
+    # ends the operation begun by beginLogged: its page changes are appended to the log as record,
+    # whose type, id, txId, compensates and undo image (data) the caller set, and the changed frames cannot
+    # be written before it; with WAL_SYNC an operation outside of a transaction is on disk on return,
+    # the commit of its transaction or the group commit syncs it otherwise
+*/
+static RC endLoggedRecord(RecordMgr *rMgr, LogRecord *record)
 {
-    // Buffer for page data
-    char data[PAGE_SIZE];
-    // File handle for page file operations
-    SM_FileHandle f_handle;
-    // Variable to store function call status
     RC status;
 
-    // Allocate memory for the Record Manager structure
-    mgrHandler.recMgr = (RecordMgr *)malloc(sizeof(RecordMgr));
-    if (mgrHandler.recMgr == NULL)
-    {
-        // Return error if memory allocation fails
-        return RC_MEM_ALLOCATION_FAIL;
-    }
+    record->lsn = 0;
+    if (mgrHandler.walMode == WAL_OFF || --rMgr->logDepth > 0)
+        return RC_OK;
 
-    // Initialize the buffer pool
-    if (initBufferPool(&mgrHandler.recMgr->bp, name, MAX_NO_OF_PAGES, RS_LRU, NULL) != RC_OK)
-    {
-        mgrHandler.currState.TM_resp = TABLE_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        // Free allocated memory if buffer pool init fails
-        free(mgrHandler.recMgr);
-        return RC_BUFF_SHUTDOWN_FAILED;
-    }
+    record->table = rMgr->fileName;
+    record->numPages = 0;
+    status = getPageChanges(&rMgr->bp, &record->changes, &record->numChanges);
+    if (status == RC_OK && record->numChanges > 0)
+        status = appendLog(record);
+    endPageChanges(&rMgr->bp, record->lsn);
 
-    char *pageHandle = data;
+    if (status == RC_OK && record->lsn > 0 && record->txId == 0 && mgrHandler.walMode == WAL_SYNC)
+        status = flushLog(record->lsn);
+    return status;
+}
 
-    int k = 0;
-    while (k < 4)
+/*
+    # ends an operation outside of any transaction as a record of the given type on record id (NULL for none)
+*/
+static RC endLogged(RecordMgr *rMgr, LogRecordType type, RID *id)
+{
+    LogRecord record;
+
+    memset(&record, 0, sizeof(LogRecord));
+    record.type = type;
+    record.id.page = id != NULL ? id->page : -1;
+    record.id.slot = id != NULL ? id->slot : -1;
+    return endLoggedRecord(rMgr, &record);
+}
+
+/*
+    # logs that the table file is cut to numPages pages and waits for the record to be on disk,
+    # the cut cannot be taken back, so redo must not find the records of the lost pages unlogged
+*/
+static RC logTruncate(RecordMgr *rMgr, int numPages)
+{
+    LogRecord record;
+    RC status;
+
+    if (mgrHandler.walMode == WAL_OFF)
+        return RC_OK;
+
+    memset(&record, 0, sizeof(LogRecord));
+    record.type = LOG_TRUNCATE;
+    record.table = rMgr->fileName;
+    record.id.page = -1;
+    record.id.slot = -1;
+    record.numPages = numPages;
+    if ((status = appendLog(&record)) != RC_OK)
+        return status;
+    return flushLog(record.lsn);
+}
+
+/*
+    # makes a change of the header page durable: through its log record when there is a log,
+    # writing the page ahead of it would break the write-ahead rule, otherwise right away
+*/
+static RC persistHeader(RecordMgr *rMgr, BM_PageHandle *header)
+{
+    markDirty(&rMgr->bp, header);
+    if (mgrHandler.walMode != WAL_OFF)
+        return RC_OK;
+    return forcePage(&rMgr->bp, header);
+}
+
+// the open tables, whose pages checkpoints write back
+static pthread_mutex_t tablesLock = PTHREAD_MUTEX_INITIALIZER;
+static RecordMgr *openList;
+
+static void addOpenTable(RecordMgr *rMgr)
+{
+    pthread_mutex_lock(&tablesLock);
+    rMgr->nextOpen = openList;
+    openList = rMgr;
+    pthread_mutex_unlock(&tablesLock);
+}
+
+/*
+    # takes the table out of the list of open tables, waiting for a checkpoint that writes it back
+*/
+static void removeOpenTable(RecordMgr *rMgr)
+{
+    pthread_mutex_lock(&tablesLock);
+    for (RecordMgr **link = &openList; *link != NULL; link = &(*link)->nextOpen)
     {
-        if (k == 0)
-        {
-            *(int *)pageHandle = 0;
-        }
-        else if (k == 1)
-        {
-            *(int *)pageHandle = 1;
-        }
-        else if (k == 2)
-        {
-            *(int *)pageHandle = schema->numAttr;
-        }
-        else if (k == 3)
+        if (*link == rMgr)
         {
-            *(int *)pageHandle = schema->keySize;
+            *link = rMgr->nextOpen;
+            break;
         }
-
-        pageHandle += sizeof(int);
-        // Increment k to proceed to the next iteration
-        k++;
     }
+    rMgr->nextOpen = NULL;
+    pthread_mutex_unlock(&tablesLock);
+}
 
-    int i = 0;
-    char *handle = pageHandle;
-
-    while (i < schema->numAttr)
-    {
-        // Copy attribute name from the schema to handle
-        strncpy(handle, schema->attrNames[i], SIZE_OF_ATTRIBUTE);
+/* Transactions */
 
-        // Move handle forward by the size of attribute name
-        handle += SIZE_OF_ATTRIBUTE;
+// an operation of a transaction, what it takes to take it back
+typedef struct UndoEntry
+{
+    RM_TableData *rel;
+    LogRecordType type;
+    RID id;
+    char *image; // the record before a delete or an update
+    long xmin;   // transaction id the version it replaced was stamped with
+    LSN lsn;     // of the log record of the operation, 0 without a log
+} UndoEntry;
+
+// what a reader sees: the versions stamped with transaction ids below xmax that were not
+// in progress (active) when it was taken, and those of its own transaction
+typedef struct Snapshot
+{
+    long xmax;
+    long xmin; // lowest id it does not see, xmax without active ones
+    long own;  // its transaction, 0 for none
+    long *active;
+    int numActive;
+    struct Snapshot *next; // in the list of registered snapshots, NULL for a snapshot of a single read
+} Snapshot;
+
+// a transaction in progress, its undo entries in the order of the operations
+typedef struct Transaction
+{
+    long id;
+    LSN firstLsn; // its log records come after it
+    Snapshot snapshot; // taken when it began, its reads see the tables as they were then and its own changes
+    LockOwner locks;   // released once it ended
+    UndoEntry *undo;
+    int numUndo;
+    int maxUndo;
+    struct Transaction *nextActive;
+} Transaction;
+
+// the transaction of the calling thread, NULL outside of one
+static __thread Transaction *currentTx;
+
+// page of the locks on primary keys, see keyLockId
+#define KEY_LOCK_PAGE -2
+
+// hands out transaction ids and lists the transactions in progress and the registered snapshots,
+// those of transactions and scans; ids below txIdLimit are reserved in XID_FILE
+static pthread_mutex_t txLock = PTHREAD_MUTEX_INITIALIZER;
+static long nextTxId = 1;
+static long txIdLimit;
+static Transaction *activeTxs;
+static Snapshot *openSnapshots;
+
+static RC undoOperation(long txId, UndoEntry *entry);
+static void unlockAfterWrite(LockOwner *owner, LockOwner *local);
+static unsigned int hashKeyBytes(char *key, int size, bool keyNull);
+static RC logTransactionEnd(long txId, LogRecordType type);
 
-        // Assign the data type of the attribute
-        *(int *)handle = (int)schema->dataTypes[i];
+/*
+    # true for the catalog, whose rows are neither versioned nor written by transactions
+*/
+static bool isCatalog(RM_TableData *rel)
+{
+    return mgrHandler.catalogOpen && rel->mgmtData == mgrHandler.catalog.mgmtData;
+}
 
-        // Move handle forward by the size of an integer
-        handle += sizeof(int);
+/*
+    # the transaction an operation on rel belongs to, changes of the catalog never belong to one
+*/
+static Transaction *transactionOf(RM_TableData *rel)
+{
+    if (isCatalog(rel))
+        return NULL;
+    return currentTx;
+}
 
-        // Assign the length of the attribute type
-        *(int *)handle = (int)schema->typeLength[i];
+/*
+    # reserves the next TX_ID_BLOCK transaction ids: the new limit is on disk before ids below it are
+    # handed out, so that the ids of a later run start above every id a crash left in the pages
+    # under txLock; a failed write keeps the old limit and is tried again with the next id
+*/
+static void reserveTxIds(void)
+{
+    long limit = nextTxId + TX_ID_BLOCK;
+    int fd = open(XID_FILE, O_RDWR | O_CREAT, 0644);
+
+    if (fd < 0)
+        return;
+    if (pwrite(fd, &limit, sizeof(long), 0) == sizeof(long) && fsync(fd) == 0)
+        txIdLimit = limit;
+    close(fd);
+}
 
-        // Move handle forward by the size of an integer
-        handle += sizeof(int);
+/*
+    # starts the transaction ids of this run above those reserved by earlier ones
+*/
+static void loadTxIds(void)
+{
+    long limit = 0;
+    int fd = open(XID_FILE, O_RDONLY);
 
-        // Increment index to the next attribute
-        i++;
+    if (fd >= 0)
+    {
+        if (pread(fd, &limit, sizeof(long), 0) != sizeof(long))
+            limit = 0;
+        close(fd);
     }
+    pthread_mutex_lock(&txLock);
+    if (limit > nextTxId)
+        nextTxId = limit;
+    txIdLimit = nextTxId;
+    pthread_mutex_unlock(&txLock);
+}
 
-    // Create the page file
-    status = createPageFile(name);
-    if (status != RC_OK)
+/*
+    # hands out the next transaction id, under txLock
+*/
+static long newTxId(void)
+{
+    if (nextTxId >= txIdLimit)
+        reserveTxIds();
+    return nextTxId++;
+}
+
+/*
+    # takes a snapshot of the transactions in progress for transaction own (0 for none), under txLock
+*/
+static RC fillSnapshot(Snapshot *snapshot, long own)
+{
+    int numActive = 0;
+
+    for (Transaction *tx = activeTxs; tx != NULL; tx = tx->nextActive)
+        numActive++;
+    snapshot->xmax = nextTxId;
+    snapshot->xmin = nextTxId;
+    snapshot->own = own;
+    snapshot->numActive = 0;
+    snapshot->active = NULL;
+    snapshot->next = NULL;
+    if (numActive > 0 && (snapshot->active = (long *)malloc(numActive * sizeof(long))) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    for (Transaction *tx = activeTxs; tx != NULL; tx = tx->nextActive)
     {
-        // If the page file creation fails, log the error state
-        mgrHandler.currState.TM_resp = TABLE_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        // Perform cleanup by freeing the allocated memory for the record manager
-        free(mgrHandler.recMgr);
-        // Return the failure status
-        return status;
+        if (tx->id == own)
+            continue;
+        snapshot->active[snapshot->numActive++] = tx->id;
+        if (tx->id < snapshot->xmin)
+            snapshot->xmin = tx->id;
     }
+    return RC_OK;
+}
 
-    // Open the newly created page file
-    status = openPageFile(name, &f_handle);
-    if (status != RC_OK)
+/*
+    # takes a snapshot for a read that spans calls, registered so that the versions it sees are kept;
+    # in a transaction it is a copy of the snapshot of the transaction
+*/
+static RC openSnapshot(Snapshot *snapshot)
+{
+    RC status = RC_OK;
+
+    pthread_mutex_lock(&txLock);
+    if (currentTx == NULL)
+        status = fillSnapshot(snapshot, 0);
+    else
     {
-        // If the page file open fails, log the error state
-        mgrHandler.currState.TM_resp = TABLE_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        // Perform cleanup
-        free(mgrHandler.recMgr);
-        return status;
+        *snapshot = currentTx->snapshot;
+        if (snapshot->numActive > 0 && (snapshot->active = (long *)malloc(snapshot->numActive * sizeof(long))) == NULL)
+            status = RC_MEM_ALLOCATION_FAIL;
+        else if (snapshot->numActive > 0)
+            memcpy(snapshot->active, currentTx->snapshot.active, snapshot->numActive * sizeof(long));
     }
-
-    // Write metadata and schema information to the first block of the page file
-    status = writeBlock(0, &f_handle, data);
-    if (status != RC_OK)
+    if (status == RC_OK)
     {
-        // If the write operation fails, log the error state
-        mgrHandler.currState.TM_resp = TABLE_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        // Ensure that the page file is closed before exiting the function
-        closePageFile(&f_handle);
-        // Perform cleanup by freeing the allocated memory for the record manager
-        free(mgrHandler.recMgr);
-        return status;
+        snapshot->next = openSnapshots;
+        openSnapshots = snapshot;
     }
+    pthread_mutex_unlock(&txLock);
+    return status;
+}
 
-    // Close the page file after writing operation
-    status = closePageFile(&f_handle);
-    if (status != RC_OK)
+/*
+    # unregisters a snapshot taken by openSnapshot or beginTransaction
+*/
+static void closeSnapshot(Snapshot *snapshot)
+{
+    pthread_mutex_lock(&txLock);
+    for (Snapshot **link = &openSnapshots; *link != NULL; link = &(*link)->next)
     {
-        // If the page file closure fails, log the error state
-        mgrHandler.currState.TM_resp = TABLE_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        // Perform cleanup by freeing the allocated memory for the record manager
-        free(mgrHandler.recMgr);
-        return status;
+        if (*link == snapshot)
+        {
+            *link = snapshot->next;
+            break;
+        }
     }
+    pthread_mutex_unlock(&txLock);
+    free(snapshot->active);
+    snapshot->active = NULL;
+}
 
-    // Give record success in state log
-    mgrHandler.currState.TM_resp = TABLE_CREATED;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+/*
+    # the snapshot a single read of the calling thread sees: that of its transaction, or one taken
+    # into local now, which needs no registering as the read holds the latch of its table throughout;
+    # endRead releases it
+*/
+static Snapshot *beginRead(Snapshot *local)
+{
+    if (currentTx != NULL)
+        return &currentTx->snapshot;
 
-    // Return success if all the steps completed without any kind of error
-    return RC_OK;
+    pthread_mutex_lock(&txLock);
+    RC status = fillSnapshot(local, 0);
+    pthread_mutex_unlock(&txLock);
+    return status == RC_OK ? local : NULL;
 }
 
-int getIncrement(int r)
+static void endRead(Snapshot *snapshot, Snapshot *local)
 {
+    if (snapshot == local)
+        free(local->active);
+}
 
-    return r++;
+/*
+    # true if the changes stamped with transaction id xid are visible in snapshot; id 0 stamps
+    # versions visible to every snapshot
+*/
+static bool xidVisible(Snapshot *snapshot, long xid)
+{
+    if (xid < snapshot->xmin || xid == snapshot->own)
+        return true;
+    if (xid >= snapshot->xmax)
+        return false;
+    for (int i = 0; i < snapshot->numActive; i++)
+        if (snapshot->active[i] == xid)
+            return false;
+    return true;
+}
+
+/*
+    # true if a version written by xmin and deleted or replaced by xmax (0 while it is the latest)
+    # is the one snapshot sees of its record; a NULL snapshot sees the latest versions
+*/
+static bool versionVisible(Snapshot *snapshot, long xmin, long xmax)
+{
+    if (snapshot == NULL)
+        return xmax == 0;
+    return xidVisible(snapshot, xmin) && (xmax == 0 || !xidVisible(snapshot, xmax));
+}
+
+/*
+    # the lowest transaction id some snapshot may not see, a version deleted or replaced by an
+    # id below it is visible to no snapshot now or later; under txLock
+*/
+static long versionHorizon(void)
+{
+    long horizon = nextTxId;
+
+    for (Transaction *tx = activeTxs; tx != NULL; tx = tx->nextActive)
+        if (tx->id < horizon)
+            horizon = tx->id;
+    for (Snapshot *snapshot = openSnapshots; snapshot != NULL; snapshot = snapshot->next)
+        if (snapshot->xmin < horizon)
+            horizon = snapshot->xmin;
+    return horizon;
 }
 
 /*
-    The function calculates the total number of slots that can fit in the page
-    by dividing the PAGE_SIZE by recordSize.
+    # the transaction id a change of rel stamps on the version it writes, once the change is in
+    # the page: that of its transaction, or outside of one a new id, which is visible to every
+    # snapshot taken from now on; keepOld tells if a snapshot may still need the version it replaced
+    # and horizon is that of versionHorizon
 */
-int availableSlot(char *data, int recordSize)
+static long stampVersion(RM_TableData *rel, bool *keepOld, long *horizon)
 {
-    float sizedata = 0;
-    int index = -1, numberOfSlots;
-    numberOfSlots = PAGE_SIZE / recordSize;
+    Transaction *tx = transactionOf(rel);
+    long xid = 0;
 
-    if (index == -1)
+    *keepOld = false;
+    pthread_mutex_lock(&txLock);
+    if (tx != NULL)
     {
-        index = 0;
-        while (index < numberOfSlots)
-        {
-            if (*(data + index * recordSize) != '#')
-            {
-                return index;
-            }
-            index++;
-        }
+        xid = tx->id;
+        *keepOld = true;
     }
-    else
+    else if (!isCatalog(rel))
     {
-        return -1;
+        // Registered snapshots were all taken before the new id
+        xid = newTxId();
+        *keepOld = openSnapshots != NULL;
     }
-    sizedata++;
-    return -1;
+    *horizon = versionHorizon();
+    pthread_mutex_unlock(&txLock);
+    return xid;
 }
 
 /*
-    # This function opens a created table for operations
+    # true while any thread has a transaction in progress
 */
-RC openTable(RM_TableData *rel, char *name)
+static bool transactionsActive(void)
 {
-    int res = 0;
-    SM_PageHandle pageHandle;
-    bool status;
+    pthread_mutex_lock(&txLock);
+    bool active = activeTxs != NULL;
+    pthread_mutex_unlock(&txLock);
+    return active;
+}
 
-    // Initialize the record manager and assign table name to it
-    res += getIncrement(res);
-    rel->name = name;
-    rel->mgmtData = mgrHandler.recMgr;
-    res += getIncrement(res);
+/* Index maintenance helpers */
 
-    // Pin the first page to access table metadata
-    status = (pinPage(&mgrHandler.recMgr->bp, &mgrHandler.recMgr->pageHandle, 0) == RC_OK);
-    if (!status)
+/*
+    # builds the file name of an index on attrNum of the given table:
+    # <table>.<attrNum>.idx for a B+-tree, <table>.<attrNum>.hidx for a hash index
+    # the caller frees the returned string
+*/
+static char *indexFileName(char *table, int attrNum, IndexKind kind)
+{
+    char *fileName = (char *)malloc(strlen(table) + 24);
+    sprintf(fileName, "%s.%d.%s", table, attrNum, kind == INDEX_HASH ? "hidx" : "idx");
+    return fileName;
+}
+
+/*
+    # returns the position of the index on attrNum in the table's index list or -1
+*/
+static int findTableIndex(RecordMgr *rMgr, int attrNum)
+{
+    for (int i = 0; i < rMgr->numIndexes; i++)
     {
-        mgrHandler.currState.TM_resp = OPEN_TABLE_FAILED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        if (rMgr->indexAttrs[i] == attrNum)
+            return i;
     }
+    return -1;
+}
 
-    res++;
+/*
+    # opens the index file of attrNum and adds it to the table's index list
+    # does nothing if the index is already open
+*/
+static RC openTableIndex(RecordMgr *rMgr, int attrNum, IndexKind kind)
+{
+    int pos = rMgr->numIndexes;
+    RC status;
 
-    int initialTableData = 2;
+    if (findTableIndex(rMgr, attrNum) >= 0)
+        return RC_OK;
+    if (pos >= MAX_TABLE_INDEXES)
+        return RC_ERROR;
 
-    // Get the current page's data as a char pointer
-    pageHandle = (char *)mgrHandler.recMgr->pageHandle.data;
+    char *fileName = indexFileName(rMgr->bp.pageFile, attrNum, kind);
+    rMgr->indexes[pos] = NULL;
+    rMgr->hashIndexes[pos] = NULL;
+    if (kind == INDEX_HASH)
+        status = openHash(&rMgr->hashIndexes[pos], fileName);
+    else
+        status = openBtree(&rMgr->indexes[pos], fileName);
+    free(fileName);
+    if (status != RC_OK)
+        return status;
 
-    // Read the count of tuples from the first part of the page
-    mgrHandler.recMgr->countOfTuples = *(int *)pageHandle;
+    rMgr->indexAttrs[pos] = attrNum;
+    rMgr->indexKinds[pos] = kind;
+    rMgr->numIndexes++;
+    return RC_OK;
+}
 
-    // Move the page handle forward by the size of an integer
-    pageHandle = pageHandle + sizeof(int);
+static RC closeTableIndex(RecordMgr *rMgr, int pos)
+{
+    if (rMgr->indexKinds[pos] == INDEX_HASH)
+        return closeHash(rMgr->hashIndexes[pos]);
+    return closeBtree(rMgr->indexes[pos]);
+}
+
+static RC indexInsert(RecordMgr *rMgr, int pos, Value *key, RID rid)
+{
+    if (rMgr->indexKinds[pos] == INDEX_HASH)
+        return hashInsert(rMgr->hashIndexes[pos], key, rid);
+    return insertKey(rMgr->indexes[pos], key, rid);
+}
+
+static RC indexDelete(RecordMgr *rMgr, int pos, Value *key, RID rid)
+{
+    if (rMgr->indexKinds[pos] == INDEX_HASH)
+        return hashDelete(rMgr->hashIndexes[pos], key, rid);
+    return deleteEntry(rMgr->indexes[pos], key, rid);
+}
+
+/*
+    # offset of the index registry in the header page, right after the attribute descriptors
+*/
+static int indexRegistryOffset(int numAttr)
+{
+    return 4 * sizeof(int) + numAttr * (SIZE_OF_ATTRIBUTE + 2 * sizeof(int));
+}
+
+/*
+    # persists the list of indexed attributes in the header page of the table
+    # the registry is the index count followed by one (attrNum, kind) pair per index
+*/
+static RC writeIndexRegistry(RM_TableData *rel)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    BM_PageHandle header;
+    RC status;
+
+    beginLogged(rMgr);
+    if ((status = pinPage(&rMgr->bp, &header, 0)) != RC_OK)
+    {
+        endLogged(rMgr, LOG_PAGES, NULL);
+        return status;
+    }
+
+    char *registry = header.data + indexRegistryOffset(rel->schema->numAttr);
+    memcpy(registry, &rMgr->numIndexes, sizeof(int));
+    for (int i = 0; i < rMgr->numIndexes; i++)
+    {
+        int kind = rMgr->indexKinds[i];
+        memcpy(registry + (1 + 2 * i) * sizeof(int), &rMgr->indexAttrs[i], sizeof(int));
+        memcpy(registry + (2 + 2 * i) * sizeof(int), &kind, sizeof(int));
+    }
+
+    status = persistHeader(rMgr, &header);
+    unpinPage(&rMgr->bp, &header);
+    RC logStatus = endLogged(rMgr, LOG_PAGES, NULL);
+    return status != RC_OK ? status : logStatus;
+}
+
+/*
+    # adds (insert = true) or removes the entries of a record in every index of the table
+    # NULL attributes are not indexed, no predicate an index serves can match them
+    # an insert that fails in one index takes back the entries it made in the indexes before it
+*/
+static RC maintainIndexes(RM_TableData *rel, Record *record, bool insert)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    Value *key;
+    RC status;
+
+    for (int i = 0; i < rMgr->numIndexes; i++)
+    {
+        getAttr(record, rel->schema, rMgr->indexAttrs[i], &key);
+        if (key->isNull)
+            status = RC_OK;
+        else
+            status = insert ? indexInsert(rMgr, i, key, record->id)
+                            : indexDelete(rMgr, i, key, record->id);
+        freeVal(key);
+        if (status != RC_OK)
+        {
+            while (insert && --i >= 0)
+            {
+                getAttr(record, rel->schema, rMgr->indexAttrs[i], &key);
+                if (!key->isNull)
+                    indexDelete(rMgr, i, key, record->id);
+                freeVal(key);
+            }
+            return status;
+        }
+    }
+    return RC_OK;
+}
+
+/*
+    # moves the index entries of an updated record whose indexed attributes changed
+*/
+static RC updateIndexes(RM_TableData *rel, Record *oldRecord, Record *newRecord)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    Value *oldKey, *newKey, *equal;
+    RC status = RC_OK;
+
+    for (int i = 0; i < rMgr->numIndexes && status == RC_OK; i++)
+    {
+        getAttr(oldRecord, rel->schema, rMgr->indexAttrs[i], &oldKey);
+        getAttr(newRecord, rel->schema, rMgr->indexAttrs[i], &newKey);
+        MAKE_VALUE(equal, DT_BOOL, FALSE);
+        valueEquals(oldKey, newKey, equal);
+
+        // Two NULLs are the same (absent) entry
+        if (!(equal->v.boolV || (oldKey->isNull && newKey->isNull)))
+        {
+            if (!oldKey->isNull)
+                status = indexDelete(rMgr, i, oldKey, oldRecord->id);
+            if (status == RC_OK && !newKey->isNull)
+                status = indexInsert(rMgr, i, newKey, newRecord->id);
+        }
+
+        freeVal(oldKey);
+        freeVal(newKey);
+        freeVal(equal);
+    }
+    return status;
+}
+
+/* Slotted data pages */
+
+/*
+    # On-disk layout of the pages after the table header
+
+    # Every page is either a data page or one page of an overflow chain or of the dictionary
+    # chain. A page appended to the file is all zeros and reads as an empty data page.
+
+    # Data page: header | slot[0 .. numSlots-1] -> free space <- records
+    #   the header is three ints: kind, numSlots and recordStart (0 on a fresh page, i.e. PAGE_SIZE)
+    #   a slot is the (offset, length) of its record, offset 0 marks a free slot
+    #   records are packed from the end of the page, a deleted or shrunk record leaves
+    #   a hole that is reclaimed when the page is compacted; slot numbers never change
+
+    # Stored record: flag byte | xmin | xmax | null bitmap | non-NULL attributes in schema order
+    #   xmin is the transaction id that wrote the version, xmax the one that deleted it or 0;
+    #   a deleted version stays in its slot while a snapshot may see it, older versions of
+    #   updated records are kept in the version store of the open table instead
+    #   the null bitmap has one bit per attribute, a NULL attribute takes no other space
+    #   ints, floats and bools keep their in-memory width
+    #   a string is a 2-byte length and its bytes, padded to at least sizeof(int),
+    #   or OVERFLOW_STRING and the first page of the overflow chain that holds it;
+    #   the padding lets any string move out of line without growing the record;
+    #   a string of a dictionary encoded attribute is the int code of its value instead;
+    #   only setting a NULL attribute can grow a record beyond what its page has room for
+
+    # PAX page, the data pages of a table created with TABLE_LAYOUT_PAX:
+    #   header | xmin[capacity] | xmax[capacity] | used bitmap | one minipage per attribute
+    #   the header is kind, numSlots (one past the highest slot ever used) and capacity, the
+    #   records the page holds; slot s is the s-th entry of every array, a clear used bit marks
+    #   a free slot; a minipage is a null bitmap and the values of its attribute at their
+    #   in-memory width, strings included, so records never move and never spill; those of
+    #   a dictionary encoded attribute are int codes; a fresh page of a PAX table is formatted
+    #   by the first insert into it
+
+    # Overflow page: header of three ints (kind, next page or 0, bytes used) | bytes
+
+    # Dictionary page: header of three ints (kind, next page or 0, bytes used) | entries
+    #   an entry is the attribute number and the length of a value as 2-byte ints and the bytes
+    #   of the value; the n-th entry of an attribute is the value of code n; the table header
+    #   names the first page of the chain, values are appended to its last page
+
+    # Free page: kind and the next page of the free page list or 0; the head of the list is
+    #   kept in the table header. Freed overflow pages and pages emptied by vacuumTable go
+    #   there, and new pages are taken from it before the file grows
+*/
+
+#define PAGE_KIND_DATA 0
+#define PAGE_KIND_OVERFLOW 1
+#define PAGE_KIND_FREE 2
+#define PAGE_KIND_PAX 3
+#define PAGE_KIND_DICTIONARY 4
+
+#define PAGE_HEADER_SIZE (3 * (int)sizeof(int))
+#define PAGE_KIND 0
+#define PAGE_NUM_SLOTS 1
+#define PAGE_RECORD_START 2
+#define OVERFLOW_NEXT 1
+#define OVERFLOW_USED 2
+#define FREE_NEXT 1
+#define PAX_CAPACITY 2
+#define DICTIONARY_NEXT 1
+#define DICTIONARY_USED 2
+
+#define SLOT_ENTRY_SIZE (2 * (int)sizeof(unsigned short))
+#define VERSION_HEADER_SIZE (2 * (int)sizeof(long))
+#define STRING_LENGTH_SIZE ((int)sizeof(unsigned short))
+#define OVERFLOW_STRING 0xFFFF
+
+// Strings longer than this are always stored in an overflow chain
+#define MAX_INLINE_STRING (PAGE_SIZE / 4)
+#define OVERFLOW_CAPACITY (PAGE_SIZE - PAGE_HEADER_SIZE)
+// Largest stored record that fits on an empty data page
+#define MAX_STORED_RECORD (PAGE_SIZE - PAGE_HEADER_SIZE - SLOT_ENTRY_SIZE)
+
+// The version arrays of a PAX page start after its header, aligned for longs
+#define PAX_VERSIONS 16
+#define PAX_MAX_CAPACITY ((PAGE_SIZE - PAX_VERSIONS) / (2 * (int)sizeof(long)))
+#define PAX_BITMAP_SIZE(capacity) (((capacity) + 7) / 8)
+
+#define DICTIONARY_ENTRY_HEADER (2 * (int)sizeof(unsigned short))
+// Longest value of a dictionary encoded attribute, an entry fits on one dictionary page
+#define MAX_DICTIONARY_VALUE (PAGE_SIZE - PAGE_HEADER_SIZE - DICTIONARY_ENTRY_HEADER)
+
+RC attrOffset(Schema *schema, int attrNum, int *result);
+static int freeListOffset(int numAttr);
+static int dictionaryHeadOffset(int numAttr);
+static RC encodeString(RecordMgr *rMgr, Schema *schema, int attrNum, char *value, int *code);
+static char *dictionaryValue(struct Dictionary *dict, int code);
+
+#define NULL_BITMAP_SIZE(numAttr) (((numAttr) + 7) / 8)
+
+/*
+    # the null bitmap of an in-memory record follows its attributes,
+    # bit i is set if attribute i is NULL
+*/
+static char *nullBitmap(Schema *schema, char *image)
+{
+    int offset;
+    attrOffset(schema, schema->numAttr, &offset);
+    return image + offset;
+}
+
+static bool isNullBit(char *bitmap, int attrNum)
+{
+    return (bitmap[attrNum / 8] >> (attrNum % 8)) & 1;
+}
+
+static void setNullBit(char *bitmap, int attrNum, bool isNull)
+{
+    if (isNull)
+        bitmap[attrNum / 8] |= (char)(1 << (attrNum % 8));
+    else
+        bitmap[attrNum / 8] &= (char)~(1 << (attrNum % 8));
+}
+
+static bool declaredNotNull(Schema *schema, int attrNum)
+{
+    return schema->notNull != NULL && schema->notNull[attrNum];
+}
+
+static bool isKeyAttr(Schema *schema, int attrNum)
+{
+    for (int k = 0; k < schema->keySize; k++)
+        if (schema->keyAttrs[k] == attrNum)
+            return true;
+    return false;
+}
+
+/*
+    # the dictionary of attribute attrNum of an open table, NULL unless the attribute is dictionary encoded
+*/
+static struct Dictionary *attrDictionary(RecordMgr *rMgr, int attrNum)
+{
+    return rMgr->dictionaries != NULL ? rMgr->dictionaries[attrNum] : NULL;
+}
+
+// page header access
+static int pageGet(char *page, int field)
+{
+    int value;
+    memcpy(&value, page + field * sizeof(int), sizeof(int));
+    return value;
+}
+
+static void pageSet(char *page, int field, int value)
+{
+    memcpy(page + field * sizeof(int), &value, sizeof(int));
+}
+
+static int recordStart(char *page)
+{
+    int start = pageGet(page, PAGE_RECORD_START);
+    return start == 0 ? PAGE_SIZE : start;
+}
+
+static void getSlot(char *page, int slot, int *offset, int *length)
+{
+    unsigned short entry[2];
+    memcpy(entry, page + PAGE_HEADER_SIZE + slot * SLOT_ENTRY_SIZE, SLOT_ENTRY_SIZE);
+    *offset = entry[0];
+    *length = entry[1];
+}
+
+static void setSlot(char *page, int slot, int offset, int length)
+{
+    unsigned short entry[2] = {(unsigned short)offset, (unsigned short)length};
+    memcpy(page + PAGE_HEADER_SIZE + slot * SLOT_ENTRY_SIZE, entry, SLOT_ENTRY_SIZE);
+}
+
+// version header of a stored record
+static long storedXmin(char *stored)
+{
+    long xmin;
+    memcpy(&xmin, stored + 1, sizeof(long));
+    return xmin;
+}
+
+static long storedXmax(char *stored)
+{
+    long xmax;
+    memcpy(&xmax, stored + 1 + sizeof(long), sizeof(long));
+    return xmax;
+}
+
+static void setStoredVersion(char *stored, long xmin, long xmax)
+{
+    memcpy(stored + 1, &xmin, sizeof(long));
+    memcpy(stored + 1 + sizeof(long), &xmax, sizeof(long));
+}
+
+// version arrays and used bitmap of a PAX page
+static int paxXminOffset(int slot)
+{
+    return PAX_VERSIONS + slot * (int)sizeof(long);
+}
+
+static int paxXmaxOffset(int capacity, int slot)
+{
+    return PAX_VERSIONS + (capacity + slot) * (int)sizeof(long);
+}
+
+static char *paxUsedBitmap(char *page)
+{
+    return page + PAX_VERSIONS + 2 * pageGet(page, PAX_CAPACITY) * (int)sizeof(long);
+}
+
+/*
+    # true for the pages that hold records, slotted or PAX
+*/
+static bool hasSlots(char *page)
+{
+    int kind = pageGet(page, PAGE_KIND);
+    return kind == PAGE_KIND_DATA || kind == PAGE_KIND_PAX;
+}
+
+/*
+    # true if slot of a data page holds a record
+*/
+static bool slotIsLive(char *page, int slot)
+{
+    int offset, length;
+
+    if (!hasSlots(page) || slot < 0 || slot >= pageGet(page, PAGE_NUM_SLOTS))
+        return false;
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_PAX)
+        return isNullBit(paxUsedBitmap(page), slot);
+    getSlot(page, slot, &offset, &length);
+    return offset != 0;
+}
+
+// version of the record in a live slot of a data page
+static long slotXmin(char *page, int slot)
+{
+    int offset, length;
+    long xmin;
+
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_PAX)
+    {
+        getSlot(page, slot, &offset, &length);
+        return storedXmin(page + offset);
+    }
+    memcpy(&xmin, page + paxXminOffset(slot), sizeof(long));
+    return xmin;
+}
+
+static long slotXmax(char *page, int slot)
+{
+    int offset, length;
+    long xmax;
+
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_PAX)
+    {
+        getSlot(page, slot, &offset, &length);
+        return storedXmax(page + offset);
+    }
+    memcpy(&xmax, page + paxXmaxOffset(pageGet(page, PAX_CAPACITY), slot), sizeof(long));
+    return xmax;
+}
+
+static void setSlotVersion(char *page, int slot, long xmin, long xmax)
+{
+    int offset, length, capacity = pageGet(page, PAX_CAPACITY);
+
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_PAX)
+    {
+        getSlot(page, slot, &offset, &length);
+        setStoredVersion(page + offset, xmin, xmax);
+        return;
+    }
+    memcpy(page + paxXminOffset(slot), &xmin, sizeof(long));
+    memcpy(page + paxXmaxOffset(capacity, slot), &xmax, sizeof(long));
+}
+
+/*
+    # true if slot of a data page holds the latest version of a record, one that is not deleted
+*/
+static bool slotIsLatest(char *page, int slot)
+{
+    return slotIsLive(page, slot) && slotXmax(page, slot) == 0;
+}
+
+/*
+    # bytes between the slot directory and the records
+*/
+static int contiguousFree(char *page)
+{
+    return recordStart(page) - PAGE_HEADER_SIZE - pageGet(page, PAGE_NUM_SLOTS) * SLOT_ENTRY_SIZE;
+}
+
+/*
+    # free bytes of a data page once it is compacted, holes included
+*/
+static int totalFree(char *page)
+{
+    int numSlots = pageGet(page, PAGE_NUM_SLOTS), used = 0, offset, length;
+
+    for (int slot = 0; slot < numSlots; slot++)
+    {
+        getSlot(page, slot, &offset, &length);
+        if (offset != 0)
+            used += length;
+    }
+    return PAGE_SIZE - PAGE_HEADER_SIZE - numSlots * SLOT_ENTRY_SIZE - used;
+}
+
+/*
+    # packs the records of a data page against the end of the page so that
+    # all free space is contiguous, every record keeps its slot
+*/
+static void compactPage(char *page)
+{
+    char copy[PAGE_SIZE];
+    int numSlots = pageGet(page, PAGE_NUM_SLOTS), start = PAGE_SIZE, offset, length;
+
+    memcpy(copy, page, PAGE_SIZE);
+    for (int slot = 0; slot < numSlots; slot++)
+    {
+        getSlot(copy, slot, &offset, &length);
+        if (offset == 0)
+            continue;
+        start -= length;
+        memcpy(page + start, copy + offset, length);
+        setSlot(page, slot, start, length);
+    }
+    pageSet(page, PAGE_RECORD_START, start);
+}
+
+/*
+    # points a free slot of a data page at room for a stored record of size bytes, growing the
+    # slot directory up to the slot and compacting the page first if its free space is fragmented
+    # returns false if the slot is taken or the page is too full
+*/
+static bool claimSlot(char *page, int slot, int size)
+{
+    int numSlots = pageGet(page, PAGE_NUM_SLOTS), offset;
+
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_DATA || slot < 0 || slotIsLive(page, slot))
+        return false;
+
+    int needed = size + (slot >= numSlots ? (slot - numSlots + 1) * SLOT_ENTRY_SIZE : 0);
+    if (totalFree(page) < needed)
+        return false;
+    if (contiguousFree(page) < needed)
+        compactPage(page);
+
+    if (slot >= numSlots)
+    {
+        for (int free = numSlots; free < slot; free++)
+            setSlot(page, free, 0, 0);
+        pageSet(page, PAGE_NUM_SLOTS, slot + 1);
+    }
+    offset = recordStart(page) - size;
+    pageSet(page, PAGE_RECORD_START, offset);
+    setSlot(page, slot, offset, size);
+    return true;
+}
+
+/*
+    # finds room for a stored record of size bytes on a data page and points the first
+    # free slot or a new one at it
+    # returns the slot or -1 if this is not a data page or it is too full
+*/
+static int reserveSlot(char *page, int size)
+{
+    int numSlots, slot, offset, length;
+
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_DATA)
+        return -1;
+
+    numSlots = pageGet(page, PAGE_NUM_SLOTS);
+    for (slot = 0; slot < numSlots; slot++)
+    {
+        getSlot(page, slot, &offset, &length);
+        if (offset == 0)
+            break;
+    }
+    return claimSlot(page, slot, size) ? slot : -1;
+}
+
+/*
+    # persists the head of the free page list in the header page
+*/
+static RC saveFreeList(RecordMgr *rMgr, Schema *schema)
+{
+    BM_PageHandle header;
+    RC status;
+
+    if ((status = pinPage(&rMgr->bp, &header, 0)) != RC_OK)
+        return status;
+    memcpy(header.data + freeListOffset(schema->numAttr), &rMgr->freeListHead, sizeof(int));
+    status = persistHeader(rMgr, &header);
+    unpinPage(&rMgr->bp, &header);
+    return status;
+}
+
+/*
+    # puts a page that holds nothing onto the free page list, the caller saves the list
+*/
+static void pushFreePage(RecordMgr *rMgr, char *page, int pageNum)
+{
+    memset(page, 0, PAGE_HEADER_SIZE);
+    pageSet(page, PAGE_KIND, PAGE_KIND_FREE);
+    pageSet(page, FREE_NEXT, rMgr->freeListHead);
+    rMgr->freeListHead = pageNum;
+}
+
+/*
+    # returns the number of an empty page for new data, the head of the free page list
+    # if there is one and otherwise the page after the end of the file
+*/
+static RC allocatePage(RecordMgr *rMgr, Schema *schema, int *pageNum)
+{
+    BM_PageHandle page;
+    RC status;
+
+    if (rMgr->freeListHead == 0)
+    {
+        *pageNum = getNumFilePages(&rMgr->bp);
+        return RC_OK;
+    }
+
+    *pageNum = rMgr->freeListHead;
+    if ((status = pinPage(&rMgr->bp, &page, *pageNum)) != RC_OK)
+        return status;
+    rMgr->freeListHead = pageGet(page.data, FREE_NEXT);
+    memset(page.data, 0, PAGE_SIZE);
+    markDirty(&rMgr->bp, &page);
+    unpinPage(&rMgr->bp, &page);
+    return saveFreeList(rMgr, schema);
+}
+
+static int fixedAttrSize(DataType dataType)
+{
+    switch (dataType)
+    {
+    case DT_INT:
+        return sizeof(int);
+    case DT_FLOAT:
+        return sizeof(float);
+    case DT_BOOL:
+        return sizeof(bool);
+    default:
+        return 0;
+    }
+}
+
+static int storedStringSize(int length, bool overflow)
+{
+    if (overflow)
+        return STRING_LENGTH_SIZE + sizeof(int);
+    return STRING_LENGTH_SIZE + (length < (int)sizeof(int) ? (int)sizeof(int) : length);
+}
+
+/*
+    # decides which strings of an in-memory record go to overflow chains and returns
+    # the size of its stored form; strings longer than MAX_INLINE_STRING always move out
+    # of line, then the longest inline strings follow until the record fits in limit;
+    # dictionary encoded strings take the size of their code and never move out
+    # returns -1 if the record cannot be made to fit
+*/
+static int planStoredRecord(RecordMgr *rMgr, Schema *schema, char *image, bool *spill, int limit)
+{
+    char *nulls = nullBitmap(schema, image);
+    int size = 1 + VERSION_HEADER_SIZE + NULL_BITMAP_SIZE(schema->numAttr), offset;
+
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        spill[i] = false;
+        if (isNullBit(nulls, i))
+            continue;
+        if (schema->dataTypes[i] != DT_STRING)
+        {
+            size += fixedAttrSize(schema->dataTypes[i]);
+            continue;
+        }
+        if (attrDictionary(rMgr, i) != NULL)
+        {
+            size += sizeof(int);
+            continue;
+        }
+        attrOffset(schema, i, &offset);
+        int length = strnlen(image + offset, schema->typeLength[i]);
+        spill[i] = length > MAX_INLINE_STRING;
+        size += storedStringSize(length, spill[i]);
+    }
+
+    while (size > limit)
+    {
+        int longest = -1, longestLength = sizeof(int);
+        for (int i = 0; i < schema->numAttr; i++)
+        {
+            if (schema->dataTypes[i] != DT_STRING || spill[i] || isNullBit(nulls, i) || attrDictionary(rMgr, i) != NULL)
+                continue;
+            attrOffset(schema, i, &offset);
+            int length = strnlen(image + offset, schema->typeLength[i]);
+            if (length > longestLength)
+            {
+                longest = i;
+                longestLength = length;
+            }
+        }
+        if (longest < 0)
+            return -1;
+        spill[longest] = true;
+        size -= storedStringSize(longestLength, false) - storedStringSize(longestLength, true);
+    }
+    return size;
+}
+
+/*
+    # writes length bytes of value to a chain of pages taken from the free page list
+    # or appended to the table file
+*/
+static RC writeOverflowChain(RecordMgr *rMgr, Schema *schema, char *value, int length, int *firstPage)
+{
+    BM_PageHandle page, prev;
+    bool hasPrev = false;
+    RC status = RC_OK;
+
+    *firstPage = 0;
+    for (int written = 0; written < length && status == RC_OK;)
+    {
+        int pageNum;
+        if ((status = allocatePage(rMgr, schema, &pageNum)) != RC_OK ||
+            (status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+            break;
+
+        int chunk = (length - written < OVERFLOW_CAPACITY) ? length - written : OVERFLOW_CAPACITY;
+        memset(page.data, 0, PAGE_SIZE);
+        pageSet(page.data, PAGE_KIND, PAGE_KIND_OVERFLOW);
+        pageSet(page.data, OVERFLOW_USED, chunk);
+        memcpy(page.data + PAGE_HEADER_SIZE, value + written, chunk);
+        markDirty(&rMgr->bp, &page);
+        written += chunk;
+
+        if (hasPrev)
+        {
+            pageSet(prev.data, OVERFLOW_NEXT, pageNum);
+            markDirty(&rMgr->bp, &prev);
+            status = unpinPage(&rMgr->bp, &prev);
+        }
+        else
+            *firstPage = pageNum;
+        prev = page;
+        hasPrev = true;
+    }
+
+    if (hasPrev)
+        unpinPage(&rMgr->bp, &prev);
+    return status;
+}
+
+/*
+    # copies at most maxLength bytes of an overflow chain to dest
+*/
+static RC readOverflowChain(RecordMgr *rMgr, int pageNum, char *dest, int maxLength)
+{
+    BM_PageHandle page;
+    RC status;
+
+    while (pageNum != 0 && maxLength > 0)
+    {
+        if ((status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+            return status;
+        int chunk = pageGet(page.data, OVERFLOW_USED);
+        if (chunk > maxLength)
+            chunk = maxLength;
+        memcpy(dest, page.data + PAGE_HEADER_SIZE, chunk);
+        dest += chunk;
+        maxLength -= chunk;
+        pageNum = pageGet(page.data, OVERFLOW_NEXT);
+        unpinPage(&rMgr->bp, &page);
+    }
+    return RC_OK;
+}
+
+/*
+    # writes the stored form of an in-memory record to dest, the strings marked in
+    # spill are written to new overflow chains and new values of dictionary encoded strings
+    # to the dictionary chain; the version is stamped with xmin and not deleted
+*/
+static RC writeStoredRecord(RecordMgr *rMgr, Schema *schema, char *image, bool *spill, long xmin, char *dest)
+{
+    char *nulls = nullBitmap(schema, image);
+    int offset;
+    RC status;
+
+    *dest = '#';
+    setStoredVersion(dest, xmin, 0);
+    dest += 1 + VERSION_HEADER_SIZE;
+    memcpy(dest, nulls, NULL_BITMAP_SIZE(schema->numAttr));
+    dest += NULL_BITMAP_SIZE(schema->numAttr);
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        if (isNullBit(nulls, i))
+            continue;
+        attrOffset(schema, i, &offset);
+        if (schema->dataTypes[i] != DT_STRING)
+        {
+            int size = fixedAttrSize(schema->dataTypes[i]);
+            memcpy(dest, image + offset, size);
+            dest += size;
+            continue;
+        }
+        if (attrDictionary(rMgr, i) != NULL)
+        {
+            int code;
+            if ((status = encodeString(rMgr, schema, i, image + offset, &code)) != RC_OK)
+                return status;
+            memcpy(dest, &code, sizeof(int));
+            dest += sizeof(int);
+            continue;
+        }
+
+        int length = strnlen(image + offset, schema->typeLength[i]);
+        unsigned short prefix = spill[i] ? OVERFLOW_STRING : (unsigned short)length;
+        memcpy(dest, &prefix, STRING_LENGTH_SIZE);
+        if (spill[i])
+        {
+            int firstPage;
+            if ((status = writeOverflowChain(rMgr, schema, image + offset, length, &firstPage)) != RC_OK)
+                return status;
+            memcpy(dest + STRING_LENGTH_SIZE, &firstPage, sizeof(int));
+        }
+        else
+        {
+            memset(dest + STRING_LENGTH_SIZE, 0, sizeof(int));
+            memcpy(dest + STRING_LENGTH_SIZE, image + offset, length);
+        }
+        dest += storedStringSize(length, spill[i]);
+    }
+    return RC_OK;
+}
+
+/*
+    # decodes the attributes marked in wanted (all of them if wanted is NULL) and the null bitmap
+    # of a stored record into an in-memory record image, the flag byte of the image is left alone;
+    # the image bytes of the other attributes are not touched and their overflow chains are not read
+*/
+static RC readStoredAttrs(RecordMgr *rMgr, Schema *schema, char *src, char *image, bool *wanted)
+{
+    char *nulls = nullBitmap(schema, image);
+    int offset;
+    RC status;
+
+    src += 1 + VERSION_HEADER_SIZE;
+    memcpy(nulls, src, NULL_BITMAP_SIZE(schema->numAttr));
+    src += NULL_BITMAP_SIZE(schema->numAttr);
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        attrOffset(schema, i, &offset);
+        if (isNullBit(nulls, i))
+        {
+            memset(image + offset, 0, schema->dataTypes[i] == DT_STRING ? schema->typeLength[i] : fixedAttrSize(schema->dataTypes[i]));
+            continue;
+        }
+        bool skip = wanted != NULL && !wanted[i];
+        if (schema->dataTypes[i] != DT_STRING)
+        {
+            int size = fixedAttrSize(schema->dataTypes[i]);
+            if (!skip)
+                memcpy(image + offset, src, size);
+            src += size;
+            continue;
+        }
+        if (attrDictionary(rMgr, i) != NULL)
+        {
+            int code;
+            memcpy(&code, src, sizeof(int));
+            src += sizeof(int);
+            char *value = skip ? NULL : dictionaryValue(attrDictionary(rMgr, i), code);
+            if (!skip && value == NULL)
+                return RC_ERROR;
+            if (!skip)
+                memcpy(image + offset, value, schema->typeLength[i]);
+            continue;
+        }
+
+        unsigned short prefix;
+        memcpy(&prefix, src, STRING_LENGTH_SIZE);
+        src += STRING_LENGTH_SIZE;
+        if (skip)
+        {
+            src += storedStringSize(prefix, prefix == OVERFLOW_STRING) - STRING_LENGTH_SIZE;
+            continue;
+        }
+        memset(image + offset, 0, schema->typeLength[i]);
+        if (prefix == OVERFLOW_STRING)
+        {
+            int firstPage;
+            memcpy(&firstPage, src, sizeof(int));
+            src += sizeof(int);
+            if ((status = readOverflowChain(rMgr, firstPage, image + offset, schema->typeLength[i])) != RC_OK)
+                return status;
+        }
+        else
+        {
+            memcpy(image + offset, src, prefix);
+            src += storedStringSize(prefix, false) - STRING_LENGTH_SIZE;
+        }
+    }
+    return RC_OK;
+}
+
+/*
+    # releases the overflow chains of a stored record to the free page list
+*/
+static void freeOverflowChains(RecordMgr *rMgr, Schema *schema, char *src)
+{
+    BM_PageHandle page;
+    char *nulls = src + 1 + VERSION_HEADER_SIZE;
+    int freed = 0;
+
+    src = nulls + NULL_BITMAP_SIZE(schema->numAttr);
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        if (isNullBit(nulls, i))
+            continue;
+        if (schema->dataTypes[i] != DT_STRING || attrDictionary(rMgr, i) != NULL)
+        {
+            src += attrDictionary(rMgr, i) != NULL ? (int)sizeof(int) : fixedAttrSize(schema->dataTypes[i]);
+            continue;
+        }
+
+        unsigned short prefix;
+        memcpy(&prefix, src, STRING_LENGTH_SIZE);
+        src += STRING_LENGTH_SIZE;
+        if (prefix != OVERFLOW_STRING)
+        {
+            src += storedStringSize(prefix, false) - STRING_LENGTH_SIZE;
+            continue;
+        }
+
+        int pageNum;
+        memcpy(&pageNum, src, sizeof(int));
+        src += sizeof(int);
+        while (pageNum != 0 && pinPage(&rMgr->bp, &page, pageNum) == RC_OK)
+        {
+            int next = pageGet(page.data, OVERFLOW_NEXT);
+            pushFreePage(rMgr, page.data, pageNum);
+            markDirty(&rMgr->bp, &page);
+            unpinPage(&rMgr->bp, &page);
+            pageNum = next;
+            freed++;
+        }
+    }
+
+    if (freed > 0)
+        saveFreeList(rMgr, schema);
+}
+
+/*
+    # the stored bytes of attribute attrNum of a stored record, NULL if the attribute is NULL
+*/
+static char *storedAttr(RecordMgr *rMgr, Schema *schema, char *src, int attrNum)
+{
+    char *nulls = src + 1 + VERSION_HEADER_SIZE;
+
+    if (isNullBit(nulls, attrNum))
+        return NULL;
+    src = nulls + NULL_BITMAP_SIZE(schema->numAttr);
+    for (int i = 0; i < attrNum; i++)
+    {
+        if (isNullBit(nulls, i))
+            continue;
+        if (attrDictionary(rMgr, i) != NULL)
+            src += sizeof(int);
+        else if (schema->dataTypes[i] != DT_STRING)
+            src += fixedAttrSize(schema->dataTypes[i]);
+        else
+        {
+            unsigned short prefix;
+            memcpy(&prefix, src, STRING_LENGTH_SIZE);
+            src += storedStringSize(prefix, prefix == OVERFLOW_STRING);
+        }
+    }
+    return src;
+}
+
+/* Dictionaries */
+
+#define DICTIONARY_INITIAL_CODES 16
+
+/*
+    # The values of a dictionary encoded attribute of an open table by code; its stored records
+    # hold the code of their value instead of the value. Codes are handed out in the order the
+    # values first occur and never change, a value stays in the dictionary for the life of the table
+*/
+typedef struct Dictionary
+{
+    int width; // typeLength of the attribute, every value is kept zero padded to it
+    int numCodes;
+    int capacity;
+    char *values;   // value of code c at c * width
+    int *buckets;   // codes by the hash of their value, -1 for an empty bucket
+    int numBuckets; // a power of two, at least twice the capacity
+} Dictionary;
+
+static unsigned int dictionaryHash(char *value, int length)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    for (int i = 0; i < length; i++)
+        hash = (hash ^ (unsigned char)value[i]) * 16777619u;
+    return hash;
+}
+
+static Dictionary *createDictionary(int width)
+{
+    Dictionary *dict = (Dictionary *)calloc(1, sizeof(Dictionary));
+    if (dict == NULL)
+        return NULL;
+    dict->width = width;
+    return dict;
+}
+
+static void freeDictionaries(RecordMgr *rMgr, int numAttr)
+{
+    if (rMgr->dictionaries == NULL)
+        return;
+    for (int i = 0; i < numAttr; i++)
+    {
+        Dictionary *dict = rMgr->dictionaries[i];
+        if (dict == NULL)
+            continue;
+        free(dict->values);
+        free(dict->buckets);
+        free(dict);
+    }
+    free(rMgr->dictionaries);
+    rMgr->dictionaries = NULL;
+}
+
+/*
+    # the code of a value of length bytes, -1 if the dictionary does not have it
+*/
+static int dictionaryCode(Dictionary *dict, char *value, int length)
+{
+    if (dict->numBuckets == 0 || length > dict->width)
+        return -1;
+
+    unsigned int mask = dict->numBuckets - 1;
+    for (unsigned int b = dictionaryHash(value, length) & mask; dict->buckets[b] >= 0; b = (b + 1) & mask)
+    {
+        char *entry = dict->values + (long)dict->buckets[b] * dict->width;
+        if ((int)strnlen(entry, dict->width) == length && memcmp(entry, value, length) == 0)
+            return dict->buckets[b];
+    }
+    return -1;
+}
+
+/*
+    # the value of a code, zero padded to the width of the attribute as in a record image;
+    # NULL for a code the dictionary does not have
+*/
+static char *dictionaryValue(Dictionary *dict, int code)
+{
+    if (code < 0 || code >= dict->numCodes)
+        return NULL;
+    return dict->values + (long)code * dict->width;
+}
+
+/*
+    # makes room for one more code, so that adding it cannot fail once its entry is on a page
+*/
+static RC reserveDictionaryCode(Dictionary *dict)
+{
+    if (dict->numCodes < dict->capacity)
+        return RC_OK;
+
+    int capacity = dict->capacity > 0 ? 2 * dict->capacity : DICTIONARY_INITIAL_CODES;
+    char *values = (char *)realloc(dict->values, (long)capacity * dict->width);
+    if (values == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    dict->values = values;
+
+    int *buckets = (int *)malloc(2 * capacity * sizeof(int));
+    if (buckets == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memset(buckets, -1, 2 * capacity * sizeof(int));
+    unsigned int mask = 2 * capacity - 1;
+    for (int code = 0; code < dict->numCodes; code++)
+    {
+        char *value = dict->values + (long)code * dict->width;
+        unsigned int b = dictionaryHash(value, strnlen(value, dict->width)) & mask;
+        while (buckets[b] >= 0)
+            b = (b + 1) & mask;
+        buckets[b] = code;
+    }
+    free(dict->buckets);
+    dict->buckets = buckets;
+    dict->numBuckets = 2 * capacity;
+    dict->capacity = capacity;
+    return RC_OK;
+}
+
+/*
+    # gives a value the dictionary does not have the next code, in memory; reserveDictionaryCode made room
+*/
+static int addDictionaryValue(Dictionary *dict, char *value, int length)
+{
+    int code = dict->numCodes++;
+    char *entry = dict->values + (long)code * dict->width;
+
+    memset(entry, 0, dict->width);
+    memcpy(entry, value, length);
+    unsigned int mask = dict->numBuckets - 1, b = dictionaryHash(value, length) & mask;
+    while (dict->buckets[b] >= 0)
+        b = (b + 1) & mask;
+    dict->buckets[b] = code;
+    return code;
+}
+
+/*
+    # appends the value of the next code of attribute attrNum to the dictionary chain of the table,
+    # on its last page if there is room, otherwise on a new page linked to it or, for the first
+    # entry, named in the table header
+*/
+static RC appendDictionaryEntry(RecordMgr *rMgr, Schema *schema, int attrNum, char *value, int length)
+{
+    BM_PageHandle page, prev;
+    int entrySize = DICTIONARY_ENTRY_HEADER + length, pageNum;
+    unsigned short entry[2] = {(unsigned short)attrNum, (unsigned short)length};
+    RC status;
+
+    if (rMgr->dictionaryTail != 0)
+    {
+        if ((status = pinPage(&rMgr->bp, &page, rMgr->dictionaryTail)) != RC_OK)
+            return status;
+        int used = pageGet(page.data, DICTIONARY_USED);
+        if (PAGE_HEADER_SIZE + used + entrySize <= PAGE_SIZE)
+        {
+            memcpy(page.data + PAGE_HEADER_SIZE + used, entry, DICTIONARY_ENTRY_HEADER);
+            memcpy(page.data + PAGE_HEADER_SIZE + used + DICTIONARY_ENTRY_HEADER, value, length);
+            pageSet(page.data, DICTIONARY_USED, used + entrySize);
+            markDirty(&rMgr->bp, &page);
+            return unpinPage(&rMgr->bp, &page);
+        }
+        prev = page;
+    }
+
+    if ((status = allocatePage(rMgr, schema, &pageNum)) != RC_OK ||
+        (status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+    {
+        if (rMgr->dictionaryTail != 0)
+            unpinPage(&rMgr->bp, &prev);
+        return status;
+    }
+    memset(page.data, 0, PAGE_SIZE);
+    pageSet(page.data, PAGE_KIND, PAGE_KIND_DICTIONARY);
+    pageSet(page.data, DICTIONARY_USED, entrySize);
+    memcpy(page.data + PAGE_HEADER_SIZE, entry, DICTIONARY_ENTRY_HEADER);
+    memcpy(page.data + PAGE_HEADER_SIZE + DICTIONARY_ENTRY_HEADER, value, length);
+    markDirty(&rMgr->bp, &page);
+    unpinPage(&rMgr->bp, &page);
+
+    // Link the new page to the chain
+    if (rMgr->dictionaryTail != 0)
+    {
+        pageSet(prev.data, DICTIONARY_NEXT, pageNum);
+        markDirty(&rMgr->bp, &prev);
+        status = unpinPage(&rMgr->bp, &prev);
+    }
+    else if ((status = pinPage(&rMgr->bp, &prev, 0)) == RC_OK)
+    {
+        memcpy(prev.data + dictionaryHeadOffset(schema->numAttr), &pageNum, sizeof(int));
+        status = persistHeader(rMgr, &prev);
+        unpinPage(&rMgr->bp, &prev);
+    }
+    if (status == RC_OK)
+        rMgr->dictionaryTail = pageNum;
+    return status;
+}
+
+/*
+    # the code of value, a string attribute of a record image, in the dictionary of attribute
+    # attrNum; a new value is appended to the dictionary chain first, by the operation that
+    # writes the record, so that its log record has both
+*/
+static RC encodeString(RecordMgr *rMgr, Schema *schema, int attrNum, char *value, int *code)
+{
+    Dictionary *dict = rMgr->dictionaries[attrNum];
+    int length = strnlen(value, dict->width);
+    RC status;
+
+    if ((*code = dictionaryCode(dict, value, length)) >= 0)
+        return RC_OK;
+    if ((status = reserveDictionaryCode(dict)) != RC_OK ||
+        (status = appendDictionaryEntry(rMgr, schema, attrNum, value, length)) != RC_OK)
+        return status;
+    *code = addDictionaryValue(dict, value, length);
+    return RC_OK;
+}
+
+/*
+    # reads the dictionary chain that starts at page head into the dictionaries of an open table
+*/
+static RC loadDictionaries(RecordMgr *rMgr, Schema *schema, int head)
+{
+    BM_PageHandle page;
+    RC status = RC_OK;
+
+    for (int pageNum = head; pageNum != 0 && status == RC_OK;)
+    {
+        if ((status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+            return status;
+        int used = pageGet(page.data, DICTIONARY_USED);
+        if (pageGet(page.data, PAGE_KIND) != PAGE_KIND_DICTIONARY || used < 0 || used > PAGE_SIZE - PAGE_HEADER_SIZE)
+            status = RC_ERROR;
+        for (int pos = 0; pos + DICTIONARY_ENTRY_HEADER <= used && status == RC_OK;)
+        {
+            unsigned short entry[2];
+            memcpy(entry, page.data + PAGE_HEADER_SIZE + pos, DICTIONARY_ENTRY_HEADER);
+            Dictionary *dict = entry[0] < schema->numAttr ? attrDictionary(rMgr, entry[0]) : NULL;
+            if (dict == NULL || entry[1] > dict->width)
+                status = RC_ERROR;
+            else if ((status = reserveDictionaryCode(dict)) == RC_OK)
+                addDictionaryValue(dict, page.data + PAGE_HEADER_SIZE + pos + DICTIONARY_ENTRY_HEADER, entry[1]);
+            pos += DICTIONARY_ENTRY_HEADER + entry[1];
+        }
+
+        rMgr->dictionaryTail = pageNum;
+        pageNum = pageGet(page.data, DICTIONARY_NEXT);
+        unpinPage(&rMgr->bp, &page);
+    }
+    return status;
+}
+
+/* PAX pages */
+
+/*
+    # Where the minipages of the PAX pages of a table are; every page of the table has the
+    # same capacity and layout, both follow from the schema
+*/
+typedef struct PaxLayout
+{
+    int capacity;
+    int *nulls;        // offset of the null bitmap of each attribute
+    int *values;       // offset of the values of each attribute
+    int *widths;       // bytes of one value, as in a record image or a dictionary code
+    int *imageOffsets; // offset of each attribute in a record image
+} PaxLayout;
+
+/*
+    # lays the minipages of a PAX page with room for capacity records out into layout (may be NULL),
+    # the values of every attribute start at a multiple of 8; returns the bytes the page needs
+    # the attributes marked in encoded (none if NULL) hold dictionary codes
+*/
+static int planPaxLayout(Schema *schema, bool *encoded, int capacity, PaxLayout *layout)
+{
+    int end = PAX_VERSIONS + 2 * capacity * (int)sizeof(long) + PAX_BITMAP_SIZE(capacity);
+
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        int width = schema->dataTypes[i] == DT_STRING ? schema->typeLength[i] : fixedAttrSize(schema->dataTypes[i]);
+        if (encoded != NULL && encoded[i])
+            width = sizeof(int);
+        if (layout != NULL)
+        {
+            layout->nulls[i] = end;
+            layout->widths[i] = width;
+        }
+        end = (end + PAX_BITMAP_SIZE(capacity) + 7) & ~7;
+        if (layout != NULL)
+            layout->values[i] = end;
+        end += capacity * width;
+    }
+    return end;
+}
+
+/*
+    # the layout of the PAX pages of a table of schema whose attributes marked in encoded (may be NULL)
+    # are dictionary encoded, NULL if not even one record fits on a page
+*/
+static PaxLayout *createPaxLayout(Schema *schema, bool *encoded)
+{
+    int capacity = PAX_MAX_CAPACITY;
+
+    while (capacity > 0 && planPaxLayout(schema, encoded, capacity, NULL) > PAGE_SIZE)
+        capacity--;
+    if (capacity == 0)
+        return NULL;
+
+    PaxLayout *layout = (PaxLayout *)malloc(sizeof(PaxLayout));
+    int *offsets = (int *)malloc(4 * (schema->numAttr > 0 ? schema->numAttr : 1) * sizeof(int));
+    if (layout == NULL || offsets == NULL)
+    {
+        free(layout);
+        free(offsets);
+        return NULL;
+    }
+    layout->capacity = capacity;
+    layout->nulls = offsets;
+    layout->values = offsets + schema->numAttr;
+    layout->widths = offsets + 2 * schema->numAttr;
+    layout->imageOffsets = offsets + 3 * schema->numAttr;
+    planPaxLayout(schema, encoded, capacity, layout);
+    for (int i = 0; i < schema->numAttr; i++)
+        attrOffset(schema, i, &layout->imageOffsets[i]);
+    return layout;
+}
+
+static void freePaxLayout(PaxLayout *layout)
+{
+    if (layout == NULL)
+        return;
+    free(layout->nulls);
+    free(layout);
+}
+
+/*
+    # marks a free slot of a PAX page used, growing numSlots up to it; a fresh page of the
+    # table is formatted first; returns false if the slot is taken or beyond the capacity
+*/
+static bool claimPaxSlot(RecordMgr *rMgr, char *page, int slot)
+{
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_DATA && pageGet(page, PAGE_NUM_SLOTS) == 0)
+    {
+        memset(page, 0, PAGE_SIZE);
+        pageSet(page, PAGE_KIND, PAGE_KIND_PAX);
+        pageSet(page, PAX_CAPACITY, rMgr->pax->capacity);
+    }
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_PAX || slot < 0 || slot >= pageGet(page, PAX_CAPACITY) ||
+        slotIsLive(page, slot))
+        return false;
+
+    if (slot >= pageGet(page, PAGE_NUM_SLOTS))
+        pageSet(page, PAGE_NUM_SLOTS, slot + 1);
+    setNullBit(paxUsedBitmap(page), slot, true);
+    return true;
+}
+
+/*
+    # slots of a PAX page that do not hold a record
+*/
+static int paxFreeSlots(char *page)
+{
+    int numSlots = pageGet(page, PAGE_NUM_SLOTS), freeSlots = pageGet(page, PAX_CAPACITY) - numSlots;
+
+    for (int slot = 0; slot < numSlots; slot++)
+        if (!slotIsLive(page, slot))
+            freeSlots++;
+    return freeSlots;
+}
+
+/*
+    # scatters an in-memory record image over the minipages of a used slot of a PAX page,
+    # encoding the strings of dictionary encoded attributes; the version is stamped with xmin
+    # and not deleted
+*/
+static RC writePaxSlot(RecordMgr *rMgr, Schema *schema, char *page, int slot, char *image, long xmin)
+{
+    PaxLayout *pax = rMgr->pax;
+    char *nulls = nullBitmap(schema, image);
+    RC status;
+
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        char *value = page + pax->values[i] + slot * pax->widths[i];
+        bool isNull = isNullBit(nulls, i);
+        setNullBit(page + pax->nulls[i], slot, isNull);
+        if (isNull)
+            memset(value, 0, pax->widths[i]);
+        else if (attrDictionary(rMgr, i) != NULL)
+        {
+            int code;
+            if ((status = encodeString(rMgr, schema, i, image + pax->imageOffsets[i], &code)) != RC_OK)
+                return status;
+            memcpy(value, &code, sizeof(int));
+        }
+        else
+            memcpy(value, image + pax->imageOffsets[i], pax->widths[i]);
+    }
+    setSlotVersion(page, slot, xmin, 0);
+    return RC_OK;
+}
+
+/*
+    # gathers the attributes marked in wanted (all of them if wanted is NULL) and the null bitmap of
+    # the record in slot of a PAX page into an in-memory record image, like readStoredAttrs
+*/
+static RC readPaxAttrs(RecordMgr *rMgr, Schema *schema, char *page, int slot, char *image, bool *wanted)
+{
+    PaxLayout *pax = rMgr->pax;
+    char *nulls = nullBitmap(schema, image);
+
+    for (int i = 0; i < schema->numAttr; i++)
+    {
+        Dictionary *dict = attrDictionary(rMgr, i);
+        char *value = page + pax->values[i] + slot * pax->widths[i];
+        bool isNull = isNullBit(page + pax->nulls[i], slot);
+        setNullBit(nulls, i, isNull);
+        if (isNull)
+            memset(image + pax->imageOffsets[i], 0, dict != NULL ? dict->width : pax->widths[i]);
+        else if (wanted != NULL && !wanted[i])
+            continue;
+        else if (dict != NULL)
+        {
+            int code;
+            memcpy(&code, value, sizeof(int));
+            if ((value = dictionaryValue(dict, code)) == NULL)
+                return RC_ERROR;
+            memcpy(image + pax->imageOffsets[i], value, dict->width);
+        }
+        else
+            memcpy(image + pax->imageOffsets[i], value, pax->widths[i]);
+    }
+    return RC_OK;
+}
+
+/* Record slots of either layout */
+
+/*
+    # finds a free slot for a new record on a data page of the table and takes it, size is
+    # the stored form of the record on a slotted page; returns the slot or -1 if there is no room
+*/
+static int reserveRecordSlot(RecordMgr *rMgr, char *page, int size)
+{
+    int numSlots, slot;
+
+    if (rMgr->pax == NULL)
+        return reserveSlot(page, size);
+
+    numSlots = hasSlots(page) ? pageGet(page, PAGE_NUM_SLOTS) : 0;
+    for (slot = 0; slot < numSlots && slotIsLive(page, slot); slot++)
+        ;
+    return claimPaxSlot(rMgr, page, slot) ? slot : -1;
+}
+
+/*
+    # takes the free slot of a data page of the table back for a record of size stored bytes,
+    # false if it is not free or the page has no room
+*/
+static bool claimRecordSlot(RecordMgr *rMgr, char *page, int slot, int size)
+{
+    return rMgr->pax != NULL ? claimPaxSlot(rMgr, page, slot) : claimSlot(page, slot, size);
+}
+
+/*
+    # writes an in-memory record image into a slot taken by reserveRecordSlot or claimRecordSlot,
+    # the strings marked in spill go to overflow chains on a slotted page
+*/
+static RC writeSlotRecord(RecordMgr *rMgr, Schema *schema, char *page, int slot, char *image, bool *spill, long xmin)
+{
+    int offset, length;
+
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_PAX)
+        return writePaxSlot(rMgr, schema, page, slot, image, xmin);
+    getSlot(page, slot, &offset, &length);
+    return writeStoredRecord(rMgr, schema, image, spill, xmin, page + offset);
+}
+
+/*
+    # decodes the attributes marked in wanted (all if NULL) of the record in a live slot of a data page
+*/
+static RC readSlotAttrs(RecordMgr *rMgr, Schema *schema, char *page, int slot, char *image, bool *wanted)
+{
+    int offset, length;
+
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_PAX)
+        return readPaxAttrs(rMgr, schema, page, slot, image, wanted);
+    getSlot(page, slot, &offset, &length);
+    return readStoredAttrs(rMgr, schema, page + offset, image, wanted);
+}
+
+/*
+    # decodes every attribute of the record in a live slot of a data page into an in-memory record image
+*/
+static RC readSlotRecord(RecordMgr *rMgr, Schema *schema, char *page, int slot, char *image)
+{
+    return readSlotAttrs(rMgr, schema, page, slot, image, NULL);
+}
+
+/*
+    # the code of dictionary encoded attribute attrNum of the record in a live slot of a data page,
+    # without decoding anything; false if the attribute is NULL
+*/
+static bool slotCode(RecordMgr *rMgr, Schema *schema, char *page, int slot, int attrNum, int *code)
+{
+    int offset, length;
+    char *value;
+
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_PAX)
+    {
+        if (isNullBit(page + rMgr->pax->nulls[attrNum], slot))
+            return false;
+        value = page + rMgr->pax->values[attrNum] + slot * sizeof(int);
+    }
+    else
+    {
+        getSlot(page, slot, &offset, &length);
+        if ((value = storedAttr(rMgr, schema, page + offset, attrNum)) == NULL)
+            return false;
+    }
+    memcpy(code, value, sizeof(int));
+    return true;
+}
+
+/*
+    # frees a live slot of a data page, a slotted page releases the overflow chains of its record
+    # and keeps its bytes as a hole until it is compacted
+*/
+static void freeSlot(RecordMgr *rMgr, Schema *schema, char *page, int slot)
+{
+    int offset, length;
+
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_PAX)
+    {
+        setNullBit(paxUsedBitmap(page), slot, false);
+        return;
+    }
+    getSlot(page, slot, &offset, &length);
+    freeOverflowChains(rMgr, schema, page + offset);
+    setSlot(page, slot, 0, 0);
+}
+
+/*
+    # replaces the record in slot of a data page by an in-memory record image
+    # the record keeps its slot: it is rewritten in place when it fits, otherwise moved
+    # within the page, and as a last resort its strings go to overflow chains; the new version
+    # is stamped with xmin
+*/
+static RC rewriteSlot(RecordMgr *rMgr, Schema *schema, char *page, int slot, char *image, long xmin)
+{
+    int offset, length, size;
+    RC status;
+
+    // A record of a PAX page is rewritten in place, its values have a fixed width
+    if (pageGet(page, PAGE_KIND) == PAGE_KIND_PAX)
+    {
+        if (slot < 0 || slot >= pageGet(page, PAGE_NUM_SLOTS))
+            return RC_RM_NO_MORE_TUPLES;
+        setNullBit(paxUsedBitmap(page), slot, true);
+        return writePaxSlot(rMgr, schema, page, slot, image, xmin);
+    }
+
+    if (pageGet(page, PAGE_KIND) != PAGE_KIND_DATA || slot < 0 || slot >= pageGet(page, PAGE_NUM_SLOTS))
+        return RC_RM_NO_MORE_TUPLES;
+
+    getSlot(page, slot, &offset, &length);
+    if (offset != 0)
+        freeOverflowChains(rMgr, schema, page + offset);
+    else
+        length = 0;
+
+    // The old version's bytes are free space for the new one
+    bool *spill = (bool *)malloc(schema->numAttr * sizeof(bool));
+    size = planStoredRecord(rMgr, schema, image, spill, totalFree(page) + length);
+    if (size < 0)
+    {
+        free(spill);
+        return RC_ERROR;
+    }
+
+    if (size > length)
+    {
+        setSlot(page, slot, 0, 0);
+        if (contiguousFree(page) < size)
+            compactPage(page);
+        offset = recordStart(page) - size;
+        pageSet(page, PAGE_RECORD_START, offset);
+    }
+    setSlot(page, slot, offset, size);
+
+    status = writeStoredRecord(rMgr, schema, image, spill, xmin, page + offset);
+    free(spill);
+    return status;
+}
+
+/* Version store */
+
+/*
+    # The version store of an open table keeps, in memory, the versions updates replaced while
+    # a snapshot may still see them: a snapshot that does not see the version in a slot reads
+    # the one of the store it sees instead. Versions are kept by RID in hash buckets, newer
+    # versions of a record before older ones, and dropped by vacuumTable once no snapshot sees
+    # them, or when the record is updated again. The latch of the table guards the store.
+*/
+
+// an older version of a record
+typedef struct RecordVersion
+{
+    RID id;
+    long xmin;
+    long xmax; // the transaction that replaced it
+    char *image; // the record as getRecord returns it
+    struct RecordVersion *next;
+} RecordVersion;
+
+static unsigned int versionBucket(RecordMgr *rMgr, RID id)
+{
+    return ((unsigned int)id.page * 31u + (unsigned int)id.slot) & (rMgr->numVersionBuckets - 1);
+}
+
+/*
+    # doubles the buckets of the store, keeping the versions of a record in their order
+*/
+static RC growVersionStore(RecordMgr *rMgr)
+{
+    int oldBuckets = rMgr->numVersionBuckets;
+    int numBuckets = oldBuckets > 0 ? 2 * oldBuckets : VERSION_BUCKETS;
+    RecordVersion **buckets = (RecordVersion **)calloc(numBuckets, sizeof(RecordVersion *));
+    RecordVersion **tails = (RecordVersion **)calloc(numBuckets, sizeof(RecordVersion *));
+
+    if (buckets == NULL || tails == NULL)
+    {
+        free(buckets);
+        free(tails);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    RecordVersion **old = rMgr->versions;
+    rMgr->versions = buckets;
+    rMgr->numVersionBuckets = numBuckets;
+    for (int b = 0; b < oldBuckets; b++)
+    {
+        for (RecordVersion *v = old[b], *next; v != NULL; v = next)
+        {
+            next = v->next;
+            unsigned int bucket = versionBucket(rMgr, v->id);
+            v->next = NULL;
+            if (tails[bucket] == NULL)
+                buckets[bucket] = v;
+            else
+                tails[bucket]->next = v;
+            tails[bucket] = v;
+        }
+    }
+    free(old);
+    free(tails);
+    return RC_OK;
+}
+
+/*
+    # keeps the version of record id that xmin wrote and xmax replaced as its newest older version,
+    # image goes to the store
+*/
+static RC pushVersion(RecordMgr *rMgr, RID id, long xmin, long xmax, char *image)
+{
+    RecordVersion *v = (RecordVersion *)malloc(sizeof(RecordVersion));
+    RC status;
+
+    if (v == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    if (rMgr->numVersions >= 2 * rMgr->numVersionBuckets && (status = growVersionStore(rMgr)) != RC_OK)
+    {
+        free(v);
+        return status;
+    }
+
+    unsigned int bucket = versionBucket(rMgr, id);
+    v->id = id;
+    v->xmin = xmin;
+    v->xmax = xmax;
+    v->image = image;
+    v->next = rMgr->versions[bucket];
+    rMgr->versions[bucket] = v;
+    rMgr->numVersions++;
+    return RC_OK;
+}
+
+/*
+    # the older version of record id snapshot sees, NULL if it sees none
+*/
+static RecordVersion *visibleVersion(RecordMgr *rMgr, Snapshot *snapshot, RID id)
+{
+    if (rMgr->numVersions == 0 || snapshot == NULL)
+        return NULL;
+    for (RecordVersion *v = rMgr->versions[versionBucket(rMgr, id)]; v != NULL; v = v->next)
+        if (v->id.page == id.page && v->id.slot == id.slot && versionVisible(snapshot, v->xmin, v->xmax))
+            return v;
+    return NULL;
+}
+
+/*
+    # drops older versions of record id: those replaced below horizon, which no snapshot sees,
+    # or with newest only the newest one, if transaction horizon replaced it; returns how many
+*/
+static int dropVersions(RecordMgr *rMgr, RID id, long horizon, bool newest)
+{
+    int dropped = 0;
+
+    if (rMgr->numVersions == 0)
+        return 0;
+    for (RecordVersion **link = &rMgr->versions[versionBucket(rMgr, id)]; *link != NULL;)
+    {
+        RecordVersion *v = *link;
+        if (v->id.page != id.page || v->id.slot != id.slot)
+        {
+            link = &v->next;
+            continue;
+        }
+        if (newest && v->xmax != horizon)
+            break;
+        if (!newest && v->xmax >= horizon)
+        {
+            link = &v->next;
+            continue;
+        }
+        *link = v->next;
+        free(v->image);
+        free(v);
+        rMgr->numVersions--;
+        dropped++;
+        if (newest)
+            break;
+    }
+    return dropped;
+}
+
+/*
+    # true if the store keeps an older version of record id
+*/
+static bool hasVersions(RecordMgr *rMgr, RID id)
+{
+    if (rMgr->numVersions == 0)
+        return false;
+    for (RecordVersion *v = rMgr->versions[versionBucket(rMgr, id)]; v != NULL; v = v->next)
+        if (v->id.page == id.page && v->id.slot == id.slot)
+            return true;
+    return false;
+}
+
+static void freeVersionStore(RecordMgr *rMgr)
+{
+    for (int b = 0; b < rMgr->numVersionBuckets; b++)
+    {
+        for (RecordVersion *v = rMgr->versions[b], *next; v != NULL; v = next)
+        {
+            next = v->next;
+            free(v->image);
+            free(v);
+        }
+    }
+    free(rMgr->versions);
+    rMgr->versions = NULL;
+    rMgr->numVersionBuckets = 0;
+    rMgr->numVersions = 0;
+}
+
+/*
+    # decodes the version of record id snapshot sees (the latest for a NULL snapshot) into image,
+    # the one in its slot of the pinned data page or one of the store; only the attributes marked in
+    # wanted (all if NULL) of a version in the slot; RC_RM_NO_MORE_TUPLES if the snapshot sees none
+*/
+static RC readVersion(RM_TableData *rel, char *page, RID id, Snapshot *snapshot, bool *wanted, char *image)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+
+    if (slotIsLive(page, id.slot) && versionVisible(snapshot, slotXmin(page, id.slot), slotXmax(page, id.slot)))
+        return readSlotAttrs(rMgr, rel->schema, page, id.slot, image, wanted);
+
+    RecordVersion *v = visibleVersion(rMgr, snapshot, id);
+    if (v == NULL)
+        return RC_RM_NO_MORE_TUPLES;
+    memcpy(image, v->image, getRecordSize(rel->schema));
+    return RC_OK;
+}
+
+/*
+    # advances rid to the next live record after it and copies its latest version into record
+    # start with rid = (1, -1) to read the table from the first record
+    # returns RC_RM_NO_MORE_TUPLES after the last page of the file
+*/
+static RC nextLiveRecord(RM_TableData *rel, RID *rid, Record *record)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    BM_PageHandle page;
+    int numPages = getNumFilePages(&rMgr->bp);
+    RC status;
+
+    rid->slot++;
+    for (; rid->page < numPages; rid->page++, rid->slot = 0)
+    {
+        if ((status = pinPage(&rMgr->bp, &page, rid->page)) != RC_OK)
+            return status;
+
+        // Overflow pages have no slots
+        int numSlots = hasSlots(page.data) ? pageGet(page.data, PAGE_NUM_SLOTS) : 0;
+        for (; rid->slot < numSlots; rid->slot++)
+        {
+            if (slotIsLatest(page.data, rid->slot))
+            {
+                record->id = *rid;
+                status = readSlotRecord(rMgr, rel->schema, page.data, rid->slot, record->data);
+                unpinPage(&rMgr->bp, &page);
+                return status;
+            }
+        }
+        unpinPage(&rMgr->bp, &page);
+    }
+    return RC_RM_NO_MORE_TUPLES;
+}
+
+/*
+    # offset of the primary key attributes in the header page, after the space reserved for the index registry
+*/
+static int keyAttrsOffset(int numAttr)
+{
+    return indexRegistryOffset(numAttr) + (1 + 2 * MAX_TABLE_INDEXES) * sizeof(int);
+}
+
+/*
+    # offset of the NOT NULL flags in the header page, one byte per attribute after the room for the key attributes
+*/
+static int notNullOffset(int numAttr)
+{
+    return keyAttrsOffset(numAttr) + numAttr * sizeof(int);
+}
+
+/*
+    # offset of the head of the free page list in the header page, after the NOT NULL flags
+*/
+static int freeListOffset(int numAttr)
+{
+    return notNullOffset(numAttr) + numAttr;
+}
+
+/*
+    # offset of the LSN recovery of the table starts at in the header page, after the head of the
+    # free page list; the page file has every change logged before it
+*/
+static int recoveryLsnOffset(int numAttr)
+{
+    return freeListOffset(numAttr) + sizeof(int);
+}
+
+/*
+    # offset of the TableLayout of the table in the header page, after the recovery LSN;
+    # tables created before there were layouts have 0 there, slotted pages
+*/
+static int tableLayoutOffset(int numAttr)
+{
+    return recoveryLsnOffset(numAttr) + sizeof(LSN);
+}
+
+/*
+    # offset of the dictionary encoding flags in the header page, one byte per attribute after the
+    # TableLayout; tables created before there were dictionaries have zeros there
+*/
+static int dictionaryOffset(int numAttr)
+{
+    return tableLayoutOffset(numAttr) + sizeof(int);
+}
+
+/*
+    # offset of the first page of the dictionary chain in the header page, after the flags; 0 for none
+*/
+static int dictionaryHeadOffset(int numAttr)
+{
+    return dictionaryOffset(numAttr) + numAttr;
+}
+
+/*
+    # true if an in-memory record has a NULL in an attribute declared NOT NULL
+*/
+static bool violatesNotNull(Schema *schema, char *image)
+{
+    char *nulls = nullBitmap(schema, image);
+
+    for (int i = 0; i < schema->numAttr; i++)
+        if (declaredNotNull(schema, i) && isNullBit(nulls, i))
+            return true;
+    return false;
+}
+
+static RC readRecord(RM_TableData *table, RID id, Snapshot *snapshot, Record *outputRecord);
+
+/*
+    # looks up the record whose primary key equals the key attributes of probe
+    # the primary key index is a B+-tree on the first key attribute, the remaining
+    # key attributes of a composite key are compared on the records it returns
+    # returns RC_IM_KEY_NOT_FOUND if no record has the key
+*/
+static RC findByKey(RM_TableData *rel, Record *probe, RID *rid)
+{
+    Schema *schema = rel->schema;
+    BTreeHandle *tree;
+    BT_ScanHandle *sc;
+    Record *candidate;
+    Value *first;
+    RC status;
+
+    if (schema->keySize <= 0 || getTableIndex(rel, schema->keyAttrs[0], &tree) != RC_OK)
+        return RC_IM_KEY_NOT_FOUND;
+
+    getAttr(probe, schema, schema->keyAttrs[0], &first);
+    if (first->isNull)
+    {
+        freeVal(first);
+        return RC_IM_KEY_NOT_FOUND;
+    }
+    if (schema->keySize == 1)
+    {
+        status = findKey(tree, first, rid);
+        freeVal(first);
+        return status;
+    }
+
+    status = openTreeRangeScan(tree, first, first, &sc);
+    freeVal(first);
+    if (status != RC_OK)
+        return status;
+
+    createRecord(&candidate, schema);
+    while ((status = nextEntry(sc, rid)) == RC_OK)
+    {
+        bool match = readRecord(rel, *rid, NULL, candidate) == RC_OK;
+
+        for (int k = 1; k < schema->keySize && match; k++)
+        {
+            Value *l, *r, *equal;
+            getAttr(probe, schema, schema->keyAttrs[k], &l);
+            getAttr(candidate, schema, schema->keyAttrs[k], &r);
+            MAKE_VALUE(equal, DT_BOOL, FALSE);
+            valueEquals(l, r, equal);
+            match = equal->v.boolV;
+            freeVal(l);
+            freeVal(r);
+            freeVal(equal);
+        }
+        if (match)
+            break;
+    }
+    freeRecord(candidate);
+    closeTreeScan(sc);
+
+    return (status == RC_IM_NO_MORE_ENTRIES) ? RC_IM_KEY_NOT_FOUND : status;
+}
+
+/* System catalog */
+
+/*
+    # builds the schema of the catalog, its arrays are malloc'ed like those of a schema read by openTable
+*/
+static Schema *catalogSchema(void)
+{
+    char *names[] = {"tableName", "fileName", "numAttr", "schema"};
+    DataType types[] = {DT_STRING, DT_STRING, DT_INT, DT_STRING};
+    int lengths[] = {CATALOG_NAME_LENGTH, CATALOG_NAME_LENGTH, 0, CATALOG_SCHEMA_LENGTH};
+    char **attrNames = (char **)malloc(4 * sizeof(char *));
+    DataType *dataTypes = (DataType *)malloc(4 * sizeof(DataType));
+    int *typeLength = (int *)malloc(4 * sizeof(int));
+    int *keys = (int *)malloc(sizeof(int));
+
+    for (int i = 0; i < 4; i++)
+    {
+        attrNames[i] = (char *)malloc(SIZE_OF_ATTRIBUTE + 1);
+        strncpy(attrNames[i], names[i], SIZE_OF_ATTRIBUTE);
+        attrNames[i][SIZE_OF_ATTRIBUTE] = '\0';
+        dataTypes[i] = types[i];
+        typeLength[i] = lengths[i];
+    }
+    keys[0] = 0;
+    return createSchema(4, attrNames, dataTypes, typeLength, 1, keys);
+}
+
+/*
+    # frees a schema together with the arrays it points to
+*/
+static void freeTableSchema(Schema *schema)
+{
+    for (int i = 0; i < schema->numAttr; i++)
+        free(schema->attrNames[i]);
+    free(schema->attrNames);
+    free(schema->dataTypes);
+    free(schema->typeLength);
+    free(schema->keyAttrs);
+    freeSchema(schema);
+}
+
+/*
+    # opens the catalog, creating its page file the first time
+*/
+static RC openCatalog(void)
+{
+    SM_FileHandle fHandle;
+    RC status;
+
+    if (openPageFile(CATALOG_TABLE, &fHandle) == RC_OK)
+        closePageFile(&fHandle);
+    else
+    {
+        Schema *schema = catalogSchema();
+        status = createTable(CATALOG_TABLE, schema);
+        freeTableSchema(schema);
+        if (status != RC_OK)
+            return status;
+    }
+
+    if ((status = openTable(&mgrHandler.catalog, CATALOG_TABLE)) != RC_OK)
+        return status;
+    mgrHandler.catalogOpen = true;
+    return RC_OK;
+}
+
+static RC closeCatalog(void)
+{
+    mgrHandler.catalogOpen = false;
+    return closeTable(&mgrHandler.catalog);
+}
+
+/*
+    # reads the catalog row of table name into row
+    # returns RC_RM_NO_MORE_TUPLES if the table is not in the catalog
+*/
+static RC findCatalogRow(char *name, Record *row)
+{
+    Value *key;
+    RC status;
+
+    MAKE_STRING_VALUE(key, name);
+    status = getRecordByValue(&mgrHandler.catalog, 0, key, row);
+    freeVal(key);
+    return status;
+}
+
+/*
+    # returns the page file of table name as listed in the catalog, or a copy of name
+    # for a table the catalog does not know; the caller frees the returned string
+*/
+static char *catalogFileName(char *name)
+{
+    Record *row;
+    Value *file;
+    char *fileName = NULL;
+
+    if (mgrHandler.catalogOpen)
+    {
+        createRecord(&row, mgrHandler.catalog.schema);
+        if (findCatalogRow(name, row) == RC_OK)
+        {
+            getAttr(row, mgrHandler.catalog.schema, 1, &file);
+            fileName = strdup(file->v.stringV);
+            freeVal(file);
+        }
+        freeRecord(row);
+    }
+    return fileName != NULL ? fileName : strdup(name);
+}
+
+/*
+    # drops the catalog row of table name
+    # returns RC_RM_NO_MORE_TUPLES if the table is not in the catalog
+*/
+static RC unregisterTable(char *name)
+{
+    Record *row;
+    RC status;
+
+    createRecord(&row, mgrHandler.catalog.schema);
+    status = findCatalogRow(name, row);
+    if (status == RC_OK)
+        status = deleteRecord(&mgrHandler.catalog, row->id);
+    freeRecord(row);
+    return status;
+}
+
+/*
+    # lists table name in the catalog, replacing the row of an earlier table of the same name
+    # whose page file createTable has just overwritten
+*/
+static RC registerTable(char *name, Schema *schema)
+{
+    Schema *catalog = mgrHandler.catalog.schema;
+    Record *row;
+    Value *value;
+    RC status;
+
+    if ((status = unregisterTable(name)) != RC_OK && status != RC_RM_NO_MORE_TUPLES)
+        return status;
+
+    createRecord(&row, catalog);
+    MAKE_STRING_VALUE(value, name);
+    status = setAttr(row, catalog, 0, value);
+    freeVal(value);
+
+    // Every table is kept in a page file of its own name
+    if (status == RC_OK)
+    {
+        MAKE_STRING_VALUE(value, name);
+        status = setAttr(row, catalog, 1, value);
+        freeVal(value);
+    }
+
+    if (status == RC_OK)
+    {
+        MAKE_VALUE(value, DT_INT, schema->numAttr);
+        status = setAttr(row, catalog, 2, value);
+        freeVal(value);
+    }
+
+    if (status == RC_OK)
+    {
+        char *text = serializeSchema(schema);
+        MAKE_STRING_VALUE(value, text);
+        status = setAttr(row, catalog, 3, value);
+        freeVal(value);
+        free(text);
+    }
+
+    if (status == RC_OK)
+        status = insertRecord(&mgrHandler.catalog, row);
+    freeRecord(row);
+    return status;
+}
+
+/*
+    # whether the catalog row of table name holds its name and serialized schema whole,
+    # setAttr would cut longer strings short and the table would not open again
+*/
+static bool fitsCatalog(char *name, Schema *schema)
+{
+    char *text = serializeSchema(schema);
+    bool fits = strlen(name) < CATALOG_NAME_LENGTH && text != NULL && strlen(text) < CATALOG_SCHEMA_LENGTH;
+    free(text);
+    return fits;
+}
+
+/*
+    # returns the names of the tables in the catalog in a malloc'ed array of malloc'ed strings,
+    # the catalog itself included; the caller frees the strings and the array
+*/
+RC getTableNames(char ***names, int *numTables)
+{
+    RM_TableData *catalog = &mgrHandler.catalog;
+    Record *row;
+    Value *name;
+    RID rid;
+    RC status;
+    int capacity = 8;
+
+    if (names == NULL || numTables == NULL)
+        return RC_NULL_ARGUMENT;
+    if (!mgrHandler.catalogOpen)
+        return RC_ERROR;
+
+    *names = (char **)malloc(capacity * sizeof(char *));
+    *numTables = 0;
+    createRecord(&row, catalog->schema);
+    rid.page = 1;
+    rid.slot = -1;
+    while ((status = nextLiveRecord(catalog, &rid, row)) == RC_OK)
+    {
+        if (*numTables == capacity)
+        {
+            capacity *= 2;
+            *names = (char **)realloc(*names, capacity * sizeof(char *));
+        }
+        getAttr(row, catalog->schema, 0, &name);
+        (*names)[(*numTables)++] = strdup(name->v.stringV);
+        freeVal(name);
+    }
+    freeRecord(row);
+    return status == RC_RM_NO_MORE_TUPLES ? RC_OK : status;
+}
+
+/* Recovery */
+
+/*
+    # writes the pages of the table back and then the tuple count, the first page with room and
+    # the end of the log to the header page, recovery of the table starts there from now on
+*/
+static RC writeTableHeader(RecordMgr *rMgr, int numAttr)
+{
+    BM_PageHandle header;
+    LSN start = getLogEnd();
+    RC status;
+
+    // The header goes last, a crash before leaves the old start in it
+    if ((status = syncPool(&rMgr->bp)) != RC_OK || (status = pinPage(&rMgr->bp, &header, 0)) != RC_OK)
+        return status;
+    memcpy(header.data, &rMgr->countOfTuples, sizeof(int));
+    memcpy(header.data + sizeof(int), &rMgr->deallocatePage, sizeof(int));
+    memcpy(header.data + recoveryLsnOffset(numAttr), &start, sizeof(LSN));
+    markDirty(&rMgr->bp, &header);
+    status = forcePage(&rMgr->bp, &header);
+    unpinPage(&rMgr->bp, &header);
+    return status;
+}
+
+static LSN checkpointStart(char *table);
+static LSN redoStart(LSN begin, BM_DirtyPage *pages, int numPages);
+
+// Bookkeeping of redoTable
+typedef struct RedoContext
+{
+    RecordMgr *rMgr;
+    LSN from;
+    int applied;
+} RedoContext;
+
+/*
+    # applies a log record of the table to its pages, records of other tables and records from
+    # before the start in the header page are skipped; the after-images are written in log order,
+    # so the pages end up as the last record left them whichever records the page file already had
+*/
+static RC redoRecord(LogRecord *record, void *context)
+{
+    RedoContext *redo = (RedoContext *)context;
+    RecordMgr *rMgr = redo->rMgr;
+    BM_PageHandle page;
+    RC status;
+
+    if (record->lsn < redo->from || strcmp(record->table, rMgr->fileName) != 0)
+        return RC_OK;
+    redo->applied++;
+
+    if (record->type == LOG_TRUNCATE)
+        return truncatePool(&rMgr->bp, record->numPages);
+
+    // Pinning a page past the end of the file appends it
+    for (int i = 0; i < record->numChanges; i++)
+    {
+        BM_PageChange *change = &record->changes[i];
+        if ((status = pinPage(&rMgr->bp, &page, change->pageNum)) != RC_OK)
+            return status;
+        memcpy(page.data + change->offset, change->data, change->length);
+        markDirty(&rMgr->bp, &page);
+        unpinPage(&rMgr->bp, &page);
+    }
+    return RC_OK;
+}
+
+/*
+    # redoes the log records of a table that its page file may miss, recovered tells whether there were any
+    # or whether the table was open at the last checkpoint, whose start redo began at instead
+*/
+static RC redoTable(RecordMgr *rMgr, bool *recovered)
+{
+    BM_PageHandle header;
+    RedoContext redo;
+    RC status;
+
+    if ((status = pinPage(&rMgr->bp, &header, 0)) != RC_OK)
+        return status;
+    int numAttr = *(int *)(header.data + 2 * sizeof(int));
+    memcpy(&redo.from, header.data + recoveryLsnOffset(numAttr), sizeof(LSN));
+    unpinPage(&rMgr->bp, &header);
+
+    // The changes before it are in the page file, but not yet in the tuple count and the indexes
+    LSN start = checkpointStart(rMgr->fileName);
+    bool skipped = start > redo.from;
+    if (skipped)
+        redo.from = start;
+
+    redo.rMgr = rMgr;
+    redo.applied = 0;
+    status = redo.from < getLogEnd() ? readLog(redo.from, redoRecord, &redo) : RC_OK;
+    *recovered = redo.applied > 0 || skipped;
+    return status;
+}
+
+/*
+    # replaces an index file of the table by an empty one, for rebuildAfterRedo to fill
+*/
+static RC recreateIndexFile(RM_TableData *rel, int attrNum, IndexKind kind)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    char *fileName = indexFileName(rMgr->bp.pageFile, attrNum, kind);
+    RC status;
+
+    if (kind == INDEX_HASH)
+    {
+        deleteHash(fileName);
+        status = createHash(fileName, rel->schema->dataTypes[attrNum], rel->schema->typeLength[attrNum]);
+    }
+    else
+    {
+        deleteBtree(fileName);
+        status = createBtree(fileName, rel->schema->dataTypes[attrNum], rel->schema->typeLength[attrNum], 0);
+    }
+    free(fileName);
+    return status;
+}
+
+/*
+    # indexes are not logged and the tuple count in the header page is only written by closeTable,
+    # after a redo both are rebuilt from the records; the table is then written back so that
+    # the next recovery starts after the records just redone
+*/
+static RC rebuildAfterRedo(RM_TableData *rel)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    Record *record;
+    RID rid;
+    RC status;
+
+    createRecord(&record, rel->schema);
+    rMgr->countOfTuples = 0;
+    rid.page = 1;
+    rid.slot = -1;
+    while ((status = nextLiveRecord(rel, &rid, record)) == RC_OK)
+    {
+        rMgr->countOfTuples++;
+        if ((status = maintainIndexes(rel, record, true)) != RC_OK)
+            break;
+    }
+    freeRecord(record);
+    if (status != RC_RM_NO_MORE_TUPLES)
+        return status;
+
+    if (rMgr->deallocatePage < 1 || rMgr->deallocatePage > getNumFilePages(&rMgr->bp))
+        rMgr->deallocatePage = 1;
+    return writeTableHeader(rMgr, rel->schema->numAttr);
+}
+
+// an operation of a transaction found in the log
+typedef struct LoggedOperation
+{
+    long txId;
+    LSN lsn;
+    LogRecordType type;
+    int table; // in RecoveryContext.tables
+    RID id;
+    char *image;
+} LoggedOperation;
+
+// a transaction found in the log
+typedef struct LoggedTransaction
+{
+    long id;
+    bool ended;     // committed or aborted
+    LSN undoneFrom; // operations from here on were taken back before the crash, 0 for none
+} LoggedTransaction;
+
+// Bookkeeping of recoverTables, every array is in log order
+typedef struct RecoveryContext
+{
+    char **tables;
+    int numTables;
+    LoggedOperation *ops;
+    int numOps;
+    int maxOps;
+    LoggedTransaction *txs;
+    int numTxs;
+    char **checkpointTables; // open at the last checkpoint
+    LSN *checkpointStarts;   // where their redo starts, 0 if it cannot start from the checkpoint
+    int numCheckpointTables;
+} RecoveryContext;
+
+// the recovery in progress, NULL outside of recoverTables
+static RecoveryContext *recovery;
+
+/*
+    # where the last checkpoint lets the redo of a table start, 0 if it was not open then
+*/
+static LSN checkpointStart(char *table)
+{
+    if (recovery == NULL)
+        return 0;
+    for (int i = 0; i < recovery->numCheckpointTables; i++)
+    {
+        if (strcmp(recovery->checkpointTables[i], table) == 0)
+            return recovery->checkpointStarts[i];
+    }
+    return 0;
+}
+
+static void freeCheckpointTables(RecoveryContext *rc)
+{
+    for (int i = 0; i < rc->numCheckpointTables; i++)
+        free(rc->checkpointTables[i]);
+    free(rc->checkpointTables);
+    free(rc->checkpointStarts);
+    rc->checkpointTables = NULL;
+    rc->checkpointStarts = NULL;
+    rc->numCheckpointTables = 0;
+}
+
+/*
+    # the index of the table in the tables of the log, added if it is not there yet
+*/
+static int loggedTable(RecoveryContext *rc, char *table)
+{
+    for (int i = 0; i < rc->numTables; i++)
+    {
+        if (strcmp(rc->tables[i], table) == 0)
+            return i;
+    }
+    char **grown = (char **)realloc(rc->tables, (rc->numTables + 1) * sizeof(char *));
+    if (grown == NULL)
+        return -1;
+    rc->tables = grown;
+    rc->tables[rc->numTables] = strdup(table);
+    return rc->numTables++;
+}
+
+/*
+    # the transaction in the log, added if it is not there yet
+*/
+static LoggedTransaction *loggedTransaction(RecoveryContext *rc, long txId)
+{
+    for (int i = 0; i < rc->numTxs; i++)
+    {
+        if (rc->txs[i].id == txId)
+            return &rc->txs[i];
+    }
+    LoggedTransaction *grown = (LoggedTransaction *)realloc(rc->txs, (rc->numTxs + 1) * sizeof(LoggedTransaction));
+    if (grown == NULL)
+        return NULL;
+    rc->txs = grown;
+    memset(&rc->txs[rc->numTxs], 0, sizeof(LoggedTransaction));
+    rc->txs[rc->numTxs].id = txId;
+    return &rc->txs[rc->numTxs++];
+}
+
+/*
+    # takes the open tables and the transactions in progress from a checkpoint record,
+    # a later checkpoint replaces what an earlier one said
+*/
+static RC collectCheckpoint(RecoveryContext *rc, LogRecord *record)
+{
+    char *pos = record->data, *end = record->data + record->dataLength;
+    LSN begin;
+    int numTables, numTxs;
+
+    freeCheckpointTables(rc);
+    memcpy(&begin, pos, sizeof(LSN));
+    memcpy(&numTables, pos + sizeof(LSN), sizeof(int));
+    pos += sizeof(LSN) + sizeof(int);
+    rc->checkpointTables = (char **)calloc(numTables > 0 ? numTables : 1, sizeof(char *));
+    rc->checkpointStarts = (LSN *)calloc(numTables > 0 ? numTables : 1, sizeof(LSN));
+    if (rc->checkpointTables == NULL || rc->checkpointStarts == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    for (int i = 0; i < numTables; i++)
+    {
+        int nameLength, numPages;
+        memcpy(&nameLength, pos, sizeof(int));
+        if ((rc->checkpointTables[i] = strndup(pos + sizeof(int), nameLength)) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        rc->numCheckpointTables++;
+        pos += sizeof(int) + nameLength;
+        memcpy(&numPages, pos, sizeof(int));
+        pos += sizeof(int);
+        BM_DirtyPage *pages = (BM_DirtyPage *)malloc((numPages > 0 ? numPages : 1) * sizeof(BM_DirtyPage));
+        if (pages == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memcpy(pages, pos, numPages * sizeof(BM_DirtyPage));
+        rc->checkpointStarts[i] = redoStart(begin, pages, numPages);
+        free(pages);
+        pos += numPages * sizeof(BM_DirtyPage);
+    }
+
+    // Transactions in progress then are losers unless a later record ends them
+    memcpy(&numTxs, pos, sizeof(int));
+    pos += sizeof(int);
+    for (int i = 0; i < numTxs && pos + sizeof(long) <= end; i++, pos += sizeof(long) + sizeof(LSN))
+    {
+        long txId;
+        memcpy(&txId, pos, sizeof(long));
+        if (loggedTransaction(rc, txId) == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+    }
+    return RC_OK;
+}
+
+/*
+    # collects the tables of the log and what it takes to roll back its transactions
+*/
+static RC collectLogged(LogRecord *record, void *context)
+{
+    RecoveryContext *rc = (RecoveryContext *)context;
+    LoggedTransaction *tx = NULL;
+    int table = -1;
+
+    if (record->type == LOG_CHECKPOINT)
+        return collectCheckpoint(rc, record);
+    if (record->table[0] != '\0' && (table = loggedTable(rc, record->table)) < 0)
+        return RC_MEM_ALLOCATION_FAIL;
+    if (record->txId == 0)
+        return RC_OK;
+    if ((tx = loggedTransaction(rc, record->txId)) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    if (record->type == LOG_COMMIT || record->type == LOG_ABORT)
+        tx->ended = true;
+    else if (record->compensates > 0)
+    {
+        // Operations are taken back last one first
+        if (tx->undoneFrom == 0 || record->compensates < tx->undoneFrom)
+            tx->undoneFrom = record->compensates;
+    }
+    else if (record->type == LOG_INSERT || record->type == LOG_DELETE || record->type == LOG_UPDATE)
+    {
+        if (rc->numOps == rc->maxOps)
+        {
+            int max = rc->maxOps > 0 ? 2 * rc->maxOps : 64;
+            LoggedOperation *grown = (LoggedOperation *)realloc(rc->ops, max * sizeof(LoggedOperation));
+            if (grown == NULL)
+                return RC_MEM_ALLOCATION_FAIL;
+            rc->ops = grown;
+            rc->maxOps = max;
+        }
+        LoggedOperation *op = &rc->ops[rc->numOps++];
+        op->txId = record->txId;
+        op->lsn = record->lsn;
+        op->type = record->type;
+        op->table = table;
+        op->id = record->id;
+        op->image = NULL;
+        if (record->dataLength > 0)
+        {
+            if ((op->image = (char *)malloc(record->dataLength)) == NULL)
+                return RC_MEM_ALLOCATION_FAIL;
+            memcpy(op->image, record->data, record->dataLength);
+        }
+    }
+    return RC_OK;
+}
+
+/*
+    # rolls back the transactions of the log that neither committed nor aborted, the operations of
+    # all of them in reverse log order, skipping those taken back before the crash; rels are the
+    # open tables of the log, those not open were deleted
+*/
+static RC undoLosers(RecoveryContext *rc, RM_TableData *rels)
+{
+    RC status = RC_OK;
+
+    for (int i = rc->numOps - 1; i >= 0 && status == RC_OK; i--)
+    {
+        LoggedOperation *op = &rc->ops[i];
+        LoggedTransaction *tx = loggedTransaction(rc, op->txId);
+        if (tx->ended || (tx->undoneFrom > 0 && op->lsn >= tx->undoneFrom) || rels[op->table].mgmtData == NULL ||
+            (op->type != LOG_INSERT && op->image == NULL))
+            continue;
+
+        UndoEntry entry;
+        entry.rel = &rels[op->table];
+        entry.type = op->type;
+        entry.id = op->id;
+        entry.image = op->image;
+        entry.xmin = 0; // no snapshot outlives a restart, a version put back is visible to all
+        entry.lsn = op->lsn;
+        status = undoOperation(op->txId, &entry);
+    }
+    for (int i = 0; i < rc->numTxs && status == RC_OK; i++)
+    {
+        if (!rc->txs[i].ended)
+            status = logTransactionEnd(rc->txs[i].id, LOG_ABORT);
+    }
+    return status;
+}
+
+/*
+    # opens every table with records in the log, which redoes what a crash kept from their page
+    # files from the start the last checkpoint found for them on, rolls back the transactions the
+    # crash interrupted and closes the tables again; after that no record is needed any more and
+    # the log is reset
+*/
+static RC recoverTables(void)
+{
+    RecoveryContext rc;
+    RM_TableData *rels;
+    SM_FileHandle fHandle;
+    RC status;
+
+    memset(&rc, 0, sizeof(RecoveryContext));
+    status = readLog(0, collectLogged, &rc);
+    recovery = &rc;
+
+    rels = (RM_TableData *)calloc(rc.numTables > 0 ? rc.numTables : 1, sizeof(RM_TableData));
+    for (int i = 0; i < rc.numTables && status == RC_OK; i++)
+    {
+        // A table deleted since has nothing to recover
+        if (openPageFile(rc.tables[i], &fHandle) == RC_OK)
+        {
+            closePageFile(&fHandle);
+            status = openTable(&rels[i], rc.tables[i]);
+        }
+    }
+    if (status == RC_OK)
+        status = undoLosers(&rc, rels);
+
+    for (int i = 0; i < rc.numTables; i++)
+    {
+        if (rels[i].mgmtData != NULL)
+        {
+            RC closeStatus = closeTable(&rels[i]);
+            if (status == RC_OK)
+                status = closeStatus;
+        }
+        free(rc.tables[i]);
+    }
+    recovery = NULL;
+    for (int i = 0; i < rc.numOps; i++)
+        free(rc.ops[i].image);
+    freeCheckpointTables(&rc);
+    free(rels);
+    free(rc.tables);
+    free(rc.ops);
+    free(rc.txs);
+    return status == RC_OK ? resetLog() : status;
+}
+
+/*
+    # This function is used to create a table
+    # It is used to store the information about the schema
+*/
+RC createTable(char *name, Schema *schema)
+{
+    return createTableWithOptions(name, schema, NULL);
+}
+
+/*
+    # createTable with the options of the table, NULL for the defaults
+    # A compressed table is a compressed page file, its pages are compressed whenever they are written
+    # A PAX table keeps the values of every attribute of a page together, see PAX pages
+    # The strings of dictionary encoded attributes are stored as codes, see Dictionaries
+*/
+RC createTableWithOptions(char *name, Schema *schema, RM_TableOptions *options)
+{
+    // Buffer for page data
+    char data[PAGE_SIZE];
+    // File handle for page file operations
+    SM_FileHandle f_handle;
+    // Variable to store function call status
+    RC status;
+
+    // The catalog is keyed by the table name and keeps the schema, neither may be cut short there
+    if (mgrHandler.catalogOpen && !fitsCatalog(name, schema))
+    {
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Only strings are dictionary encoded, and each of their values must fit on a dictionary page
+    bool *encoded = options != NULL ? options->dictionaryEncoded : NULL;
+    for (int a = 0; encoded != NULL && a < schema->numAttr; a++)
+    {
+        if (encoded[a] && (schema->dataTypes[a] != DT_STRING || schema->typeLength[a] > MAX_DICTIONARY_VALUE))
+        {
+            currState.TM_resp = TABLE_NOT_CREATED;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_ERROR;
+        }
+    }
+
+    // A PAX page must hold at least one record, its values keep their in-memory width
+    TableLayout layout = options != NULL ? options->layout : TABLE_LAYOUT_ROWS;
+    PaxLayout *pax = layout == TABLE_LAYOUT_PAX ? createPaxLayout(schema, encoded) : NULL;
+    if (layout == TABLE_LAYOUT_PAX && pax == NULL)
+    {
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+    freePaxLayout(pax);
+
+    // Zero the header so that the index registry after the attributes starts out empty
+    memset(data, 0, PAGE_SIZE);
+    char *pageHandle = data;
+
+    int k = 0;
+    while (k < 4)
+    {
+        if (k == 0)
+        {
+            *(int *)pageHandle = 0;
+        }
+        else if (k == 1)
+        {
+            *(int *)pageHandle = 1;
+        }
+        else if (k == 2)
+        {
+            *(int *)pageHandle = schema->numAttr;
+        }
+        else if (k == 3)
+        {
+            *(int *)pageHandle = schema->keySize;
+        }
+
+        pageHandle += sizeof(int);
+        // Increment k to proceed to the next iteration
+        k++;
+    }
+
+    int i = 0;
+    char *handle = pageHandle;
+
+    while (i < schema->numAttr)
+    {
+        // Copy attribute name from the schema to handle
+        strncpy(handle, schema->attrNames[i], SIZE_OF_ATTRIBUTE);
+
+        // Move handle forward by the size of attribute name
+        handle += SIZE_OF_ATTRIBUTE;
+
+        // Assign the data type of the attribute
+        *(int *)handle = (int)schema->dataTypes[i];
+
+        // Move handle forward by the size of an integer
+        handle += sizeof(int);
+
+        // Assign the length of the attribute type
+        *(int *)handle = (int)schema->typeLength[i];
+
+        // Move handle forward by the size of an integer
+        handle += sizeof(int);
+
+        // Increment index to the next attribute
+        i++;
+    }
+
+    // The primary key is backed by an index on its first attribute, registered like any other index
+    char *registry = data + indexRegistryOffset(schema->numAttr);
+    *(int *)registry = (schema->keySize > 0) ? 1 : 0;
+    if (schema->keySize > 0)
+    {
+        *(int *)(registry + sizeof(int)) = schema->keyAttrs[0];
+        *(int *)(registry + 2 * sizeof(int)) = INDEX_BTREE;
+    }
+
+    // Persist the key attributes after the space reserved for the registry
+    memcpy(data + keyAttrsOffset(schema->numAttr), schema->keyAttrs, schema->keySize * sizeof(int));
+    // Key attributes are NOT NULL whether the schema says so or not
+    for (i = 0; i < schema->numAttr; i++)
+        data[notNullOffset(schema->numAttr) + i] = declaredNotNull(schema, i) || isKeyAttr(schema, i);
+
+    // Records still in the log for an earlier table of the same name are not redone on this one
+    LSN start = getLogEnd();
+    memcpy(data + recoveryLsnOffset(schema->numAttr), &start, sizeof(LSN));
+    memcpy(data + tableLayoutOffset(schema->numAttr), &layout, sizeof(int));
+    for (i = 0; i < schema->numAttr; i++)
+        data[dictionaryOffset(schema->numAttr) + i] = encoded != NULL && encoded[i];
+
+    // Create the page file
+    status = options != NULL && options->compressed ? createCompressedPageFile(name) : createPageFile(name);
+    if (status != RC_OK)
+    {
+        // If the page file creation fails, log the error state
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        // Return the failure status
+        return status;
+    }
+
+    // Open the newly created page file
+    status = openPageFile(name, &f_handle);
+    if (status != RC_OK)
+    {
+        // If the page file open fails, log the error state
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        return status;
+    }
+
+    // Write metadata and schema information to the first block of the page file
+    status = writeBlock(0, &f_handle, data);
+    if (status != RC_OK)
+    {
+        // If the write operation fails, log the error state
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        // Ensure that the page file is closed before exiting the function
+        closePageFile(&f_handle);
+        return status;
+    }
+
+    // Close the page file after writing operation
+    status = closePageFile(&f_handle);
+    if (status != RC_OK)
+    {
+        // If the page file closure fails, log the error state
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        return status;
+    }
+
+    if (schema->keySize > 0)
+    {
+        int keyAttr = schema->keyAttrs[0];
+        char *fileName = indexFileName(name, keyAttr, INDEX_BTREE);
+        status = createBtree(fileName, schema->dataTypes[keyAttr], schema->typeLength[keyAttr], 0);
+        free(fileName);
+        if (status != RC_OK)
+        {
+            currState.TM_resp = TABLE_NOT_CREATED;
+            currState.recordUpdatedAt = time(NULL);
+            return status;
+        }
+    }
+
+    // List the table in the catalog, the catalog itself is created before it is open
+    if (mgrHandler.catalogOpen && (status = registerTable(name, schema)) != RC_OK)
+    {
+        currState.TM_resp = TABLE_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
+        return status;
+    }
+
+    // Give record success in state log
+    currState.TM_resp = TABLE_CREATED;
+    currState.recordUpdatedAt = time(NULL);
+
+    // Return success if all the steps completed without any kind of error
+    return RC_OK;
+}
+
+int getIncrement(int r)
+{
+
+    return r++;
+}
+
+/*
+    # This function opens a created table for operations
+*/
+RC openTable(RM_TableData *rel, char *name)
+{
+    int res = 0;
+    SM_PageHandle pageHandle;
+    BM_PageHandle header;
+    bool status;
+
+    // Every open table has a record manager of its own, with its own buffer pool
+    // or a share of the global one
+    RecordMgr *rMgr = (RecordMgr *)calloc(1, sizeof(RecordMgr));
+    if (rMgr == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    pthread_rwlock_init(&rMgr->latch, NULL);
+    rMgr->fileName = catalogFileName(name);
+    if (mgrHandler.poolShared)
+        status = attachBufferPool(&rMgr->bp, rMgr->fileName, &mgrHandler.sharedPool) == RC_OK;
+    else
+        status = initBufferPool(&rMgr->bp, rMgr->fileName, mgrHandler.poolPages > 0 ? mgrHandler.poolPages : MAX_NO_OF_PAGES, RS_LRU, NULL) == RC_OK;
+    if (!status)
+    {
+        free(rMgr->fileName);
+        pthread_rwlock_destroy(&rMgr->latch);
+        free(rMgr);
+        currState.TM_resp = OPEN_TABLE_FAILED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Frames of the table are written after the log records of their changes
+    setLogFlush(&rMgr->bp, flushLog);
+
+    // Initialize the record manager and assign table name to it
+    res += getIncrement(res);
+    rel->name = name;
+    rel->mgmtData = rMgr;
+    res += getIncrement(res);
+
+    // Redo what the page file misses of the log first, the header page may be one of the pages
+    // Then pin the first page to access table metadata, it is unpinned once the header is read
+    bool recovered = false;
+    status = redoTable(rMgr, &recovered) == RC_OK && pinPage(&rMgr->bp, &header, 0) == RC_OK;
+    if (!status)
+    {
+        shutdownBufferPool(&rMgr->bp);
+        free(rMgr->fileName);
+        pthread_rwlock_destroy(&rMgr->latch);
+        free(rMgr);
+        rel->mgmtData = NULL;
+        currState.TM_resp = OPEN_TABLE_FAILED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // From here on a failure closes the table
+    mgrHandler.openTables++;
+    res++;
+
+    int initialTableData = 2;
+
+    // Get the current page's data as a char pointer
+    pageHandle = (char *)header.data;
+
+    // Read the count of tuples from the first part of the page
+    rMgr->countOfTuples = *(int *)pageHandle;
+
+    // Move the page handle forward by the size of an integer
+    pageHandle = pageHandle + sizeof(int);
 
     // Read the release page number
-    mgrHandler.recMgr->deallocatePage = *(int *)pageHandle;
+    rMgr->deallocatePage = *(int *)pageHandle;
+
+    // Move the page handle forward again
+    pageHandle = pageHandle + sizeof(int);
+
+    // Retrieve the attribute count from the page
+    int attrCount = *(int *)pageHandle;
+
+    pageHandle += sizeof(int);
+
+    // The key size follows the attribute count, the key attributes are read after the registry
+    int keySize = *(int *)pageHandle;
+    pageHandle += sizeof(int);
+
+    initialTableData += attrCount;
+
+    // Allocate memory for the schema structure
+    Schema *schema = (Schema *)calloc(1, sizeof(Schema));
+
+    // Set the number of attributes in the schema
+    schema->numAttr = attrCount;
+
+    // Allocate memory for attribute names by initializing it to zero
+    schema->attrNames = (char **)calloc(attrCount, sizeof(char *));
+
+    // Allocate memory for data types by initializing it to zero
+    schema->dataTypes = (DataType *)calloc(attrCount, sizeof(DataType));
+
+    // Allocate memory for type lengths by initializing it to zero
+    schema->typeLength = (int *)calloc(attrCount, sizeof(int));
+
+    int i = 0;
+    while (i < attrCount)
+    {
+        // Allocate the memory for attribute names, a name that fills its field is stored without terminator
+        schema->attrNames[i] = (char *)malloc(SIZE_OF_ATTRIBUTE + 1);
+
+        // Copy attribute name from pageHandle
+        strncpy(schema->attrNames[i], pageHandle, SIZE_OF_ATTRIBUTE);
+        schema->attrNames[i][SIZE_OF_ATTRIBUTE] = '\0';
+
+        // Move pageHandle by the size of the attribute
+        pageHandle = pageHandle + SIZE_OF_ATTRIBUTE;
+
+        // Assign the data type of the attribute
+        schema->dataTypes[i] = *(DataType *)pageHandle;
+
+        // Move pageHandle by the size of DataType
+        pageHandle = pageHandle + sizeof(DataType);
+
+        // Assign the type length of the attribute
+        schema->typeLength[i] = *(int *)pageHandle;
+
+        // Move pageHandle by the size of an integer
+        pageHandle = pageHandle + sizeof(int);
+
+        // Increment the index
+        i++;
+    }
+
+    schema->keySize = keySize;
+    schema->keyAttrs = (int *)calloc(keySize > 0 ? keySize : 1, sizeof(int));
+    memcpy(schema->keyAttrs, header.data + keyAttrsOffset(attrCount), keySize * sizeof(int));
+    // Key attributes are NOT NULL also in a table created from a schema that did not say so
+    schema->notNull = (bool *)calloc(attrCount, sizeof(bool));
+    for (i = 0; i < attrCount; i++)
+        schema->notNull[i] = header.data[notNullOffset(attrCount) + i] || isKeyAttr(schema, i);
+    memcpy(&rMgr->freeListHead, header.data + freeListOffset(attrCount), sizeof(int));
+    rMgr->vacuumCursor = 1;
+
+    rel->schema = schema;
+
+    // The dictionaries of the encoded attributes are read from their chain, after redo like any other page
+    bool *encoded = (bool *)calloc(attrCount > 0 ? attrCount : 1, sizeof(bool));
+    int dictionaryHead;
+    bool loaded = true;
+    memcpy(&dictionaryHead, header.data + dictionaryHeadOffset(attrCount), sizeof(int));
+    for (i = 0; i < attrCount; i++)
+    {
+        if (!(encoded[i] = header.data[dictionaryOffset(attrCount) + i]))
+            continue;
+        if (rMgr->dictionaries == NULL)
+            rMgr->dictionaries = (Dictionary **)calloc(attrCount, sizeof(Dictionary *));
+        if (rMgr->dictionaries == NULL || (rMgr->dictionaries[i] = createDictionary(schema->typeLength[i])) == NULL)
+            loaded = false;
+    }
+
+    int layout;
+    memcpy(&layout, header.data + tableLayoutOffset(attrCount), sizeof(int));
+    if (layout == TABLE_LAYOUT_PAX)
+        rMgr->pax = createPaxLayout(schema, encoded);
+    free(encoded);
+    if ((layout == TABLE_LAYOUT_PAX && rMgr->pax == NULL) || !loaded || loadDictionaries(rMgr, schema, dictionaryHead) != RC_OK)
+    {
+        unpinPage(&rMgr->bp, &header);
+        closeTable(rel);
+        currState.TM_resp = OPEN_TABLE_FAILED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Reopen the indexes listed in the registry that follows the attribute descriptors
+    int numIndexes = *(int *)pageHandle;
+    pageHandle += sizeof(int);
+    for (i = 0; i < numIndexes && i < MAX_TABLE_INDEXES; i++)
+    {
+        int *entry = (int *)pageHandle + 2 * i;
+        if ((recovered && recreateIndexFile(rel, entry[0], (IndexKind)entry[1]) != RC_OK) ||
+            openTableIndex(rMgr, entry[0], (IndexKind)entry[1]) != RC_OK)
+        {
+            unpinPage(&rMgr->bp, &header);
+            closeTable(rel);
+            currState.TM_resp = OPEN_TABLE_FAILED;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_ERROR;
+        }
+    }
+
+    status = unpinPage(&rMgr->bp, &header) == RC_OK;
+    if (status && recovered)
+        status = rebuildAfterRedo(rel) == RC_OK;
+    if (status)
+        addOpenTable(rMgr);
+    if (!status)
+    {
+        // Log the failure of opening the table
+        currState.TM_resp = OPEN_TABLE_FAILED;
+        // Update the timestamp of the recorded state
+        currState.recordUpdatedAt = time(NULL);
+    }
+    else
+    {
+        // Log the successful opening of the table
+        currState.TM_resp = TABLE_OPENED;
+        // Update the timestamp of the recorded state
+        currState.recordUpdatedAt = time(NULL);
+    }
+    // Return RC_ERROR if failed otherwise return RC_OK
+    return !status ? RC_ERROR : RC_OK;
+}
+
+/*
+    # This function closes the table after all operations are finished
+    # It de-allocates all memory to prevent memory leaks
+*/
+RC closeTable(RM_TableData *rel)
+{
+    RecordMgr *rMgr = (*rel).mgmtData;
+
+    if (rMgr == NULL)
+        return RC_ERROR;
+    removeOpenTable(rMgr);
+
+    // Indexes have their own buffer pools and are reopened from the registry by openTable
+    for (int i = 0; i < rMgr->numIndexes; i++)
+        closeTableIndex(rMgr, i);
+    rMgr->numIndexes = 0;
+
+    // Persist the pages, then the tuple count, the first page with room and where recovery starts
+    int result = writeTableHeader(rMgr, rel->schema->numAttr);
+    if (result == RC_OK)
+        result = shutdownBufferPool(&rMgr->bp);
+    if (result != RC_OK)
+    {
+        addOpenTable(rMgr);
+        currState.TM_resp = CLOSE_TABLE_FAILED;
+        currState.recordUpdatedAt = time(NULL);
+        return result;
+    }
+
+    freeVersionStore(rMgr);
+    freePaxLayout(rMgr->pax);
+    freeDictionaries(rMgr, rel->schema->numAttr);
+    pthread_rwlock_destroy(&rMgr->latch);
+    free(rMgr->fileName);
+    free(rMgr);
+    freeTableSchema(rel->schema);
+    rel->mgmtData = NULL;
+    rel->schema = NULL;
+    mgrHandler.openTables--;
+
+    currState.TM_resp = TABLE_CLOSED;
+    currState.recordUpdatedAt = time(NULL);
+    return RC_OK;
+}
+
+void incrementTableCount(int count)
+{
+    // Ensure count is a attrPositive integer before updating
+    if (count > 0)
+    {
+        MAX_COUNT = count;
+    }
+    else
+    {
+        printf("Error: count must be a attrPositive integer.\n");
+    }
+}
+
+/*
+    # This fucntion is used to delete a created table
+    # It is done by using destroyPageFile function from the BufferManger implementation
+*/
+RC deleteTable(char *name)
+{
+    SM_FileHandle fHandle;
+    char header[PAGE_SIZE];
+    char *fileName = catalogFileName(name);
+
+    if (mgrHandler.catalogOpen)
+        unregisterTable(name);
+
+    // Remove the index files of every attribute that has one
+    if (openPageFile(fileName, &fHandle) == RC_OK)
+    {
+        if (readBlock(0, &fHandle, header) == RC_OK)
+        {
+            int numAttr = *(int *)(header + 2 * sizeof(int));
+            for (int i = 0; i < numAttr; i++)
+            {
+                char *indexFile = indexFileName(fileName, i, INDEX_BTREE);
+                deleteBtree(indexFile);
+                free(indexFile);
+                indexFile = indexFileName(fileName, i, INDEX_HASH);
+                deleteHash(indexFile);
+                free(indexFile);
+            }
+        }
+        closePageFile(&fHandle);
+    }
+
+    RC status = destroyPageFile(fileName);
+    free(fileName);
+    if (status != RC_OK)
+    {
+        // Increment table count if needed
+        incrementTableCount(1);
+        currState.TM_resp = DELETE_TABLE_ERROR;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Log the successful deletion of the table
+    currState.TM_resp = TABLE_DELETEED;
+    currState.recordUpdatedAt = time(NULL);
+
+    return RC_OK;
+}
+
+/*
+    # This method is used to get the total number of tuples in the table
+*/
+int getNumTuples(RM_TableData *rel)
+
+{
+    // Check if the table data or management data is NULL
+    if (rel == NULL || rel->mgmtData == NULL)
+    {
+        printf("Error: Table data or management data is NULL.\n");
+        // Return an error code if the input is invalid
+        return -1;
+    }
+
+    RecordMgr *recMgr = rel->mgmtData;
+    return recMgr->countOfTuples;
+}
+
+/*
+    # This function is used to insert a new record into the table
+    # It takes the table data pointer and the new record
+    # It returns 0 on success and -1 on failure
+*/
+static RC applyInsert(RM_TableData *rel, Record *record)
+{
+    char *data;
+    RID *rec_ID = &(*record).id;
+    RecordMgr *recordMgr = (*rel).mgmtData;
+    int retryCount = 0;
+    RID existing;
+
+    // Reject a record with a NULL in a NOT NULL attribute
+    if (violatesNotNull(rel->schema, record->data))
+    {
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_NOT_NULL_VIOLATION;
+    }
+
+    // Reject a record whose primary key is already in the table
+    if (findByKey(rel, record, &existing) == RC_OK)
+    {
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+
+    // Decide the stored form first, it must fit on an empty data page; any record fits on a PAX page
+    Schema *schema = rel->schema;
+    bool *spill = (bool *)malloc(schema->numAttr * sizeof(bool));
+    int storedSize = recordMgr->pax != NULL ? 0 : planStoredRecord(recordMgr, schema, record->data, spill, MAX_STORED_RECORD);
+    if (storedSize < 0)
+    {
+        free(spill);
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Intialize the record ID
+    if (!retryCount)
+    {
+        recordMgr = rel->mgmtData;
+        rec_ID->page = recordMgr->deallocatePage;
+    }
+
+    // Check if the record exists in the table and return error if it does
+    if (pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, (*rec_ID).page) != RC_OK)
+    {
+        free(spill);
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Find room for the record in the page
+    data = (*recordMgr).pageHandle.data;
+    rec_ID->slot = reserveRecordSlot(recordMgr, data, storedSize);
+
+    // If the page is full, move to the next page and attempt pinning again
+    while (rec_ID->slot == -1)
+    {
+        // Unpin the page before moving to the next page
+        if (unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+        {
+            free(spill);
+            currState.TM_resp = RECORD_NOT_INSERTED;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_ERROR;
+        }
+
+        // A page without room for the record stops being where inserts start looking
+        if (rec_ID->page == recordMgr->deallocatePage)
+            recordMgr->deallocatePage = rec_ID->page + 1;
+
+        // Move to the next page, past the end of the file it comes from the free page list
+        rec_ID->page++;
+        if (rec_ID->page >= getNumFilePages(&recordMgr->bp) && allocatePage(recordMgr, schema, &rec_ID->page) != RC_OK)
+        {
+            free(spill);
+            currState.TM_resp = RECORD_NOT_INSERTED;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_ERROR;
+        }
+        if (rec_ID->page < recordMgr->deallocatePage)
+            recordMgr->deallocatePage = rec_ID->page;
+        if (pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, rec_ID->page) != RC_OK)
+        {
+            free(spill);
+            currState.TM_resp = RECORD_NOT_INSERTED;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_ERROR;
+        }
+
+        // Find room for the record after pinning
+        data = (*recordMgr).pageHandle.data;
+        rec_ID->slot = reserveRecordSlot(recordMgr, data, storedSize);
+    }
+
+    // Mark the page as dirty
+    if (markDirty(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+    {
+        free(spill);
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Write the stored form of the record into the reserved space, stamped once it is there
+    RC writeStatus = writeSlotRecord(recordMgr, schema, data, rec_ID->slot, record->data, spill, 0);
+    free(spill);
+    if (writeStatus != RC_OK)
+    {
+        unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle);
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return writeStatus;
+    }
+    bool keepOld;
+    long horizon;
+    setSlotVersion(data, rec_ID->slot, stampVersion(rel, &keepOld, &horizon), 0);
+
+    // Unpin the page before updating global info
+    if (unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+    {
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Index the record under its new RID, a record that cannot be indexed is taken out again
+    RC indexStatus = maintainIndexes(rel, record, true);
+    if (indexStatus != RC_OK)
+    {
+        if (pinPage(&recordMgr->bp, &recordMgr->pageHandle, rec_ID->page) == RC_OK)
+        {
+            freeSlot(recordMgr, schema, recordMgr->pageHandle.data, rec_ID->slot);
+            markDirty(&recordMgr->bp, &recordMgr->pageHandle);
+            unpinPage(&recordMgr->bp, &recordMgr->pageHandle);
+        }
+        currState.TM_resp = RECORD_NOT_INSERTED;
+        currState.recordUpdatedAt = time(NULL);
+        return indexStatus;
+    }
+
+    // Update global info, closeTable writes it to the header page
+    recordMgr->countOfTuples++;
+
+    // Log success and update the state record
+    currState.TM_resp = RECORD_INSERTED;
+    currState.recordUpdatedAt = time(NULL);
+    return RC_OK;
+}
+
+/*
+    # copies the latest version of the record at id before an operation of a transaction replaces it,
+    # NULL if there is none; xmin is the transaction id the version was stamped with
+*/
+static char *undoImage(RM_TableData *rel, RID id, long *xmin)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    BM_PageHandle page;
+    char *image = NULL;
+
+    *xmin = 0;
+    if (pinPage(&rMgr->bp, &page, id.page) != RC_OK)
+        return NULL;
+    if (slotIsLatest(page.data, id.slot) && (image = (char *)malloc(getRecordSize(rel->schema))) != NULL)
+    {
+        *xmin = slotXmin(page.data, id.slot);
+        if (readSlotRecord(rMgr, rel->schema, page.data, id.slot, image) != RC_OK)
+        {
+            free(image);
+            image = NULL;
+        }
+    }
+    unpinPage(&rMgr->bp, &page);
+    return image;
+}
+
+/*
+    # locks the table of a write in IX mode and the record at id, if id.page >= 0, in X mode, waiting
+    # while others hold them; no latch is held meanwhile, which keeps waits for locks and latches
+    # apart. The locks belong to the transaction of the calling thread, or outside of one to local,
+    # which unlockAfterWrite releases; owner is NULL for the catalog, which is not locked
+*/
+static RC lockForWrite(RM_TableData *rel, RID id, LockOwner *local, LockOwner **owner)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    RID table = {-1, -1};
+    RC status;
+
+    *owner = NULL;
+    if (isCatalog(rel))
+        return RC_OK;
+    if (currentTx != NULL)
+        *owner = &currentTx->locks;
+    else if ((status = beginLockOwner(local)) != RC_OK)
+        return status;
+    else
+        *owner = local;
+
+    status = acquireLock(*owner, rMgr->fileName, table, LOCK_IX, true);
+    if (status == RC_OK && id.page >= 0)
+        status = acquireLock(*owner, rMgr->fileName, id, LOCK_X, true);
+    if (status != RC_OK)
+    {
+        // A transaction keeps what it has until it is aborted
+        unlockAfterWrite(*owner, local);
+        *owner = NULL;
+    }
+    return status;
+}
+
+static void unlockAfterWrite(LockOwner *owner, LockOwner *local)
+{
+    if (owner == local)
+        releaseLocks(local);
+}
+
+/*
+    # the lock on the primary key of a record image: the key of a record deleted or updated by a
+    # transaction leaves the index at once but may come back until the transaction ends, so writes
+    # that remove a key and writes that add one take its lock in X mode; keys hash to slots of
+    # KEY_LOCK_PAGE, apart from the table (page -1) and its records
+*/
+static RID keyLockId(Schema *schema, char *image)
+{
+    RID id = {KEY_LOCK_PAGE, 0};
+    unsigned int hash = 0;
+    char *nulls = nullBitmap(schema, image);
+    int offset;
+
+    for (int k = 0; k < schema->keySize; k++)
+    {
+        int attr = schema->keyAttrs[k];
+        int size = schema->dataTypes[attr] == DT_STRING ? schema->typeLength[attr] : fixedAttrSize(schema->dataTypes[attr]);
+        attrOffset(schema, attr, &offset);
+        hash = hash * 31 + hashKeyBytes(image + offset, size, isNullBit(nulls, attr));
+    }
+    id.slot = (int)(hash & 0x7fffffff);
+    return id;
+}
+
+/*
+    # locks the primary key of the record image, and with id.page >= 0 also that of the latest
+    # version stored at id, for a write that adds the one and removes the other; waits, so the
+    # caller holds no latch, and like lockForWrite releases the locks of local on failure
+*/
+static RC lockKeys(RM_TableData *rel, RID id, char *image, LockOwner *local, LockOwner *owner)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    RC status = RC_OK;
+    long xmin;
+
+    if (owner == NULL || rel->schema->keySize <= 0)
+        return RC_OK;
+    if (id.page >= 0)
+    {
+        pthread_rwlock_rdlock(&rMgr->latch);
+        char *stored = undoImage(rel, id, &xmin);
+        pthread_rwlock_unlock(&rMgr->latch);
+        // Nothing stored is left to the write to report
+        if (stored != NULL)
+            status = acquireLock(owner, rMgr->fileName, keyLockId(rel->schema, stored), LOCK_X, true);
+        free(stored);
+    }
+    if (status == RC_OK && image != NULL)
+        status = acquireLock(owner, rMgr->fileName, keyLockId(rel->schema, image), LOCK_X, true);
+    if (status != RC_OK)
+        unlockAfterWrite(owner, local);
+    return status;
+}
+
+/*
+    # RC_TX_CONFLICT if the latest version at id was written or deleted by a transaction the snapshot
+    # of the writer does not see: that of its transaction, or outside of one the latest changes;
+    # present tells if there is a record at id that is not deleted. The caller holds the latch
+*/
+static RC checkWriteConflict(RM_TableData *rel, RID id, bool *present)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    BM_PageHandle page;
+    Snapshot local;
+    RC status = RC_OK;
+
+    *present = false;
+    if (isCatalog(rel))
+        return RC_OK;
+    Snapshot *snapshot = beginRead(&local);
+    if (snapshot == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    // A page that is not there is left to the operation to report
+    if (pinPage(&rMgr->bp, &page, id.page) == RC_OK)
+    {
+        if (slotIsLive(page.data, id.slot))
+        {
+            long xmin = slotXmin(page.data, id.slot), xmax = slotXmax(page.data, id.slot);
+            *present = xmax == 0;
+            if (!xidVisible(snapshot, xmax != 0 ? xmax : xmin))
+                status = RC_TX_CONFLICT;
+        }
+        unpinPage(&rMgr->bp, &page);
+    }
+    endRead(snapshot, &local);
+    return status;
+}
+
+/*
+    # ends a record operation begun by beginLogged: a failed one is logged as the page changes it
+    # left, a successful one of a transaction with the record it replaced, image, which then goes
+    # to the undo entries of the transaction with the transaction id xmin of that version; returns
+    # the status of the operation or of the log
+*/
+static RC endRecordOperation(RM_TableData *rel, RC status, LogRecordType type, RID id, char *image, long xmin)
+{
+    Transaction *tx = status == RC_OK ? transactionOf(rel) : NULL;
+    LogRecord record;
+
+    // An update of a free slot in a transaction put a record there
+    if (tx != NULL && type == LOG_UPDATE && image == NULL)
+        type = LOG_INSERT;
+
+    memset(&record, 0, sizeof(LogRecord));
+    record.type = status == RC_OK ? type : LOG_PAGES;
+    record.id = id;
+    if (tx != NULL)
+    {
+        record.txId = tx->id;
+        record.data = image;
+        record.dataLength = image != NULL ? getRecordSize(rel->schema) : 0;
+    }
+    RC logStatus = endLoggedRecord(rel->mgmtData, &record);
+
+    // A delete of a free slot changed nothing there is to take back
+    if (tx == NULL || (type != LOG_INSERT && image == NULL))
+    {
+        free(image);
+        return status != RC_OK ? status : logStatus;
+    }
+    if (tx->numUndo == tx->maxUndo)
+    {
+        int max = tx->maxUndo > 0 ? 2 * tx->maxUndo : 16;
+        UndoEntry *grown = (UndoEntry *)realloc(tx->undo, max * sizeof(UndoEntry));
+        if (grown == NULL)
+        {
+            free(image);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        tx->undo = grown;
+        tx->maxUndo = max;
+    }
+    UndoEntry *entry = &tx->undo[tx->numUndo++];
+    entry->rel = rel;
+    entry->type = type;
+    entry->id = id;
+    entry->image = image;
+    entry->xmin = xmin;
+    entry->lsn = record.lsn;
+    return logStatus;
+}
+
+/*
+    # inserts a record and logs the pages it changed, a failed insert logs what it changed before failing
+    # the latch of the table keeps readers out until the pages are changed and logged
+    # The new record is locked without waiting, as the latch is held: a slot just vacuumed may still
+    # be locked by a transaction that is ending, the record is then left unlocked and writes to it
+    # check for conflicts like any other
+*/
+RC insertRecord(RM_TableData *rel, Record *record)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    LockOwner local, *owner;
+    RID table = {-1, -1};
+
+    RC status = lockForWrite(rel, table, &local, &owner);
+    if (status != RC_OK || (status = lockKeys(rel, table, record->data, &local, owner)) != RC_OK)
+        return status;
+    pthread_rwlock_wrlock(&rMgr->latch);
+    beginLogged(rMgr);
+    status = applyInsert(rel, record);
+    status = endRecordOperation(rel, status, LOG_INSERT, record->id, NULL, 0);
+    if (status == RC_OK && owner != NULL &&
+        (status = acquireLock(owner, rMgr->fileName, record->id, LOCK_X, false)) == RC_LOCK_TIMEOUT)
+        status = RC_OK;
+    pthread_rwlock_unlock(&rMgr->latch);
+    unlockAfterWrite(owner, &local);
+    return status;
+}
+
+/*
+    # This function deletes the record based on the RID
+    # If the record is not found, it returns NULL
+    # Otherwise, it returns the pointer to the record
+    # A version a snapshot may still see stays in its slot marked deleted until vacuumTable reclaims
+    # it; the delete that takes back an insert of transaction undoOf > 0 marks the record deleted by
+    # that transaction, whose lock on it may still be waited for, the slot is reused once vacuumed
+*/
+static RC applyDelete(RM_TableData *rel, RID id, long undoOf)
+{
+    // Get the record manager
+    RecordMgr *recordMgr = (RecordMgr *)(*rel).mgmtData;
+
+    // Attempt to pin the page, a corrupted one is reported as such
+    RC pinned = pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, id.page);
+    if (pinned != RC_OK)
+    {
+        // Log failure and update the state record
+        currState.TM_resp = RECORD_NOT_DELETED;
+        currState.recordUpdatedAt = time(NULL);
+        return pinned == RC_PAGE_CORRUPTED ? pinned : RC_ERROR;
+    }
+
+    // Inserts look for room from the first page that had a record deleted
+    if (id.page < (*recordMgr).deallocatePage)
+        (*recordMgr).deallocatePage = id.page;
+
+    char *data = (*recordMgr).pageHandle.data;
+
+    // The slot still holds the old values, drop them from the indexes before freeing it
+    if (slotIsLatest(data, id.slot))
+    {
+        Record oldRecord;
+        oldRecord.id = id;
+        oldRecord.data = (char *)malloc(getRecordSize(rel->schema));
+        RC status = readSlotRecord(recordMgr, rel->schema, data, id.slot, oldRecord.data);
+        if (status == RC_OK)
+            status = maintainIndexes(rel, &oldRecord, false);
+        free(oldRecord.data);
+        if (status != RC_OK)
+        {
+            unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle);
+            currState.TM_resp = RECORD_NOT_DELETED;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_ERROR;
+        }
+
+        // Free the slot, its bytes stay a hole until the page is compacted
+        bool keepOld = undoOf > 0;
+        long horizon, xid = undoOf > 0 ? undoOf : stampVersion(rel, &keepOld, &horizon);
+        if (keepOld)
+            setSlotVersion(data, id.slot, slotXmin(data, id.slot), xid);
+        else
+            freeSlot(recordMgr, rel->schema, data, id.slot);
+        recordMgr->countOfTuples--;
+    }
+
+    // Mark the page as dirty
+    if (markDirty(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+    {
+        currState.TM_resp = RECORD_NOT_DELETED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Unpin the page after writing data
+    if (unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle) != RC_OK)
+    {
+        currState.TM_resp = RECORD_NOT_DELETED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Log success and update the state record
+    currState.TM_resp = RECORD_DELETED;
+    currState.recordUpdatedAt = time(NULL);
+    return RC_OK;
+}
+
+/*
+    # deletes a record and logs the pages it changed
+*/
+RC deleteRecord(RM_TableData *rel, RID id)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    LockOwner local, *owner;
+    long xmin = 0;
+    bool present;
+
+    RC status = lockForWrite(rel, id, &local, &owner);
+    if (status != RC_OK || (status = lockKeys(rel, id, NULL, &local, owner)) != RC_OK)
+        return status;
+    pthread_rwlock_wrlock(&rMgr->latch);
+    if ((status = checkWriteConflict(rel, id, &present)) == RC_OK)
+    {
+        char *image = transactionOf(rel) != NULL ? undoImage(rel, id, &xmin) : NULL;
+        beginLogged(rMgr);
+        status = applyDelete(rel, id, 0);
+        status = endRecordOperation(rel, status, LOG_DELETE, id, image, xmin);
+    }
+    pthread_rwlock_unlock(&rMgr->latch);
+    unlockAfterWrite(owner, &local);
+    return status;
+}
+
+/*
+    # This function is used to update a record
+    # It takes the table data pointer and the new record
+    # The version it replaces goes to the version store while a snapshot may see it; the update that
+    # takes back one of transaction undoOf > 0 restores the version xmin wrote and drops the one kept
+*/
+static RC applyUpdate(RM_TableData *table, Record *newRecord, long undoOf, long xmin)
+{
+    RC returnValue;
+    RecordMgr *recordManager = (RecordMgr *)(*table).mgmtData;
+    bool shouldUpdate = true;
+    RID existing;
+
+    if (violatesNotNull(table->schema, newRecord->data))
+    {
+        currState.TM_resp = RECORD_NOT_UPDATED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_NOT_NULL_VIOLATION;
+    }
+
+    // The new key may only belong to the record that is being updated
+    if (findByKey(table, newRecord, &existing) == RC_OK &&
+        (existing.page != newRecord->id.page || existing.slot != newRecord->id.slot))
+    {
+        currState.TM_resp = RECORD_NOT_UPDATED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_IM_KEY_ALREADY_EXISTS;
+    }
+
+    // Check if the record exists in the table
+    if ((returnValue = pinPage(&(*recordManager).bp, &(*recordManager).pageHandle, (*newRecord).id.page)) != RC_OK)
+    {
+        currState.TM_resp = RECORD_NOT_UPDATED;
+        currState.recordUpdatedAt = time(NULL);
+        return returnValue == RC_PAGE_CORRUPTED ? returnValue : RC_ERROR;
+    }
+
+    // Check if the record should be updated or not
+    if (shouldUpdate)
+    {
+        // Get the current data
+        char *pageData = (*recordManager).pageHandle.data;
+
+        // Move the index entries of changed indexed attributes while the old values are still there,
+        // a deleted version in the slot has none
+        Record oldRecord;
+        RID id = newRecord->id;
+        long oldXmin = 0, oldXmax = 0;
+        oldRecord.id = id;
+        oldRecord.data = NULL;
+        if (slotIsLive(pageData, id.slot))
+        {
+            oldXmin = slotXmin(pageData, id.slot);
+            oldXmax = slotXmax(pageData, id.slot);
+            oldRecord.data = (char *)malloc(getRecordSize(table->schema));
+            returnValue = readSlotRecord(recordManager, table->schema, pageData, id.slot, oldRecord.data);
+            if (returnValue == RC_OK)
+                returnValue = oldXmax == 0 ? updateIndexes(table, &oldRecord, newRecord) : maintainIndexes(table, newRecord, true);
+        }
+        else
+            returnValue = maintainIndexes(table, newRecord, true);
+
+        // Store the new version in the same slot, it is stamped once it is there
+        if (returnValue == RC_OK)
+            returnValue = rewriteSlot(recordManager, table->schema, pageData, id.slot, newRecord->data, undoOf > 0 ? xmin : 0);
+        if (returnValue == RC_OK && undoOf > 0)
+            dropVersions(recordManager, id, undoOf, true);
+        else if (returnValue == RC_OK)
+        {
+            bool keepOld;
+            long horizon, xid = stampVersion(table, &keepOld, &horizon);
+            setSlotVersion(pageData, id.slot, xid, 0);
+            dropVersions(recordManager, id, horizon, false);
+            if (keepOld && oldRecord.data != NULL && (oldXmax == 0 || oldXmax >= horizon))
+            {
+                returnValue = pushVersion(recordManager, id, oldXmin, oldXmax != 0 ? oldXmax : xid, oldRecord.data);
+                if (returnValue == RC_OK)
+                    oldRecord.data = NULL;
+            }
+        }
+        free(oldRecord.data);
+        if (returnValue != RC_OK)
+        {
+            unpinPage(&(*recordManager).bp, &(*recordManager).pageHandle);
+            currState.TM_resp = RECORD_NOT_UPDATED;
+            currState.recordUpdatedAt = time(NULL);
+            return returnValue;
+        }
+    }
+
+    // Mark the page as dirty after making changes
+    if (markDirty(&(*recordManager).bp, &(*recordManager).pageHandle) != RC_OK)
+    {
+        currState.TM_resp = RECORD_NOT_UPDATED;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Unpin the page after writing data
+    return unpinPage(&(*recordManager).bp, &(*recordManager).pageHandle) == RC_ERROR ? RC_ERROR : RC_OK;
+}
+
+/*
+    # updates a record and logs the pages it changed
+*/
+RC updateRecord(RM_TableData *table, Record *newRecord)
+{
+    RecordMgr *rMgr = table->mgmtData;
+    LockOwner local, *owner;
+    long xmin = 0;
+    bool present;
+
+    RC status = lockForWrite(table, newRecord->id, &local, &owner);
+    if (status != RC_OK || (status = lockKeys(table, newRecord->id, newRecord->data, &local, owner)) != RC_OK)
+        return status;
+    pthread_rwlock_wrlock(&rMgr->latch);
+    if ((status = checkWriteConflict(table, newRecord->id, &present)) == RC_OK)
+    {
+        char *image = transactionOf(table) != NULL ? undoImage(table, newRecord->id, &xmin) : NULL;
+        beginLogged(rMgr);
+        status = applyUpdate(table, newRecord, 0, 0);
+        status = endRecordOperation(table, status, LOG_UPDATE, newRecord->id, image, xmin);
+    }
+    pthread_rwlock_unlock(&rMgr->latch);
+    unlockAfterWrite(owner, &local);
+    return status;
+}
+
+/*
+    # This function returns the version of the record at the RID that snapshot sees,
+    # the latest one for a NULL snapshot; the caller holds the latch of the table
+    # If the snapshot sees none, it returns RC_RM_NO_MORE_TUPLES
+*/
+static RC readRecord(RM_TableData *table, RID id, Snapshot *snapshot, Record *outputRecord)
+{
+    // Check if the record exists in the table
+    RecordMgr *recordManager = (RecordMgr *)(*table).mgmtData;
+    bool shouldFetchRecord = true;
+    // A handle of its own, concurrent scans read records through getRecord
+    BM_PageHandle page;
+
+    // Attempt to pin the page, return error if pinning fails or if the record is not found
+    RC pinned = pinPage(&(*recordManager).bp, &page, id.page);
+    if (pinned != RC_OK)
+    {
+        currState.TM_resp = FOUND_NOT_RECORD;
+        currState.recordUpdatedAt = time(NULL);
+        return pinned == RC_PAGE_CORRUPTED ? pinned : RC_ERROR;
+    }
+
+    // Get the record data from the page
+    char *dataPointer = page.data;
+
+    // Check if the record is found
+    // a slot past the slot directory means that the record is not found, a free one may still
+    // have an older version the snapshot sees
+    if (hasSlots(dataPointer) && id.slot >= 0 && id.slot < pageGet(dataPointer, PAGE_NUM_SLOTS))
+    {
+        // Check if the record should be fetched
+        if (shouldFetchRecord)
+        {
+            outputRecord->id = id;
+            // Decode the version the snapshot sees
+            RC status = readVersion(table, dataPointer, id, snapshot, NULL, outputRecord->data);
+            if (status != RC_OK)
+            {
+                unpinPage(&(*recordManager).bp, &page);
+                return status == RC_RM_NO_MORE_TUPLES ? status : RC_ERROR;
+            }
+        }
+    }
+    else
+    {
+        if (shouldFetchRecord)
+        {
+            unpinPage(&(*recordManager).bp, &page);
+            return RC_RM_NO_MORE_TUPLES;
+        }
+    }
+
+    // Unpin the page after completing the operation
+    if (unpinPage(&(*recordManager).bp, &page) == RC_ERROR)
+    {
+        currState.TM_resp = FOUND_NOT_RECORD;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    // Log successful retrieval of the record
+    currState.TM_resp = FOUND_RECORD;
+    currState.recordUpdatedAt = time(NULL);
+    return RC_OK;
+}
+
+/*
+    # returns the record at the RID as the snapshot of the transaction of the calling thread sees it,
+    # outside of one the latest version no transaction in progress wrote; writers do not block it
+*/
+RC getRecord(RM_TableData *table, RID id, Record *outputRecord)
+{
+    RecordMgr *rMgr = table->mgmtData;
+    Snapshot local;
+
+    pthread_rwlock_rdlock(&rMgr->latch);
+    Snapshot *snapshot = beginRead(&local);
+    RC status = snapshot != NULL ? readRecord(table, id, snapshot, outputRecord) : RC_MEM_ALLOCATION_FAIL;
+    endRead(snapshot, &local);
+    pthread_rwlock_unlock(&rMgr->latch);
+    return status;
+}
+
+/* Transactions */
+
+/*
+    # takes back the delete of a record by transaction txId: the version it marked deleted in its
+    # slot is the latest again; a record whose slot was freed is put back into it, stamped with
+    # xmin, a page vacuumed meanwhile still has room for it
+    # Returns RC_IM_KEY_ALREADY_EXISTS if another record has taken its primary key meanwhile
+*/
+static RC applyRestore(RM_TableData *rel, Record *record, long txId, long xmin)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    Schema *schema = rel->schema;
+    BM_PageHandle page;
+    RID existing;
+    RC status;
+
+    if (findByKey(rel, record, &existing) == RC_OK &&
+        (existing.page != record->id.page || existing.slot != record->id.slot))
+        return RC_IM_KEY_ALREADY_EXISTS;
+
+    bool *spill = (bool *)malloc(schema->numAttr * sizeof(bool));
+    int storedSize = rMgr->pax != NULL ? 0 : planStoredRecord(rMgr, schema, record->data, spill, MAX_STORED_RECORD);
+    if (storedSize < 0 || (status = pinPage(&rMgr->bp, &page, record->id.page)) != RC_OK)
+    {
+        free(spill);
+        return RC_ERROR;
+    }
+
+    bool marked = slotIsLive(page.data, record->id.slot) && slotXmax(page.data, record->id.slot) == txId;
+    if (marked)
+    {
+        setSlotVersion(page.data, record->id.slot, slotXmin(page.data, record->id.slot), 0);
+        markDirty(&rMgr->bp, &page);
+    }
+    else if (!claimRecordSlot(rMgr, page.data, record->id.slot, storedSize))
+        status = RC_ERROR;
+    else
+    {
+        status = writeSlotRecord(rMgr, schema, page.data, record->id.slot, record->data, spill, xmin);
+        markDirty(&rMgr->bp, &page);
+    }
+    free(spill);
+    unpinPage(&rMgr->bp, &page);
+
+    if (status == RC_OK && (status = maintainIndexes(rel, record, true)) == RC_OK)
+        rMgr->countOfTuples++;
+    return status;
+}
+
+/*
+    # takes back one operation of transaction txId with the opposite one, which is logged as
+    # compensating the operation so that recovery does not take the operation back again
+*/
+static RC undoOperation(long txId, UndoEntry *entry)
+{
+    RM_TableData *rel = entry->rel;
+    RecordMgr *rMgr = rel->mgmtData;
+    Record record;
+    LogRecord log;
+    RC status;
+
+    record.id = entry->id;
+    record.data = entry->image;
+    memset(&log, 0, sizeof(LogRecord));
+    log.id = entry->id;
+    log.txId = txId;
+    log.compensates = entry->lsn;
+
+    pthread_rwlock_wrlock(&rMgr->latch);
+    beginLogged(rMgr);
+    switch (entry->type)
+    {
+    case LOG_INSERT:
+        log.type = LOG_DELETE;
+        status = applyDelete(rel, entry->id, txId);
+        break;
+    case LOG_DELETE:
+        log.type = LOG_INSERT;
+        status = applyRestore(rel, &record, txId, entry->xmin);
+        break;
+    default:
+        log.type = LOG_UPDATE;
+        status = applyUpdate(rel, &record, txId, entry->xmin);
+        break;
+    }
+    if (status != RC_OK)
+        log.type = LOG_PAGES;
+    RC logStatus = endLoggedRecord(rMgr, &log);
+    pthread_rwlock_unlock(&rMgr->latch);
+    return status != RC_OK ? status : logStatus;
+}
+
+/*
+    # appends the record that ends transaction txId, a commit is on disk on return
+*/
+static RC logTransactionEnd(long txId, LogRecordType type)
+{
+    LogRecord record;
+    RC status;
+
+    if (mgrHandler.walMode == WAL_OFF)
+        return RC_OK;
+
+    memset(&record, 0, sizeof(LogRecord));
+    record.type = type;
+    record.table = "";
+    record.id.page = -1;
+    record.id.slot = -1;
+    record.txId = txId;
+    if ((status = appendLog(&record)) != RC_OK || type != LOG_COMMIT)
+        return status;
+    return flushLog(record.lsn);
+}
+
+/*
+    # frees the transaction of the calling thread, which ends it
+*/
+static void endTransaction(void)
+{
+    pthread_mutex_lock(&txLock);
+    for (Transaction **link = &activeTxs; *link != NULL; link = &(*link)->nextActive)
+    {
+        if (*link == currentTx)
+        {
+            *link = currentTx->nextActive;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&txLock);
+    closeSnapshot(&currentTx->snapshot);
+    // Writers the locks let in next see the transaction ended
+    releaseLocks(&currentTx->locks);
+
+    for (int i = 0; i < currentTx->numUndo; i++)
+        free(currentTx->undo[i].image);
+    free(currentTx->undo);
+    free(currentTx);
+    currentTx = NULL;
+}
+
+/*
+    # starts a transaction in the calling thread, the inserts, deletes and updates it makes
+    # until commitTransaction or abortTransaction belong to it; its reads and scans see the
+    # tables as transactions committed them before it began, and its own changes
+*/
+RC beginTransaction(void)
+{
+    if (currentTx != NULL)
+        return RC_TX_ACTIVE;
+    if ((currentTx = (Transaction *)calloc(1, sizeof(Transaction))) == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    currentTx->firstLsn = getLogEnd();
+    if (beginLockOwner(&currentTx->locks) != RC_OK)
+    {
+        free(currentTx);
+        currentTx = NULL;
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    pthread_mutex_lock(&txLock);
+    currentTx->id = newTxId();
+    RC status = fillSnapshot(&currentTx->snapshot, currentTx->id);
+    if (status == RC_OK)
+    {
+        currentTx->snapshot.next = openSnapshots;
+        openSnapshots = &currentTx->snapshot;
+        currentTx->nextActive = activeTxs;
+        activeTxs = currentTx;
+    }
+    pthread_mutex_unlock(&txLock);
+    if (status != RC_OK)
+    {
+        releaseLocks(&currentTx->locks);
+        free(currentTx);
+        currentTx = NULL;
+    }
+    return status;
+}
+
+/*
+    # makes the transaction of the calling thread durable: no-force, only the log is synced,
+    # the pages it changed are written whenever the buffer pools write them
+*/
+RC commitTransaction(void)
+{
+    if (currentTx == NULL)
+        return RC_TX_NOT_ACTIVE;
+
+    // A transaction that changed nothing has nothing to commit
+    RC status = currentTx->numUndo > 0 ? logTransactionEnd(currentTx->id, LOG_COMMIT) : RC_OK;
+    endTransaction();
+    return status;
+}
+
+/*
+    # takes back every operation of the transaction of the calling thread, the last one first
+    # steal: pages with changes of the transaction may have been written already, the undo
+    # changes them back like any other operation
+*/
+RC abortTransaction(void)
+{
+    RC status = RC_OK;
+
+    if (currentTx == NULL)
+        return RC_TX_NOT_ACTIVE;
+
+    for (int i = currentTx->numUndo - 1; i >= 0 && status == RC_OK; i--)
+        status = undoOperation(currentTx->id, &currentTx->undo[i]);
+    if (status == RC_OK && currentTx->numUndo > 0)
+        status = logTransactionEnd(currentTx->id, LOG_ABORT);
+    endTransaction();
+    return status;
+}
+
+/*
+    # locks rel for the transaction of the calling thread until it ends: S keeps writers out,
+    # X keeps writers and lockers out, IS and IX only announce locks on records
+*/
+RC lockTable(RM_TableData *rel, LockMode mode)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    RID table = {-1, -1};
+
+    if (transactionOf(rel) == NULL)
+        return RC_TX_NOT_ACTIVE;
+    return acquireLock(&currentTx->locks, rMgr->fileName, table, mode, true);
+}
+
+/*
+    # locks the record at id for the transaction of the calling thread until it ends, in S mode
+    # to keep writers of it out or in X mode to keep them and lockers out, with IS or IX on rel
+    # Returns RC_RM_NO_MORE_TUPLES if there is no such record, and RC_TX_CONFLICT if a transaction
+    # its snapshot does not see changed it, the lock is kept then
+*/
+RC lockRecord(RM_TableData *rel, RID id, LockMode mode)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    RID table = {-1, -1};
+    bool present;
+    RC status;
+
+    if (transactionOf(rel) == NULL)
+        return RC_TX_NOT_ACTIVE;
+    if (mode != LOCK_S && mode != LOCK_X)
+        return RC_ERROR;
+    bool held = holdsLock(&currentTx->locks, rMgr->fileName, id);
+    if ((status = acquireLock(&currentTx->locks, rMgr->fileName, table, mode == LOCK_S ? LOCK_IS : LOCK_IX, true)) != RC_OK ||
+        (status = acquireLock(&currentTx->locks, rMgr->fileName, id, mode, true)) != RC_OK)
+        return status;
+
+    pthread_rwlock_rdlock(&rMgr->latch);
+    status = checkWriteConflict(rel, id, &present);
+    pthread_rwlock_unlock(&rMgr->latch);
+    if (status == RC_OK && !present)
+    {
+        // The lock of a record that is not there would only get in the way of inserts
+        if (!held)
+            releaseLock(&currentTx->locks, rMgr->fileName, id);
+        status = RC_RM_NO_MORE_TUPLES;
+    }
+    return status;
+}
+
+/* Checkpoints */
+
+// A checkpoint record holds, in its data:
+//   LSN begin, the end of the log when the checkpoint started
+//   int numTables, then for every open table
+//     int nameLength, the name of its page file, int numPages, numPages BM_DirtyPage
+//   int numTxs, then for every transaction in progress long txId, LSN firstLsn
+// Every change before begin of a table that is not in one of its dirty pages is in its page file
+
+// what the checkpoints have to go on from
+static struct Checkpoints
+{
+    pthread_mutex_t lock; // one checkpoint at a time
+    LSN lastEnd;          // end of the log after the last checkpoint
+    pthread_mutex_t threadLock;
+    pthread_cond_t wake;
+    pthread_t thread;
+    bool running;
+    bool stopping;
+} checkpoints = {PTHREAD_MUTEX_INITIALIZER, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER};
+
+/*
+    # appends length bytes to a growing buffer
+*/
+static RC appendBytes(char **buffer, int *length, int *size, void *bytes, int numBytes)
+{
+    if (*length + numBytes > *size)
+    {
+        int grown = *size > 0 ? *size : 256;
+        while (grown < *length + numBytes)
+            grown *= 2;
+        char *data = (char *)realloc(*buffer, grown);
+        if (data == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        *buffer = data;
+        *size = grown;
+    }
+    memcpy(*buffer + *length, bytes, numBytes);
+    *length += numBytes;
+    return RC_OK;
+}
+
+/*
+    # where redo of a table with these dirty pages has to start, 0 if a page was changed without a log record
+*/
+static LSN redoStart(LSN begin, BM_DirtyPage *pages, int numPages)
+{
+    LSN start = begin;
+
+    for (int i = 0; i < numPages; i++)
+    {
+        if (pages[i].recLsn == 0)
+            return 0;
+        if (pages[i].recLsn < start)
+            start = pages[i].recLsn;
+    }
+    return start;
+}
+
+/*
+    # adds an open table to the checkpoint record: writes back its pages first changed before begin,
+    # page by page so that operations on it go on, and records the pages changed meanwhile
+*/
+static RC checkpointTable(RecordMgr *rMgr, LSN begin, char **data, int *length, int *size, LSN *cut,
+                          RM_CheckpointStats *stats)
+{
+    BM_DirtyPage *pages;
+    int numPages, writes = getNumWriteIO(&rMgr->bp), nameLength = strlen(rMgr->fileName);
+    RC status;
+
+    if ((status = flushDirtyPages(&rMgr->bp, begin)) != RC_OK ||
+        (status = getDirtyPages(&rMgr->bp, &pages, &numPages)) != RC_OK)
+        return status;
+    stats->tables++;
+    stats->pagesWritten += getNumWriteIO(&rMgr->bp) - writes;
+    stats->dirtyPages += numPages;
+
+    LSN start = redoStart(begin, pages, numPages);
+    if (start < *cut)
+        *cut = start;
+    if ((status = appendBytes(data, length, size, &nameLength, sizeof(int))) == RC_OK &&
+        (status = appendBytes(data, length, size, rMgr->fileName, nameLength)) == RC_OK &&
+        (status = appendBytes(data, length, size, &numPages, sizeof(int))) == RC_OK)
+        status = appendBytes(data, length, size, pages, numPages * sizeof(BM_DirtyPage));
+    free(pages);
+    return status;
+}
+
+/*
+    # takes a fuzzy checkpoint: writes back the pages of the open tables changed before it started and
+    # logs the pages changed since and the transactions in progress; recovery then redoes a table from
+    # its oldest dirty page on, so the segments of the log older than that and than the first record
+    # of any transaction in progress are dropped; operations go on during the checkpoint
+*/
+RC checkpoint(RM_CheckpointStats *stats)
+{
+    RM_CheckpointStats local;
+    struct timespec start, end;
+    LogStats before, after;
+    LogRecord record;
+    char *data = NULL;
+    int length = 0, size = 0, numTables = 0, numTxs = 0, countAt;
+    RC status = RC_OK;
+
+    if (stats == NULL)
+        stats = &local;
+    memset(stats, 0, sizeof(RM_CheckpointStats));
+    if (!mgrHandler.initialized)
+        return RC_ERROR;
+    if (mgrHandler.walMode == WAL_OFF)
+        return RC_OK;
+
+    pthread_mutex_lock(&checkpoints.lock);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    getLogStats(&before);
+    LSN begin = getLogEnd(), cut = begin;
+
+    status = appendBytes(&data, &length, &size, &begin, sizeof(LSN));
+    countAt = length;
+    if (status == RC_OK)
+        status = appendBytes(&data, &length, &size, &numTables, sizeof(int));
+    pthread_mutex_lock(&tablesLock);
+    for (RecordMgr *rMgr = openList; rMgr != NULL && status == RC_OK; rMgr = rMgr->nextOpen, numTables++)
+        status = checkpointTable(rMgr, begin, &data, &length, &size, &cut, stats);
+    pthread_mutex_unlock(&tablesLock);
+    if (status == RC_OK)
+    {
+        memcpy(data + countAt, &numTables, sizeof(int));
+        countAt = length;
+        status = appendBytes(&data, &length, &size, &numTxs, sizeof(int));
+    }
+
+    pthread_mutex_lock(&txLock);
+    for (Transaction *tx = activeTxs; tx != NULL && status == RC_OK; tx = tx->nextActive, numTxs++)
+    {
+        if ((status = appendBytes(&data, &length, &size, &tx->id, sizeof(long))) == RC_OK)
+            status = appendBytes(&data, &length, &size, &tx->firstLsn, sizeof(LSN));
+        if (tx->firstLsn < cut)
+            cut = tx->firstLsn;
+    }
+    pthread_mutex_unlock(&txLock);
+
+    if (status == RC_OK)
+    {
+        memcpy(data + countAt, &numTxs, sizeof(int));
+        memset(&record, 0, sizeof(LogRecord));
+        record.type = LOG_CHECKPOINT;
+        record.table = "";
+        record.id.page = -1;
+        record.id.slot = -1;
+        record.data = data;
+        record.dataLength = length;
+        status = appendLog(&record);
+    }
+    if (status == RC_OK)
+        status = flushLog(record.lsn);
+    if (status == RC_OK && cut > 0)
+        status = truncateLog(cut);
+    free(data);
+
+    getLogStats(&after);
+    checkpoints.lastEnd = getLogEnd();
+    stats->activeTransactions = numTxs;
+    stats->logBytesDropped = before.size - after.size + (after.bytes - before.bytes);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->elapsedMs = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    pthread_mutex_unlock(&checkpoints.lock);
+    return status;
+}
+
+/*
+    # takes a checkpoint every checkpointMs and whenever the log grew by checkpointLogBytes since the last one
+*/
+static void *checkpointThread(void *arg)
+{
+    (void)arg;
+    struct timespec last, now;
+
+    clock_gettime(CLOCK_MONOTONIC, &last);
+    pthread_mutex_lock(&checkpoints.threadLock);
+    while (!checkpoints.stopping)
+    {
+        struct timespec deadline;
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_nsec += CHECKPOINT_POLL_MS * 1000000L;
+        deadline.tv_sec += deadline.tv_nsec / 1000000000L;
+        deadline.tv_nsec %= 1000000000L;
+        pthread_cond_timedwait(&checkpoints.wake, &checkpoints.threadLock, &deadline);
+        if (checkpoints.stopping)
+            break;
+
+        clock_gettime(CLOCK_MONOTONIC, &now);
+        double elapsedMs = (now.tv_sec - last.tv_sec) * 1e3 + (now.tv_nsec - last.tv_nsec) / 1e6;
+        bool due = mgrHandler.checkpointMs > 0 && elapsedMs >= mgrHandler.checkpointMs;
+        if (mgrHandler.checkpointLogBytes > 0 && getLogEnd() - checkpoints.lastEnd >= mgrHandler.checkpointLogBytes)
+            due = true;
+        if (!due)
+            continue;
+
+        pthread_mutex_unlock(&checkpoints.threadLock);
+        checkpoint(NULL);
+        clock_gettime(CLOCK_MONOTONIC, &last);
+        pthread_mutex_lock(&checkpoints.threadLock);
+    }
+    pthread_mutex_unlock(&checkpoints.threadLock);
+    return NULL;
+}
+
+/*
+    # starts the background checkpoints, unless there is no log or neither trigger is set
+*/
+static RC startCheckpoints(void)
+{
+    checkpoints.lastEnd = getLogEnd();
+    if (mgrHandler.walMode == WAL_OFF || (mgrHandler.checkpointMs < 0 && mgrHandler.checkpointLogBytes < 0))
+        return RC_OK;
+
+    checkpoints.stopping = false;
+    if (pthread_create(&checkpoints.thread, NULL, checkpointThread, NULL) != 0)
+        return RC_ERROR;
+    checkpoints.running = true;
+    return RC_OK;
+}
+
+static void stopCheckpoints(void)
+{
+    if (!checkpoints.running)
+        return;
+
+    pthread_mutex_lock(&checkpoints.threadLock);
+    checkpoints.stopping = true;
+    pthread_cond_signal(&checkpoints.wake);
+    pthread_mutex_unlock(&checkpoints.threadLock);
+    pthread_join(checkpoints.thread, NULL);
+    checkpoints.running = false;
+}
+
+/* Vacuum */
+
+/*
+    # true if page pageNum holds no records: a free page or a data page without live slots
+    # whose records have no versions in the version store either
+*/
+static bool pageIsEmpty(RecordMgr *rMgr, char *page, int pageNum)
+{
+    int kind = pageGet(page, PAGE_KIND);
+    int numSlots = pageGet(page, PAGE_NUM_SLOTS);
+
+    if (kind == PAGE_KIND_FREE)
+        return true;
+    if (!hasSlots(page))
+        return false;
+    for (int slot = 0; slot < numSlots; slot++)
+        if (slotIsLive(page, slot) || hasVersions(rMgr, (RID){pageNum, slot}))
+            return false;
+    return true;
+}
+
+/*
+    # cuts the empty pages at the end of the file off and drops them from the free page list
+*/
+static RC truncateEmptyTail(RM_TableData *rel, int *pagesTruncated)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    BM_PageHandle page;
+    int numPages = getNumFilePages(&rMgr->bp), end = numPages;
+    RC status;
+
+    *pagesTruncated = 0;
+    while (end > 1)
+    {
+        if ((status = pinPage(&rMgr->bp, &page, end - 1)) != RC_OK)
+            return status;
+        bool empty = pageIsEmpty(rMgr, page.data, end - 1);
+        unpinPage(&rMgr->bp, &page);
+        if (!empty)
+            break;
+        end--;
+    }
+    if (end == numPages)
+        return RC_OK;
+
+    // Unlink the pages that are cut off from the free page list first, pinning
+    // them afterwards would grow the file again
+    int prev = 0, pageNum = rMgr->freeListHead;
+    beginLogged(rMgr);
+    while (pageNum != 0)
+    {
+        if ((status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+        {
+            endLogged(rMgr, LOG_PAGES, NULL);
+            return status;
+        }
+        int next = pageGet(page.data, FREE_NEXT);
+        unpinPage(&rMgr->bp, &page);
+
+        if (pageNum < end)
+            prev = pageNum;
+        else if (prev == 0)
+            rMgr->freeListHead = next;
+        else
+        {
+            if ((status = pinPage(&rMgr->bp, &page, prev)) != RC_OK)
+            {
+                endLogged(rMgr, LOG_PAGES, NULL);
+                return status;
+            }
+            pageSet(page.data, FREE_NEXT, next);
+            markDirty(&rMgr->bp, &page);
+            unpinPage(&rMgr->bp, &page);
+        }
+        pageNum = next;
+    }
+    status = saveFreeList(rMgr, rel->schema);
+    RC logStatus = endLogged(rMgr, LOG_PAGES, NULL);
+    if (status != RC_OK || (status = logStatus) != RC_OK)
+        return status;
+
+    if (rMgr->deallocatePage >= end)
+        rMgr->deallocatePage = (end > 1) ? end - 1 : 1;
+    if (rMgr->vacuumCursor >= end)
+        rMgr->vacuumCursor = 1;
+
+    if ((status = logTruncate(rMgr, end)) != RC_OK || (status = truncatePool(&rMgr->bp, end)) != RC_OK)
+        return status;
+    *pagesTruncated = numPages - end;
+    return RC_OK;
+}
+
+/*
+    # vacuums at most maxPages pages of the table (every page if maxPages <= 0), starting
+    # where the previous call stopped, so that it can run a few pages at a time:
+    #   - holes left by deleted and shrunk records are compacted away
+    #   - free slots at the end of a slot directory are dropped
+    #   - pages without records go to the free page list, which inserts and overflow
+    #     chains use before the file grows
+    #   - inserts start again at the first page that got room
+    #   - deleted records and older versions in the version store that no snapshot sees
+    #     any more are dropped, a transaction in progress keeps the records it deleted
+    # with truncate the empty pages at the end of the file are cut off whenever a call
+    # reaches the end of the file; stats (may be NULL) reports what was reclaimed
+    # the latch of the table is held for one page at a time
+*/
+RC vacuumTable(RM_TableData *rel, int maxPages, bool truncate, RM_VacuumStats *stats)
+{
+    RecordMgr *rMgr;
+    RM_VacuumStats local;
+    BM_PageHandle page;
+    struct timespec start, end;
+    RC status = RC_OK;
+
+    if (rel == NULL || rel->mgmtData == NULL)
+        return RC_NULL_ARGUMENT;
+    if (stats == NULL)
+        stats = &local;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    memset(stats, 0, sizeof(RM_VacuumStats));
+    rMgr = rel->mgmtData;
+
+    int numPages = getNumFilePages(&rMgr->bp);
+    if (rMgr->vacuumCursor < 1 || rMgr->vacuumCursor >= numPages)
+        rMgr->vacuumCursor = 1;
+
+    pthread_mutex_lock(&txLock);
+    long horizon = versionHorizon();
+    pthread_mutex_unlock(&txLock);
+
+    bool freed = false;
+    while (rMgr->vacuumCursor < numPages && (maxPages <= 0 || stats->pagesVisited < maxPages))
+    {
+        int pageNum = rMgr->vacuumCursor++;
+
+        // Every page is logged on its own, a vacuum of the whole table would pin every page it changed
+        pthread_rwlock_wrlock(&rMgr->latch);
+        beginLogged(rMgr);
+        if ((status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+        {
+            endLogged(rMgr, LOG_PAGES, NULL);
+            pthread_rwlock_unlock(&rMgr->latch);
+            break;
+        }
+        stats->pagesVisited++;
+
+        if (!hasSlots(page.data))
+        {
+            unpinPage(&rMgr->bp, &page);
+            endLogged(rMgr, LOG_PAGES, NULL);
+            pthread_rwlock_unlock(&rMgr->latch);
+            continue;
+        }
+
+        // Drop the versions no snapshot sees any more, the deleted ones free their slots
+        bool dirty = false;
+        int numSlots = pageGet(page.data, PAGE_NUM_SLOTS);
+        for (int slot = 0; slot < numSlots; slot++)
+        {
+            RID id = {pageNum, slot};
+            stats->versionsRemoved += dropVersions(rMgr, id, horizon, false);
+            if (!slotIsLive(page.data, slot) || slotXmax(page.data, slot) == 0 || slotXmax(page.data, slot) >= horizon)
+                continue;
+            freeSlot(rMgr, rel->schema, page.data, slot);
+            stats->versionsRemoved++;
+            dirty = true;
+        }
+
+        // A free slot keeps its number while the version store has versions of its record
+        while (numSlots > 0 && !slotIsLive(page.data, numSlots - 1) && !hasVersions(rMgr, (RID){pageNum, numSlots - 1}))
+            numSlots--;
+        if (numSlots != pageGet(page.data, PAGE_NUM_SLOTS))
+        {
+            pageSet(page.data, PAGE_NUM_SLOTS, numSlots);
+            dirty = true;
+        }
+
+        if (numSlots == 0)
+        {
+            pushFreePage(rMgr, page.data, pageNum);
+            stats->pagesFreed++;
+            freed = dirty = true;
+        }
+        else if (pageGet(page.data, PAGE_KIND) == PAGE_KIND_PAX)
+        {
+            // Records of a PAX page never move, it has no holes to compact
+            if (paxFreeSlots(page.data) >= pageGet(page.data, PAX_CAPACITY) / 4 && pageNum < rMgr->deallocatePage)
+                rMgr->deallocatePage = pageNum;
+        }
+        else
+        {
+            if (totalFree(page.data) > contiguousFree(page.data))
+            {
+                compactPage(page.data);
+                stats->pagesCompacted++;
+                dirty = true;
+            }
+            if (totalFree(page.data) >= PAGE_SIZE / 4 && pageNum < rMgr->deallocatePage)
+                rMgr->deallocatePage = pageNum;
+        }
+
+        if (dirty)
+            markDirty(&rMgr->bp, &page);
+        unpinPage(&rMgr->bp, &page);
+        status = endLogged(rMgr, LOG_PAGES, NULL);
+        pthread_rwlock_unlock(&rMgr->latch);
+        if (status != RC_OK)
+            break;
+    }
+
+    if (status == RC_OK && freed)
+    {
+        pthread_rwlock_wrlock(&rMgr->latch);
+        beginLogged(rMgr);
+        status = saveFreeList(rMgr, rel->schema);
+        RC logStatus = endLogged(rMgr, LOG_PAGES, NULL);
+        pthread_rwlock_unlock(&rMgr->latch);
+        if (status == RC_OK)
+            status = logStatus;
+    }
+
+    stats->passComplete = rMgr->vacuumCursor >= numPages;
+    if (stats->passComplete)
+        rMgr->vacuumCursor = 1;
+    if (status == RC_OK && truncate && stats->passComplete)
+    {
+        pthread_rwlock_wrlock(&rMgr->latch);
+        status = truncateEmptyTail(rel, &stats->pagesTruncated);
+        pthread_rwlock_unlock(&rMgr->latch);
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    stats->elapsedMs = (end.tv_sec - start.tv_sec) * 1e3 + (end.tv_nsec - start.tv_nsec) / 1e6;
+    return status;
+}
+
+/* Secondary indexes */
+
+/*
+    # creates an index of the given kind on attribute attrNum of an open table
+    # the records already in the table are loaded into the new index
+*/
+static RC createIndexOfKind(RM_TableData *rel, int attrNum, IndexKind kind)
+{
+    RecordMgr *rMgr;
+    Record *record;
+    RID rid;
+    RC status;
+
+    if (rel == NULL || rel->mgmtData == NULL)
+        return RC_NULL_ARGUMENT;
+    if (attrNum < 0 || attrNum >= rel->schema->numAttr)
+        return RC_ERROR;
+
+    rMgr = rel->mgmtData;
+    if (findTableIndex(rMgr, attrNum) >= 0)
+        return RC_IM_KEY_ALREADY_EXISTS;
+    if (rMgr->numIndexes >= MAX_TABLE_INDEXES)
+        return RC_ERROR;
+
+    char *fileName = indexFileName(rMgr->bp.pageFile, attrNum, kind);
+    if (kind == INDEX_HASH)
+        status = createHash(fileName, rel->schema->dataTypes[attrNum], rel->schema->typeLength[attrNum]);
+    else
+        status = createBtree(fileName, rel->schema->dataTypes[attrNum], rel->schema->typeLength[attrNum], 0);
+    free(fileName);
+    if (status != RC_OK || (status = openTableIndex(rMgr, attrNum, kind)) != RC_OK)
+        return status;
+
+    int pos = rMgr->numIndexes - 1;
+    createRecord(&record, rel->schema);
+    rid.page = 1;
+    rid.slot = -1;
+    while ((status = nextLiveRecord(rel, &rid, record)) == RC_OK)
+    {
+        Value *key;
+        getAttr(record, rel->schema, attrNum, &key);
+        status = key->isNull ? RC_OK : indexInsert(rMgr, pos, key, rid);
+        freeVal(key);
+        if (status != RC_OK)
+            break;
+    }
+    freeRecord(record);
+
+    if (status != RC_RM_NO_MORE_TUPLES)
+    {
+        dropIndex(rel, attrNum);
+        return status;
+    }
+    return writeIndexRegistry(rel);
+}
+
+/*
+    # creates a B+-tree index on attribute attrNum, for equality and range predicates
+*/
+RC createIndex(RM_TableData *rel, int attrNum)
+{
+    return createIndexOfKind(rel, attrNum, INDEX_BTREE);
+}
+
+/*
+    # creates an extendible hash index on attribute attrNum, for equality lookups only
+*/
+RC createHashIndex(RM_TableData *rel, int attrNum)
+{
+    return createIndexOfKind(rel, attrNum, INDEX_HASH);
+}
+
+/*
+    # removes the index on attrNum and deletes its file
+*/
+RC dropIndex(RM_TableData *rel, int attrNum)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    int pos = findTableIndex(rMgr, attrNum);
+
+    if (pos < 0)
+        return RC_IM_KEY_NOT_FOUND;
+
+    // The primary key index enforces uniqueness and stays for the lifetime of the table
+    if (rel->schema->keySize > 0 && rel->schema->keyAttrs[0] == attrNum)
+        return RC_ERROR;
+
+    IndexKind kind = rMgr->indexKinds[pos];
+    closeTableIndex(rMgr, pos);
+    for (int i = pos; i < rMgr->numIndexes - 1; i++)
+    {
+        rMgr->indexAttrs[i] = rMgr->indexAttrs[i + 1];
+        rMgr->indexKinds[i] = rMgr->indexKinds[i + 1];
+        rMgr->indexes[i] = rMgr->indexes[i + 1];
+        rMgr->hashIndexes[i] = rMgr->hashIndexes[i + 1];
+    }
+    rMgr->numIndexes--;
+
+    char *fileName = indexFileName(rMgr->bp.pageFile, attrNum, kind);
+    if (kind == INDEX_HASH)
+        deleteHash(fileName);
+    else
+        deleteBtree(fileName);
+    free(fileName);
+    return writeIndexRegistry(rel);
+}
+
+/*
+    # returns the B+-tree on attrNum, RC_IM_KEY_NOT_FOUND if the attribute has none
+*/
+RC getTableIndex(RM_TableData *rel, int attrNum, BTreeHandle **tree)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    int pos = findTableIndex(rMgr, attrNum);
+
+    if (pos < 0 || rMgr->indexKinds[pos] != INDEX_BTREE)
+        return RC_IM_KEY_NOT_FOUND;
+    *tree = rMgr->indexes[pos];
+    return RC_OK;
+}
+
+/*
+    # returns the hash index on attrNum, RC_IM_KEY_NOT_FOUND if the attribute has none
+*/
+RC getTableHashIndex(RM_TableData *rel, int attrNum, HashHandle **hash)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    int pos = findTableIndex(rMgr, attrNum);
+
+    if (pos < 0 || rMgr->indexKinds[pos] != INDEX_HASH)
+        return RC_IM_KEY_NOT_FOUND;
+    *hash = rMgr->hashIndexes[pos];
+    return RC_OK;
+}
+
+/*
+    # fetches the first record whose attribute attrNum equals value, as getRecord sees it
+    # uses the index on the attribute if there is one, otherwise scans the table
+    # returns RC_RM_NO_MORE_TUPLES if no record matches, which is always the case for a NULL value
+*/
+RC getRecordByValue(RM_TableData *rel, int attrNum, Value *value, Record *record)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    BTreeHandle *tree;
+    HashHandle *hash;
+    RM_ScanHandle scan;
+    Value *attr, *equal, *yes;
+    Expr *all;
+    RID rid, *rids;
+    int numRids;
+    RC status;
+
+    if (value->isNull)
+        return RC_RM_NO_MORE_TUPLES;
+
+    bool indexed = true;
+    pthread_rwlock_rdlock(&rMgr->latch);
+    if (getTableIndex(rel, attrNum, &tree) == RC_OK)
+        status = findKey(tree, value, &rid);
+    else if (getTableHashIndex(rel, attrNum, &hash) == RC_OK)
+    {
+        if ((status = hashLookup(hash, value, &rids, &numRids)) == RC_OK)
+        {
+            rid = rids[0];
+            free(rids);
+        }
+    }
+    else
+        indexed = false;
+
+    if (indexed)
+    {
+        // the index holds the latest versions, the record is read as the snapshot sees it
+        Snapshot local, *snapshot = NULL;
+        if (status == RC_IM_KEY_NOT_FOUND)
+            status = RC_RM_NO_MORE_TUPLES;
+        else if (status == RC_OK && (snapshot = beginRead(&local)) == NULL)
+            status = RC_MEM_ALLOCATION_FAIL;
+        else if (status == RC_OK)
+            status = readRecord(rel, rid, snapshot, record);
+        endRead(snapshot, &local);
+        pthread_rwlock_unlock(&rMgr->latch);
+        return status;
+    }
+    pthread_rwlock_unlock(&rMgr->latch);
+
+    // without an index a scan of the whole table compares the values itself
+    MAKE_VALUE(yes, DT_BOOL, TRUE);
+    MAKE_CONS(all, yes);
+    if ((status = startScan(rel, &scan, all)) != RC_OK)
+    {
+        freeExpr(all);
+        return status;
+    }
+    while ((status = next(&scan, record)) == RC_OK)
+    {
+        getAttr(record, rel->schema, attrNum, &attr);
+        MAKE_VALUE(equal, DT_BOOL, FALSE);
+        status = valueEquals(attr, value, equal);
+        bool found = status == RC_OK && equal->v.boolV;
+        freeVal(attr);
+        freeVal(equal);
+        if (status != RC_OK || found)
+            break;
+    }
+    closeScan(&scan);
+    freeExpr(all);
+    return status;
+}
+
+/*
+    # fetches the record with the given primary key, as getRecord sees it
+    # keyValues holds one value per key attribute, in the order of schema->keyAttrs
+    # returns RC_IM_KEY_NOT_FOUND if no record has the key
+*/
+RC getRecordByKey(RM_TableData *rel, Value **keyValues, Record *record)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    Schema *schema = rel->schema;
+    Snapshot local, *snapshot;
+    Record *probe;
+    RID rid;
+    RC status;
+
+    if (schema->keySize <= 0)
+        return RC_IM_KEY_NOT_FOUND;
+
+    createRecord(&probe, schema);
+    for (int k = 0; k < schema->keySize; k++)
+        setAttr(probe, schema, schema->keyAttrs[k], keyValues[k]);
+
+    pthread_rwlock_rdlock(&rMgr->latch);
+    if ((snapshot = beginRead(&local)) == NULL)
+        status = RC_MEM_ALLOCATION_FAIL;
+    else if ((status = findByKey(rel, probe, &rid)) == RC_OK)
+    {
+        status = readRecord(rel, rid, snapshot, record);
+        // the key belongs to a version the snapshot does not see
+        if (status == RC_RM_NO_MORE_TUPLES)
+            status = RC_IM_KEY_NOT_FOUND;
+    }
+    endRead(snapshot, &local);
+    pthread_rwlock_unlock(&rMgr->latch);
+    freeRecord(probe);
+    return status;
+}
+
+/*
+    # This function returns the size of the record in bytes based on the schema
+    # and the data types in the schema
+    # this is the size of the in-memory record, strings take their full typeLength and
+    # the null bitmap follows the attributes; on the pages records are stored in
+    # variable-length form (see the layout above)
+*/
+int getRecordSize(Schema *customSchema)
+{
+    // Check if the schema is valid
+    if (customSchema == NULL || customSchema->numAttr <= 0)
+    {
+        printf("Invalid schema or schema has no attributes\n");
+        return -1;
+    }
+
+    int totalSize = 0;
+
+    // Calculate the total size of the record based on the schema
+    for (int i = 0; i < customSchema->numAttr; i++)
+    {
+        switch (customSchema->dataTypes[i])
+        {
+        case DT_INT:
+            totalSize += sizeof(int);
+            break;
+        case DT_STRING:
+            totalSize += customSchema->typeLength[i];
+            break;
+        case DT_FLOAT:
+            totalSize += sizeof(float);
+            break;
+        case DT_BOOL:
+            totalSize += sizeof(bool);
+            break;
+        default:
+            printf("Unrecognized data type\n");
+            // Return error if an unidentified data type is found
+            return -1;
+        }
+    }
+
+    // Add 1 for the record's metadata and the null bitmap
+    return totalSize + 1 + NULL_BITMAP_SIZE(customSchema->numAttr);
+}
+
+/* Access path selection */
+
+// Upper bound of top-level conjuncts inspected by the planner
+#define MAX_PLAN_CONJUNCTS 32
+
+/*
+    # collects the conjuncts of the top-level AND-chain of a condition
+*/
+static void collectConjuncts(Expr *cond, Expr **conjuncts, int *count)
+{
+    if (cond->type == EXPR_OP && cond->expr.op->type == OP_BOOL_AND)
+    {
+        collectConjuncts(cond->expr.op->args[0], conjuncts, count);
+        collectConjuncts(cond->expr.op->args[1], conjuncts, count);
+    }
+    else if (*count < MAX_PLAN_CONJUNCTS)
+        conjuncts[(*count)++] = cond;
+}
+
+/*
+    # checks whether a normalized conjunct is "attr op constant" on an indexed attribute
+    # and returns the inclusive key range it restricts the attribute to; a NULL bound is open
+    # strict bounds are widened to inclusive ones, the full condition is still evaluated per record
+    # hash indexes only serve equality
+*/
+static bool indexablePredicate(RM_TableData *rel, Expr *conjunct, int *attrNum, Value **low, Value **high,
+                               IndexKind *kind)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+
+    if (conjunct->type != EXPR_OP)
+        return false;
+
+    Operator *op = conjunct->expr.op;
+    if (op->numArgs < 2 || op->args[0]->type != EXPR_ATTRREF)
+        return false;
+    for (int i = 1; i < op->numArgs; i++)
+    {
+        if (op->args[i]->type != EXPR_CONST || op->args[i]->expr.cons->isNull ||
+            op->args[i]->expr.cons->dt != rel->schema->dataTypes[op->args[0]->expr.attrRef])
+            return false;
+    }
+
+    *attrNum = op->args[0]->expr.attrRef;
+    int pos = findTableIndex(rMgr, *attrNum);
+    if (pos < 0)
+        return false;
+    *kind = rMgr->indexKinds[pos];
+    if (*kind == INDEX_HASH && op->type != OP_COMP_EQUAL)
+        return false;
+
+    *low = *high = NULL;
+    switch (op->type)
+    {
+    case OP_COMP_EQUAL:
+        *low = *high = op->args[1]->expr.cons;
+        return true;
+    case OP_COMP_SMALLER:
+    case OP_COMP_SMALLER_EQUAL:
+        *high = op->args[1]->expr.cons;
+        return true;
+    case OP_COMP_GREATER:
+    case OP_COMP_GREATER_EQUAL:
+        *low = op->args[1]->expr.cons;
+        return true;
+    case OP_COMP_BETWEEN:
+        *low = op->args[1]->expr.cons;
+        *high = op->args[2]->expr.cons;
+        return true;
+    default:
+        return false;
+    }
+}
+
+/*
+    # true if the conjuncts pin every primary key attribute to a constant
+*/
+static bool pinsPrimaryKey(RM_TableData *rel, Expr **conjuncts, int count)
+{
+    Schema *schema = rel->schema;
+
+    if (schema->keySize <= 0)
+        return false;
+
+    for (int k = 0; k < schema->keySize; k++)
+    {
+        bool pinned = false;
+        for (int i = 0; i < count && !pinned; i++)
+        {
+            Operator *op = conjuncts[i]->type == EXPR_OP ? conjuncts[i]->expr.op : NULL;
+            pinned = op != NULL && op->type == OP_COMP_EQUAL &&
+                     op->args[0]->type == EXPR_ATTRREF && op->args[0]->expr.attrRef == schema->keyAttrs[k] &&
+                     op->args[1]->type == EXPR_CONST && !op->args[1]->expr.cons->isNull;
+        }
+        if (!pinned)
+            return false;
+    }
+    return true;
+}
+
+/*
+    # chooses the access path of a scan from its normalized condition
+    # key lookup when the condition pins the primary key, otherwise an index range scan
+    # on the most restrictive indexed predicate (equality, then closed range, then open range),
+    # otherwise a sequential scan
+*/
+static void planScan(RM_TableData *rel, ScanMgr *sm)
+{
+    Expr *conjuncts[MAX_PLAN_CONJUNCTS];
+    int count = 0, bestRank = -1;
+
+    sm->accessPath = SCAN_SEQUENTIAL;
+    collectConjuncts(sm->condition, conjuncts, &count);
+
+    for (int i = 0; i < count; i++)
+    {
+        int attrNum, rank;
+        Value *low, *high;
+        IndexKind kind;
+
+        if (!indexablePredicate(rel, conjuncts[i], &attrNum, &low, &high, &kind))
+            continue;
+
+        if (low != NULL && low == high)
+            rank = 2;
+        else if (low != NULL && high != NULL)
+            rank = 1;
+        else
+            rank = 0;
+        if (rank == 2 && rel->schema->keySize > 0 && attrNum == rel->schema->keyAttrs[0] &&
+            pinsPrimaryKey(rel, conjuncts, count))
+            rank = 3;
+
+        if (rank > bestRank)
+        {
+            bestRank = rank;
+            if (rank == 3)
+                sm->accessPath = SCAN_KEY_LOOKUP;
+            else
+                sm->accessPath = (kind == INDEX_HASH) ? SCAN_HASH_LOOKUP : SCAN_INDEX_RANGE;
+            sm->pathAttr = attrNum;
+            sm->pathLow = low;
+            sm->pathHigh = high;
+        }
+    }
+}
+
+/*
+    # An equality "attr = constant" of a condition on a dictionary encoded attribute, rewritten to
+    # a compare of the codes in the stored records that rules records out before anything is decoded;
+    # code is that of the constant, -1 while the dictionary does not have it, which no record matches
+*/
+typedef struct CodeFilter
+{
+    int attrNum;
+    Value *constant;
+    int code;
+    int numCodes; // size of the dictionary when the constant was last looked up
+} CodeFilter;
+
+/*
+    # finds the conjuncts of a normalized condition that can be checked on dictionary codes and
+    # returns how many went to filters, which has room for MAX_PLAN_CONJUNCTS
+*/
+static int planCodeFilters(RM_TableData *rel, Expr *cond, CodeFilter *filters)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    Expr *conjuncts[MAX_PLAN_CONJUNCTS];
+    int count = 0, numFilters = 0;
+
+    if (rMgr->dictionaries == NULL)
+        return 0;
+    collectConjuncts(cond, conjuncts, &count);
+    for (int i = 0; i < count; i++)
+    {
+        Operator *op = conjuncts[i]->type == EXPR_OP ? conjuncts[i]->expr.op : NULL;
+        if (op == NULL || op->type != OP_COMP_EQUAL || op->args[0]->type != EXPR_ATTRREF ||
+            op->args[1]->type != EXPR_CONST)
+            continue;
+
+        Value *constant = op->args[1]->expr.cons;
+        int attrNum = op->args[0]->expr.attrRef;
+        if (attrDictionary(rMgr, attrNum) == NULL || constant->isNull || constant->dt != DT_STRING)
+            continue;
+        filters[numFilters].attrNum = attrNum;
+        filters[numFilters].constant = constant;
+        filters[numFilters].code = -1;
+        filters[numFilters].numCodes = -1;
+        numFilters++;
+    }
+    return numFilters;
+}
+
+/*
+    # looks the constants of code filters up again that were not in their dictionaries the last time,
+    # if the dictionaries grew since: a scan in a transaction sees the values the transaction adds
+    # called with the latch of the table held
+*/
+static void refreshCodeFilters(RecordMgr *rMgr, CodeFilter *filters, int numFilters)
+{
+    for (int i = 0; i < numFilters; i++)
+    {
+        Dictionary *dict = rMgr->dictionaries[filters[i].attrNum];
+        if (filters[i].code >= 0 || filters[i].numCodes == dict->numCodes)
+            continue;
+        char *value = filters[i].constant->v.stringV;
+        filters[i].code = dictionaryCode(dict, value, strlen(value));
+        filters[i].numCodes = dict->numCodes;
+    }
+}
+
+/*
+    # true if the version in slot of a data page is the one snapshot sees and the code filters rule
+    # it out; older versions in the version store are left to the condition
+*/
+static bool slotFilteredOut(RM_TableData *rel, char *page, int slot, Snapshot *snapshot, CodeFilter *filters,
+                            int numFilters)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    int code;
+
+    if (!slotIsLive(page, slot) || !versionVisible(snapshot, slotXmin(page, slot), slotXmax(page, slot)))
+        return false;
+    for (int i = 0; i < numFilters; i++)
+    {
+        // A NULL equals nothing
+        if (!slotCode(rMgr, rel->schema, page, slot, filters[i].attrNum, &code) || code != filters[i].code)
+            return true;
+    }
+    return false;
+}
+
+/*
+    # replaces "attr IS NULL" on attributes declared NOT NULL by FALSE, so that
+    # normalization can simplify the condition and no record is tested for it;
+    # only valid for the schema it was folded for, so scans fold their own copy
+*/
+static void foldNotNullChecks(Expr *expr, Schema *schema)
+{
+    if (expr->type != EXPR_OP)
+        return;
+
+    Operator *op = expr->expr.op;
+    if (op->type == OP_IS_NULL && op->args[0]->type == EXPR_ATTRREF &&
+        declaredNotNull(schema, op->args[0]->expr.attrRef))
+    {
+        freeExpr(op->args[0]);
+        free(op->args);
+        free(op);
+        expr->type = EXPR_CONST;
+        MAKE_VALUE(expr->expr.cons, DT_BOOL, FALSE);
+        return;
+    }
+    for (int i = 0; i < op->numArgs; i++)
+        foldNotNullChecks(op->args[i], schema);
+}
+
+/*
+    # evaluates a condition on a record
+*/
+static RC conditionMatches(Record *rec, Schema *schema, Expr *condition, bool *match)
+{
+    Value *result;
+    RC status;
+
+    if ((status = evalExpr(rec, schema, condition, &result)) != RC_OK)
+        return status;
+    // Only TRUE matches, a condition that is unknown (NULL) for the record does not
+    *match = !result->isNull && result->v.boolV;
+    freeVal(result);
+    return RC_OK;
+}
+
+/*
+    # evaluates the condition of a scan on a record, adaptively if setScanAdaptive switched it on
+*/
+static RC evalScanCondition(ScanMgr *sm, Record *rec, Schema *schema, bool *match)
+{
+    // Adaptive evaluation keeps its own ordering of the conjuncts
+    if (sm->conjunction != NULL)
+        return evalConjunction(rec, schema, sm->conjunction, match);
+    return conditionMatches(rec, schema, sm->condition, match);
+}
+
+/*
+    # returns the next candidate RID of an index scan
+*/
+static RC nextIndexRid(ScanMgr *sm, RID *rid)
+{
+    if (sm->accessPath != SCAN_HASH_LOOKUP)
+        return nextEntry(sm->treeScan, rid);
+
+    if (sm->hashPos >= sm->numHashRids)
+        return RC_IM_NO_MORE_ENTRIES;
+    *rid = sm->hashRids[sm->hashPos++];
+    return RC_OK;
+}
+
+/*
+    # returns the next record of an index scan that satisfies the condition
+*/
+static RC nextFromIndex(RM_ScanHandle *scan, Record *rec)
+{
+    ScanMgr *sm = scan->mgmtData;
+    RecordMgr *rMgr = scan->rel->mgmtData;
+    RC status = RC_IM_NO_MORE_ENTRIES;
+    bool match;
+    RID rid;
+
+    pthread_rwlock_rdlock(&rMgr->latch);
+    while (!sm->lookupDone && (status = nextIndexRid(sm, &rid)) == RC_OK)
+    {
+        // The index holds the latest versions, a record the snapshot does not see is passed over
+        if ((status = readRecord(scan->rel, rid, sm->snapshot, rec)) == RC_RM_NO_MORE_TUPLES)
+            continue;
+        if (status != RC_OK || (status = evalScanCondition(sm, rec, scan->rel->schema, &match)) != RC_OK)
+        {
+            pthread_rwlock_unlock(&rMgr->latch);
+            currState.SCN_resp = SCAN_FAIL;
+            currState.recordUpdatedAt = time(NULL);
+            return status;
+        }
+
+        if (match)
+        {
+            // A primary key matches at most one record
+            sm->lookupDone = (sm->accessPath == SCAN_KEY_LOOKUP);
+            pthread_rwlock_unlock(&rMgr->latch);
+            currState.SCN_resp = SCAN_SUCCESS;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_OK;
+        }
+    }
+    pthread_rwlock_unlock(&rMgr->latch);
+
+    if (status != RC_OK && status != RC_IM_NO_MORE_ENTRIES)
+        return status;
+    return RC_RM_NO_MORE_TUPLES;
+}
+
+/*
+    # advances the cursor of a sequential scan to the next record its snapshot sees and copies that
+    # version into record; the page under the cursor stays pinned between calls and is unpinned when
+    # the cursor leaves it, the latch of the table only for the call; the scan ends at the last page
+    # the file has when the cursor gets there
+*/
+static RC nextFromCursor(RM_TableData *rel, ScanMgr *sm, Record *record)
+{
+    RecordMgr *rMgr = rel->mgmtData;
+    RC status = RC_RM_NO_MORE_TUPLES;
+
+    pthread_rwlock_rdlock(&rMgr->latch);
+    refreshCodeFilters(rMgr, sm->codeFilters, sm->numCodeFilters);
+    sm->r_id.slot++;
+    while (status == RC_RM_NO_MORE_TUPLES)
+    {
+        if (!sm->pinned)
+        {
+            if (sm->r_id.page >= getNumFilePages(&rMgr->bp))
+                break;
+            if ((status = pinPage(&rMgr->bp, &sm->pageHandle, sm->r_id.page)) != RC_OK)
+                break;
+            sm->pinned = true;
+            status = RC_RM_NO_MORE_TUPLES;
+        }
+
+        // Overflow and free pages have no slots
+        char *data = sm->pageHandle.data;
+        int numSlots = hasSlots(data) ? pageGet(data, PAGE_NUM_SLOTS) : 0;
+        for (; sm->r_id.slot < numSlots; sm->r_id.slot++)
+        {
+            if (sm->numCodeFilters > 0 &&
+                slotFilteredOut(rel, data, sm->r_id.slot, sm->snapshot, sm->codeFilters, sm->numCodeFilters))
+                continue;
+            status = readVersion(rel, data, sm->r_id, sm->snapshot, sm->neededAttrs, record->data);
+            if (status != RC_RM_NO_MORE_TUPLES)
+            {
+                record->id = sm->r_id;
+                break;
+            }
+        }
+        if (status != RC_RM_NO_MORE_TUPLES)
+            break;
+
+        unpinPage(&rMgr->bp, &sm->pageHandle);
+        sm->pinned = false;
+        sm->r_id.page++;
+        sm->r_id.slot = 0;
+    }
+    pthread_rwlock_unlock(&rMgr->latch);
+    return status;
+}
+
+/*
+    # marks the attributes an expression refers to
+*/
+static void markExprAttrs(Expr *expr, bool *marked)
+{
+    if (expr->type == EXPR_ATTRREF)
+        marked[expr->expr.attrRef] = true;
+    else if (expr->type == EXPR_OP)
+        for (int i = 0; i < expr->expr.op->numArgs; i++)
+            markExprAttrs(expr->expr.op->args[i], marked);
+}
+
+/*
+    # builds the schema of the records a projected scan returns,
+    # the projected attributes keep their names, types and NOT NULL constraints
+*/
+static Schema *projectionSchema(Schema *schema, int numAttrs, int *attrs)
+{
+    Schema *proj = (Schema *)malloc(sizeof(Schema));
+
+    proj->numAttr = numAttrs;
+    proj->attrNames = (char **)malloc(numAttrs * sizeof(char *));
+    proj->dataTypes = (DataType *)malloc(numAttrs * sizeof(DataType));
+    proj->typeLength = (int *)malloc(numAttrs * sizeof(int));
+    proj->notNull = (bool *)calloc(numAttrs, sizeof(bool));
+    proj->keySize = 0;
+    proj->keyAttrs = NULL;
+    for (int j = 0; j < numAttrs; j++)
+    {
+        proj->attrNames[j] = strdup(schema->attrNames[attrs[j]]);
+        proj->dataTypes[j] = schema->dataTypes[attrs[j]];
+        proj->typeLength[j] = schema->typeLength[attrs[j]];
+        proj->notNull[j] = declaredNotNull(schema, attrs[j]);
+    }
+    return proj;
+}
+
+/*
+    # copies the projected attributes and their null bits from a full-width record
+    # into a record laid out by the projection schema of the scan
+*/
+static void projectRecord(Schema *schema, ScanMgr *sm, Record *full, Record *rec)
+{
+    char *fullNulls = nullBitmap(schema, full->data);
+    char *nulls = nullBitmap(sm->projSchema, rec->data);
+    int from, to;
+
+    for (int j = 0; j < sm->numProjAttrs; j++)
+    {
+        int attr = sm->projAttrs[j];
+        int size = schema->dataTypes[attr] == DT_STRING ? schema->typeLength[attr] : fixedAttrSize(schema->dataTypes[attr]);
+
+        attrOffset(schema, attr, &from);
+        attrOffset(sm->projSchema, j, &to);
+        memcpy(rec->data + to, full->data + from, size);
+        setNullBit(nulls, j, isNullBit(fullNulls, attr));
+    }
+    rec->id = full->id;
+}
+
+/*
+    # the function is used to initialize the scan manager
+    # and all its attributes
+*/
+RC startScan(RM_TableData *r, RM_ScanHandle *s_handle, Expr *condition)
+{
+    if (condition == NULL)
+    {
+        currState.TM_resp = SCAN_FAIL;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_SCAN_CONDITION_NOT_FOUND;
+    }
+
+    if (r == NULL || r->mgmtData == NULL)
+    {
+        currState.TM_resp = SCAN_FAIL;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    ScanMgr *sm = (ScanMgr *)calloc(1, sizeof(ScanMgr));
+    if (sm == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    // The scan sees the table as it is now until it is closed
+    if ((sm->snapshot = (Snapshot *)malloc(sizeof(Snapshot))) == NULL || openSnapshot(sm->snapshot) != RC_OK)
+    {
+        free(sm->snapshot);
+        free(sm);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    s_handle->mgmtData = sm;
+    sm->r_id.page = 1;
+    sm->r_id.slot = -1;
+    sm->pinned = false;
+
+    // Rewrite the condition into its cheapest equivalent form before evaluating it per tuple, on a
+    // copy owned by the scan: the caller's condition is left as it is and may be shared
+    if (copyExpr(condition, &sm->condition) != RC_OK)
+    {
+        closeSnapshot(sm->snapshot);
+        free(sm->snapshot);
+        free(sm);
+        s_handle->mgmtData = NULL;
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+    foldNotNullChecks(sm->condition, r->schema);
+    normalizeExpr(sm->condition);
+
+    // Use an index when the condition restricts an indexed attribute
+    planScan(r, sm);
+    if (sm->accessPath == SCAN_HASH_LOOKUP)
+    {
+        // The RIDs under the key are collected up front, an absent key leaves the list empty
+        HashHandle *hash = NULL;
+        RC status = RC_ERROR;
+        if (getTableHashIndex(r, sm->pathAttr, &hash) == RC_OK)
+            status = hashLookup(hash, sm->pathLow, &sm->hashRids, &sm->numHashRids);
+        if (status != RC_OK && status != RC_IM_KEY_NOT_FOUND)
+            sm->accessPath = SCAN_SEQUENTIAL;
+    }
+    else if (sm->accessPath != SCAN_SEQUENTIAL)
+    {
+        BTreeHandle *tree = NULL;
+        if (getTableIndex(r, sm->pathAttr, &tree) != RC_OK ||
+            openTreeRangeScan(tree, sm->pathLow, sm->pathHigh, &sm->treeScan) != RC_OK)
+            sm->accessPath = SCAN_SEQUENTIAL;
+    }
+
+    // A sequential scan checks equalities on dictionary encoded attributes on the stored codes
+    RecordMgr *rMgr = r->mgmtData;
+    if (sm->accessPath == SCAN_SEQUENTIAL && rMgr->dictionaries != NULL &&
+        (sm->codeFilters = (CodeFilter *)malloc(MAX_PLAN_CONJUNCTS * sizeof(CodeFilter))) != NULL)
+        sm->numCodeFilters = planCodeFilters(r, sm->condition, sm->codeFilters);
+
+    s_handle->rel = r;
+
+    currState.SCN_resp = SCAN_FAIL;
+    currState.recordUpdatedAt = time(NULL);
+    return RC_OK;
+}
+
+/*
+    # starts a scan that returns only the attributes attrs[0..numAttrs-1], in that order,
+    # as records laid out by the schema getScanSchema returns; a sequential scan decodes
+    # only these and the attributes the condition refers to from each stored record
+*/
+RC startProjectedScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int numAttrs, int *attrs)
+{
+    RC status;
+
+    if (rel == NULL || rel->schema == NULL || numAttrs <= 0 || attrs == NULL)
+        return RC_NULL_ARGUMENT;
+    for (int j = 0; j < numAttrs; j++)
+    {
+        if (attrs[j] < 0 || attrs[j] >= rel->schema->numAttr)
+            return RC_ERROR;
+    }
+
+    if ((status = startScan(rel, scan, cond)) != RC_OK)
+        return status;
+
+    ScanMgr *sm = scan->mgmtData;
+    sm->numProjAttrs = numAttrs;
+    sm->projAttrs = (int *)malloc(numAttrs * sizeof(int));
+    memcpy(sm->projAttrs, attrs, numAttrs * sizeof(int));
+    sm->projSchema = projectionSchema(rel->schema, numAttrs, attrs);
+    if ((status = createRecord(&sm->scratch, rel->schema)) != RC_OK)
+    {
+        closeScan(scan);
+        return status;
+    }
+
+    // The condition is normalized by now, so it refers to no attribute it does not need
+    sm->neededAttrs = (bool *)calloc(rel->schema->numAttr, sizeof(bool));
+    for (int j = 0; j < numAttrs; j++)
+        sm->neededAttrs[attrs[j]] = true;
+    markExprAttrs(sm->condition, sm->neededAttrs);
+    return RC_OK;
+}
+
+/*
+    # the schema of the records next returns, the table schema unless the scan is projected;
+    # it belongs to the scan and is freed by closeScan
+*/
+RC getScanSchema(RM_ScanHandle *scan, Schema **schema)
+{
+    if (scan == NULL || scan->mgmtData == NULL || schema == NULL)
+        return RC_NULL_ARGUMENT;
+
+    ScanMgr *sm = scan->mgmtData;
+    *schema = sm->projSchema != NULL ? sm->projSchema : scan->rel->schema;
+    return RC_OK;
+}
+
+/*
+    # returns the next record of a sequential scan that satisfies the condition
+*/
+static RC nextMatch(RM_ScanHandle *scan, Record *rec)
+{
+    ScanMgr *sm = scan->mgmtData;
+    Schema *schema = scan->rel->schema;
+    bool match = FALSE;
+    RC status;
+
+    // Walk the slot directories up to the last page of the file
+    while ((status = nextFromCursor(scan->rel, sm, rec)) == RC_OK)
+    {
+        RC evalStatus = evalScanCondition(sm, rec, schema, &match);
+        if (evalStatus != RC_OK)
+        {
+            currState.SCN_resp = SCAN_FAIL;
+            currState.recordUpdatedAt = time(NULL);
+            return evalStatus;
+        }
+
+        if (match == TRUE)
+        {
+            currState.SCN_resp = SCAN_SUCCESS;
+            currState.recordUpdatedAt = time(NULL);
+            return RC_OK;
+        }
+    }
+
+    if (status != RC_RM_NO_MORE_TUPLES)
+    {
+        currState.SCN_resp = SCAN_FAIL;
+        currState.recordUpdatedAt = time(NULL);
+        return status;
+    }
+
+    // Rewind so that the scan can be run again
+    sm->r_id.page = 1;
+    sm->r_id.slot = -1;
+
+    return RC_RM_NO_MORE_TUPLES;
+}
+
+/*
+    # this funtion evaluates the condition
+    # return the tuples taht staisfy the condition given
+    # if no condition is provided it returns all the tuples
+*/
+RC next(RM_ScanHandle *scan, Record *rec)
+
+{
+    ScanMgr *sm = scan->mgmtData;
+    RC status;
+
+    if (sm->projSchema == NULL)
+        return sm->accessPath != SCAN_SEQUENTIAL ? nextFromIndex(scan, rec) : nextMatch(scan, rec);
+
+    // A projected scan reads each candidate into its scratch record and hands out the projection
+    status = sm->accessPath != SCAN_SEQUENTIAL ? nextFromIndex(scan, sm->scratch) : nextMatch(scan, sm->scratch);
+    if (status == RC_OK)
+        projectRecord(scan->rel->schema, sm, sm->scratch, rec);
+    return status;
+}
+
+/*
+    # switches a scan to adaptive predicate evaluation
+    # the AND-chain of the condition is flattened and its conjuncts are reordered
+    # by observed cost and selectivity while the scan runs
+*/
+RC setScanAdaptive(RM_ScanHandle *scan, bool adaptive)
+{
+    ScanMgr *sm;
+
+    if (scan == NULL || scan->mgmtData == NULL)
+        return RC_NULL_ARGUMENT;
+
+    sm = scan->mgmtData;
+    freeConjunction(sm->conjunction);
+    sm->conjunction = NULL;
+
+    if (adaptive)
+        return buildConjunction(sm->condition, &sm->conjunction);
+    return RC_OK;
+}
+
+/*
+    # describes the access path chosen for a scan, e.g.
+    # "KEY LOOKUP on a = 3", "INDEX RANGE SCAN on b [aaaa, +inf]", "HASH LOOKUP on b = aaaa"
+    # or "SEQUENTIAL SCAN"
+    # the caller frees the returned string
+*/
+RC explainScan(RM_ScanHandle *scan, char **plan)
+{
+    ScanMgr *sm;
+    char *low, *high;
+
+    if (scan == NULL || scan->mgmtData == NULL || plan == NULL)
+        return RC_NULL_ARGUMENT;
+
+    sm = scan->mgmtData;
+    if (sm->accessPath == SCAN_SEQUENTIAL)
+    {
+        *plan = (char *)malloc(strlen("SEQUENTIAL SCAN") + 1);
+        strcpy(*plan, "SEQUENTIAL SCAN");
+        return RC_OK;
+    }
+
+    char *attrName = scan->rel->schema->attrNames[sm->pathAttr];
+    low = sm->pathLow != NULL ? serializeValue(sm->pathLow) : NULL;
+    high = sm->pathHigh != NULL ? serializeValue(sm->pathHigh) : NULL;
+
+    *plan = (char *)malloc(strlen(attrName) + (low ? strlen(low) : 0) + (high ? strlen(high) : 0) + 48);
+    if (sm->accessPath == SCAN_KEY_LOOKUP)
+        sprintf(*plan, "KEY LOOKUP on %s = %s", attrName, low);
+    else if (sm->accessPath == SCAN_HASH_LOOKUP)
+        sprintf(*plan, "HASH LOOKUP on %s = %s", attrName, low);
+    else
+        sprintf(*plan, "INDEX RANGE SCAN on %s [%s, %s]", attrName, low ? low : "-inf", high ? high : "+inf");
+
+    free(low);
+    free(high);
+    return RC_OK;
+}
+
+/*
+    # deallocates all the memory allocated to the scan manager
+*/
+RC closeScan(RM_ScanHandle *scan)
+{
+    ScanMgr *sm = scan->mgmtData;
+    RecordMgr *rMgr = scan->rel->mgmtData;
+
+    // Release the page under the cursor of a scan that was not run to the end
+    if (sm->pinned && unpinPage(&rMgr->bp, &sm->pageHandle) == RC_ERROR)
+    {
+        currState.SCN_resp = SCAN_FAIL;
+        currState.recordUpdatedAt = time(NULL);
+        return RC_ERROR;
+    }
+
+    freeConjunction(sm->conjunction);
+    if (sm->treeScan != NULL)
+        closeTreeScan(sm->treeScan);
+    free(sm->hashRids);
+    free(sm->codeFilters);
+    free(sm->projAttrs);
+    free(sm->neededAttrs);
+    if (sm->projSchema != NULL)
+        freeTableSchema(sm->projSchema);
+    if (sm->scratch != NULL)
+        freeRecord(sm->scratch);
+    freeExpr(sm->condition);
+    closeSnapshot(sm->snapshot);
+    free(sm->snapshot);
+    free(sm);
+    scan->mgmtData = NULL;
+
+    currState.SCN_resp = SCAN_SUCCESS;
+    currState.recordUpdatedAt = time(NULL);
+    return RC_OK;
+}
+
+/* Parallel scans */
+
+// Pages a worker of a parallel scan claims from its range at a time
+#define PARALLEL_SCAN_CHUNK 4
+#define MAX_SCAN_WORKERS 64
+
+/*
+    # The pages one worker of a parallel scan still has to visit, [next, end)
+    # The owner claims chunks from the front, idle workers steal the back half
+*/
+typedef struct PageRange
+{
+    pthread_mutex_t lock;
+    int next;
+    int end;
+} PageRange;
+
+// called by a worker of a parallel scan once for every PAX page, instead of the record callback for
+// the records in the slots of the page the scan sees; selected marks those that satisfy the condition
+typedef RC (*PaxPageCallback)(char *page, bool *selected, int numSlots, int worker, void *context);
+
+typedef struct ParallelScan
+{
+    RM_TableData *rel;
+    Expr *condition;
+    RM_RecordCallback callback;
+    PaxPageCallback pageCallback; // NULL: the records of PAX pages go to callback one by one
+    void *context;
+    bool *neededAttrs; // attributes decoded from each stored record, NULL for all
+    bool *conditionAttrs; // attributes the condition refers to, decoded for the page callback
+    CodeFilter codeFilters[MAX_PLAN_CONJUNCTS]; // equalities of the condition checked on dictionary codes
+    int numCodeFilters;
+    Snapshot snapshot; // taken when the scan started, shared by the workers
+    int numWorkers;
+    PageRange *ranges;
+    pthread_mutex_t lock; // guards status
+    RC status;            // first error or non-OK callback result, stops every worker
+} ParallelScan;
+
+typedef struct ScanWorker
+{
+    ParallelScan *scan;
+    int id;
+    int matches;
+    int pages;
+    int steals;
+} ScanWorker;
+
+static bool parallelScanStopped(ParallelScan *ps)
+{
+    pthread_mutex_lock(&ps->lock);
+    bool stopped = ps->status != RC_OK;
+    pthread_mutex_unlock(&ps->lock);
+    return stopped;
+}
+
+static void stopParallelScan(ParallelScan *ps, RC status)
+{
+    pthread_mutex_lock(&ps->lock);
+    if (ps->status == RC_OK)
+        ps->status = status;
+    pthread_mutex_unlock(&ps->lock);
+}
+
+/*
+    # takes the next chunk of pages from the front of a range, false if it is empty
+*/
+static bool claimPages(PageRange *range, int *first, int *last)
+{
+    pthread_mutex_lock(&range->lock);
+    bool claimed = range->next < range->end;
+    if (claimed)
+    {
+        *first = range->next;
+        *last = range->next + PARALLEL_SCAN_CHUNK < range->end ? range->next + PARALLEL_SCAN_CHUNK : range->end;
+        range->next = *last;
+    }
+    pthread_mutex_unlock(&range->lock);
+    return claimed;
+}
+
+/*
+    # moves the back half of the fullest other range into the empty range of worker id
+    # false once every range is empty, the pages taken are only visible to the thief
+*/
+static bool stealPages(ParallelScan *ps, int id)
+{
+    int victim = -1, most = 0, first, last;
+
+    for (int w = 0; w < ps->numWorkers; w++)
+    {
+        if (w == id)
+            continue;
+        pthread_mutex_lock(&ps->ranges[w].lock);
+        int left = ps->ranges[w].end - ps->ranges[w].next;
+        pthread_mutex_unlock(&ps->ranges[w].lock);
+        if (left > most)
+        {
+            most = left;
+            victim = w;
+        }
+    }
+    if (victim == -1)
+        return false;
+
+    // The victim may have moved on since, take half of what it has now
+    PageRange *range = &ps->ranges[victim];
+    pthread_mutex_lock(&range->lock);
+    last = range->end;
+    first = range->next + (range->end - range->next) / 2;
+    range->end = first;
+    pthread_mutex_unlock(&range->lock);
+
+    pthread_mutex_lock(&ps->ranges[id].lock);
+    ps->ranges[id].next = first;
+    ps->ranges[id].end = last;
+    pthread_mutex_unlock(&ps->ranges[id].lock);
+    return true;
+}
+
+/*
+    # evaluates the condition on every record of a page the snapshot of the scan sees and hands the
+    # matches to the callback, with the latch of the table held for the page
+    # With a page callback the records in the slots of a PAX page are only marked in a selection,
+    # decoding just what the condition needs, and the page goes to the page callback as a whole
+*/
+static RC scanPageParallel(ScanWorker *worker, int pageNum, Record *record)
+{
+    ParallelScan *ps = worker->scan;
+    RecordMgr *rMgr = ps->rel->mgmtData;
+    Schema *schema = ps->rel->schema;
+    BM_PageHandle page;
+    bool selected[PAX_MAX_CAPACITY];
+    bool match = true;
+    RC status;
+
+    pthread_rwlock_rdlock(&rMgr->latch);
+    if ((status = pinPage(&rMgr->bp, &page, pageNum)) != RC_OK)
+    {
+        pthread_rwlock_unlock(&rMgr->latch);
+        return status;
+    }
+
+    int numSlots = hasSlots(page.data) ? pageGet(page.data, PAGE_NUM_SLOTS) : 0;
+    bool columnar = ps->pageCallback != NULL && pageGet(page.data, PAGE_KIND) == PAGE_KIND_PAX;
+    for (int slot = 0; slot < numSlots && status == RC_OK; slot++)
+    {
+        record->id.page = pageNum;
+        record->id.slot = slot;
+        if (ps->numCodeFilters > 0 &&
+            slotFilteredOut(ps->rel, page.data, slot, &ps->snapshot, ps->codeFilters, ps->numCodeFilters))
+        {
+            if (columnar)
+                selected[slot] = false;
+            continue;
+        }
+
+        // Only older versions of the store are handed over one by one
+        if (columnar)
+        {
+            selected[slot] = slotIsLive(page.data, slot) &&
+                             versionVisible(&ps->snapshot, slotXmin(page.data, slot), slotXmax(page.data, slot));
+            if (selected[slot])
+            {
+                if (ps->condition != NULL)
+                {
+                    if ((status = readPaxAttrs(rMgr, schema, page.data, slot, record->data, ps->conditionAttrs)) != RC_OK ||
+                        (status = conditionMatches(record, schema, ps->condition, &selected[slot])) != RC_OK)
+                        break;
+                }
+                if (selected[slot])
+                    worker->matches++;
+                continue;
+            }
+        }
+
+        status = readVersion(ps->rel, page.data, record->id, &ps->snapshot, ps->neededAttrs, record->data);
+        if (status == RC_RM_NO_MORE_TUPLES)
+        {
+            status = RC_OK;
+            continue;
+        }
+        if (status != RC_OK)
+            break;
+        if (ps->condition != NULL && (status = conditionMatches(record, schema, ps->condition, &match)) != RC_OK)
+            break;
+        if (match)
+        {
+            worker->matches++;
+            status = ps->callback(record, worker->id, ps->context);
+        }
+    }
+    if (columnar && status == RC_OK)
+        status = ps->pageCallback(page.data, selected, numSlots, worker->id, ps->context);
+
+    unpinPage(&rMgr->bp, &page);
+    pthread_rwlock_unlock(&rMgr->latch);
+    return status;
+}
+
+static void *scanWorkerMain(void *data)
+{
+    ScanWorker *worker = (ScanWorker *)data;
+    ParallelScan *ps = worker->scan;
+    Record *record;
+    int first, last;
+    RC status = RC_OK;
+
+    if ((status = createRecord(&record, ps->rel->schema)) != RC_OK)
+    {
+        stopParallelScan(ps, status);
+        return NULL;
+    }
+
+    while (!parallelScanStopped(ps))
+    {
+        if (!claimPages(&ps->ranges[worker->id], &first, &last))
+        {
+            if (!stealPages(ps, worker->id))
+                break;
+            worker->steals++;
+            continue;
+        }
+
+        for (int pageNum = first; pageNum < last && status == RC_OK; pageNum++, worker->pages++)
+            status = scanPageParallel(worker, pageNum, record);
+        if (status != RC_OK)
+            stopParallelScan(ps, status);
+    }
+
+    freeRecord(record);
+    return NULL;
+}
+
+/*
+    # runs a parallel scan that decodes only the attributes marked in neededAttrs (all if NULL)
+    # and those the condition refers to; PAX pages go to pageCallback unless it is NULL
+*/
+static RC runParallelScan(RM_TableData *rel, Expr *cond, int numWorkers, RM_RecordCallback callback, void *context,
+                          bool *neededAttrs, PaxPageCallback pageCallback, RM_ParallelScanStats *stats)
+{
+    ParallelScan ps;
+    ScanWorker workers[MAX_SCAN_WORKERS];
+    pthread_t threads[MAX_SCAN_WORKERS];
+    struct timespec start, end;
+    int w, started;
+
+    if (rel == NULL || rel->mgmtData == NULL || callback == NULL)
+        return RC_NULL_ARGUMENT;
+    if (numWorkers < 1)
+        numWorkers = 1;
+    if (numWorkers > MAX_SCAN_WORKERS)
+        numWorkers = MAX_SCAN_WORKERS;
+
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    RecordMgr *rMgr = rel->mgmtData;
+    int numPages = getNumFilePages(&rMgr->bp);
+    if (numPages < 0)
+        return RC_ERROR;
+
+    // A copy of the condition is normalized once, the workers only read it
+    ps.conditionAttrs = NULL;
+    if (cond != NULL)
+    {
+        if (copyExpr(cond, &cond) != RC_OK)
+            return RC_MEM_ALLOCATION_FAIL;
+        foldNotNullChecks(cond, rel->schema);
+        normalizeExpr(cond);
+        if (neededAttrs != NULL)
+            markExprAttrs(cond, neededAttrs);
+        if (pageCallback != NULL && (ps.conditionAttrs = (bool *)calloc(rel->schema->numAttr, sizeof(bool))) == NULL)
+        {
+            freeExpr(cond);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        if (pageCallback != NULL)
+            markExprAttrs(cond, ps.conditionAttrs);
+    }
+
+    if (openSnapshot(&ps.snapshot) != RC_OK)
+    {
+        free(ps.conditionAttrs);
+        if (cond != NULL)
+            freeExpr(cond);
+        return RC_MEM_ALLOCATION_FAIL;
+    }
+
+    // The codes are looked up once, the calling thread adds no values while the scan runs
+    ps.numCodeFilters = cond != NULL ? planCodeFilters(rel, cond, ps.codeFilters) : 0;
+    pthread_rwlock_rdlock(&rMgr->latch);
+    refreshCodeFilters(rMgr, ps.codeFilters, ps.numCodeFilters);
+    pthread_rwlock_unlock(&rMgr->latch);
+    ps.rel = rel;
+    ps.condition = cond;
+    ps.callback = callback;
+    ps.pageCallback = pageCallback;
+    ps.context = context;
+    ps.neededAttrs = neededAttrs;
+    ps.numWorkers = numWorkers;
+    ps.status = RC_OK;
+    pthread_mutex_init(&ps.lock, NULL);
+    ps.ranges = (PageRange *)malloc(numWorkers * sizeof(PageRange));
+
+    // Page 0 is the table header
+    for (w = 0; w < numWorkers; w++)
+    {
+        pthread_mutex_init(&ps.ranges[w].lock, NULL);
+        ps.ranges[w].next = 1 + (int)((long)(numPages - 1) * w / numWorkers);
+        ps.ranges[w].end = 1 + (int)((long)(numPages - 1) * (w + 1) / numWorkers);
+        workers[w].scan = &ps;
+        workers[w].id = w;
+        workers[w].matches = 0;
+        workers[w].pages = 0;
+        workers[w].steals = 0;
+    }
+
+    // Worker 0 runs on the calling thread, it steals the pages of workers that could not be started
+    for (started = 1; started < numWorkers; started++)
+    {
+        if (pthread_create(&threads[started], NULL, scanWorkerMain, &workers[started]) != 0)
+            break;
+    }
+    scanWorkerMain(&workers[0]);
+    for (w = 1; w < started; w++)
+        pthread_join(threads[w], NULL);
+
+    if (stats != NULL)
+    {
+        memset(stats, 0, sizeof(RM_ParallelScanStats));
+        stats->numWorkers = numWorkers;
+        for (w = 0; w < numWorkers; w++)
+        {
+            stats->numMatches += workers[w].matches;
+            stats->pagesScanned += workers[w].pages;
+            stats->steals += workers[w].steals;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &end);
+        stats->elapsedMs = (end.tv_sec - start.tv_sec) * 1000.0 + (end.tv_nsec - start.tv_nsec) / 1000000.0;
+    }
+
+    for (w = 0; w < numWorkers; w++)
+        pthread_mutex_destroy(&ps.ranges[w].lock);
+    free(ps.ranges);
+    pthread_mutex_destroy(&ps.lock);
+    closeSnapshot(&ps.snapshot);
+    free(ps.conditionAttrs);
+    if (cond != NULL)
+        freeExpr(cond);
+    return ps.status;
+}
+
+/*
+    # scans rel with numWorkers threads and calls callback for every record that satisfies cond
+    # (every record if cond is NULL), from the worker thread that found it
+    # The pages of the table are split into one range per worker; a worker that runs out of
+    # pages steals the back half of the fullest range left, so slow pages do not stall the scan
+    # The record passed to the callback is reused for the next match of that worker, the callback
+    # copies what it keeps and returns RC_OK to go on; any other code stops the scan and is returned
+    # The scan sees the table as it was when it started, other threads may change it meanwhile;
+    # the callback runs with the latch of the table held and must not change the table
+*/
+RC parallelScan(RM_TableData *rel, Expr *cond, int numWorkers, RM_RecordCallback callback, void *context,
+                RM_ParallelScanStats *stats)
+{
+    return runParallelScan(rel, cond, numWorkers, callback, context, NULL, NULL, stats);
+}
 
-    // Move the page handle forward again
-    pageHandle = pageHandle + sizeof(int);
+/* Aggregates */
 
-    // Retrieve the attribute count from the page
-    int attrCount = *(int *)pageHandle;
+#define AGG_INITIAL_BUCKETS 64
 
-    pageHandle += sizeof(int);
+/*
+    # The running state of one aggregate within one group
+*/
+typedef struct AggAccum
+{
+    long count; // rows for COUNT(*), non-NULL values otherwise
+    long intSum;
+    double floatSum;
+    char *extreme; // MIN or MAX so far, valid once count > 0
+} AggAccum;
 
-    initialTableData += attrCount;
+typedef struct AggGroup
+{
+    unsigned int hash;
+    bool keyNull;
+    char *key; // bytes of the grouping attribute as laid out in a record image
+    AggAccum *accums;
+    struct AggGroup *next;
+} AggGroup;
+
+// The groups one worker has seen, chained on the hash of the grouping attribute
+typedef struct AggTable
+{
+    AggGroup **buckets;
+    int numBuckets;
+    int numGroups;
+} AggTable;
 
-    // Allocate memory for the schema structure
-    Schema *schema = (Schema *)calloc(1, sizeof(Schema));
+typedef struct AggScan
+{
+    Schema *schema;
+    int groupAttr; // -1 without GROUP BY
+    int groupOffset;
+    int groupSize;
+    int numAggs;
+    RM_Aggregate *aggs;
+    int *offsets; // record image offset of each aggregated attribute
+    int *sizes;
+    PaxLayout *pax; // minipages of the PAX pages of the table, NULL for slotted pages
+    Dictionary **dictionaries; // of the table, for the codes in the minipages of encoded attributes
+    AggTable *tables; // one per worker, each only touched by its worker
+} AggScan;
+
+static unsigned int hashKeyBytes(char *key, int size, bool keyNull)
+{
+    // FNV-1a
+    unsigned int hash = 2166136261u;
+    if (keyNull)
+        return hash;
+    for (int i = 0; i < size; i++)
+        hash = (hash ^ (unsigned char)key[i]) * 16777619u;
+    return hash;
+}
 
-    // Set the number of attributes in the schema
-    schema->numAttr = attrCount;
+/*
+    # orders two attribute values as stored in record images, strings are zero padded
+*/
+static int compareAttrBytes(DataType dataType, int size, char *left, char *right)
+{
+    switch (dataType)
+    {
+    case DT_INT:
+    {
+        int l, r;
+        memcpy(&l, left, sizeof(int));
+        memcpy(&r, right, sizeof(int));
+        return (l > r) - (l < r);
+    }
+    case DT_FLOAT:
+    {
+        float l, r;
+        memcpy(&l, left, sizeof(float));
+        memcpy(&r, right, sizeof(float));
+        return (l > r) - (l < r);
+    }
+    case DT_BOOL:
+    {
+        bool l, r;
+        memcpy(&l, left, sizeof(bool));
+        memcpy(&r, right, sizeof(bool));
+        return (int)l - (int)r;
+    }
+    default:
+        return strncmp(left, right, size);
+    }
+}
 
-    // Allocate memory for attribute names by initializing it to zero
-    schema->attrNames = (char **)calloc(attrCount, sizeof(char *));
+/*
+    # the group of a key in a worker table, created with empty accumulators when it is new
+*/
+static AggGroup *findAggGroup(AggScan *as, AggTable *table, char *key, bool keyNull, unsigned int hash)
+{
+    AggGroup *group;
 
-    // Allocate memory for data types by initializing it to zero
-    schema->dataTypes = (DataType *)calloc(attrCount, sizeof(DataType));
+    for (group = table->buckets[hash % table->numBuckets]; group != NULL; group = group->next)
+    {
+        if (group->hash == hash && group->keyNull == keyNull &&
+            (keyNull || as->groupAttr < 0 || memcmp(group->key, key, as->groupSize) == 0))
+            return group;
+    }
 
-    // Allocate memory for type lengths by initializing it to zero
-    schema->typeLength = (int *)calloc(attrCount, sizeof(int));
+    // Keep the chains short, rehash into twice the buckets once there are as many groups as buckets
+    if (table->numGroups >= table->numBuckets)
+    {
+        int numBuckets = table->numBuckets * 2;
+        AggGroup **buckets = (AggGroup **)calloc(numBuckets, sizeof(AggGroup *));
+        for (int b = 0; b < table->numBuckets; b++)
+        {
+            while ((group = table->buckets[b]) != NULL)
+            {
+                table->buckets[b] = group->next;
+                group->next = buckets[group->hash % numBuckets];
+                buckets[group->hash % numBuckets] = group;
+            }
+        }
+        free(table->buckets);
+        table->buckets = buckets;
+        table->numBuckets = numBuckets;
+    }
 
-    int i = 0;
-    while (i < attrCount)
+    group = (AggGroup *)calloc(1, sizeof(AggGroup));
+    group->hash = hash;
+    group->keyNull = keyNull;
+    if (as->groupAttr >= 0)
     {
-        // Allocate the memory for attribute names
-        schema->attrNames[i] = (char *)malloc(SIZE_OF_ATTRIBUTE);
+        // A NULL key of a dictionary encoded attribute has no bytes to copy
+        group->key = (char *)calloc(1, as->groupSize);
+        if (!keyNull)
+            memcpy(group->key, key, as->groupSize);
+    }
+    group->accums = (AggAccum *)calloc(as->numAggs, sizeof(AggAccum));
+    for (int a = 0; a < as->numAggs; a++)
+    {
+        if (as->aggs[a].func == AGG_MIN || as->aggs[a].func == AGG_MAX)
+            group->accums[a].extreme = (char *)malloc(as->sizes[a]);
+    }
+    group->next = table->buckets[hash % table->numBuckets];
+    table->buckets[hash % table->numBuckets] = group;
+    table->numGroups++;
+    return group;
+}
 
-        // Copy attribute name from pageHandle
-        strncpy(schema->attrNames[i], pageHandle, SIZE_OF_ATTRIBUTE);
+/*
+    # folds one value of an aggregated attribute into an accumulator
+*/
+static void accumulate(AggScan *as, int a, AggAccum *accum, char *value)
+{
+    DataType dataType = as->aggs[a].attrNum >= 0 ? as->schema->dataTypes[as->aggs[a].attrNum] : DT_INT;
+
+    switch (as->aggs[a].func)
+    {
+    case AGG_SUM:
+    case AGG_AVG:
+        if (dataType == DT_INT)
+        {
+            int v;
+            memcpy(&v, value, sizeof(int));
+            accum->intSum += v;
+        }
+        else
+        {
+            float v;
+            memcpy(&v, value, sizeof(float));
+            accum->floatSum += v;
+        }
+        break;
+    case AGG_MIN:
+    case AGG_MAX:
+    {
+        int order = accum->count == 0 ? 0 : compareAttrBytes(dataType, as->sizes[a], value, accum->extreme);
+        if (accum->count == 0 || (as->aggs[a].func == AGG_MIN ? order < 0 : order > 0))
+            memcpy(accum->extreme, value, as->sizes[a]);
+        break;
+    }
+    default:
+        break;
+    }
+    accum->count++;
+}
+
+/*
+    # parallel scan callback, adds a matching record to the group table of its worker
+    # the values are read straight from the attribute offsets of the record image
+*/
+static RC aggregateRecord(Record *record, int worker, void *context)
+{
+    AggScan *as = (AggScan *)context;
+    char *nulls = nullBitmap(as->schema, record->data);
+    char *key = NULL;
+    bool keyNull = false;
+
+    if (as->groupAttr >= 0)
+    {
+        key = record->data + as->groupOffset;
+        keyNull = !declaredNotNull(as->schema, as->groupAttr) && isNullBit(nulls, as->groupAttr);
+    }
+    AggGroup *group = findAggGroup(as, &as->tables[worker], key, keyNull, hashKeyBytes(key, as->groupSize, keyNull));
+
+    for (int a = 0; a < as->numAggs; a++)
+    {
+        int attr = as->aggs[a].attrNum;
+        // COUNT(*) counts rows, everything else skips NULLs
+        if (attr < 0)
+            group->accums[a].count++;
+        else if (declaredNotNull(as->schema, attr) || !isNullBit(nulls, attr))
+            accumulate(as, a, &group->accums[a], record->data + as->offsets[a]);
+    }
+    return RC_OK;
+}
+
+/*
+    # the value in slot of the minipage of attribute attr as laid out in a record image, the
+    # codes of a dictionary encoded attribute are decoded; NULL for a code the dictionary does not have
+*/
+static char *paxValue(AggScan *as, char *page, int attr, int slot)
+{
+    char *value = page + as->pax->values[attr] + slot * as->pax->widths[attr];
+    Dictionary *dict = as->dictionaries != NULL ? as->dictionaries[attr] : NULL;
+    int code;
+
+    if (dict == NULL)
+        return value;
+    memcpy(&code, value, sizeof(int));
+    return dictionaryValue(dict, code);
+}
+
+/*
+    # parallel scan page callback, adds the selected records of a PAX page to the group table of
+    # its worker; the values are read straight from the minipages, without grouping in one pass
+    # over a minipage per aggregate
+*/
+static RC aggregatePaxPage(char *page, bool *selected, int numSlots, int worker, void *context)
+{
+    AggScan *as = (AggScan *)context;
+    PaxLayout *pax = as->pax;
+    AggTable *table = &as->tables[worker];
+    char *value;
+    int slot;
+
+    if (as->groupAttr >= 0)
+    {
+        char *keyNulls = page + pax->nulls[as->groupAttr];
+        for (slot = 0; slot < numSlots; slot++)
+        {
+            if (!selected[slot])
+                continue;
+            bool keyNull = isNullBit(keyNulls, slot);
+            char *key = keyNull ? NULL : paxValue(as, page, as->groupAttr, slot);
+            if (!keyNull && key == NULL)
+                return RC_ERROR;
+            AggGroup *group = findAggGroup(as, table, key, keyNull, hashKeyBytes(key, as->groupSize, keyNull));
+            for (int a = 0; a < as->numAggs; a++)
+            {
+                int attr = as->aggs[a].attrNum;
+                if (attr < 0)
+                    group->accums[a].count++;
+                else if (isNullBit(page + pax->nulls[attr], slot))
+                    continue;
+                else if ((value = paxValue(as, page, attr, slot)) == NULL)
+                    return RC_ERROR;
+                else
+                    accumulate(as, a, &group->accums[a], value);
+            }
+        }
+        return RC_OK;
+    }
+
+    AggGroup *group = findAggGroup(as, table, NULL, false, hashKeyBytes(NULL, 0, false));
+    for (int a = 0; a < as->numAggs; a++)
+    {
+        AggAccum *accum = &group->accums[a];
+        int attr = as->aggs[a].attrNum;
+        if (attr < 0)
+        {
+            for (slot = 0; slot < numSlots; slot++)
+                accum->count += selected[slot];
+            continue;
+        }
+
+        char *values = page + pax->values[attr], *nulls = page + pax->nulls[attr];
+        AggFunction func = as->aggs[a].func;
+        if ((func == AGG_SUM || func == AGG_AVG) && as->schema->dataTypes[attr] == DT_INT)
+        {
+            // Sums of ints, the most common aggregate, without a call per value
+            long sum = 0, count = 0;
+            for (slot = 0; slot < numSlots; slot++)
+            {
+                if (!selected[slot] || isNullBit(nulls, slot))
+                    continue;
+                int v;
+                memcpy(&v, values + slot * sizeof(int), sizeof(int));
+                sum += v;
+                count++;
+            }
+            accum->intSum += sum;
+            accum->count += count;
+            continue;
+        }
+        for (slot = 0; slot < numSlots; slot++)
+        {
+            if (!selected[slot] || isNullBit(nulls, slot))
+                continue;
+            if ((value = paxValue(as, page, attr, slot)) == NULL)
+                return RC_ERROR;
+            accumulate(as, a, accum, value);
+        }
+    }
+    return RC_OK;
+}
+
+/*
+    # folds the accumulators of a group of another worker into the same group of the first table
+*/
+static void mergeAggGroup(AggScan *as, AggGroup *into, AggGroup *from)
+{
+    for (int a = 0; a < as->numAggs; a++)
+    {
+        AggAccum *dst = &into->accums[a], *src = &from->accums[a];
+        if (src->count == 0)
+            continue;
+        if (dst->extreme != NULL)
+        {
+            int attr = as->aggs[a].attrNum;
+            int order = dst->count == 0 ? 0 : compareAttrBytes(as->schema->dataTypes[attr], as->sizes[a], src->extreme, dst->extreme);
+            if (dst->count == 0 || (as->aggs[a].func == AGG_MIN ? order < 0 : order > 0))
+                memcpy(dst->extreme, src->extreme, as->sizes[a]);
+        }
+        dst->count += src->count;
+        dst->intSum += src->intSum;
+        dst->floatSum += src->floatSum;
+    }
+}
+
+static void freeAggTable(AggScan *as, AggTable *table)
+{
+    AggGroup *group;
+
+    for (int b = 0; b < table->numBuckets; b++)
+    {
+        while ((group = table->buckets[b]) != NULL)
+        {
+            table->buckets[b] = group->next;
+            for (int a = 0; a < as->numAggs; a++)
+                free(group->accums[a].extreme);
+            free(group->accums);
+            free(group->key);
+            free(group);
+        }
+    }
+    free(table->buckets);
+}
+
+/*
+    # a Value holding an attribute as laid out in a record image
+*/
+static Value *attrBytesToValue(DataType dataType, int size, char *bytes)
+{
+    Value *value = (Value *)malloc(sizeof(Value));
+
+    value->dt = dataType;
+    value->isNull = FALSE;
+    if (dataType == DT_STRING)
+    {
+        value->v.stringV = (char *)calloc(size + 1, sizeof(char));
+        strncpy(value->v.stringV, bytes, size);
+    }
+    else
+        memcpy(&value->v, bytes, fixedAttrSize(dataType));
+    return value;
+}
+
+/*
+    # the result of one aggregate of a group
+    # COUNT is an int, AVG a float, SUM, MIN and MAX have the type of the attribute;
+    # all but COUNT are NULL when the group has no non-NULL value
+*/
+static RC aggregateValue(AggScan *as, int a, AggAccum *accum, Value **result)
+{
+    RM_Aggregate *agg = &as->aggs[a];
+    DataType dataType = agg->attrNum >= 0 ? as->schema->dataTypes[agg->attrNum] : DT_INT;
+
+    if (agg->func == AGG_COUNT)
+    {
+        if (accum->count > INT_MAX)
+            return RC_VALUE_OUT_OF_RANGE;
+        MAKE_VALUE(*result, DT_INT, (int)accum->count);
+        return RC_OK;
+    }
+    if (accum->count == 0)
+    {
+        MAKE_NULL_VALUE(*result, agg->func == AGG_AVG ? DT_FLOAT : dataType);
+        return RC_OK;
+    }
+
+    switch (agg->func)
+    {
+    case AGG_SUM:
+        if (dataType == DT_FLOAT)
+            MAKE_VALUE(*result, DT_FLOAT, (float)accum->floatSum);
+        else if (accum->intSum < INT_MIN || accum->intSum > INT_MAX)
+            return RC_VALUE_OUT_OF_RANGE;
+        else
+            MAKE_VALUE(*result, DT_INT, (int)accum->intSum);
+        return RC_OK;
+    case AGG_AVG:
+        MAKE_VALUE(*result, DT_FLOAT, (float)((dataType == DT_INT ? (double)accum->intSum : accum->floatSum) / accum->count));
+        return RC_OK;
+    default:
+        *result = attrBytesToValue(dataType, as->sizes[a], accum->extreme);
+        return RC_OK;
+    }
+}
+
+/*
+    # turns the merged groups of the first worker table into the result of aggregateScan
+*/
+static RC buildAggResult(AggScan *as, AggTable *table, RM_AggResult **result)
+{
+    RM_AggResult *res = (RM_AggResult *)malloc(sizeof(RM_AggResult));
+    RC status = RC_OK;
+    int g = 0;
+
+    res->numAggs = as->numAggs;
+    res->numGroups = table->numGroups;
+    res->groups = (RM_AggGroup *)calloc(table->numGroups > 0 ? table->numGroups : 1, sizeof(RM_AggGroup));
+    for (int b = 0; b < table->numBuckets; b++)
+    {
+        for (AggGroup *group = table->buckets[b]; group != NULL; group = group->next, g++)
+        {
+            RM_AggGroup *out = &res->groups[g];
+            if (as->groupAttr >= 0 && group->keyNull)
+                MAKE_NULL_VALUE(out->key, as->schema->dataTypes[as->groupAttr]);
+            else if (as->groupAttr >= 0)
+                out->key = attrBytesToValue(as->schema->dataTypes[as->groupAttr], as->groupSize, group->key);
+            out->values = (Value **)calloc(as->numAggs, sizeof(Value *));
+            for (int a = 0; a < as->numAggs && status == RC_OK; a++)
+                status = aggregateValue(as, a, &group->accums[a], &out->values[a]);
+        }
+    }
+
+    if (status != RC_OK)
+    {
+        freeAggResult(res);
+        return status;
+    }
+    *result = res;
+    return RC_OK;
+}
+
+/*
+    # computes aggregates over the records of rel that satisfy cond (every record if cond is NULL),
+    # grouped by the attribute groupAttr, or over all of them as one group if groupAttr is -1
+    # The records are not materialized: a worker decodes only the attributes the condition, the
+    # aggregates and the grouping need and folds them into its own hash table of groups, on the
+    # pages of a PAX table it folds the minipages of the aggregated attributes instead; with
+    # numWorkers > 1 the workers split the table as in parallelScan and their partial aggregates
+    # are merged at the end
+    # Without grouping the result always has one group, with grouping one per distinct value
+    # (NULLs form one group), in no particular order; the caller frees it with freeAggResult
+*/
+RC aggregateScan(RM_TableData *rel, Expr *cond, int groupAttr, int numAggs, RM_Aggregate *aggs, int numWorkers,
+                 RM_AggResult **result)
+{
+    AggScan as;
+    RC status;
+    int w, a;
+
+    if (rel == NULL || rel->mgmtData == NULL || aggs == NULL || numAggs <= 0 || result == NULL)
+        return RC_NULL_ARGUMENT;
+
+    Schema *schema = rel->schema;
+    if (groupAttr < -1 || groupAttr >= schema->numAttr)
+        return RC_ERROR;
+    for (a = 0; a < numAggs; a++)
+    {
+        int attr = aggs[a].attrNum;
+        if (attr < -1 || attr >= schema->numAttr || (attr == -1 && aggs[a].func != AGG_COUNT))
+            return RC_ERROR;
+        if ((aggs[a].func == AGG_SUM || aggs[a].func == AGG_AVG) &&
+            schema->dataTypes[attr] != DT_INT && schema->dataTypes[attr] != DT_FLOAT)
+            return RC_TYPE_MISMATCH;
+    }
+    if (numWorkers < 1)
+        numWorkers = 1;
+    if (numWorkers > MAX_SCAN_WORKERS)
+        numWorkers = MAX_SCAN_WORKERS;
+
+    as.schema = schema;
+    as.groupAttr = groupAttr;
+    as.groupOffset = 0;
+    as.groupSize = 0;
+    as.numAggs = numAggs;
+    as.aggs = aggs;
+    as.offsets = (int *)calloc(numAggs, sizeof(int));
+    as.sizes = (int *)calloc(numAggs, sizeof(int));
+    as.pax = ((RecordMgr *)rel->mgmtData)->pax;
+    as.dictionaries = ((RecordMgr *)rel->mgmtData)->dictionaries;
+    bool *neededAttrs = (bool *)calloc(schema->numAttr, sizeof(bool));
+    if (groupAttr >= 0)
+    {
+        attrOffset(schema, groupAttr, &as.groupOffset);
+        as.groupSize = schema->dataTypes[groupAttr] == DT_STRING ? schema->typeLength[groupAttr] : fixedAttrSize(schema->dataTypes[groupAttr]);
+        neededAttrs[groupAttr] = true;
+    }
+    for (a = 0; a < numAggs; a++)
+    {
+        int attr = aggs[a].attrNum;
+        if (attr < 0)
+            continue;
+        attrOffset(schema, attr, &as.offsets[a]);
+        as.sizes[a] = schema->dataTypes[attr] == DT_STRING ? schema->typeLength[attr] : fixedAttrSize(schema->dataTypes[attr]);
+        neededAttrs[attr] = true;
+    }
+
+    as.tables = (AggTable *)calloc(numWorkers, sizeof(AggTable));
+    for (w = 0; w < numWorkers; w++)
+    {
+        as.tables[w].numBuckets = AGG_INITIAL_BUCKETS;
+        as.tables[w].buckets = (AggGroup **)calloc(AGG_INITIAL_BUCKETS, sizeof(AggGroup *));
+    }
+
+    status = runParallelScan(rel, cond, numWorkers, aggregateRecord, &as, neededAttrs,
+                             as.pax != NULL ? aggregatePaxPage : NULL, NULL);
+
+    // Merge the partial aggregates of the other workers into the table of worker 0
+    for (w = 1; w < numWorkers && status == RC_OK; w++)
+    {
+        for (int b = 0; b < as.tables[w].numBuckets; b++)
+        {
+            for (AggGroup *group = as.tables[w].buckets[b]; group != NULL; group = group->next)
+                mergeAggGroup(&as, findAggGroup(&as, &as.tables[0], group->key, group->keyNull, group->hash), group);
+        }
+    }
+
+    // An aggregate without GROUP BY has a result even if no record matched
+    if (status == RC_OK && groupAttr < 0 && as.tables[0].numGroups == 0)
+        findAggGroup(&as, &as.tables[0], NULL, false, hashKeyBytes(NULL, 0, false));
+    if (status == RC_OK)
+        status = buildAggResult(&as, &as.tables[0], result);
+
+    for (w = 0; w < numWorkers; w++)
+        freeAggTable(&as, &as.tables[w]);
+    free(as.tables);
+    free(neededAttrs);
+    free(as.offsets);
+    free(as.sizes);
+    return status;
+}
+
+/*
+    # frees the result of aggregateScan
+*/
+RC freeAggResult(RM_AggResult *result)
+{
+    if (result == NULL)
+        return RC_NULL_ARGUMENT;
+
+    for (int g = 0; g < result->numGroups; g++)
+    {
+        if (result->groups[g].key != NULL)
+            freeVal(result->groups[g].key);
+        for (int a = 0; a < result->numAggs && result->groups[g].values != NULL; a++)
+        {
+            if (result->groups[g].values[a] != NULL)
+                freeVal(result->groups[g].values[a]);
+        }
+        free(result->groups[g].values);
+    }
+    free(result->groups);
+    free(result);
+    return RC_OK;
+}
+
+/* Temporary runs */
+
+/*
+    # A stream of fixed-size entries spilled to a temporary page file by a join or a sort,
+    # written front to back and then read back once
+*/
+typedef struct TempRun
+{
+    char *fileName;
+    SM_FileHandle fHandle;
+    char *page; // page being filled, then page being read
+    int pageNum;
+    int used; // bytes of page written or read
+    long numRecords;
+    long readRecords;
+} TempRun;
+
+static RC openTempRun(TempRun *run, char *fileName)
+{
+    RC status;
+
+    if ((status = createPageFile(fileName)) != RC_OK || (status = openPageFile(fileName, &run->fHandle)) != RC_OK)
+    {
+        free(fileName);
+        return status;
+    }
+    run->fileName = fileName;
+    run->page = (char *)malloc(PAGE_SIZE);
+    run->pageNum = 0;
+    run->used = 0;
+    run->numRecords = 0;
+    run->readRecords = 0;
+    return RC_OK;
+}
+
+static RC writeTempRun(TempRun *run, char *image, int size)
+{
+    RC status;
+
+    for (int done = 0; done < size;)
+    {
+        int chunk = PAGE_SIZE - run->used < size - done ? PAGE_SIZE - run->used : size - done;
+        memcpy(run->page + run->used, image + done, chunk);
+        run->used += chunk;
+        done += chunk;
+        if (run->used == PAGE_SIZE)
+        {
+            if ((status = ensureCapacity(run->pageNum + 1, &run->fHandle)) != RC_OK ||
+                (status = writeBlock(run->pageNum, &run->fHandle, run->page)) != RC_OK)
+                return status;
+            run->pageNum++;
+            run->used = 0;
+        }
+    }
+    run->numRecords++;
+    return RC_OK;
+}
+
+/*
+    # writes out the last, partly filled page of a run and turns it around for reading
+*/
+static RC finishTempRun(TempRun *run)
+{
+    RC status;
+
+    if (run->used > 0 && ((status = ensureCapacity(run->pageNum + 1, &run->fHandle)) != RC_OK ||
+                          (status = writeBlock(run->pageNum, &run->fHandle, run->page)) != RC_OK))
+        return status;
+    run->pageNum = 0;
+    run->used = PAGE_SIZE;
+    return RC_OK;
+}
+
+static RC readTempRun(TempRun *run, char *image, int size)
+{
+    RC status;
+
+    if (run->readRecords == run->numRecords)
+        return RC_RM_NO_MORE_TUPLES;
+    for (int done = 0; done < size;)
+    {
+        if (run->used == PAGE_SIZE)
+        {
+            if ((status = readBlock(run->pageNum++, &run->fHandle, run->page)) != RC_OK)
+                return status;
+            run->used = 0;
+        }
+        int chunk = PAGE_SIZE - run->used < size - done ? PAGE_SIZE - run->used : size - done;
+        memcpy(image + done, run->page + run->used, chunk);
+        run->used += chunk;
+        done += chunk;
+    }
+    run->readRecords++;
+    return RC_OK;
+}
+
+static void closeTempRun(TempRun *run)
+{
+    if (run->page == NULL)
+        return;
+    closePageFile(&run->fHandle);
+    destroyPageFile(run->fileName);
+    free(run->fileName);
+    free(run->page);
+    run->page = NULL;
+}
+
+/* Joins */
 
-        // Move pageHandle by the size of the attribute
-        pageHandle = pageHandle + SIZE_OF_ATTRIBUTE;
+#define JOIN_LEFT 0
+#define JOIN_RIGHT 1
+// Memory for the hash table of a hash join when startJoin is given none, in pages
+#define JOIN_DEFAULT_MEMORY_PAGES 1024
+// A hash join splits its inputs into at most this many partitions at once, partitions still over
+// the memory budget are split again, at most MAX_JOIN_LEVELS times
+#define MAX_JOIN_PARTITIONS 64
+#define MAX_JOIN_LEVELS 4
 
-        // Assign the data type of the attribute
-        schema->dataTypes[i] = *(DataType *)pageHandle;
+// A record image in the hash table of a hash join
+typedef struct JoinEntry
+{
+    unsigned int hash;
+    struct JoinEntry *next;
+    char *image;
+} JoinEntry;
 
-        // Move pageHandle by the size of DataType
-        pageHandle = pageHandle + sizeof(DataType);
+typedef struct JoinMgr
+{
+    JoinMethod method;
+    Schema *schema; // attributes of the left table, then those of the right one
+    RM_TableData *rel[2];
+    int attr[2];
+    int keyOffset[2];
+    int keySize[2];
+    int attrBytes[2]; // bytes of all attributes of a record image
+    Record *rec[2];   // current record of each side
+    ScanMgr *cursor;  // sequential cursor over the table being read
+    int cursorSide;
+    // hash join
+    int build; // side the hash table is built on, the other one probes it
+    JoinEntry **buckets;
+    int numBuckets;
+    long budget;       // bytes the hash table of one partition may take
+    int numPartitions; // 0 when the build side fits in memory
+    int numSplit;      // partitions split again, whose runs are empty
+    int partition;     // partition being joined
+    TempRun *runs[2];  // numPartitions runs of each side
+    int *levels;       // times the records of each partition were split before
+    JoinEntry *match;  // next entry to test against the current probe record
+    unsigned int probeHash;
+    // index nested loop join
+    RID *rids;
+    int numRids;
+    int ridPos;
+} JoinMgr;
+
+static bool joinKeyNull(JoinMgr *jm, int side, char *image)
+{
+    Schema *schema = jm->rel[side]->schema;
+    return !declaredNotNull(schema, jm->attr[side]) && isNullBit(nullBitmap(schema, image), jm->attr[side]);
+}
 
-        // Assign the type length of the attribute
-        schema->typeLength[i] = *(int *)pageHandle;
+/*
+    # bytes of the join key of a record image, strings without their padding
+*/
+static int joinKeyLength(JoinMgr *jm, int side, char *image)
+{
+    if (jm->rel[side]->schema->dataTypes[jm->attr[side]] != DT_STRING)
+        return jm->keySize[side];
+    return strnlen(image + jm->keyOffset[side], jm->keySize[side]);
+}
 
-        // Move pageHandle by the size of an integer
-        pageHandle = pageHandle + sizeof(int);
+static unsigned int joinKeyHash(JoinMgr *jm, int side, char *image)
+{
+    return hashKeyBytes(image + jm->keyOffset[side], joinKeyLength(jm, side, image), false);
+}
 
-        // Increment the index
-        i++;
-    }
+static bool joinKeysEqual(JoinMgr *jm, char *leftImage, char *rightImage)
+{
+    int length = joinKeyLength(jm, JOIN_LEFT, leftImage);
+    return length == joinKeyLength(jm, JOIN_RIGHT, rightImage) &&
+           memcmp(leftImage + jm->keyOffset[JOIN_LEFT], rightImage + jm->keyOffset[JOIN_RIGHT], length) == 0;
+}
 
-    rel->schema = schema;
+/*
+    # builds the schema of joined records, the attributes of left then right named table.attribute
+*/
+static Schema *joinSchema(RM_TableData *left, RM_TableData *right)
+{
+    RM_TableData *rels[2] = {left, right};
+    Schema *schema = (Schema *)malloc(sizeof(Schema));
+    int numAttr = left->schema->numAttr + right->schema->numAttr, j = 0;
 
-    status = forcePage(&mgrHandler.recMgr->bp, &mgrHandler.recMgr->pageHandle) == RC_OK;
-    if (!status)
-    {
-        // Log the failure of opening the table
-        mgrHandler.currState.TM_resp = OPEN_TABLE_FAILED;
-        // Update the timestamp of the recorded state
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-    }
-    else
+    schema->numAttr = numAttr;
+    schema->attrNames = (char **)malloc(numAttr * sizeof(char *));
+    schema->dataTypes = (DataType *)malloc(numAttr * sizeof(DataType));
+    schema->typeLength = (int *)malloc(numAttr * sizeof(int));
+    schema->notNull = (bool *)calloc(numAttr, sizeof(bool));
+    schema->keySize = 0;
+    schema->keyAttrs = NULL;
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT; side++)
     {
-        // Log the successful opening of the table
-        mgrHandler.currState.TM_resp = TABLE_OPENED;
-        // Update the timestamp of the recorded state
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
+        Schema *from = rels[side]->schema;
+        for (int i = 0; i < from->numAttr; i++, j++)
+        {
+            schema->attrNames[j] = (char *)malloc(strlen(rels[side]->name) + strlen(from->attrNames[i]) + 2);
+            sprintf(schema->attrNames[j], "%s.%s", rels[side]->name, from->attrNames[i]);
+            schema->dataTypes[j] = from->dataTypes[i];
+            schema->typeLength[j] = from->typeLength[i];
+            schema->notNull[j] = declaredNotNull(from, i);
+        }
     }
-    // Return RC_ERROR if failed otherwise return RC_OK
-    return !status ? RC_ERROR : RC_OK;
+    return schema;
 }
 
 /*
-    # This function closes the table after all operations are finished
-    # It de-allocates all memory to prevent memory leaks
+    # writes the joined record of a left and a right record image into record
+    # the attributes of both sides are contiguous in their images, so each side is one copy
 */
-RC closeTable(RM_TableData *rel)
+static void emitJoined(JoinMgr *jm, char *leftImage, char *rightImage, Record *record)
 {
-    RecordMgr *rMgr = (*rel).mgmtData;
+    Schema *left = jm->rel[JOIN_LEFT]->schema, *right = jm->rel[JOIN_RIGHT]->schema;
+    char *nulls = nullBitmap(jm->schema, record->data);
+    char *leftNulls = nullBitmap(left, leftImage), *rightNulls = nullBitmap(right, rightImage);
+
+    memcpy(record->data + 1, leftImage + 1, jm->attrBytes[JOIN_LEFT]);
+    memcpy(record->data + 1 + jm->attrBytes[JOIN_LEFT], rightImage + 1, jm->attrBytes[JOIN_RIGHT]);
+    for (int i = 0; i < left->numAttr; i++)
+        setNullBit(nulls, i, isNullBit(leftNulls, i));
+    for (int i = 0; i < right->numAttr; i++)
+        setNullBit(nulls, left->numAttr + i, isNullBit(rightNulls, i));
+    // A joined record is not stored anywhere
+    record->id.page = -1;
+    record->id.slot = -1;
+}
 
-    int result = shutdownBufferPool(&rMgr->bp);
-    if (result == (float)RC_ERROR)
-    {
-        mgrHandler.currState.TM_resp = CLOSE_TABLE_FAILED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-    }
-    else
-    {
-        mgrHandler.currState.TM_resp = TABLE_CLOSED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-    }
-    return (result == RC_ERROR) ? RC_ERROR : RC_OK;
+/*
+    # points the sequential cursor of a join at the first record of one side
+*/
+static void rewindJoinCursor(JoinMgr *jm, int side)
+{
+    RecordMgr *rMgr = jm->rel[jm->cursorSide]->mgmtData;
+
+    if (jm->cursor->pinned)
+        unpinPage(&rMgr->bp, &jm->cursor->pageHandle);
+    jm->cursor->pinned = false;
+    jm->cursor->r_id.page = 1;
+    jm->cursor->r_id.slot = -1;
+    jm->cursorSide = side;
 }
 
-void incrementTableCount(int count)
+/*
+    # the next record of one side of a join, from its table or from the current partition
+*/
+static RC readJoinInput(JoinMgr *jm, int side, Record *record)
 {
-    // Ensure count is a attrPositive integer before updating
-    if (count > 0)
-    {
-        MAX_COUNT = count;
-    }
-    else
+    if (jm->numPartitions == 0)
+        return nextFromCursor(jm->rel[side], jm->cursor, record);
+    return readTempRun(&jm->runs[side][jm->partition], record->data, getRecordSize(jm->rel[side]->schema));
+}
+
+static void addJoinEntry(JoinMgr *jm, char *image)
+{
+    int size = getRecordSize(jm->rel[jm->build]->schema);
+    JoinEntry *entry = (JoinEntry *)malloc(sizeof(JoinEntry) + size);
+
+    entry->image = (char *)(entry + 1);
+    memcpy(entry->image, image, size);
+    entry->hash = joinKeyHash(jm, jm->build, image);
+    entry->next = jm->buckets[entry->hash % jm->numBuckets];
+    jm->buckets[entry->hash % jm->numBuckets] = entry;
+}
+
+static void clearJoinTable(JoinMgr *jm)
+{
+    JoinEntry *entry;
+
+    for (int b = 0; b < jm->numBuckets; b++)
     {
-        printf("Error: count must be a attrPositive integer.\n");
+        while ((entry = jm->buckets[b]) != NULL)
+        {
+            jm->buckets[b] = entry->next;
+            free(entry);
+        }
     }
+    jm->match = NULL;
 }
 
 /*
-    # This fucntion is used to delete a created table
-    # It is done by using destroyPageFile function from the BufferManger implementation
+    # fills the hash table with the build records of the current partition,
+    # or of the whole build table if nothing was spilled; NULL keys never match and are left out
 */
-RC deleteTable(char *name)
+static RC buildJoinTable(JoinMgr *jm)
 {
-    if (destroyPageFile(name) != RC_OK)
+    Record *record = jm->rec[jm->build];
+    RC status;
+
+    clearJoinTable(jm);
+    while ((status = readJoinInput(jm, jm->build, record)) == RC_OK)
     {
-        // Increment table count if needed
-        incrementTableCount(1);
-        mgrHandler.currState.TM_resp = DELETE_TABLE_ERROR;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        if (!joinKeyNull(jm, jm->build, record->data))
+            addJoinEntry(jm, record->data);
     }
-
-    // Log the successful deletion of the table
-    mgrHandler.currState.TM_resp = TABLE_DELETEED;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
-
-    return RC_OK;
+    return status == RC_RM_NO_MORE_TUPLES ? RC_OK : status;
 }
 
 /*
-    # This method is used to get the total number of tuples in the table
+    # the partition among numPartitions of a record whose join key hashes to hash, every level
+    # mixes the hash again so records sharing a partition spread over the next level
+    # the bucket of a record in the hash table is taken from the low bits of the unmixed hash
 */
-int getNumTuples(RM_TableData *rel)
+static int joinPartitionOf(unsigned int hash, int level, int numPartitions)
+{
+    for (int l = 0; l < level; l++)
+        hash = (hash ^ (hash >> 15)) * 0x2c1b3c6dU;
+    return (hash >> 16) % numPartitions;
+}
 
+static long joinPartitionBytes(JoinMgr *jm, long numRecords)
 {
-    // Check if the table data or management data is NULL
-    if (rel == NULL || rel->mgmtData == NULL)
-    {
-        printf("Error: Table data or management data is NULL.\n");
-        // Return an error code if the input is invalid
-        return -1;
-    }
+    return numRecords * (long)(getRecordSize(jm->rel[jm->build]->schema) + sizeof(JoinEntry));
+}
 
-    RecordMgr *recMgr = rel->mgmtData;
-    return recMgr->countOfTuples;
+/*
+    # number of partitions to split numRecords build records into so each fits in the budget
+*/
+static int joinFanOut(JoinMgr *jm, long numRecords)
+{
+    long count = joinPartitionBytes(jm, numRecords) / jm->budget + 1;
+    return count > MAX_JOIN_PARTITIONS ? MAX_JOIN_PARTITIONS : (int)count;
 }
 
 /*
-    # This function is used to insert a new record into the table
-    # It takes the table data pointer and the new record
-    # It returns 0 on success and -1 on failure
+    # appends count empty partitions of the given level, with a run of each side
 */
-RC insertRecord(RM_TableData *rel, Record *record)
+static RC addJoinPartitions(JoinMgr *jm, int count, int level)
 {
-    char *data;
-    RID *rec_ID = &(*record).id;
-    RecordMgr *recordMgr = (*rel).mgmtData;
-    int retryCount = 0;
-    float varValue = 1.0;
+    int first = jm->numPartitions;
+    int *levels = (int *)realloc(jm->levels, (first + count) * sizeof(int));
+    RC status = RC_OK;
 
-    // Intialize the record ID
-    if (!retryCount)
+    if (levels == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    jm->levels = levels;
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT; side++)
     {
-        recordMgr = rel->mgmtData;
-        rec_ID->page = recordMgr->deallocatePage;
+        TempRun *runs = (TempRun *)realloc(jm->runs[side], (first + count) * sizeof(TempRun));
+        if (runs == NULL)
+            return RC_MEM_ALLOCATION_FAIL;
+        memset(runs + first, 0, count * sizeof(TempRun));
+        jm->runs[side] = runs;
     }
+    jm->numPartitions = first + count;
 
-    // Check if the record exists in the table and return error if it does
-    if (pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, (*rec_ID).page) != RC_OK)
+    for (int p = first; p < jm->numPartitions; p++)
     {
-        mgrHandler.currState.TM_resp = RECORD_NOT_INSERTED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        jm->levels[p] = level;
+        for (int side = JOIN_LEFT; side <= JOIN_RIGHT && status == RC_OK; side++)
+        {
+            char *fileName = (char *)malloc(strlen(jm->rel[side]->name) + 48);
+            sprintf(fileName, "%s.%lx.jtmp%d", jm->rel[side]->name, (unsigned long)jm, p);
+            status = openTempRun(&jm->runs[side][p], fileName);
+        }
     }
+    return status;
+}
 
-    // Find an available slot in the page
-    data = (*recordMgr).pageHandle.data;
-    rec_ID->slot = availableSlot(data, getRecordSize(rel->schema));
+/*
+    # splits both tables into count runs on the hash of their join key
+*/
+static RC partitionJoinInputs(JoinMgr *jm, int count)
+{
+    RC status = addJoinPartitions(jm, count, 0);
 
-    // If the slot is not available, move to the next page and attempt pinning again
-    while (rec_ID->slot == -1)
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT && status == RC_OK; side++)
     {
-        // Unpin the page before moving to the next page
-        if (unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+        Record *record = jm->rec[side];
+        int size = getRecordSize(jm->rel[side]->schema);
+
+        rewindJoinCursor(jm, side);
+        while (status == RC_OK && (status = nextFromCursor(jm->rel[side], jm->cursor, record)) == RC_OK)
         {
-            mgrHandler.currState.TM_resp = RECORD_NOT_INSERTED;
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
-            return RC_ERROR;
+            if (joinKeyNull(jm, side, record->data))
+                continue;
+            int p = joinPartitionOf(joinKeyHash(jm, side, record->data), 0, count);
+            status = writeTempRun(&jm->runs[side][p], record->data, size);
         }
+        if (status == RC_RM_NO_MORE_TUPLES)
+            status = RC_OK;
+        for (int p = 0; p < count && status == RC_OK; p++)
+            status = finishTempRun(&jm->runs[side][p]);
+    }
+    return status;
+}
 
-        // Move to the next page and attempt pinning
-        rec_ID->page++;
-        if (pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, rec_ID->page) != RC_OK)
+/*
+    # moves the records of partition p into new partitions of the next level and empties it
+    # a new partition that got every build record of p holds keys hashing alike, most likely
+    # a single key, and is not split any further
+*/
+static RC splitJoinPartition(JoinMgr *jm, int p)
+{
+    long numRecords = jm->runs[jm->build][p].numRecords;
+    int count = joinFanOut(jm, numRecords), level = jm->levels[p] + 1, first = jm->numPartitions;
+    RC status = addJoinPartitions(jm, count, level);
+
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT && status == RC_OK; side++)
+    {
+        Record *record = jm->rec[side];
+        int size = getRecordSize(jm->rel[side]->schema);
+
+        while (status == RC_OK && (status = readTempRun(&jm->runs[side][p], record->data, size)) == RC_OK)
         {
-            mgrHandler.currState.TM_resp = RECORD_NOT_INSERTED;
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
-            return RC_ERROR;
+            int q = first + joinPartitionOf(joinKeyHash(jm, side, record->data), level, count);
+            status = writeTempRun(&jm->runs[side][q], record->data, size);
         }
-
-        // Find an available slot in the page after pinning
-        data = (*recordMgr).pageHandle.data;
-        rec_ID->slot = availableSlot(data, getRecordSize(rel->schema));
+        if (status == RC_RM_NO_MORE_TUPLES)
+            status = RC_OK;
+        for (int q = first; q < first + count && status == RC_OK; q++)
+            status = finishTempRun(&jm->runs[side][q]);
+        closeTempRun(&jm->runs[side][p]);
+        jm->runs[side][p].numRecords = jm->runs[side][p].readRecords = 0;
     }
-
-    // Mark the page as dirty
-    if (markDirty(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+    for (int q = first; q < first + count; q++)
     {
-        mgrHandler.currState.TM_resp = RECORD_NOT_INSERTED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        if (jm->runs[jm->build][q].numRecords == numRecords)
+            jm->levels[q] = MAX_JOIN_LEVELS;
     }
+    jm->numSplit++;
+    return status;
+}
+
+/*
+    # sets up a hash join, building on the table with fewer bytes of records
+    # if its records do not fit in memoryPages pages, both tables are partitioned to disk first,
+    # partitions still over the budget are split again, and the partitions are joined one pair at a time
+*/
+static RC startHashJoin(JoinMgr *jm, int memoryPages)
+{
+    long bytes[2], buildRecords;
+    RC status;
 
-    // Write the record data into the identified slot
-    char *slotPointer = data + ((*rec_ID).slot * getRecordSize(rel->schema));
-    *slotPointer = '#';
-    memcpy(slotPointer + 1, (*record).data + 1, getRecordSize(rel->schema) - 1);
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT; side++)
+        bytes[side] = (long)getNumTuples(jm->rel[side]) * (getRecordSize(jm->rel[side]->schema) + sizeof(JoinEntry));
+    jm->build = bytes[JOIN_LEFT] < bytes[JOIN_RIGHT] ? JOIN_LEFT : JOIN_RIGHT;
+    jm->budget = (long)(memoryPages > 0 ? memoryPages : JOIN_DEFAULT_MEMORY_PAGES) * PAGE_SIZE;
 
-    // Unpin the page before updating global info
-    if (unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+    buildRecords = getNumTuples(jm->rel[jm->build]);
+    if (bytes[jm->build] > jm->budget)
     {
-        mgrHandler.currState.TM_resp = RECORD_NOT_INSERTED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        if ((status = partitionJoinInputs(jm, joinFanOut(jm, buildRecords))) != RC_OK)
+            return status;
+        // partitions appended by a split are checked in turn, so the split recurses
+        for (int p = 0; p < jm->numPartitions; p++)
+        {
+            if (jm->levels[p] < MAX_JOIN_LEVELS &&
+                joinPartitionBytes(jm, jm->runs[jm->build][p].numRecords) > jm->budget &&
+                (status = splitJoinPartition(jm, p)) != RC_OK)
+                return status;
+        }
+        buildRecords = jm->budget / (getRecordSize(jm->rel[jm->build]->schema) + sizeof(JoinEntry));
     }
 
-    // Update global info
-    recordMgr->countOfTuples++;
+    jm->numBuckets = buildRecords > 64 ? (int)buildRecords : 64;
+    jm->buckets = (JoinEntry **)calloc(jm->numBuckets, sizeof(JoinEntry *));
 
-    // Attempt to pin the page after updating global info
-    if (pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, 0) == RC_ERROR)
+    if (jm->numPartitions > 0)
     {
-        mgrHandler.currState.TM_resp = RECORD_NOT_INSERTED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        jm->partition = 0;
+        return buildJoinTable(jm);
     }
 
-    // Log success and update the state record
-    mgrHandler.currState.TM_resp = RECORD_INSERTED;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+    rewindJoinCursor(jm, jm->build);
+    if ((status = buildJoinTable(jm)) != RC_OK)
+        return status;
+    rewindJoinCursor(jm, 1 - jm->build);
     return RC_OK;
 }
 
+static RC nextHashJoin(JoinMgr *jm, Record *record)
+{
+    int probe = 1 - jm->build;
+    Record *probeRec = jm->rec[probe];
+    RC status;
+
+    while (true)
+    {
+        while (jm->match != NULL)
+        {
+            JoinEntry *entry = jm->match;
+            jm->match = entry->next;
+            if (entry->hash != jm->probeHash)
+                continue;
+
+            char *leftImage = jm->build == JOIN_LEFT ? entry->image : probeRec->data;
+            char *rightImage = jm->build == JOIN_LEFT ? probeRec->data : entry->image;
+            if (joinKeysEqual(jm, leftImage, rightImage))
+            {
+                emitJoined(jm, leftImage, rightImage, record);
+                return RC_OK;
+            }
+        }
+
+        status = readJoinInput(jm, probe, probeRec);
+        if (status == RC_RM_NO_MORE_TUPLES && jm->partition + 1 < jm->numPartitions)
+        {
+            jm->partition++;
+            if ((status = buildJoinTable(jm)) != RC_OK)
+                return status;
+            continue;
+        }
+        if (status != RC_OK)
+            return status;
+
+        if (joinKeyNull(jm, probe, probeRec->data))
+            continue;
+        jm->probeHash = joinKeyHash(jm, probe, probeRec->data);
+        jm->match = jm->buckets[jm->probeHash % jm->numBuckets];
+    }
+}
+
 /*
-    # This function deletes the record based on the RID
-    # If the record is not found, it returns NULL
-    # Otherwise, it returns the pointer to the record
+    # collects the RIDs of the right records whose join attribute equals the key of the left record
 */
-RC deleteRecord(RM_TableData *rel, RID id)
+static RC lookupJoinRids(JoinMgr *jm)
 {
-    // Get the record manager
-    RecordMgr *recordMgr = (RecordMgr *)(*rel).mgmtData;
+    RM_TableData *right = jm->rel[JOIN_RIGHT];
+    RecordMgr *rMgr = right->mgmtData;
+    char *image = jm->rec[JOIN_LEFT]->data;
+    DataType dataType = jm->rel[JOIN_LEFT]->schema->dataTypes[jm->attr[JOIN_LEFT]];
+    Value *key = attrBytesToValue(dataType, jm->keySize[JOIN_LEFT], image + jm->keyOffset[JOIN_LEFT]);
+    int pos = findTableIndex(rMgr, jm->attr[JOIN_RIGHT]);
+    RC status;
 
-    // Attempt to pin the page
-    if (pinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle, id.page) == RC_ERROR)
+    jm->numRids = jm->ridPos = 0;
+    if (rMgr->indexKinds[pos] == INDEX_HASH)
     {
-        // Log failure and update the state record
-        mgrHandler.currState.TM_resp = RECORD_NOT_DELETED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        status = hashLookup(rMgr->hashIndexes[pos], key, &jm->rids, &jm->numRids);
+        if (status == RC_IM_KEY_NOT_FOUND)
+            status = RC_OK;
     }
+    else
+    {
+        BT_ScanHandle *scan;
+        RID rid;
+        int capacity = 0;
 
-    // Mark the record as deleted in the page data
-    (*recordMgr).deallocatePage = id.page;
+        if ((status = openTreeRangeScan(rMgr->indexes[pos], key, key, &scan)) == RC_OK)
+        {
+            while ((status = nextEntry(scan, &rid)) == RC_OK)
+            {
+                if (jm->numRids == capacity)
+                {
+                    capacity = capacity > 0 ? capacity * 2 : 4;
+                    jm->rids = (RID *)realloc(jm->rids, capacity * sizeof(RID));
+                }
+                jm->rids[jm->numRids++] = rid;
+            }
+            closeTreeScan(scan);
+            if (status == RC_IM_NO_MORE_ENTRIES)
+                status = RC_OK;
+        }
+    }
+    freeVal(key);
+    return status;
+}
 
-    // Write the record data into the identified slot
-    char *data = (*recordMgr).pageHandle.data + (id.slot * getRecordSize(rel->schema));
-    *data = '-';
+static RC nextIndexJoin(JoinMgr *jm, Record *record)
+{
+    RecordMgr *rMgr = jm->rel[JOIN_RIGHT]->mgmtData;
+    RC status;
 
-    // Mark the page as dirty
-    if (markDirty(&(*recordMgr).bp, &(*recordMgr).pageHandle) == RC_ERROR)
+    while (true)
     {
-        mgrHandler.currState.TM_resp = RECORD_NOT_DELETED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
-    }
+        if (jm->ridPos < jm->numRids)
+        {
+            pthread_rwlock_rdlock(&rMgr->latch);
+            status = readRecord(jm->rel[JOIN_RIGHT], jm->rids[jm->ridPos++], jm->cursor->snapshot, jm->rec[JOIN_RIGHT]);
+            pthread_rwlock_unlock(&rMgr->latch);
+            // The index holds the latest versions, the one the snapshot sees may not be there or have another key
+            if (status == RC_RM_NO_MORE_TUPLES ||
+                (status == RC_OK && (joinKeyNull(jm, JOIN_RIGHT, jm->rec[JOIN_RIGHT]->data) ||
+                                      !joinKeysEqual(jm, jm->rec[JOIN_LEFT]->data, jm->rec[JOIN_RIGHT]->data))))
+                continue;
+            if (status != RC_OK)
+                return status;
+            emitJoined(jm, jm->rec[JOIN_LEFT]->data, jm->rec[JOIN_RIGHT]->data, record);
+            return RC_OK;
+        }
 
-    // Unpin the page after writing data
-    if (unpinPage(&(*recordMgr).bp, &(*recordMgr).pageHandle) != RC_OK)
-    {
-        mgrHandler.currState.TM_resp = RECORD_NOT_DELETED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        free(jm->rids);
+        jm->rids = NULL;
+        jm->numRids = jm->ridPos = 0;
+        if ((status = nextFromCursor(jm->rel[JOIN_LEFT], jm->cursor, jm->rec[JOIN_LEFT])) != RC_OK)
+            return status;
+        if (!joinKeyNull(jm, JOIN_LEFT, jm->rec[JOIN_LEFT]->data) && (status = lookupJoinRids(jm)) != RC_OK)
+            return status;
     }
-
-    // Log success and update the state record
-    mgrHandler.currState.TM_resp = RECORD_DELETED;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
-    return RC_OK;
 }
 
 /*
-    # This function is used to update a record
-    # It takes the table data pointer and the new record
+    # starts an equi-join of left and right on left.leftAttr = right.rightAttr, whose records
+    # are read with nextJoin; the records carry the attributes of both tables (see getJoinSchema)
+    # JOIN_INDEX_NESTED_LOOP scans left and looks every key up in the index on rightAttr,
+    # JOIN_HASH builds a hash table on the smaller table and probes it with the other one,
+    # spilling partitions of both to temporary page files past memoryPages (0 for the default)
+    # and splitting those still over it again, unless the records of one key alone exceed it,
+    # JOIN_AUTO picks the index nested loop join when rightAttr is indexed
+    # NULL keys match nothing; both tables are read as they were when the join started, the
+    # records of the transaction of the calling thread included
 */
-RC updateRecord(RM_TableData *table, Record *newRecord)
+RC startJoin(RM_TableData *left, int leftAttr, RM_TableData *right, int rightAttr, JoinMethod method,
+             int memoryPages, RM_JoinHandle *join)
 {
-    RC returnValue;
-    RecordMgr *recordManager = (RecordMgr *)(*table).mgmtData;
-    bool shouldUpdate = true;
+    RC status;
 
-    // Check if the record exists in the table
-    if (pinPage(&(*recordManager).bp, &(*recordManager).pageHandle, (*newRecord).id.page) == RC_ERROR)
-    {
-        mgrHandler.currState.TM_resp = RECORD_NOT_UPDATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
+    if (left == NULL || right == NULL || left->mgmtData == NULL || right->mgmtData == NULL || join == NULL)
+        return RC_NULL_ARGUMENT;
+    if (leftAttr < 0 || leftAttr >= left->schema->numAttr || rightAttr < 0 || rightAttr >= right->schema->numAttr)
         return RC_ERROR;
-    }
-
-    // Check if the record should be updated or not
-    if (shouldUpdate)
-    {
-        // Get the current data
-        char *currentDataattrPosition = (*recordManager).pageHandle.data;
+    if (left->schema->dataTypes[leftAttr] != right->schema->dataTypes[rightAttr])
+        return RC_TYPE_MISMATCH;
 
-        // Calculate the current data attrPosition
-        currentDataattrPosition += (*newRecord).id.slot * getRecordSize(table->schema);
+    bool indexed = findTableIndex(right->mgmtData, rightAttr) >= 0;
+    if (method == JOIN_AUTO)
+        method = indexed ? JOIN_INDEX_NESTED_LOOP : JOIN_HASH;
+    if (method == JOIN_INDEX_NESTED_LOOP && !indexed)
+        return RC_ERROR;
 
-        // Mark the current data as deleted
-        *currentDataattrPosition = '#';
+    JoinMgr *jm = (JoinMgr *)calloc(1, sizeof(JoinMgr));
+    if (jm == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    join->left = left;
+    join->right = right;
+    join->mgmtData = jm;
+
+    jm->method = method;
+    jm->rel[JOIN_LEFT] = left;
+    jm->rel[JOIN_RIGHT] = right;
+    jm->attr[JOIN_LEFT] = leftAttr;
+    jm->attr[JOIN_RIGHT] = rightAttr;
+    jm->schema = joinSchema(left, right);
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT; side++)
+    {
+        Schema *schema = jm->rel[side]->schema;
+        int attr = jm->attr[side];
+        attrOffset(schema, attr, &jm->keyOffset[side]);
+        jm->keySize[side] = schema->dataTypes[attr] == DT_STRING ? schema->typeLength[attr] : fixedAttrSize(schema->dataTypes[attr]);
+        attrOffset(schema, schema->numAttr, &jm->attrBytes[side]);
+        jm->attrBytes[side]--;
+        createRecord(&jm->rec[side], schema);
+    }
+    jm->cursor = (ScanMgr *)calloc(1, sizeof(ScanMgr));
+    jm->cursorSide = JOIN_LEFT;
+    rewindJoinCursor(jm, JOIN_LEFT);
 
-        // Copy the new data
-        memcpy(currentDataattrPosition + 1, (*newRecord).data + 1, getRecordSize(table->schema) - 1);
+    // Both tables are read through one snapshot, as a scan of each would see them
+    if ((jm->cursor->snapshot = (Snapshot *)malloc(sizeof(Snapshot))) == NULL ||
+        openSnapshot(jm->cursor->snapshot) != RC_OK)
+    {
+        free(jm->cursor->snapshot);
+        jm->cursor->snapshot = NULL;
+        closeJoin(join);
+        return RC_MEM_ALLOCATION_FAIL;
     }
 
-    // Mark the page as dirty after making changes
-    if (markDirty(&(*recordManager).bp, &(*recordManager).pageHandle) != RC_OK)
+    if (method == JOIN_HASH && (status = startHashJoin(jm, memoryPages)) != RC_OK)
     {
-        mgrHandler.currState.TM_resp = RECORD_NOT_UPDATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        closeJoin(join);
+        return status;
     }
+    return RC_OK;
+}
 
-    // Unpin the page after writing data
-    return unpinPage(&(*recordManager).bp, &(*recordManager).pageHandle) == RC_ERROR ? RC_ERROR : RC_OK;
+/*
+    # the next joined record, RC_RM_NO_MORE_TUPLES once every pair has been returned
+*/
+RC nextJoin(RM_JoinHandle *join, Record *record)
+{
+    if (join == NULL || join->mgmtData == NULL || record == NULL)
+        return RC_NULL_ARGUMENT;
+
+    JoinMgr *jm = join->mgmtData;
+    if (jm->method == JOIN_INDEX_NESTED_LOOP)
+        return nextIndexJoin(jm, record);
+    return nextHashJoin(jm, record);
+}
+
+/*
+    # the schema of the records nextJoin returns, it belongs to the join and is freed by closeJoin
+*/
+RC getJoinSchema(RM_JoinHandle *join, Schema **schema)
+{
+    if (join == NULL || join->mgmtData == NULL || schema == NULL)
+        return RC_NULL_ARGUMENT;
+
+    *schema = ((JoinMgr *)join->mgmtData)->schema;
+    return RC_OK;
 }
 
 /*
-    # This function returns the record based on the RID
-    # If the record is not found, it returns NULL
+    # describes how a join runs, e.g. "INDEX NESTED LOOP JOIN on l.c = r.a using the B+-tree on r.a",
+    # "HASH JOIN on l.c = r.a building on r in memory" or "... building on r in 8 partitions on disk"
+    # the caller frees the returned string
 */
-RC getRecord(RM_TableData *table, RID id, Record *outputRecord)
+RC explainJoin(RM_JoinHandle *join, char **plan)
 {
-    // Check if the record exists in the table
-    RecordMgr *recordManager = (RecordMgr *)(*table).mgmtData;
-    bool shouldFetchRecord = true;
-
-    // Attempt to pin the page, return error if pinning fails or if the record is not found
-    if (pinPage(&(*recordManager).bp, &(*recordManager).pageHandle, id.page) == RC_ERROR)
-    {
-        mgrHandler.currState.TM_resp = FOUND_NOT_RECORD;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
-    }
+    if (join == NULL || join->mgmtData == NULL || plan == NULL)
+        return RC_NULL_ARGUMENT;
 
-    // Get the record data from the page
-    char *dataPointer = (*recordManager).pageHandle.data;
-    dataPointer += (id.slot * getRecordSize(table->schema));
+    JoinMgr *jm = join->mgmtData;
+    char *leftAttr = jm->schema->attrNames[jm->attr[JOIN_LEFT]];
+    char *rightAttr = jm->schema->attrNames[join->left->schema->numAttr + jm->attr[JOIN_RIGHT]];
 
-    // Check if the record is found
-    // # is used to indicate that the record is not found
-    if (*dataPointer == '#')
+    *plan = (char *)malloc(strlen(leftAttr) + 2 * strlen(rightAttr) + strlen(jm->rel[JOIN_LEFT]->name) +
+                           strlen(jm->rel[JOIN_RIGHT]->name) + 96);
+    if (jm->method == JOIN_INDEX_NESTED_LOOP)
     {
-        // Check if the record should be fetched
-        if (shouldFetchRecord)
-        {
-            char *recordData = outputRecord->data;
-            outputRecord->id = id;
-            // Copy the record data
-            memcpy(++recordData, dataPointer + 1, getRecordSize(table->schema) - 1);
-        }
+        RecordMgr *rMgr = join->right->mgmtData;
+        bool hash = rMgr->indexKinds[findTableIndex(rMgr, jm->attr[JOIN_RIGHT])] == INDEX_HASH;
+        sprintf(*plan, "INDEX NESTED LOOP JOIN on %s = %s using the %s on %s", leftAttr, rightAttr,
+                hash ? "hash index" : "B+-tree", rightAttr);
     }
+    else if (jm->numPartitions > 0)
+        sprintf(*plan, "HASH JOIN on %s = %s building on %s in %d partitions on disk", leftAttr, rightAttr,
+                jm->rel[jm->build]->name, jm->numPartitions - jm->numSplit);
     else
-    {
-        if (shouldFetchRecord)
-        {
-            return RC_RM_NO_MORE_TUPLES;
-        }
-    }
+        sprintf(*plan, "HASH JOIN on %s = %s building on %s in memory", leftAttr, rightAttr, jm->rel[jm->build]->name);
+    return RC_OK;
+}
 
-    // Unpin the page after completing the operation
-    if (unpinPage(&(*recordManager).bp, &(*recordManager).pageHandle) == RC_ERROR)
+/*
+    # releases a join, its hash table and its temporary partition files
+*/
+RC closeJoin(RM_JoinHandle *join)
+{
+    if (join == NULL || join->mgmtData == NULL)
+        return RC_NULL_ARGUMENT;
+
+    JoinMgr *jm = join->mgmtData;
+    rewindJoinCursor(jm, jm->cursorSide);
+    if (jm->cursor->snapshot != NULL)
+        closeSnapshot(jm->cursor->snapshot);
+    free(jm->cursor->snapshot);
+    free(jm->cursor);
+    if (jm->buckets != NULL)
+        clearJoinTable(jm);
+    free(jm->buckets);
+    for (int side = JOIN_LEFT; side <= JOIN_RIGHT; side++)
     {
-        mgrHandler.currState.TM_resp = FOUND_NOT_RECORD;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        for (int p = 0; jm->runs[side] != NULL && p < jm->numPartitions; p++)
+            closeTempRun(&jm->runs[side][p]);
+        free(jm->runs[side]);
+        if (jm->rec[side] != NULL)
+            freeRecord(jm->rec[side]);
     }
-
-    // Log successful retrieval of the record
-    mgrHandler.currState.TM_resp = FOUND_RECORD;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+    free(jm->rids);
+    free(jm->levels);
+    freeTableSchema(jm->schema);
+    free(jm);
+    join->mgmtData = NULL;
     return RC_OK;
 }
 
+/* Sorting */
+
+// Memory for the records of a sort when startSort is given none, in pages
+#define SORT_DEFAULT_MEMORY_PAGES 1024
+
 /*
-    # This function returns the size of the record in bytes based on the schema
-    # and the data types in the schema
+    # Merges sorted runs; the heap holds the current head entry of every run that is not
+    # used up, the head of run r lives at heads + r * entrySize
 */
-int getRecordSize(Schema *customSchema)
+typedef struct RunMerge
 {
-    // Check if the schema is valid
-    if (customSchema == NULL || customSchema->numAttr <= 0)
-    {
-        printf("Invalid schema or schema has no attributes\n");
-        return -1;
-    }
+    TempRun *runs;
+    int numRuns;
+    char *heads;
+    char **heap;
+    int heapSize;
+} RunMerge;
 
-    int totalSize = 0;
+/*
+    # An entry of a sort is the RID of a record followed by its record image
+*/
+typedef struct SortMgr
+{
+    Schema *schema;
+    int numKeys;
+    RM_SortKey *keys;
+    int *keyOffsets;
+    int *keySizes;
+    int recordSize;
+    int entrySize;
+    long limit; // records nextSorted returns at most, 0 for all
+    long returned;
+    long numRecords;
+    bool topN;
+    // sorted entries when everything fit in memory
+    char *arena;
+    char **entries;
+    int numEntries;
+    int pos;
+    // otherwise the runs on disk and their final merge
+    int initialRuns;
+    int mergePasses;
+    int runsCreated; // names the run files
+    RunMerge merge;
+    char *entry; // entry nextSorted copies out of the merge
+} SortMgr;
 
-    // Calculate the total size of the record based on the schema
-    for (int i = 0; i < customSchema->numAttr; i++)
+/*
+    # orders two entries on the sort keys, NULLs are smaller than any value
+*/
+static int compareSortEntries(SortMgr *sm, char *left, char *right)
+{
+    char *leftImage = left + sizeof(RID), *rightImage = right + sizeof(RID);
+    char *leftNulls = nullBitmap(sm->schema, leftImage), *rightNulls = nullBitmap(sm->schema, rightImage);
+
+    for (int k = 0; k < sm->numKeys; k++)
     {
-        switch (customSchema->dataTypes[i])
-        {
-        case DT_INT:
-            totalSize += sizeof(int);
-            break;
-        case DT_STRING:
-            totalSize += customSchema->typeLength[i];
-            break;
-        case DT_FLOAT:
-            totalSize += sizeof(float);
-            break;
-        case DT_BOOL:
-            totalSize += sizeof(bool);
-            break;
-        default:
-            printf("Unrecognized data type\n");
-            // Return error if an unidentified data type is found
-            return -1;
-        }
-    }
+        int attr = sm->keys[k].attrNum, order;
+        bool notNull = declaredNotNull(sm->schema, attr);
+        bool leftNull = !notNull && isNullBit(leftNulls, attr), rightNull = !notNull && isNullBit(rightNulls, attr);
 
-    // Add 1 for the record's metadata
-    return totalSize + 1;
+        if (leftNull || rightNull)
+            order = (int)rightNull - (int)leftNull;
+        else
+            order = compareAttrBytes(sm->schema->dataTypes[attr], sm->keySizes[k], leftImage + sm->keyOffsets[k],
+                                     rightImage + sm->keyOffsets[k]);
+        if (order != 0)
+            return sm->keys[k].descending ? -order : order;
+    }
+    return 0;
 }
 
 /*
-    # the function is used to initialize the scan manager
-    # and all its attributes
+    # restores the heap order below position i; sign 1 keeps the largest entry on top, -1 the smallest
 */
-RC startScan(RM_TableData *r, RM_ScanHandle *s_handle, Expr *condition)
+static void siftDownEntries(SortMgr *sm, char **heap, int n, int i, int sign)
 {
-    if (condition == NULL)
+    while (true)
     {
-        mgrHandler.currState.TM_resp = SCAN_FAIL;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_SCAN_CONDITION_NOT_FOUND;
+        int top = i, left = 2 * i + 1, right = 2 * i + 2;
+        if (left < n && sign * compareSortEntries(sm, heap[left], heap[top]) > 0)
+            top = left;
+        if (right < n && sign * compareSortEntries(sm, heap[right], heap[top]) > 0)
+            top = right;
+        if (top == i)
+            return;
+        char *swap = heap[i];
+        heap[i] = heap[top];
+        heap[top] = swap;
+        i = top;
     }
+}
 
-    if (openTable(r, "ScanTable") == RC_ERROR)
+static void siftUpEntries(SortMgr *sm, char **heap, int i, int sign)
+{
+    while (i > 0 && sign * compareSortEntries(sm, heap[i], heap[(i - 1) / 2]) > 0)
     {
-        mgrHandler.currState.TM_resp = SCAN_FAIL;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        char *swap = heap[i];
+        heap[i] = heap[(i - 1) / 2];
+        heap[(i - 1) / 2] = swap;
+        i = (i - 1) / 2;
     }
+}
 
-    mgrHandler.sm = (RecordMgr *)malloc(sizeof(RecordMgr));
-    s_handle->mgmtData = mgrHandler.sm;
-    mgrHandler.sm->r_id.page = 1;
-    mgrHandler.sm->r_id.slot = 0;
-
-    mgrHandler.sm->scanCount = 0;
-    mgrHandler.sm->condition = condition;
-
-    mgrHandler.tm = r->mgmtData;
-    mgrHandler.tm->countOfTuples = SIZE_OF_ATTRIBUTE;
+/*
+    # sorts entries in place with a heap sort
+*/
+static void sortEntries(SortMgr *sm, char **entries, int n)
+{
+    for (int i = n / 2 - 1; i >= 0; i--)
+        siftDownEntries(sm, entries, n, i, 1);
+    for (int end = n - 1; end > 0; end--)
+    {
+        char *swap = entries[0];
+        entries[0] = entries[end];
+        entries[end] = swap;
+        siftDownEntries(sm, entries, end, 0, 1);
+    }
+}
 
-    s_handle->rel = r;
+static RC startRunMerge(SortMgr *sm, RunMerge *merge, TempRun *runs, int numRuns)
+{
+    RC status;
 
-    mgrHandler.currState.SCN_resp = SCAN_FAIL;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+    merge->runs = runs;
+    merge->numRuns = numRuns;
+    merge->heads = (char *)malloc((long)numRuns * sm->entrySize);
+    merge->heap = (char **)malloc(numRuns * sizeof(char *));
+    merge->heapSize = 0;
+    for (int r = 0; r < numRuns; r++)
+    {
+        char *head = merge->heads + (long)r * sm->entrySize;
+        status = readTempRun(&runs[r], head, sm->entrySize);
+        if (status == RC_RM_NO_MORE_TUPLES)
+            continue;
+        if (status != RC_OK)
+            return status;
+        merge->heap[merge->heapSize++] = head;
+    }
+    for (int i = merge->heapSize / 2 - 1; i >= 0; i--)
+        siftDownEntries(sm, merge->heap, merge->heapSize, i, -1);
     return RC_OK;
 }
 
 /*
-    # this funtion evaluates the condition
-    # return the tuples taht staisfy the condition given
-    # if no condition is provided it returns all the tuples
+    # copies the smallest head entry of a merge into entry and refills it from its run
 */
-RC next(RM_ScanHandle *scan, Record *rec)
-
+static RC nextMerged(SortMgr *sm, RunMerge *merge, char *entry)
 {
-    RecordMgr *sm = scan->mgmtData, *tm = scan->rel->mgmtData;
+    if (merge->heapSize == 0)
+        return RC_RM_NO_MORE_TUPLES;
 
-    int slotCount;
+    char *head = merge->heap[0];
+    int r = (head - merge->heads) / sm->entrySize;
+    memcpy(entry, head, sm->entrySize);
 
-    int count_scan_var_val = 1;
+    RC status = readTempRun(&merge->runs[r], head, sm->entrySize);
+    if (status == RC_RM_NO_MORE_TUPLES)
+        merge->heap[0] = merge->heap[--merge->heapSize];
+    else if (status != RC_OK)
+        return status;
+    siftDownEntries(sm, merge->heap, merge->heapSize, 0, -1);
+    return RC_OK;
+}
 
-    int chkVal_flag = true;
+static void endRunMerge(RunMerge *merge)
+{
+    for (int r = 0; r < merge->numRuns; r++)
+        closeTempRun(&merge->runs[r]);
+    free(merge->runs);
+    free(merge->heads);
+    free(merge->heap);
+    merge->runs = NULL;
+    merge->heads = NULL;
+    merge->heap = NULL;
+    merge->numRuns = 0;
+}
 
-    Schema *schema = scan->rel->schema;
+static RC newSortRun(SortMgr *sm, RM_TableData *rel, TempRun *run)
+{
+    char *fileName = (char *)malloc(strlen(rel->name) + 48);
+    sprintf(fileName, "%s.%lx.stmp%d", rel->name, (unsigned long)sm, sm->runsCreated++);
+    return openTempRun(run, fileName);
+}
 
-    Value *outputExpr = (Value *)malloc(sizeof(Value));
+/*
+    # sorts the numEntries entries in the arena and writes them out as a new run
+*/
+static RC spillSortRun(SortMgr *sm, RM_TableData *rel, TempRun **runs, int *numRuns)
+{
+    RC status;
 
-    int tuple_Count = 0;
+    sortEntries(sm, sm->entries, sm->numEntries);
+    *runs = (TempRun *)realloc(*runs, (*numRuns + 1) * sizeof(TempRun));
+    TempRun *run = &(*runs)[*numRuns];
+    memset(run, 0, sizeof(TempRun));
+    if ((status = newSortRun(sm, rel, run)) != RC_OK)
+        return status;
+    (*numRuns)++;
+    for (int i = 0; i < sm->numEntries; i++)
+    {
+        if ((status = writeTempRun(run, sm->entries[i], sm->entrySize)) != RC_OK)
+            return status;
+    }
+    sm->numEntries = 0;
+    return finishTempRun(run);
+}
 
-    slotCount = PAGE_SIZE / getRecordSize(schema);
-    int dem = 1;
-    while (sm->scanCount <= tm->countOfTuples && MAX_COUNT > 0)
+/*
+    # merges runs fanIn at a time into longer runs until one final merge of at most fanIn runs is left
+*/
+static RC mergeSortRuns(SortMgr *sm, RM_TableData *rel, TempRun *runs, int numRuns, int fanIn)
+{
+    RC status = RC_OK;
 
+    while (numRuns > fanIn)
     {
-        count_scan_var_val--;
-
-        if (sm->scanCount <= 0 && tuple_Count == 0)
+        int numMerged = (numRuns + fanIn - 1) / fanIn;
+        TempRun *merged = (TempRun *)calloc(numMerged, sizeof(TempRun));
 
+        for (int m = 0; m < numMerged && status == RC_OK; m++)
         {
-            if (chkVal_flag && tuple_Count == 0)
-
+            int first = m * fanIn, count = numRuns - first < fanIn ? numRuns - first : fanIn;
+            RunMerge merge;
+
+            memset(&merge, 0, sizeof(RunMerge));
+            merge.runs = (TempRun *)malloc(count * sizeof(TempRun));
+            merge.numRuns = count;
+            memcpy(merge.runs, runs + first, count * sizeof(TempRun));
+            memset(runs + first, 0, count * sizeof(TempRun));
+            if ((status = newSortRun(sm, rel, &merged[m])) == RC_OK &&
+                (status = startRunMerge(sm, &merge, merge.runs, count)) == RC_OK)
             {
-                sm->r_id.page = 1;
-                dem = 2;
+                while ((status = nextMerged(sm, &merge, sm->entry)) == RC_OK)
+                {
+                    if ((status = writeTempRun(&merged[m], sm->entry, sm->entrySize)) != RC_OK)
+                        break;
+                }
+                if (status == RC_RM_NO_MORE_TUPLES)
+                    status = finishTempRun(&merged[m]);
             }
-
-            sm->r_id.slot = 0 + 0;
+            endRunMerge(&merge);
         }
 
-        else
-        {
-            if (dem)
-            {
-                sm->r_id.slot++;
+        for (int r = 0; r < numRuns; r++)
+            closeTempRun(&runs[r]);
+        free(runs);
+        runs = merged;
+        numRuns = numMerged;
+        sm->mergePasses++;
+        if (status != RC_OK)
+            break;
+    }
 
-                if (chkVal_flag)
-                {
+    sm->merge.runs = runs;
+    sm->merge.numRuns = numRuns;
+    if (status != RC_OK)
+        return status;
+    sm->mergePasses++;
+    return startRunMerge(sm, &sm->merge, runs, numRuns);
+}
 
-                    if (sm->r_id.slot >= slotCount)
+/*
+    # keeps the limit smallest entries seen so far in a heap with the largest on top
+*/
+static void addTopEntry(SortMgr *sm, Record *record)
+{
+    memcpy(sm->entry, &record->id, sizeof(RID));
+    memcpy(sm->entry + sizeof(RID), record->data, sm->recordSize);
+    if (sm->numEntries < sm->limit)
+    {
+        char *entry = sm->arena + (long)sm->numEntries * sm->entrySize;
+        memcpy(entry, sm->entry, sm->entrySize);
+        sm->entries[sm->numEntries] = entry;
+        siftUpEntries(sm, sm->entries, sm->numEntries++, 1);
+    }
+    // Once the heap is full only a record smaller than the largest kept one gets in, in its place
+    else if (compareSortEntries(sm, sm->entry, sm->entries[0]) < 0)
+    {
+        memcpy(sm->entries[0], sm->entry, sm->entrySize);
+        siftDownEntries(sm, sm->entries, sm->numEntries, 0, 1);
+    }
+}
 
-                    {
-                        dem = 1;
-                        sm->r_id.slot = 0, sm->r_id.page++, tuple_Count--;
-                    }
-                }
-            }
-        }
+/*
+    # reads the records of a scan into the sort: into the top-N heap, or into the arena,
+    # which is sorted and spilled as a run whenever it is full
+*/
+static RC readSortInput(SortMgr *sm, RM_TableData *rel, RM_ScanHandle *scan, int capacity, TempRun **runs, int *numRuns)
+{
+    Record *record;
+    RC status;
 
-        if (pinPage(&tm->bp, &sm->pageHandle, sm->r_id.page) == RC_ERROR)
+    if ((status = createRecord(&record, rel->schema)) != RC_OK)
+        return status;
+    while ((status = next(scan, record)) == RC_OK)
+    {
+        sm->numRecords++;
+        if (sm->topN)
         {
-            mgrHandler.currState.SCN_resp = SCAN_FAIL;
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
-            return RC_ERROR;
+            addTopEntry(sm, record);
+            continue;
         }
+        if (sm->numEntries == capacity && (status = spillSortRun(sm, rel, runs, numRuns)) != RC_OK)
+            break;
+        char *entry = sm->arena + (long)sm->numEntries * sm->entrySize;
+        memcpy(entry, &record->id, sizeof(RID));
+        memcpy(entry + sizeof(RID), record->data, sm->recordSize);
+        sm->entries[sm->numEntries++] = entry;
+    }
+    freeRecord(record);
+    return status == RC_RM_NO_MORE_TUPLES ? RC_OK : status;
+}
 
-        int val = 1;
-        char *recordDta;
-        char *valPtr;
-        if (val)
-        {
-            int dta = 1;
-            recordDta = sm->pageHandle.data;
-            if (dta)
-            {
-                recordDta += (sm->r_id.slot * getRecordSize(schema));
-
-                rec->id.page = sm->r_id.page;
-                rec->id.slot = sm->r_id.slot;
-
-                // initializing and updating valPtr with rrecord data
-                valPtr = rec->data;
-                *valPtr = '-';
-            }
+/*
+    # sorts the records of rel that satisfy cond (every record if cond is NULL) on numKeys keys,
+    # the first key first; nextSorted returns them in order, NULLs before every value of a key
+    # Records are sorted in an arena of memoryPages pages (0 for the default); what does not fit is
+    # sorted into runs in temporary page files (<table>.<id>.stmp<n>) that are merged k-way,
+    # with as many runs per merge as the budget has pages for
+    # With limit > 0 only the first limit records are returned, and if they fit in the budget
+    # they are kept in a heap while the scan runs instead of sorting everything
+*/
+RC startSort(RM_TableData *rel, Expr *cond, int numKeys, RM_SortKey *keys, int limit, int memoryPages,
+             RM_SortHandle *sort)
+{
+    RM_ScanHandle scan;
+    Expr *all = NULL;
+    TempRun *runs = NULL;
+    int numRuns = 0;
+    RC status;
 
-            if (val)
-            {
-                memcpy(++valPtr, recordDta + 1, getRecordSize(schema) - 1);
-                val++;
-            }
+    if (rel == NULL || rel->mgmtData == NULL || keys == NULL || numKeys <= 0 || sort == NULL)
+        return RC_NULL_ARGUMENT;
+    for (int k = 0; k < numKeys; k++)
+    {
+        if (keys[k].attrNum < 0 || keys[k].attrNum >= rel->schema->numAttr)
+            return RC_ERROR;
+    }
 
-            sm->scanCount++;
-        }
+    SortMgr *sm = (SortMgr *)calloc(1, sizeof(SortMgr));
+    if (sm == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    sort->rel = rel;
+    sort->mgmtData = sm;
+
+    Schema *schema = rel->schema;
+    sm->schema = schema;
+    sm->numKeys = numKeys;
+    sm->keys = (RM_SortKey *)malloc(numKeys * sizeof(RM_SortKey));
+    memcpy(sm->keys, keys, numKeys * sizeof(RM_SortKey));
+    sm->keyOffsets = (int *)malloc(numKeys * sizeof(int));
+    sm->keySizes = (int *)malloc(numKeys * sizeof(int));
+    for (int k = 0; k < numKeys; k++)
+    {
+        int attr = keys[k].attrNum;
+        attrOffset(schema, attr, &sm->keyOffsets[k]);
+        sm->keySizes[k] = schema->dataTypes[attr] == DT_STRING ? schema->typeLength[attr] : fixedAttrSize(schema->dataTypes[attr]);
+    }
+    sm->recordSize = getRecordSize(schema);
+    sm->entrySize = sizeof(RID) + sm->recordSize;
+    sm->limit = limit > 0 ? limit : 0;
+    sm->entry = (char *)malloc(sm->entrySize);
+
+    long budget = (long)(memoryPages > 0 ? memoryPages : SORT_DEFAULT_MEMORY_PAGES) * PAGE_SIZE;
+    long capacity = budget / (sm->entrySize + sizeof(char *));
+    if (capacity < 2)
+        capacity = 2;
+    sm->topN = sm->limit > 0 && sm->limit <= capacity;
+    if (sm->topN)
+        capacity = sm->limit;
+    else if (capacity > (long)getNumTuples(rel) + 1)
+        capacity = getNumTuples(rel) + 1;
+    sm->arena = (char *)malloc(capacity * sm->entrySize);
+    sm->entries = (char **)malloc(capacity * sizeof(char *));
+
+    // The scan picks an index for the condition if it can, a sort of everything scans with TRUE
+    if (cond == NULL)
+    {
+        Value *yes;
+        MAKE_VALUE(yes, DT_BOOL, TRUE);
+        MAKE_CONS(all, yes);
+        cond = all;
+    }
+    if ((status = startScan(rel, &scan, cond)) == RC_OK)
+    {
+        status = readSortInput(sm, rel, &scan, (int)capacity, &runs, &numRuns);
+        closeScan(&scan);
+    }
+    if (all != NULL)
+        freeExpr(all);
 
-        if (evalExpr(rec, schema, sm->condition, &outputExpr) == RC_ERROR)
+    if (status == RC_OK && numRuns > 0)
+    {
+        // What is left in the arena becomes the last run
+        sm->initialRuns = numRuns + (sm->numEntries > 0);
+        if (sm->numEntries > 0)
+            status = spillSortRun(sm, rel, &runs, &numRuns);
+        free(sm->arena);
+        free(sm->entries);
+        sm->arena = NULL;
+        sm->entries = NULL;
+        if (status == RC_OK)
         {
-            mgrHandler.currState.SCN_resp = SCAN_FAIL;
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
-            return RC_ERROR;
+            int fanIn = memoryPages > 0 ? memoryPages - 1 : SORT_DEFAULT_MEMORY_PAGES - 1;
+            status = mergeSortRuns(sm, rel, runs, numRuns, fanIn < 2 ? 2 : fanIn);
         }
-        tuple_Count = tuple_Count - 1;
-
-        while (outputExpr->v.boolV == TRUE)
+        else
         {
-
-            if (unpinPage(&tm->bp, &sm->pageHandle) == RC_ERROR)
-            {
-                mgrHandler.currState.SCN_resp = SCAN_FAIL;
-                mgrHandler.currState.recordUpdatedAt = time(NULL);
-                return RC_ERROR;
-            }
-
-            count_scan_var_val = count_scan_var_val + 1;
-
-            mgrHandler.currState.SCN_resp = SCAN_SUCCESS;
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
-            return RC_OK;
+            sm->merge.runs = runs;
+            sm->merge.numRuns = numRuns;
         }
     }
+    else if (status == RC_OK)
+        sortEntries(sm, sm->entries, sm->numEntries);
+    else
+    {
+        sm->merge.runs = runs;
+        sm->merge.numRuns = numRuns;
+    }
 
-    if (unpinPage(&tm->bp, &sm->pageHandle) == RC_ERROR)
+    if (status != RC_OK)
     {
-        mgrHandler.currState.SCN_resp = SCAN_FAIL;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
-        return RC_ERROR;
+        closeSort(sort);
+        return status;
     }
+    return RC_OK;
+}
 
-    sm->r_id.page = 1;
+/*
+    # the next record in sort order, RC_RM_NO_MORE_TUPLES after the last one
+*/
+RC nextSorted(RM_SortHandle *sort, Record *record)
+{
+    char *entry;
+    RC status;
 
-    tuple_Count--;
-    sm->r_id.slot = 0;
+    if (sort == NULL || sort->mgmtData == NULL || record == NULL)
+        return RC_NULL_ARGUMENT;
 
-    count_scan_var_val = tuple_Count + 1;
-    sm->scanCount = 0;
+    SortMgr *sm = sort->mgmtData;
+    if (sm->limit > 0 && sm->returned >= sm->limit)
+        return RC_RM_NO_MORE_TUPLES;
+    if (sm->entries != NULL)
+    {
+        if (sm->pos >= sm->numEntries)
+            return RC_RM_NO_MORE_TUPLES;
+        entry = sm->entries[sm->pos++];
+    }
+    else
+    {
+        if ((status = nextMerged(sm, &sm->merge, sm->entry)) != RC_OK)
+            return status;
+        entry = sm->entry;
+    }
 
-    return RC_RM_NO_MORE_TUPLES;
+    memcpy(&record->id, entry, sizeof(RID));
+    memcpy(record->data, entry + sizeof(RID), sm->recordSize);
+    sm->returned++;
+    return RC_OK;
 }
 
 /*
-    # deallocates all the memory allocated to the scan manager
+    # describes how a sort ran, e.g. "TOP-N HEAP keeping 10 of 5000 records",
+    # "IN-MEMORY SORT of 5000 records" or "EXTERNAL MERGE SORT of 5000 records in 12 runs, 2 merge passes"
+    # the caller frees the returned string
 */
-RC closeScan(RM_ScanHandle *scan)
+RC explainSort(RM_SortHandle *sort, char **plan)
 {
+    if (sort == NULL || sort->mgmtData == NULL || plan == NULL)
+        return RC_NULL_ARGUMENT;
 
-    RecordMgr *Record_Mgr = scan->rel->mgmtData;
-    int counter = 0;
-    mgrHandler.sm = scan->mgmtData;
-    while (mgrHandler.sm->scanCount > 0)
-    {
-        if (unpinPage(&Record_Mgr->bp, &mgrHandler.sm->pageHandle) == RC_ERROR)
-        {
-            mgrHandler.currState.SCN_resp = SCAN_FAIL;
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
-            counter = 1;
-            return RC_ERROR;
-        }
-        mgrHandler.sm->scanCount = 0;
-        mgrHandler.sm->r_id.slot = 0;
-    }
+    SortMgr *sm = sort->mgmtData;
+    *plan = (char *)malloc(128);
+    if (sm->topN)
+        sprintf(*plan, "TOP-N HEAP keeping %ld of %ld records", sm->limit, sm->numRecords);
+    else if (sm->entries != NULL)
+        sprintf(*plan, "IN-MEMORY SORT of %ld records", sm->numRecords);
+    else
+        sprintf(*plan, "EXTERNAL MERGE SORT of %ld records in %d runs, %d merge passes", sm->numRecords,
+                sm->initialRuns, sm->mergePasses);
+    return RC_OK;
+}
 
-    scan->mgmtData = NULL;
-    free(scan->mgmtData);
-    counter = 2;
+/*
+    # releases a sort and removes its temporary run files
+*/
+RC closeSort(RM_SortHandle *sort)
+{
+    if (sort == NULL || sort->mgmtData == NULL)
+        return RC_NULL_ARGUMENT;
 
-    mgrHandler.currState.SCN_resp = SCAN_SUCCESS;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+    SortMgr *sm = sort->mgmtData;
+    endRunMerge(&sm->merge);
+    free(sm->arena);
+    free(sm->entries);
+    free(sm->entry);
+    free(sm->keys);
+    free(sm->keyOffsets);
+    free(sm->keySizes);
+    free(sm);
+    sort->mgmtData = NULL;
     return RC_OK;
 }
 
@@ -989,8 +8540,8 @@ Schema *createSchema(int numAttr, char **attrNames, DataType *dataTypes, int *ty
     // Check if parameters are valid for schema creation
     if (keySize <= 0)
     {
-        mgrHandler.currState.schema_resp = SCHEMA_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
+        currState.schema_resp = SCHEMA_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
         return NULL;
     }
 
@@ -998,8 +8549,8 @@ Schema *createSchema(int numAttr, char **attrNames, DataType *dataTypes, int *ty
     Schema *schema = (Schema *)malloc(sizeof(Schema));
     if (schema == NULL)
     {
-        mgrHandler.currState.schema_resp = SCHEMA_NOT_CREATED;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
+        currState.schema_resp = SCHEMA_NOT_CREATED;
+        currState.recordUpdatedAt = time(NULL);
         return NULL;
     }
 
@@ -1011,6 +8562,11 @@ Schema *createSchema(int numAttr, char **attrNames, DataType *dataTypes, int *ty
     schema->keySize = keySize;
     schema->keyAttrs = keys;
 
+    // Primary key attributes are NOT NULL
+    schema->notNull = (bool *)calloc(numAttr, sizeof(bool));
+    for (int k = 0; k < keySize; k++)
+        schema->notNull[keys[k]] = true;
+
     return schema;
 }
 
@@ -1023,6 +8579,7 @@ RC freeSchema(Schema *schema)
     if (schema != NULL)
     {
         // Free the memory allocated for the schema
+        free(schema->notNull);
         free(schema);
         // Set the schema pointer to NULL
         schema = NULL;
@@ -1031,6 +8588,24 @@ RC freeSchema(Schema *schema)
     return RC_OK;
 }
 
+/*
+    # declares attribute attrNum NOT NULL (or nullable again) before the table is created
+    # key attributes cannot be made nullable
+*/
+RC setNotNull(Schema *schema, int attrNum, bool notNull)
+{
+    if (schema == NULL || schema->notNull == NULL)
+        return RC_NULL_ARGUMENT;
+    if (attrNum < 0 || attrNum >= schema->numAttr)
+        return RC_ERROR;
+
+    if (!notNull && isKeyAttr(schema, attrNum))
+        return RC_ERROR;
+
+    schema->notNull[attrNum] = notNull;
+    return RC_OK;
+}
+
 /*
     # implementation of attrOffset
     # calculates the offset of the record
@@ -1038,7 +8613,6 @@ RC freeSchema(Schema *schema)
 RC attrOffset(Schema *schema, int attrNum, int *result)
 {
     int offsetVal = 1;
-    int dt_type = 0;
     if (offsetVal)
     {
 
@@ -1049,27 +8623,22 @@ RC attrOffset(Schema *schema, int attrNum, int *result)
 
             if (schema->dataTypes[k] == DT_STRING)
             {
-                dt_type = 1;
                 *result += schema->typeLength[k];
             }
             else if (schema->dataTypes[k] == DT_INT)
             {
-                dt_type = 2;
                 *result += sizeof(int);
             }
             else if (schema->dataTypes[k] == DT_BOOL)
             {
-                dt_type = 3;
                 *result += sizeof(bool);
             }
             else if (schema->dataTypes[k] == DT_FLOAT)
             {
-                dt_type = 4;
                 *result += sizeof(float);
             }
             else
             {
-                dt_type = 1;
                 return RC_RM_UNKOWN_DATATYPE;
             }
         }
@@ -1092,7 +8661,8 @@ RC createRecord(Record **record, Schema *schema)
         return RC_MEM_ALLOCATION_FAIL;
 
     int recordSize = getRecordSize(schema);
-    rec->data = (char *)malloc(recordSize * sizeof(char));
+    // Zeroed so that no attribute starts out NULL
+    rec->data = (char *)calloc(recordSize, sizeof(char));
     if (rec->data == NULL)
         return CREATE_RECORD_FAILED;
 
@@ -1139,20 +8709,25 @@ RC getAttr(Record *record, Schema *schema, int attrNum, Value **attrValue)
     else
     {
         char *recordDT = record->data;
+
+        // NOT NULL attributes skip the null bitmap
+        if (!declaredNotNull(schema, attrNum) && isNullBit(nullBitmap(schema, recordDT), attrNum))
+        {
+            MAKE_NULL_VALUE(*attrValue, schema->dataTypes[attrNum]);
+            return RC_OK;
+        }
+
         attrOffset(schema, attrNum, &attrPos);
         bool isOffset = true;
 
         Value *attrDT = (Value *)malloc(sizeof(Value));
+        attrDT->isNull = FALSE;
 
         if (attrPos >= 0)
         {
             recordDT = recordDT + attrPos;
         }
         if (attrPos != 0 && ptr > 0)
-        {
-            schema->dataTypes[attrNum] = (attrNum != 1) ? schema->dataTypes[attrNum] : 1;
-        }
-        if (attrPos != 0 && ptr > 0)
         {
             switch (schema->dataTypes[attrNum])
             {
@@ -1164,8 +8739,8 @@ RC getAttr(Record *record, Schema *schema, int attrNum, Value **attrValue)
                     memcpy(&value, recordDT, sizeof(int));
                     attrDT->dt = DT_INT;
                     attrDT->v.intV = value;
-                    break;
                 }
+                break;
             }
 
             case DT_STRING:
@@ -1219,8 +8794,8 @@ RC getAttr(Record *record, Schema *schema, int attrNum, Value **attrValue)
             if (isOffset)
             {
                 *attrValue = attrDT;
-                mgrHandler.currState.SCN_resp = SCAN_FAIL;
-                mgrHandler.currState.recordUpdatedAt = time(NULL);
+                currState.SCN_resp = SCAN_FAIL;
+                currState.recordUpdatedAt = time(NULL);
             }
             return RC_OK;
         }
@@ -1233,11 +8808,8 @@ RC getAttr(Record *record, Schema *schema, int attrNum, Value **attrValue)
 */
 RC setAttr(Record *record, Schema *schema, int attrNum, Value *value)
 {
-    bool toSetAttribute = true;
-    float attr = 0;
     int rattr = -1;
     int fop = 1;
-    int attrPosition = 0;
     int attributeVal = 0;
     rattr += attributeVal;
 
@@ -1245,25 +8817,31 @@ RC setAttr(Record *record, Schema *schema, int attrNum, Value *value)
     {
 
         attributeVal += 1;
-        mgrHandler.currState.SCN_resp = SCAN_SUCCESS;
+        currState.SCN_resp = SCAN_SUCCESS;
         if (fop)
         {
-            mgrHandler.currState.recordUpdatedAt = time(NULL);
+            currState.recordUpdatedAt = time(NULL);
         }
         return RC_ERROR;
     }
 
     if (attrOffset(schema, attrNum, &attributeVal) != RC_OK)
     {
-        mgrHandler.currState.SCN_resp = SCAN_FAIL;
-        mgrHandler.currState.recordUpdatedAt = time(NULL);
+        currState.SCN_resp = SCAN_FAIL;
+        currState.recordUpdatedAt = time(NULL);
         return RC_ERROR;
     }
 
     char *pointer_d = record->data + attributeVal;
     char *pointer_e = record->data;
 
-    if (schema->dataTypes[attrNum] == DT_INT)
+    // A NULL only sets its bit, the attribute bytes are zeroed so that equal records compare equal
+    setNullBit(nullBitmap(schema, pointer_e), attrNum, value->isNull);
+    if (value->isNull)
+    {
+        memset(pointer_d, 0, schema->dataTypes[attrNum] == DT_STRING ? schema->typeLength[attrNum] : fixedAttrSize(schema->dataTypes[attrNum]));
+    }
+    else if (schema->dataTypes[attrNum] == DT_INT)
     {
         *(int *)pointer_d = value->v.intV;
     }
@@ -1288,7 +8866,7 @@ RC setAttr(Record *record, Schema *schema, int attrNum, Value *value)
         printf("Datatype not available\n");
     }
 
-    mgrHandler.currState.SCN_resp = SCAN_SUCCESS;
-    mgrHandler.currState.recordUpdatedAt = time(NULL);
+    currState.SCN_resp = SCAN_SUCCESS;
+    currState.recordUpdatedAt = time(NULL);
     return RC_OK;
 }
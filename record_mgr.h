@@ -4,6 +4,182 @@
 #include "dberror.h"
 #include "expr.h"
 #include "tables.h"
+#include "btree_mgr.h"
+#include "hash_mgr.h"
+#include "log_mgr.h"
+#include "lock_mgr.h"
+#include "storage_mgr.h"
+
+// kinds of secondary indexes
+typedef enum IndexKind
+{
+	INDEX_BTREE = 0,
+	INDEX_HASH = 1
+} IndexKind;
+
+// when the log records of inserts, deletes, updates and vacuums reach the disk
+typedef enum WalMode
+{
+	WAL_GROUP_COMMIT = 0,	// in the background, one fsync for a group of operations
+	WAL_SYNC = 1,		// before the operation returns, concurrent operations share fsyncs
+	WAL_OFF = 2		// not logged, a crash can leave the tables torn
+} WalMode;
+
+// options of initRecordManager, a NULL mgmtData keeps the defaults
+typedef struct RM_Options
+{
+	int poolPages;		// frames of the buffer pool of each open table, 0 for the default
+	int sharedPoolPages;	// > 0: all open tables share one buffer pool of this many frames
+	WalMode walMode;
+	int groupCommitSize;	// WAL_GROUP_COMMIT: log records that trigger a sync, 0 for the default
+	int groupCommitMs;	// WAL_GROUP_COMMIT: longest wait of a record for its sync, 0 for the default
+	int checkpointMs;	// time between background checkpoints, 0 for the default, < 0 for none
+	long checkpointLogBytes;	// log growth that triggers a background checkpoint, 0 for the default, < 0 for none
+	long logSegmentBytes;	// size of the log files checkpoints drop, 0 for the default, < 0 for one file
+	int lockShards;		// shards of the lock table, 0 for the default
+	int lockTimeoutMs;	// longest wait for a lock, 0 for the default, < 0 waits until granted or deadlocked
+	PageVerify pageVerify;	// when page checksums are checked on reads of every page file
+} RM_Options;
+
+// The write-ahead log of every table, tables are recovered from it by openTable
+// Older parts of it are segments named WAL_FILE.<LSN>, dropped once a checkpoint made them unneeded
+#define WAL_FILE "sys_wal"
+
+// Between beginTransaction and commitTransaction the inserts, deletes and updates of the calling
+// thread are one transaction: abortTransaction takes all of them back, and so does recovery if
+// the commit did not reach the log. Tables written by a transaction must stay open until it ends.
+
+// Reads see snapshots: a scan sees the table as it was when it started, a transaction sees the
+// tables as they were when it began and its own changes, getRecord outside of both sees the latest
+// changes of committed transactions. Changes made meanwhile do not block them, vacuumTable drops
+// the versions they replaced once no snapshot sees them. Transaction ids are reserved in XID_FILE.
+#define XID_FILE "sys_xids"
+
+// Writes lock what they change: inserts, deletes and updates take an X lock on the record, and IX on
+// its table, kept until their transaction ends, or until they return outside of transactions.
+// lockTable and lockRecord take further locks for the transaction of the calling thread. A write
+// to a record changed by a transaction the writer does not see, committed after its snapshot or
+// still running, fails with RC_TX_CONFLICT (first updater wins). After RC_TX_CONFLICT,
+// RC_LOCK_DEADLOCK or RC_LOCK_TIMEOUT the transaction should be aborted and retried.
+
+// The catalog is a system table listing every table created by the record manager,
+// one row (tableName, fileName, numAttr, schema) per table keyed by tableName; createTable fails
+// with RC_ERROR for a name or serialized schema that does not fit its column
+#define CATALOG_TABLE "sys_tables"
+#define CATALOG_NAME_LENGTH 64
+#define CATALOG_SCHEMA_LENGTH 1000
+
+// how the records of a table are laid out on its data pages
+typedef enum TableLayout
+{
+	TABLE_LAYOUT_ROWS = 0,	// slotted pages, every record stored as a whole
+	TABLE_LAYOUT_PAX = 1	// every page keeps the values of one attribute together, for scans of few attributes
+} TableLayout;
+
+// options of createTableWithOptions, fixed for the life of the table
+typedef struct RM_TableOptions
+{
+	bool compressed;	// pages are kept compressed on disk and decompressed when read into the buffer pool
+	TableLayout layout;
+	bool *dictionaryEncoded;	// one flag per attribute, NULL for none: DT_STRING attributes stored as codes of a table dictionary
+} RM_TableOptions;
+
+// what one call of vacuumTable did
+typedef struct RM_VacuumStats
+{
+	int pagesVisited;
+	int pagesCompacted;	// pages whose holes were squeezed out
+	int pagesFreed;		// pages without records moved to the free page list
+	int pagesTruncated;	// empty pages cut off the end of the file
+	int versionsRemoved;	// deleted records and older versions of records no snapshot sees any more
+	bool passComplete;	// reached the end of the file, the next call starts over
+	double elapsedMs;
+} RM_VacuumStats;
+
+// what one call of checkpoint did
+typedef struct RM_CheckpointStats
+{
+	int tables;		// open tables whose dirty pages were written
+	int pagesWritten;
+	int dirtyPages;		// pages changed during the checkpoint, left dirty in its record
+	int activeTransactions;
+	long logBytesDropped;	// size of the log segments no longer needed by recovery
+	double elapsedMs;
+} RM_CheckpointStats;
+
+// what one call of parallelScan did
+typedef struct RM_ParallelScanStats
+{
+	int numWorkers;
+	int numMatches;
+	int pagesScanned;
+	int steals;		// page ranges taken over from other workers
+	double elapsedMs;
+} RM_ParallelScanStats;
+
+// called by a worker of parallelScan for every matching record, RC_OK continues the scan
+typedef RC (*RM_RecordCallback)(Record *record, int worker, void *context);
+
+// aggregate functions of aggregateScan
+typedef enum AggFunction
+{
+	AGG_COUNT = 0,
+	AGG_SUM = 1,
+	AGG_MIN = 2,
+	AGG_MAX = 3,
+	AGG_AVG = 4
+} AggFunction;
+
+// one aggregate of aggregateScan, COUNT of attribute -1 counts records (COUNT(*))
+typedef struct RM_Aggregate
+{
+	AggFunction func;
+	int attrNum;
+} RM_Aggregate;
+
+// one group of the result of aggregateScan
+typedef struct RM_AggGroup
+{
+	Value *key;		// value of the grouping attribute, NULL without grouping
+	Value **values;		// one per aggregate, in the order they were asked for
+} RM_AggGroup;
+
+typedef struct RM_AggResult
+{
+	int numAggs;
+	int numGroups;
+	RM_AggGroup *groups;
+} RM_AggResult;
+
+// algorithms of startJoin
+typedef enum JoinMethod
+{
+	JOIN_AUTO = 0,			// index nested loop if the right join attribute is indexed, else hash
+	JOIN_HASH = 1,
+	JOIN_INDEX_NESTED_LOOP = 2
+} JoinMethod;
+
+// Bookkeeping for joins
+typedef struct RM_JoinHandle
+{
+	RM_TableData *left;
+	RM_TableData *right;
+	void *mgmtData;
+} RM_JoinHandle;
+
+// one key of startSort
+typedef struct RM_SortKey
+{
+	int attrNum;
+	bool descending;
+} RM_SortKey;
+
+// Bookkeeping for sorts
+typedef struct RM_SortHandle
+{
+	RM_TableData *rel;
+	void *mgmtData;
+} RM_SortHandle;
 
 // Bookkeeping for scans
 typedef struct RM_ScanHandle
@@ -16,10 +192,12 @@ typedef struct RM_ScanHandle
 extern RC initRecordManager(void *mgmtData);
 extern RC shutdownRecordManager();
 extern RC createTable(char *name, Schema *schema);
+extern RC createTableWithOptions(char *name, Schema *schema, RM_TableOptions *options);
 extern RC openTable(RM_TableData *rel, char *name);
 extern RC closeTable(RM_TableData *rel);
 extern RC deleteTable(char *name);
 extern int getNumTuples(RM_TableData *rel);
+extern RC getTableNames(char ***names, int *numTables);
 
 // handling records in a table
 extern RC insertRecord(RM_TableData *rel, Record *record);
@@ -27,15 +205,64 @@ extern RC deleteRecord(RM_TableData *rel, RID id);
 extern RC updateRecord(RM_TableData *rel, Record *record);
 extern RC getRecord(RM_TableData *rel, RID id, Record *record);
 
+// transactions of the calling thread
+extern RC beginTransaction(void);
+extern RC commitTransaction(void);
+extern RC abortTransaction(void);
+extern RC lockTable(RM_TableData *rel, LockMode mode);
+extern RC lockRecord(RM_TableData *rel, RID id, LockMode mode);
+
+// bounding recovery: writes the pages the log is older than and drops the log before them
+extern RC checkpoint(RM_CheckpointStats *stats);
+
+// reclaiming space
+extern RC vacuumTable(RM_TableData *rel, int maxPages, bool truncate, RM_VacuumStats *stats);
+
 // scans
 extern RC startScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond);
+extern RC startProjectedScan(RM_TableData *rel, RM_ScanHandle *scan, Expr *cond, int numAttrs, int *attrs);
+extern RC getScanSchema(RM_ScanHandle *scan, Schema **schema);
 extern RC next(RM_ScanHandle *scan, Record *record);
 extern RC closeScan(RM_ScanHandle *scan);
+extern RC setScanAdaptive(RM_ScanHandle *scan, bool adaptive);
+extern RC explainScan(RM_ScanHandle *scan, char **plan);
+extern RC parallelScan(RM_TableData *rel, Expr *cond, int numWorkers, RM_RecordCallback callback, void *context,
+		RM_ParallelScanStats *stats);
+
+// aggregates
+extern RC aggregateScan(RM_TableData *rel, Expr *cond, int groupAttr, int numAggs, RM_Aggregate *aggs, int numWorkers,
+		RM_AggResult **result);
+extern RC freeAggResult(RM_AggResult *result);
+
+// joins
+extern RC startJoin(RM_TableData *left, int leftAttr, RM_TableData *right, int rightAttr, JoinMethod method,
+		int memoryPages, RM_JoinHandle *join);
+extern RC nextJoin(RM_JoinHandle *join, Record *record);
+extern RC getJoinSchema(RM_JoinHandle *join, Schema **schema);
+extern RC explainJoin(RM_JoinHandle *join, char **plan);
+extern RC closeJoin(RM_JoinHandle *join);
+
+// sorting
+extern RC startSort(RM_TableData *rel, Expr *cond, int numKeys, RM_SortKey *keys, int limit, int memoryPages,
+		RM_SortHandle *sort);
+extern RC nextSorted(RM_SortHandle *sort, Record *record);
+extern RC explainSort(RM_SortHandle *sort, char **plan);
+extern RC closeSort(RM_SortHandle *sort);
+
+// secondary indexes
+extern RC createIndex(RM_TableData *rel, int attrNum);
+extern RC createHashIndex(RM_TableData *rel, int attrNum);
+extern RC dropIndex(RM_TableData *rel, int attrNum);
+extern RC getTableIndex(RM_TableData *rel, int attrNum, BTreeHandle **tree);
+extern RC getTableHashIndex(RM_TableData *rel, int attrNum, HashHandle **hash);
+extern RC getRecordByValue(RM_TableData *rel, int attrNum, Value *value, Record *record);
+extern RC getRecordByKey(RM_TableData *rel, Value **keyValues, Record *record);
 
 // dealing with schemas
 extern int getRecordSize(Schema *schema);
 extern Schema *createSchema(int numAttr, char **attrNames, DataType *dataTypes, int *typeLength, int keySize, int *keys);
 extern RC freeSchema(Schema *schema);
+extern RC setNotNull(Schema *schema, int attrNum, bool notNull);
 
 // dealing with records and attribute values
 extern RC createRecord(Record **record, Schema *schema);
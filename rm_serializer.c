@@ -181,9 +181,21 @@ serializeAttr(Record *record, Schema *schema, int attrNum)
 {
 	int offset;
 	char *attrData;
+	Value *value;
 	VarString *result;
 	MAKE_VARSTRING(result);
 
+	if (getAttr(record, schema, attrNum, &value) == RC_OK)
+	{
+		bool isNull = value->isNull;
+		freeVal(value);
+		if (isNull)
+		{
+			APPEND(result, "%s:NULL", schema->attrNames[attrNum]);
+			RETURN_STRING(result);
+		}
+	}
+
 	attrOffset(schema, attrNum, &offset);
 	attrData = record->data + offset;
 
@@ -235,6 +247,12 @@ serializeValue(Value *val)
 	VarString *result;
 	MAKE_VARSTRING(result);
 
+	if (val->isNull)
+	{
+		APPEND_STRING(result, "NULL");
+		RETURN_STRING(result);
+	}
+
 	switch (val->dt)
 	{
 	case DT_INT:
@@ -259,6 +277,7 @@ stringToValue(char *val)
 {
 	Value *result = (Value *)malloc(sizeof(Value));
 
+	result->isNull = FALSE;
 	switch (val[0])
 	{
 	case 'i':
@@ -278,6 +297,12 @@ stringToValue(char *val)
 		result->dt = DT_BOOL;
 		result->v.boolV = (val[1] == 't') ? TRUE : FALSE;
 		break;
+	case 'n':
+		// "n" followed by the datatype letter, e.g. "ns" is a NULL string
+		result->dt = (val[1] == 'f') ? DT_FLOAT : (val[1] == 's') ? DT_STRING : (val[1] == 'b') ? DT_BOOL : DT_INT;
+		result->isNull = TRUE;
+		result->v.stringV = NULL;
+		break;
 	default:
 		result->dt = DT_INT;
 		result->v.intV = -1;
@@ -323,6 +348,7 @@ deserializeSchema(char *serializedSchemaData)
 	MAKE_VARSTRING(result);
 
 	Schema *schema = (Schema *)malloc(sizeof(Schema));
+	schema->notNull = NULL;
 
 	int schemaNumAttr, lastAttr;
 
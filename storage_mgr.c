@@ -3,51 +3,819 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/uio.h>
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#include <nmmintrin.h>
+#define CRC32C_SSE42
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRC32)
+#include <arm_acle.h>
+#define CRC32C_ARM
+#endif
 
-void initStorageManager(void)
+// Every block on disk is a page followed by its checksum: the CRC32C of the page and its page
+// number, so that a page written to the wrong place fails its check as well; both go to the
+// file in one write. The header block in front of the pages holds the number of pages as text
+#define CHECKSUM_SIZE ((int)sizeof(unsigned int))
+#define BLOCK_SIZE (PAGE_SIZE + CHECKSUM_SIZE)
+#define BLOCK_OFFSET(pageNum) ((off_t)((pageNum) + 1) * BLOCK_SIZE)
+#define HEADER_DIGITS 32
+
+// A compressed page file keeps every page compressed in an extent of SECTOR_SIZE sectors after the
+// header block, an extent header in front saying its length and checksum. Where the extent of each
+// page is, the page map, is kept in memory and written to an extent of its own by syncPageFile and
+// closePageFile, the header block then points to it after the page count. A page is written to a new
+// extent every time, and extents freed since the map was last written are not reused before it is
+// written again: the map on disk may still need them, so a crash leaves every page as of that map
+#define SECTOR_SIZE 64
+#define SECTOR_OFFSET(sector) (BLOCK_SIZE + (off_t)(sector) * SECTOR_SIZE)
+#define SECTORS(bytes) (((bytes) + SECTOR_SIZE - 1) / SECTOR_SIZE)
+#define COMPRESSED_MAGIC 0x5A504D43
+// extent header flag: the page did not compress and is stored as it is
+#define STORED_RAW 0x80000000u
+#define MAX_EXTENT_SECTORS SECTORS((int)sizeof(ExtentHeader) + PAGE_SIZE)
+
+// the LZ codec of compressed pages: a sequence is a token, 4 bits for the number of literals and 4
+// for the match length - LZ_MIN_MATCH, both continued in bytes of 255 when they reach 15, the
+// literals and the offset of the match back into the page; the last sequence has no match
+#define LZ_MIN_MATCH 4
+#define LZ_HASH_BITS 12
+
+// reflected Castagnoli polynomial
+#define CRC32C_POLY 0x82F63B78
+// The CRC32 instruction takes 3 cycles but can start every cycle: the hardware CRC runs over three
+// strides of this many bytes at once and shifts the first two past the ones after them
+#define CRC32C_STRIDE 256
+
+// sectors of a compressed page file, sectors 0 for a page never written, read as zeros
+typedef struct PageExtent
+{
+    int sector;
+    int sectors;
+} PageExtent;
+
+typedef struct ExtentHeader
+{
+    unsigned int length;   // of the compressed page, | STORED_RAW
+    unsigned int checksum; // CRC32C of the compressed page and its page number
+} ExtentHeader;
+
+// what the header block of a compressed page file holds after the page count
+typedef struct CompressedHeader
+{
+    int magic;
+    PageExtent map;
+    int mapBytes; // the number of pages and their extents
+    unsigned int mapChecksum;
+} CompressedHeader;
+
+// what an open page file keeps in mgmtInfo
+typedef struct PageFile
+{
+    int fd;
+    unsigned char *verified; // PAGE_VERIFY_LAZY: a bit per page checked or written since the file was opened
+    int maxVerified;         // pages the bits have room for
+    int compressed;
+    PageExtent *map; // compressed: the extent of every page
+    int numMapped;
+    int maxMapped;
+    PageExtent *free; // compressed: extents nothing uses, by sector
+    int numFree;
+    int maxFree;
+    PageExtent *pending; // compressed: extents freed since the map was written
+    int numPending;
+    int maxPending;
+    PageExtent mapExtent; // where the map on disk is
+    int endSector;        // sectors up to the end of the last extent
+    int mapDirty;
+} PageFile;
+
+static PageVerify pageVerify = PAGE_VERIFY_ALWAYS;
+
+// slicing-by-8 tables of the software CRC32C
+static unsigned int crcTables[8][256];
+// a CRC moved past CRC32C_STRIDE zero bytes, a table per byte of it
+static unsigned int crcShift[4][256];
+static pthread_once_t crcOnce = PTHREAD_ONCE_INIT;
+static int crcHardware;
+
+/*
+    # fills the tables of the software CRC32C and looks for the instruction
+*/
+static void initCrc32c(void)
+{
+    for (int i = 0; i < 256; i++)
+    {
+        unsigned int crc = i;
+        for (int bit = 0; bit < 8; bit++)
+            crc = (crc >> 1) ^ (CRC32C_POLY & (0 - (crc & 1)));
+        crcTables[0][i] = crc;
+    }
+    for (int i = 0; i < 256; i++)
+        for (int t = 1; t < 8; t++)
+            crcTables[t][i] = (crcTables[t - 1][i] >> 8) ^ crcTables[0][crcTables[t - 1][i] & 0xFF];
+    for (int b = 0; b < 4; b++)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            unsigned int crc = (unsigned int)i << (8 * b);
+            for (int n = 0; n < CRC32C_STRIDE; n++)
+                crc = (crc >> 8) ^ crcTables[0][crc & 0xFF];
+            crcShift[b][i] = crc;
+        }
+    }
+
+#if defined(CRC32C_SSE42)
+    crcHardware = __builtin_cpu_supports("sse4.2");
+#elif defined(CRC32C_ARM)
+    crcHardware = 1;
+#endif
+}
+
+static unsigned int crc32cSoftware(unsigned int crc, const unsigned char *data, int length)
+{
+    while (length >= 8)
+    {
+        unsigned int low = crc ^ (data[0] | data[1] << 8 | data[2] << 16 | (unsigned int)data[3] << 24);
+        crc = crcTables[7][low & 0xFF] ^ crcTables[6][(low >> 8) & 0xFF] ^ crcTables[5][(low >> 16) & 0xFF] ^
+              crcTables[4][low >> 24] ^ crcTables[3][data[4]] ^ crcTables[2][data[5]] ^ crcTables[1][data[6]] ^
+              crcTables[0][data[7]];
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
+        crc = (crc >> 8) ^ crcTables[0][(crc ^ *data++) & 0xFF];
+    return crc;
+}
+
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARM)
+static unsigned int shiftStride(unsigned int crc)
+{
+    return crcShift[0][crc & 0xFF] ^ crcShift[1][(crc >> 8) & 0xFF] ^ crcShift[2][(crc >> 16) & 0xFF] ^
+           crcShift[3][crc >> 24];
+}
+#endif
+
+#if defined(CRC32C_SSE42)
+__attribute__((target("sse4.2"))) static unsigned int crc32cHardware(unsigned int crc, const unsigned char *data, int length)
+{
+    unsigned long long wide = crc, second, third;
+    unsigned long long word;
+
+    while (length >= 3 * CRC32C_STRIDE)
+    {
+        second = third = 0;
+        for (int i = 0; i < CRC32C_STRIDE; i += 8)
+        {
+            memcpy(&word, data + i, 8);
+            wide = _mm_crc32_u64(wide, word);
+            memcpy(&word, data + CRC32C_STRIDE + i, 8);
+            second = _mm_crc32_u64(second, word);
+            memcpy(&word, data + 2 * CRC32C_STRIDE + i, 8);
+            third = _mm_crc32_u64(third, word);
+        }
+        wide = shiftStride(shiftStride((unsigned int)wide) ^ (unsigned int)second) ^ (unsigned int)third;
+        data += 3 * CRC32C_STRIDE;
+        length -= 3 * CRC32C_STRIDE;
+    }
+    while (length >= 8)
+    {
+        memcpy(&word, data, 8);
+        wide = _mm_crc32_u64(wide, word);
+        data += 8;
+        length -= 8;
+    }
+    crc = (unsigned int)wide;
+    while (length-- > 0)
+        crc = _mm_crc32_u8(crc, *data++);
+    return crc;
+}
+#elif defined(CRC32C_ARM)
+static unsigned int crc32cHardware(unsigned int crc, const unsigned char *data, int length)
 {
+    unsigned int second, third;
+    unsigned long long word;
+
+    while (length >= 3 * CRC32C_STRIDE)
+    {
+        second = third = 0;
+        for (int i = 0; i < CRC32C_STRIDE; i += 8)
+        {
+            memcpy(&word, data + i, 8);
+            crc = __crc32cd(crc, word);
+            memcpy(&word, data + CRC32C_STRIDE + i, 8);
+            second = __crc32cd(second, word);
+            memcpy(&word, data + 2 * CRC32C_STRIDE + i, 8);
+            third = __crc32cd(third, word);
+        }
+        crc = shiftStride(shiftStride(crc) ^ second) ^ third;
+        data += 3 * CRC32C_STRIDE;
+        length -= 3 * CRC32C_STRIDE;
+    }
+    while (length >= 8)
+    {
+        memcpy(&word, data, 8);
+        crc = __crc32cd(crc, word);
+        data += 8;
+        length -= 8;
+    }
+    while (length-- > 0)
+        crc = __crc32cb(crc, *data++);
+    return crc;
 }
+#endif
 
 /*
-    # It creates a new page file with "fileName"
-    # Uses fopen() function and writes data
-    # Returns RC_FILE_NOT_FOUND if unsuccessfull
+    # continues the CRC32C crc over length bytes, start with 0; with the CRC32 instruction of
+    # SSE 4.2 or ARMv8 where the CPU has it, with lookup tables otherwise
 */
-RC createPageFile(char *fileName)
+unsigned int crc32c(unsigned int crc, const void *data, int length)
 {
-    // Open the file in write mode
-    FILE *filePtr = fopen(fileName, "w");
+    pthread_once(&crcOnce, initCrc32c);
+    crc = ~crc;
+#if defined(CRC32C_SSE42) || defined(CRC32C_ARM)
+    if (crcHardware)
+        return ~crc32cHardware(crc, (const unsigned char *)data, length);
+#endif
+    return ~crc32cSoftware(crc, (const unsigned char *)data, length);
+}
 
-    // Check if the file was opened successfully
+const char *crc32cImplementation(void)
+{
+    pthread_once(&crcOnce, initCrc32c);
+    return crcHardware ? "hardware" : "software";
+}
 
-    if (filePtr != NULL)
+static unsigned int pageChecksum(int pageNum, char *page)
+{
+    return crc32c(crc32c(0, page, PAGE_SIZE), &pageNum, sizeof(int));
+}
+
+/*
+    # sets when readBlock checks checksums, for every page file
+*/
+void setPageVerify(PageVerify mode)
+{
+    pageVerify = mode;
+}
+
+PageVerify getPageVerify(void)
+{
+    return pageVerify;
+}
+
+static int isVerified(PageFile *file, int pageNum)
+{
+    return pageNum < file->maxVerified && (file->verified[pageNum / 8] >> (pageNum % 8)) & 1;
+}
+
+/*
+    # remembers that a page of the file needs no check on its next read in PAGE_VERIFY_LAZY
+    # a page the bits have no room for is simply checked again
+*/
+static void setVerified(PageFile *file, int pageNum)
+{
+    if (pageVerify != PAGE_VERIFY_LAZY)
+        return;
+    if (pageNum >= file->maxVerified)
     {
-        // Allocate a blank page to store data
-        char *blankPage = (char *)calloc(PAGE_SIZE, sizeof(char));
+        int max = file->maxVerified > 0 ? file->maxVerified : 64;
+        while (max <= pageNum)
+            max *= 2;
+        unsigned char *grown = (unsigned char *)realloc(file->verified, max / 8);
+        if (grown == NULL)
+            return;
+        memset(grown + file->maxVerified / 8, 0, (max - file->maxVerified) / 8);
+        file->verified = grown;
+        file->maxVerified = max;
+    }
+    file->verified[pageNum / 8] |= 1 << (pageNum % 8);
+}
 
-        // Allocate headerPage to store file info like total number of pages
-        char *headerPage = (char *)calloc(PAGE_SIZE, sizeof(char));
+/*
+    # writes page pageNum and its checksum to the file in one write
+*/
+static RC writePageBlock(PageFile *file, int pageNum, char *page)
+{
+    unsigned int checksum = pageChecksum(pageNum, page);
+    struct iovec block[2] = {{page, PAGE_SIZE}, {&checksum, CHECKSUM_SIZE}};
+
+    if (pwritev(file->fd, block, 2, BLOCK_OFFSET(pageNum)) != BLOCK_SIZE)
+        return RC_WRITE_FAILED;
+    setVerified(file, pageNum);
+    return RC_OK;
+}
 
-        // set initial page number to 1 and point the filePtr to headerPage
-        fputs("1", filePtr);
+/*
+    # writes the number of pages into the header block
+*/
+static RC writeHeader(PageFile *file, int totalNumPages)
+{
+    char header[HEADER_DIGITS];
 
-        // Write the headerPage with total number of pages
-        fwrite(headerPage, PAGE_SIZE, 1, filePtr);
+    // the new count may have fewer digits than the old one, it is terminated
+    int length = snprintf(header, HEADER_DIGITS, "%d", totalNumPages) + 1;
+    return pwrite(file->fd, header, length, 0) == length ? RC_OK : RC_WRITE_FAILED;
+}
 
-        // Write the blankPage
-        fwrite(blankPage, PAGE_SIZE, 1, filePtr);
+/*
+    # compresses length bytes of in into at most maxOut bytes of out
+    # Returns the compressed length, -1 if it does not fit
+*/
+static int lzCompress(const unsigned char *in, int length, unsigned char *out, int maxOut)
+{
+    // position + 1 of the last 4 bytes with each hash, 0 for none
+    unsigned short table[1 << LZ_HASH_BITS] = {0};
+    int pos = 0, anchor = 0, o = 0;
 
-        // Free the allocated memory
-        free(headerPage);
-        free(blankPage);
+    for (;;)
+    {
+        int cand = -1, matchLength = 0;
+        while (pos + LZ_MIN_MATCH <= length)
+        {
+            unsigned int seq;
+            memcpy(&seq, in + pos, sizeof(seq));
+            unsigned int h = (seq * 2654435761u) >> (32 - LZ_HASH_BITS);
+            cand = table[h] - 1;
+            table[h] = pos + 1;
+            if (cand >= 0 && memcmp(in + cand, in + pos, LZ_MIN_MATCH) == 0)
+                break;
+            pos++;
+        }
+        int last = pos + LZ_MIN_MATCH > length;
+        if (last)
+            pos = length;
+        else
+        {
+            matchLength = LZ_MIN_MATCH;
+            while (pos + matchLength < length && in[cand + matchLength] == in[pos + matchLength])
+                matchLength++;
+        }
 
-        // Close the file pointer
-        fclose(filePtr);
+        // the token, the literals from anchor to pos and the match
+        int literals = pos - anchor, extra = matchLength - LZ_MIN_MATCH;
+        if (o + 1 + literals / 255 + 1 + literals + (last ? 0 : 2 + extra / 255 + 1) > maxOut)
+            return -1;
+        out[o++] = (literals < 15 ? literals : 15) << 4 | (last ? 0 : (extra < 15 ? extra : 15));
+        if (literals >= 15)
+        {
+            int rest = literals - 15;
+            for (; rest >= 255; rest -= 255)
+                out[o++] = 255;
+            out[o++] = rest;
+        }
+        memcpy(out + o, in + anchor, literals);
+        o += literals;
+        if (last)
+            return o;
 
-        return RC_OK;
+        int offset = pos - cand;
+        out[o++] = offset & 0xFF;
+        out[o++] = offset >> 8;
+        if (extra >= 15)
+        {
+            int rest = extra - 15;
+            for (; rest >= 255; rest -= 255)
+                out[o++] = 255;
+            out[o++] = rest;
+        }
+        pos += matchLength;
+        anchor = pos;
     }
+}
+
+/*
+    # decompresses length bytes of in into exactly outLength bytes of out
+    # Returns 0 for input that is not a compressed page of that length
+*/
+static int lzDecompress(const unsigned char *in, int length, unsigned char *out, int outLength)
+{
+    int i = 0, o = 0;
+
+    while (i < length)
+    {
+        int token = in[i++];
+        int literals = token >> 4;
+        if (literals == 15)
+        {
+            int more;
+            do
+            {
+                if (i >= length)
+                    return 0;
+                more = in[i++];
+                literals += more;
+            } while (more == 255);
+        }
+        if (literals > length - i || literals > outLength - o)
+            return 0;
+        memcpy(out + o, in + i, literals);
+        i += literals;
+        o += literals;
+        if (i == length)
+            break;
+
+        if (length - i < 2)
+            return 0;
+        int offset = in[i] | in[i + 1] << 8;
+        i += 2;
+        int matchLength = (token & 15) + LZ_MIN_MATCH;
+        if ((token & 15) == 15)
+        {
+            int more;
+            do
+            {
+                if (i >= length)
+                    return 0;
+                more = in[i++];
+                matchLength += more;
+            } while (more == 255);
+        }
+        if (offset == 0 || offset > o || matchLength > outLength - o)
+            return 0;
+        // byte by byte where a match overlaps what it writes
+        if (offset >= matchLength)
+            memcpy(out + o, out + o - offset, matchLength);
+        else
+            for (int k = 0; k < matchLength; k++)
+                out[o + k] = out[o + k - offset];
+        o += matchLength;
+    }
+    return o == outLength;
+}
+
+static int addExtent(PageExtent **list, int *num, int *max, PageExtent extent)
+{
+    if (*num == *max)
+    {
+        int grown = *max > 0 ? *max * 2 : 16;
+        PageExtent *bigger = (PageExtent *)realloc(*list, grown * sizeof(PageExtent));
+        if (bigger == NULL)
+            return 0;
+        *list = bigger;
+        *max = grown;
+    }
+    (*list)[(*num)++] = extent;
+    return 1;
+}
+
+/*
+    # takes sectors sectors from the first free extent big enough, or from the end of the file
+    # Returns the first sector taken
+*/
+static int allocateExtent(PageFile *file, int sectors)
+{
+    for (int i = 0; i < file->numFree; i++)
+    {
+        PageExtent *extent = &file->free[i];
+        if (extent->sectors >= sectors)
+        {
+            int sector = extent->sector;
+            extent->sector += sectors;
+            extent->sectors -= sectors;
+            if (extent->sectors == 0)
+                memmove(extent, extent + 1, (--file->numFree - i) * sizeof(PageExtent));
+            return sector;
+        }
+    }
+    int sector = file->endSector;
+    file->endSector += sectors;
+    return sector;
+}
+
+/*
+    # puts an extent back on the free list, merged with its free neighbours
+    # without memory for it the extent is lost until the file is opened again
+*/
+static void freeExtent(PageFile *file, PageExtent extent)
+{
+    int i = 0;
+    while (i < file->numFree && file->free[i].sector < extent.sector)
+        i++;
+
+    PageExtent *before = i > 0 ? &file->free[i - 1] : NULL;
+    PageExtent *after = i < file->numFree ? &file->free[i] : NULL;
+    if (before != NULL && before->sector + before->sectors == extent.sector)
+    {
+        before->sectors += extent.sectors;
+        if (after != NULL && before->sector + before->sectors == after->sector)
+        {
+            before->sectors += after->sectors;
+            memmove(after, after + 1, (--file->numFree - i) * sizeof(PageExtent));
+        }
+    }
+    else if (after != NULL && extent.sector + extent.sectors == after->sector)
+    {
+        after->sector = extent.sector;
+        after->sectors += extent.sectors;
+    }
+    else if (addExtent(&file->free, &file->numFree, &file->maxFree, extent))
+    {
+        memmove(&file->free[i + 1], &file->free[i], (file->numFree - 1 - i) * sizeof(PageExtent));
+        file->free[i] = extent;
+    }
+}
+
+/*
+    # frees the extents the map on disk no longer uses, and cuts free sectors off the end of the file
+*/
+static void releasePending(PageFile *file)
+{
+    for (int i = 0; i < file->numPending; i++)
+        freeExtent(file, file->pending[i]);
+    file->numPending = 0;
+
+    if (file->numFree > 0)
+    {
+        PageExtent *last = &file->free[file->numFree - 1];
+        if (last->sector + last->sectors == file->endSector)
+        {
+            file->endSector = last->sector;
+            file->numFree--;
+            if (ftruncate(file->fd, SECTOR_OFFSET(file->endSector)) != 0)
+                return;
+        }
+    }
+}
+
+static void freeLater(PageFile *file, PageExtent extent)
+{
+    if (extent.sectors > 0)
+        addExtent(&file->pending, &file->numPending, &file->maxPending, extent);
+}
+
+/*
+    # writes the page map of a compressed page file to a new extent, then the header block pointing
+    # to it; durable syncs both and the extents of the pages before the header is changed
+*/
+static RC writePageMap(PageFile *file, int durable)
+{
+    if (!file->mapDirty)
+        return durable && fsync(file->fd) != 0 ? RC_WRITE_FAILED : RC_OK;
+
+    int mapBytes = sizeof(int) + file->numMapped * sizeof(PageExtent);
+    char *image = (char *)malloc(mapBytes);
+    if (image == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    memcpy(image, &file->numMapped, sizeof(int));
+    memcpy(image + sizeof(int), file->map, file->numMapped * sizeof(PageExtent));
+
+    PageExtent extent = {0, SECTORS(mapBytes)};
+    extent.sector = allocateExtent(file, extent.sectors);
+    CompressedHeader header = {COMPRESSED_MAGIC, extent, mapBytes, crc32c(0, image, mapBytes)};
+    char block[HEADER_DIGITS + sizeof(CompressedHeader)] = {0};
+    snprintf(block, HEADER_DIGITS, "%d", file->numMapped);
+    memcpy(block + HEADER_DIGITS, &header, sizeof(header));
+
+    RC status = RC_OK;
+    if (pwrite(file->fd, image, mapBytes, SECTOR_OFFSET(extent.sector)) != mapBytes ||
+        (durable && fsync(file->fd) != 0) || pwrite(file->fd, block, sizeof(block), 0) != sizeof(block) ||
+        (durable && fsync(file->fd) != 0))
+        status = RC_WRITE_FAILED;
+    free(image);
+
+    // the header may or may not point to the new map, neither is reused before the next write
+    if (status != RC_OK)
+    {
+        freeLater(file, extent);
+        return status;
+    }
+    freeLater(file, file->mapExtent);
+    file->mapExtent = extent;
+    file->mapDirty = 0;
+    releasePending(file);
+    return RC_OK;
+}
+
+static int compareExtents(const void *a, const void *b)
+{
+    return ((PageExtent *)a)->sector - ((PageExtent *)b)->sector;
+}
+
+/*
+    # reads the page map the header block points to and finds the free extents between the ones used
+    # Returns RC_PAGE_CORRUPTED if the map fails its checksum
+*/
+static RC loadPageMap(PageFile *file, CompressedHeader *header)
+{
+    if (header->mapBytes < (int)sizeof(int) || header->map.sectors != SECTORS(header->mapBytes))
+        return RC_PAGE_CORRUPTED;
+    char *image = (char *)malloc(header->mapBytes);
+    if (image == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+
+    RC status = RC_OK;
+    int numPages = 0;
+    if (pread(file->fd, image, header->mapBytes, SECTOR_OFFSET(header->map.sector)) != header->mapBytes ||
+        crc32c(0, image, header->mapBytes) != header->mapChecksum)
+        status = RC_PAGE_CORRUPTED;
     else
+    {
+        memcpy(&numPages, image, sizeof(int));
+        if (numPages < 0 || header->mapBytes != (int)(sizeof(int) + numPages * sizeof(PageExtent)))
+            status = RC_PAGE_CORRUPTED;
+    }
+
+    PageExtent *used = NULL;
+    if (status == RC_OK)
+    {
+        file->maxMapped = numPages > 16 ? numPages : 16;
+        file->map = (PageExtent *)malloc(file->maxMapped * sizeof(PageExtent));
+        used = (PageExtent *)malloc((numPages + 1) * sizeof(PageExtent));
+        if (file->map == NULL || used == NULL)
+            status = RC_MEM_ALLOCATION_FAIL;
+    }
+    if (status == RC_OK)
+    {
+        memcpy(file->map, image + sizeof(int), numPages * sizeof(PageExtent));
+        file->numMapped = numPages;
+        file->mapExtent = header->map;
+
+        // the free extents are the gaps between the extents of the pages and the map
+        int numUsed = 0;
+        for (int i = 0; i < numPages; i++)
+            if (file->map[i].sectors > 0)
+                used[numUsed++] = file->map[i];
+        used[numUsed++] = header->map;
+        qsort(used, numUsed, sizeof(PageExtent), compareExtents);
+        for (int i = 0; i < numUsed; i++)
+        {
+            if (used[i].sector > file->endSector)
+            {
+                PageExtent gap = {file->endSector, used[i].sector - file->endSector};
+                addExtent(&file->free, &file->numFree, &file->maxFree, gap);
+            }
+            if (used[i].sector + used[i].sectors > file->endSector)
+                file->endSector = used[i].sector + used[i].sectors;
+        }
+    }
+    free(used);
+    free(image);
+    return status;
+}
+
+static unsigned int extentChecksum(int pageNum, unsigned char *data, int length)
+{
+    return crc32c(crc32c(0, data, length), &pageNum, sizeof(int));
+}
+
+/*
+    # compresses page pageNum into a new extent, never over the one the map on disk may point to,
+    # so a crash while writing leaves the page as of the last written map
+*/
+static RC writeCompressedBlock(PageFile *file, int pageNum, char *page)
+{
+    unsigned char stored[sizeof(ExtentHeader) + PAGE_SIZE];
+    ExtentHeader header;
+    int length = lzCompress((unsigned char *)page, PAGE_SIZE, stored + sizeof(header), PAGE_SIZE - 1);
+
+    header.length = length;
+    if (length < 0)
+    {
+        length = PAGE_SIZE;
+        memcpy(stored + sizeof(header), page, PAGE_SIZE);
+        header.length = length | STORED_RAW;
+    }
+    header.checksum = extentChecksum(pageNum, stored + sizeof(header), length);
+    memcpy(stored, &header, sizeof(header));
+
+    int bytes = sizeof(header) + length;
+    PageExtent target = {0, SECTORS(bytes)};
+    target.sector = allocateExtent(file, target.sectors);
+    if (pwrite(file->fd, stored, bytes, SECTOR_OFFSET(target.sector)) != bytes)
+    {
+        freeLater(file, target);
+        return RC_WRITE_FAILED;
+    }
+
+    // the old extent is reused only once a map without it is written
+    freeLater(file, file->map[pageNum]);
+    file->map[pageNum] = target;
+    file->mapDirty = 1;
+    setVerified(file, pageNum);
+    return RC_OK;
+}
+
+/*
+    # reads page pageNum from its extent and decompresses it
+    # Returns RC_PAGE_CORRUPTED for an extent cut short, failing its checksum or not decompressing
+*/
+static RC readCompressedBlock(PageFile *file, int pageNum, char *page)
+{
+    PageExtent extent = file->map[pageNum];
+    if (extent.sectors == 0)
+    {
+        memset(page, 0, PAGE_SIZE);
+        return RC_OK;
+    }
+    if (extent.sectors > MAX_EXTENT_SECTORS)
+        return RC_PAGE_CORRUPTED;
+
+    // the whole extent in one read, the last one of the file may end before its last sector does
+    unsigned char stored[MAX_EXTENT_SECTORS * SECTOR_SIZE];
+    ExtentHeader header;
+    ssize_t numRead = pread(file->fd, stored, extent.sectors * SECTOR_SIZE, SECTOR_OFFSET(extent.sector));
+    if (numRead < 0)
+        return RC_ERROR;
+    if (numRead < (ssize_t)sizeof(header))
+        return RC_PAGE_CORRUPTED;
+    memcpy(&header, stored, sizeof(header));
+
+    int length = header.length & ~STORED_RAW;
+    if (length > numRead - (int)sizeof(header))
+        return RC_PAGE_CORRUPTED;
+    if (pageVerify == PAGE_VERIFY_ALWAYS || (pageVerify == PAGE_VERIFY_LAZY && !isVerified(file, pageNum)))
+    {
+        if (header.checksum != extentChecksum(pageNum, stored + sizeof(header), length))
+            return RC_PAGE_CORRUPTED;
+        setVerified(file, pageNum);
+    }
+
+    if (header.length & STORED_RAW)
+    {
+        if (length != PAGE_SIZE)
+            return RC_PAGE_CORRUPTED;
+        memcpy(page, stored + sizeof(header), PAGE_SIZE);
+    }
+    else if (!lzDecompress(stored + sizeof(header), length, (unsigned char *)page, PAGE_SIZE))
+        return RC_PAGE_CORRUPTED;
+    return RC_OK;
+}
+
+static void freePageFile(PageFile *file)
+{
+    free(file->verified);
+    free(file->map);
+    free(file->free);
+    free(file->pending);
+    free(file);
+}
+
+void initStorageManager(void)
+{
+    pthread_once(&crcOnce, initCrc32c);
+}
+
+/*
+    # It creates a new page file with "fileName"
+    # Writes the header block and one blank page with its checksum
+    # Returns RC_FILE_NOT_FOUND if unsuccessfull
+*/
+RC createPageFile(char *fileName)
+{
+    // Open the file in write mode
+    PageFile file = {open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644), NULL, 0};
+
+    // Check if the file was opened successfully
+    if (file.fd < 0)
         return RC_FILE_NOT_FOUND;
+
+    // Allocate a blank page to store data
+    char *blankPage = (char *)calloc(PAGE_SIZE, sizeof(char));
+
+    // The header block says there is one page, the blank one after it
+    RC status = ftruncate(file.fd, BLOCK_SIZE) == 0 ? writeHeader(&file, 1) : RC_WRITE_FAILED;
+    if (status == RC_OK)
+        status = writePageBlock(&file, 0, blankPage);
+
+    // Free the allocated memory and close the file
+    free(blankPage);
+    free(file.verified);
+    close(file.fd);
+    return status;
+}
+
+/*
+    # It creates a new compressed page file with "fileName", read and written like any other
+    # Its one blank page takes no space, the header block points to the page map
+    # Returns RC_FILE_NOT_FOUND if unsuccessfull
+*/
+RC createCompressedPageFile(char *fileName)
+{
+    PageFile *file = (PageFile *)calloc(1, sizeof(PageFile));
+    if (file == NULL)
+        return RC_MEM_ALLOCATION_FAIL;
+    file->compressed = 1;
+    file->fd = open(fileName, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (file->fd < 0)
+    {
+        freePageFile(file);
+        return RC_FILE_NOT_FOUND;
+    }
+
+    PageExtent blank = {0, 0};
+    RC status = RC_WRITE_FAILED;
+    if (ftruncate(file->fd, BLOCK_SIZE) == 0 && addExtent(&file->map, &file->numMapped, &file->maxMapped, blank))
+    {
+        file->mapDirty = 1;
+        status = writePageMap(file, 0);
+    }
+
+    close(file->fd);
+    freePageFile(file);
+    return status;
 }
 
 /*
@@ -57,30 +825,49 @@ RC createPageFile(char *fileName)
 */
 RC openPageFile(char *fileName, SM_FileHandle *fHandle)
 {
-    FILE *filePtr; // file pointer
-
-    filePtr = fopen(fileName, "r+"); // open the pageFile
+    int fd = open(fileName, O_RDWR); // open the pageFile
 
-    if (filePtr != NULL) // if file exists
+    if (fd >= 0) // if file exists
     {
+        PageFile *file = (PageFile *)calloc(1, sizeof(PageFile));
+        if (file == NULL)
+        {
+            close(fd);
+            return RC_MEM_ALLOCATION_FAIL;
+        }
+        file->fd = fd;
+
         /*update the fileHandle attributes*/
 
         (*fHandle).fileName = fileName; // store the file name
 
-        /*read headerPage to get the Total Number of Pages*/
-        char *headerPage;
-        headerPage = (char *)calloc(PAGE_SIZE, sizeof(char));
-        fgets(headerPage, PAGE_SIZE, filePtr);
-        char *totalPage;
-        totalPage = headerPage;
+        /*read the header block to get the Total Number of Pages*/
+        char header[HEADER_DIGITS + sizeof(CompressedHeader)] = {0};
+        if (pread(fd, header, sizeof(header), 0) < 0)
+            header[0] = '\0';
+        header[HEADER_DIGITS - 1] = '\0';
 
-        (*fHandle).totalNumPages = atoi(totalPage); // convert to integer
-        (*fHandle).curPagePos = 0;                  // store the current page position
+        (*fHandle).totalNumPages = atoi(header); // convert to integer
 
-        // store the File pointer information in the Management info of Page Handle
-        (*fHandle).mgmtInfo = filePtr;
+        // a compressed page file has as many pages as its page map
+        CompressedHeader compressed;
+        memcpy(&compressed, header + HEADER_DIGITS, sizeof(compressed));
+        if (compressed.magic == COMPRESSED_MAGIC)
+        {
+            file->compressed = 1;
+            RC status = loadPageMap(file, &compressed);
+            if (status != RC_OK)
+            {
+                close(fd);
+                freePageFile(file);
+                return status;
+            }
+            (*fHandle).totalNumPages = file->numMapped;
+        }
+        (*fHandle).curPagePos = 0;               // store the current page position
 
-        free(headerPage); // free memory to avoid memory leaks
+        // store the open file in the Management info of Page Handle
+        (*fHandle).mgmtInfo = file;
 
         return RC_OK;
     }
@@ -96,10 +883,17 @@ RC openPageFile(char *fileName, SM_FileHandle *fHandle)
 */
 RC closePageFile(SM_FileHandle *fHandle)
 {
+    PageFile *file = (*fHandle).mgmtInfo;
+    RC status = file->compressed ? writePageMap(file, 0) : RC_OK;
+    int closed = close(file->fd);
+
+    freePageFile(file);
+    (*fHandle).mgmtInfo = NULL;
+
     // if closing the file is success
-    if (fclose((*fHandle).mgmtInfo) == 0)
+    if (closed == 0)
     {
-        return RC_OK;
+        return status;
     }
     else
     {
@@ -127,6 +921,9 @@ RC destroyPageFile(char *fileName)
     # This method checks if the page is valid or not and returns RC_READ_NON_EXISTING_PAGE if invalid
     # Reads a page specified by pageNum to memPage
     # Then it will return RC_READ_NON_EXISTING_PAGE
+    # A block cut short, in a file torn or truncated below the page count of its header, or a page
+    # that fails its checksum (as getPageVerify says) returns RC_PAGE_CORRUPTED
+    # Pages of a compressed page file are decompressed from their extent
 */
 RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
 {
@@ -140,11 +937,33 @@ RC readBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
         return RC_READ_NON_EXISTING_PAGE;
     }
 
-    // Setting the file pointer at the correct position for reading a block
+    // Reading the page and its checksum at the position of the block
     else
     {
-        fseek((*fHandle).mgmtInfo, (pageNum + 1) * PAGE_SIZE, SEEK_SET);
-        fread(memPage, sizeof(char), PAGE_SIZE, (*fHandle).mgmtInfo);
+        PageFile *file = (*fHandle).mgmtInfo;
+        if (file->compressed)
+        {
+            RC status = readCompressedBlock(file, pageNum, memPage);
+            if (status == RC_OK)
+                (*fHandle).curPagePos = pageNum;
+            return status;
+        }
+
+        unsigned int checksum;
+        struct iovec block[2] = {{memPage, PAGE_SIZE}, {&checksum, CHECKSUM_SIZE}};
+
+        ssize_t numRead = preadv(file->fd, block, 2, BLOCK_OFFSET(pageNum));
+        if (numRead < 0)
+            return RC_ERROR;
+        if (numRead != BLOCK_SIZE)
+            return RC_PAGE_CORRUPTED;
+        if (pageVerify == PAGE_VERIFY_ALWAYS || (pageVerify == PAGE_VERIFY_LAZY && !isVerified(file, pageNum)))
+        {
+            if (checksum != pageChecksum(pageNum, memPage))
+                return RC_PAGE_CORRUPTED;
+            setVerified(file, pageNum);
+        }
+
         // Updates current page position
         (*fHandle).curPagePos = pageNum;
         return RC_OK;
@@ -269,17 +1088,16 @@ RC writeBlock(int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage)
         return RC_WRITE_FAILED;
     }
 
-    // moving the file cursor to the page number provided
-    fseek((*fHandle).mgmtInfo, (pageNum + 1) * PAGE_SIZE, SEEK_SET);
-    {
-        // write the block to memPage
-        fwrite(memPage, PAGE_SIZE, 1, (*fHandle).mgmtInfo);
+    // write memPage and its checksum to the block of the page number provided, compressed or not
+    PageFile *file = (*fHandle).mgmtInfo;
+    RC status = file->compressed ? writeCompressedBlock(file, pageNum, memPage) : writePageBlock(file, pageNum, memPage);
+    if (status != RC_OK)
+        return status;
 
-        // update the curPagePos to pageNum;
-        (*fHandle).curPagePos = pageNum;
+    // update the curPagePos to pageNum;
+    (*fHandle).curPagePos = pageNum;
 
-        return RC_OK;
-    }
+    return RC_OK;
 }
 /*
     # The method below writes the current page to memPage.
@@ -308,26 +1126,32 @@ RC appendEmptyBlock(SM_FileHandle *fHandle)
     if (fHandle == NULL)
         return RC_FILE_HANDLE_NOT_INIT;
 
+    // a compressed page file only maps the page, as a page never written
+    PageFile *file = (*fHandle).mgmtInfo;
+    if (file->compressed)
+    {
+        PageExtent blank = {0, 0};
+        if (!addExtent(&file->map, &file->numMapped, &file->maxMapped, blank))
+            return RC_MEM_ALLOCATION_FAIL;
+        file->mapDirty = 1;
+        (*fHandle).curPagePos = (*fHandle).totalNumPages - 1;
+        (*fHandle).totalNumPages += 1;
+        return RC_OK;
+    }
+
     // create and allocate the new empty block.
     char *newBlock;
 
     newBlock = (char *)calloc(PAGE_SIZE, sizeof(char));
 
-    // move the cursor to the recently added block
-    fseek((*fHandle).mgmtInfo, ((*fHandle).totalNumPages + 1) * PAGE_SIZE, SEEK_SET);
-
-    // append the block to the file if possible
-    if (fwrite(newBlock, PAGE_SIZE, 1, (*fHandle).mgmtInfo))
+    // append the block after the last one if possible, the header only counts it once it is there
+    if (writePageBlock((*fHandle).mgmtInfo, (*fHandle).totalNumPages, newBlock) == RC_OK &&
+        writeHeader((*fHandle).mgmtInfo, (*fHandle).totalNumPages + 1) == RC_OK)
     {
         // update the attributes of fhandle
         (*fHandle).curPagePos = (*fHandle).totalNumPages - 1;
         (*fHandle).totalNumPages += 1;
 
-        // seek to the header page to update the total pages
-        fseek((*fHandle).mgmtInfo, 0L, SEEK_SET);
-        // write with formatting required as totalNumPages is of int type
-        fprintf((*fHandle).mgmtInfo, "%d", (*fHandle).totalNumPages);
-
         // free up the allocated space
         free(newBlock);
 
@@ -359,7 +1183,7 @@ RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle)
     if (numberOfPages <= (*fHandle).totalNumPages)
         return RC_OK;
 
-    int i, requiredPages;
+    int requiredPages;
 
     // calculate the number of pages to add
     requiredPages = numberOfPages - (*fHandle).totalNumPages;
@@ -372,3 +1196,57 @@ RC ensureCapacity(int numberOfPages, SM_FileHandle *fHandle)
     }
     return RC_OK;
 }
+
+/*
+    # The following method shortens the file to numberOfPages pages
+    # The pages after them are cut off and the header page is updated
+*/
+RC truncatePageFile(int numberOfPages, SM_FileHandle *fHandle)
+{
+    // check if the pointer to file exists
+    if (fHandle == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // nothing to cut off
+    if (numberOfPages >= (*fHandle).totalNumPages)
+        return RC_OK;
+
+    // the extents of the pages cut off of a compressed page file are freed once the map is written
+    PageFile *file = (*fHandle).mgmtInfo;
+    if (file->compressed)
+    {
+        for (int i = numberOfPages; i < file->numMapped; i++)
+            freeLater(file, file->map[i]);
+        file->numMapped = numberOfPages;
+        file->mapDirty = 1;
+    }
+    else if (ftruncate(file->fd, BLOCK_OFFSET(numberOfPages)) != 0)
+        return RC_WRITE_FAILED;
+
+    (*fHandle).totalNumPages = numberOfPages;
+    if ((*fHandle).curPagePos >= numberOfPages)
+        (*fHandle).curPagePos = numberOfPages - 1;
+
+    return file->compressed ? RC_OK : writeHeader(file, numberOfPages);
+}
+
+/*
+    # The following method makes every block written so far durable
+    # Returns RC_WRITE_FAILED if the file cannot be synced
+*/
+RC syncPageFile(SM_FileHandle *fHandle)
+{
+    // check if the pointer to file exists
+    if (fHandle == NULL)
+        return RC_FILE_HANDLE_NOT_INIT;
+
+    // blocks are written straight to the file system, wait until they are on disk
+    // a compressed page file writes its page map too, after the pages it points to
+    PageFile *file = (*fHandle).mgmtInfo;
+    if (file->compressed)
+        return writePageMap(file, 1);
+    if (fsync(file->fd) != 0)
+        return RC_WRITE_FAILED;
+
+    return RC_OK;
+}
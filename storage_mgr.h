@@ -15,16 +15,30 @@ typedef struct SM_FileHandle {
 
 typedef char* SM_PageHandle;
 
+// when readBlock checks the checksum every block carries, writeBlock always writes it
+typedef enum PageVerify {
+	PAGE_VERIFY_ALWAYS = 0,	// on every read
+	PAGE_VERIFY_LAZY = 1,	// on the first read of each page since its file was opened
+	PAGE_VERIFY_OFF = 2
+} PageVerify;
+
 /************************************************************
  *                    interface                             *
  ************************************************************/
 /* manipulating page files */
 extern void initStorageManager (void);
 extern RC createPageFile (char *fileName);
+extern RC createCompressedPageFile (char *fileName);
 extern RC openPageFile (char *fileName, SM_FileHandle *fHandle);
 extern RC closePageFile (SM_FileHandle *fHandle);
 extern RC destroyPageFile (char *fileName);
 
+/* page checksums, a page that fails its check is read as RC_PAGE_CORRUPTED */
+extern void setPageVerify (PageVerify mode);
+extern PageVerify getPageVerify (void);
+extern unsigned int crc32c (unsigned int crc, const void *data, int length);
+extern const char *crc32cImplementation (void);
+
 /* reading blocks from disc */
 extern RC readBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern int getBlockPos (SM_FileHandle *fHandle);
@@ -39,5 +53,7 @@ extern RC writeBlock (int pageNum, SM_FileHandle *fHandle, SM_PageHandle memPage
 extern RC writeCurrentBlock (SM_FileHandle *fHandle, SM_PageHandle memPage);
 extern RC appendEmptyBlock (SM_FileHandle *fHandle);
 extern RC ensureCapacity (int numberOfPages, SM_FileHandle *fHandle);
+extern RC truncatePageFile (int numberOfPages, SM_FileHandle *fHandle);
+extern RC syncPageFile (SM_FileHandle *fHandle);
 
 #endif
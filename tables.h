@@ -13,6 +13,7 @@ typedef enum DataType {
 
 typedef struct Value {
 	DataType dt;
+	bool isNull;		// SQL NULL, v holds nothing meaningful
 	union v {
 		int intV;
 		char *stringV;
@@ -41,6 +42,7 @@ typedef struct Schema
 	int *typeLength;
 	int *keyAttrs;
 	int keySize;
+	bool *notNull;		// attributes declared NOT NULL, key attributes always are
 } Schema;
 
 // TableData: Management Structure for a Record Manager to handle one relation
@@ -55,6 +57,7 @@ typedef struct RM_TableData
 		do {									\
 			(result) = (Value *) malloc(sizeof(Value));				\
 			(result)->dt = DT_STRING;						\
+			(result)->isNull = FALSE;						\
 			(result)->v.stringV = (char *) malloc(strlen(value) + 1);		\
 			strcpy((result)->v.stringV, value);					\
 		} while(0)
@@ -64,6 +67,7 @@ typedef struct RM_TableData
 		do {									\
 			(result) = (Value *) malloc(sizeof(Value));				\
 			(result)->dt = datatype;						\
+			(result)->isNull = FALSE;						\
 			switch(datatype)							\
 			{									\
 			case DT_INT:							\
@@ -78,6 +82,15 @@ typedef struct RM_TableData
 			}									\
 		} while(0)
 
+// a NULL of the given datatype, getAttr returns these for NULL attributes
+#define MAKE_NULL_VALUE(result, datatype)				\
+		do {									\
+			(result) = (Value *) malloc(sizeof(Value));				\
+			(result)->dt = datatype;						\
+			(result)->isNull = TRUE;						\
+			(result)->v.stringV = NULL;						\
+		} while(0)
+
 
 // debug and read methods
 extern Value *stringToValue (char *value);
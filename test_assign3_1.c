@@ -1,4 +1,10 @@
 #include <stdlib.h>
+#include <pthread.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include <signal.h>
 #include "dberror.h"
 #include "expr.h"
 #include "record_mgr.h"
@@ -57,6 +63,31 @@ static void testScans(void);
 static void testScansTwo(void);
 static void testInsertManyRecords(void);
 static void testMultipleScans(void);
+static void testAdaptiveConjuncts(void);
+static void testIndexes(void);
+static void testPrimaryKey(void);
+static void testIndexScans(void);
+static void testHashIndex(void);
+static void testVariableLengthRecords(void);
+static void testNulls(void);
+static void testVacuum(void);
+static void testMultipleTables(void);
+static void testSharedBufferPool(void);
+static void testConcurrentScans(void);
+static void testParallelScan(void);
+static void testProjectedScan(void);
+static void testAggregates(void);
+static void testJoins(void);
+static void testSort(void);
+static void testRecovery(void);
+static void testTransactions(void);
+static void testCheckpoints(void);
+static void testSnapshots(void);
+static void testLocking(void);
+static void testPageChecksums(void);
+static void testCompressedTables(void);
+static void testPaxTables(void);
+static void testDictionaryEncoding(void);
 
 // struct for test records
 typedef struct TestRecord
@@ -86,6 +117,31 @@ int main(void)
 	testScans();
 	testScansTwo();
 	testMultipleScans();
+	testAdaptiveConjuncts();
+	testIndexes();
+	testPrimaryKey();
+	testIndexScans();
+	testHashIndex();
+	testVariableLengthRecords();
+	testNulls();
+	testVacuum();
+	testMultipleTables();
+	testSharedBufferPool();
+	testConcurrentScans();
+	testParallelScan();
+	testProjectedScan();
+	testAggregates();
+	testJoins();
+	testSort();
+	testRecovery();
+	testTransactions();
+	testCheckpoints();
+	testSnapshots();
+	testLocking();
+	testPageChecksums();
+	testCompressedTables();
+	testPaxTables();
+	testDictionaryEncoding();
 
 	return 0;
 }
@@ -646,6 +702,3569 @@ void testScansTwo(void)
 	TEST_DONE();
 }
 
+// ************************************************************
+void testAdaptiveConjuncts(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	TestRecord inserts[] = {
+		{1, "aaaa", 3},
+		{2, "bbbb", 2},
+		{3, "cccc", 1},
+		{4, "dddd", 3},
+		{5, "eeee", 5},
+		{6, "ffff", 1},
+		{7, "gggg", 3},
+		{8, "hhhh", 3},
+		{9, "iiii", 2},
+		{10, "jjjj", 5},
+	};
+	TestRecord result = {6, "ffff", 1};
+	int numInserts = 10, i, matches = 0;
+	Record *r;
+	Schema *schema;
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	Expr *strCond, *intCond, *conj, *left, *right;
+	int rc;
+
+	testName = "test adaptive conjunct ordering in scans";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_r", schema));
+	TEST_CHECK(openTable(table, "test_table_r"));
+
+	for (i = 0; i < numInserts; i++)
+	{
+		r = fromTestRecord(schema, inserts[i]);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// b = 'ffff' AND c = 1 evaluated adaptively
+	MAKE_CONS(left, stringToValue("sffff"));
+	MAKE_ATTRREF(right, 1);
+	MAKE_BINOP_EXPR(strCond, right, left, OP_COMP_EQUAL);
+	MAKE_CONS(left, stringToValue("i1"));
+	MAKE_ATTRREF(right, 2);
+	MAKE_BINOP_EXPR(intCond, right, left, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(conj, strCond, intCond, OP_BOOL_AND);
+
+	TEST_CHECK(startScan(table, sc, conj));
+	TEST_CHECK(setScanAdaptive(sc, TRUE));
+	TEST_CHECK(createRecord(&r, schema));
+	while ((rc = next(sc, r)) == RC_OK)
+	{
+		ASSERT_EQUALS_RECORDS(fromTestRecord(schema, result), r, schema, "adaptive scan result");
+		matches++;
+	}
+	if (rc != RC_RM_NO_MORE_TUPLES)
+		TEST_CHECK(rc);
+	TEST_CHECK(closeScan(sc));
+	ASSERT_EQUALS_INT(1, matches, "adaptive scan returns one tuple");
+	freeRecord(r);
+
+	// clean up
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_r"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(sc);
+	freeSchema(schema);
+	freeExpr(conj);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testIndexes(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	TestRecord inserts[] = {
+		{1, "aaaa", 3},
+		{2, "bbbb", 2},
+		{3, "cccc", 1},
+		{4, "dddd", 3},
+		{5, "eeee", 5},
+		{6, "ffff", 1},
+		{7, "gggg", 3},
+		{8, "hhhh", 3},
+		{9, "iiii", 2},
+		{10, "jjjj", 5},
+	};
+	int numInserts = 10, i, n;
+	Record *r, *expected;
+	RID *rids;
+	Schema *schema;
+	BTreeHandle *tree;
+	Value *key;
+	testName = "test secondary indexes maintained by insert, update and delete";
+	schema = testSchema();
+	rids = (RID *)malloc(sizeof(RID) * (numInserts + 1));
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_i", schema));
+	TEST_CHECK(openTable(table, "test_table_i"));
+
+	// half of the rows exist before the index and are loaded by createIndex
+	for (i = 0; i < numInserts; i++)
+	{
+		if (i == numInserts / 2)
+			TEST_CHECK(createIndex(table, 1));
+		r = fromTestRecord(schema, inserts[i]);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, createIndex(table, 1), "attribute is already indexed");
+
+	TEST_CHECK(getTableIndex(table, 1, &tree));
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(numInserts, n, "index holds every record");
+
+	// point lookups through the index
+	TEST_CHECK(createRecord(&r, schema));
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_STRING_VALUE(key, inserts[i].b);
+		TEST_CHECK(getRecordByValue(table, 1, key, r));
+		expected = fromTestRecord(schema, inserts[i]);
+		ASSERT_EQUALS_RECORDS(expected, r, schema, "index lookup finds the record");
+		freeRecord(expected);
+		freeVal(key);
+	}
+
+	// a deleted record leaves the index
+	TEST_CHECK(deleteRecord(table, rids[3]));
+	MAKE_STRING_VALUE(key, "dddd");
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecordByValue(table, 1, key, r), "deleted key is not found");
+	freeVal(key);
+
+	// an update moves the entry to the new key
+	expected = testRecord(schema, 5, "zzzz", 5);
+	expected->id = rids[4];
+	TEST_CHECK(updateRecord(table, expected));
+	MAKE_STRING_VALUE(key, "eeee");
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecordByValue(table, 1, key, r), "old key of updated record is gone");
+	freeVal(key);
+	MAKE_STRING_VALUE(key, "zzzz");
+	TEST_CHECK(getRecordByValue(table, 1, key, r));
+	ASSERT_EQUALS_RECORDS(expected, r, schema, "updated record found by its new key");
+	freeVal(key);
+	freeRecord(expected);
+
+	// the index registry survives closing the table
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_i"));
+	TEST_CHECK(getTableIndex(table, 1, &tree));
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(numInserts - 1, n, "index reopened with the table");
+
+	// attributes without an index fall back to reading the table
+	MAKE_VALUE(key, DT_INT, 9);
+	TEST_CHECK(getRecordByValue(table, 0, key, r));
+	expected = fromTestRecord(schema, inserts[8]);
+	ASSERT_EQUALS_RECORDS(expected, r, schema, "lookup without an index");
+	freeRecord(expected);
+	freeVal(key);
+
+	TEST_CHECK(dropIndex(table, 1));
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getTableIndex(table, 1, &tree), "index dropped");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_i"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(rids);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testPrimaryKey(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	TestRecord inserts[] = {
+		{1, "aaaa", 3},
+		{2, "bbbb", 2},
+		{3, "cccc", 1},
+		{4, "aaaa", 1},
+	};
+	int numInserts = 4, i;
+	Record *r, *expected;
+	RID *rids;
+	Schema *schema;
+	Value *keys[2], *nullKey;
+	testName = "test primary key enforcement and lookup";
+	schema = testSchema();
+	rids = (RID *)malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_k", schema));
+	TEST_CHECK(openTable(table, "test_table_k"));
+
+	for (i = 0; i < numInserts; i++)
+	{
+		r = fromTestRecord(schema, inserts[i]);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// the key attributes are persisted in the table header
+	ASSERT_EQUALS_INT(1, table->schema->keySize, "key size read from the header");
+	ASSERT_EQUALS_INT(0, table->schema->keyAttrs[0], "key attribute read from the header");
+
+	// duplicates are rejected on insert and update
+	r = testRecord(schema, 2, "zzzz", 9);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate key rejected on insert");
+	r->id = rids[0];
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, updateRecord(table, r), "update to an existing key rejected");
+	freeRecord(r);
+	ASSERT_ERROR(dropIndex(table, 0), "primary key index cannot be dropped");
+
+	// lookup by key
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_VALUE(keys[0], DT_INT, 3);
+	TEST_CHECK(getRecordByKey(table, keys, r));
+	expected = fromTestRecord(schema, inserts[2]);
+	ASSERT_EQUALS_RECORDS(expected, r, schema, "record found by key");
+	freeRecord(expected);
+	freeVal(keys[0]);
+
+	// a deleted key can be inserted again
+	TEST_CHECK(deleteRecord(table, rids[1]));
+	MAKE_VALUE(keys[0], DT_INT, 2);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getRecordByKey(table, keys, r), "deleted key not found");
+	freeVal(keys[0]);
+	expected = testRecord(schema, 2, "yyyy", 7);
+	TEST_CHECK(insertRecord(table, expected));
+	freeRecord(expected);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_k"));
+	freeSchema(schema);
+
+	// composite key on (b, c)
+	schema = testSchema();
+	schema->keySize = 2;
+	schema->keyAttrs = (int *)malloc(sizeof(int) * 2);
+	schema->keyAttrs[0] = 1;
+	schema->keyAttrs[1] = 2;
+	TEST_CHECK(createTable("test_table_k", schema));
+	TEST_CHECK(openTable(table, "test_table_k"));
+
+	for (i = 0; i < numInserts; i++)
+	{
+		r = fromTestRecord(schema, inserts[i]);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	r = testRecord(schema, 5, "aaaa", 1);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate composite key rejected");
+	freeRecord(r);
+
+	// key attributes are NOT NULL although the schema was given the key after createSchema
+	r = testRecord(schema, 6, "dddd", 1);
+	MAKE_NULL_VALUE(nullKey, DT_INT);
+	TEST_CHECK(setAttr(r, schema, 2, nullKey));
+	freeVal(nullKey);
+	ASSERT_EQUALS_INT(RC_NOT_NULL_VIOLATION, insertRecord(table, r), "NULL key attribute rejected on insert");
+	TEST_CHECK(getRecord(table, rids[0], r));
+	MAKE_NULL_VALUE(nullKey, DT_STRING);
+	TEST_CHECK(setAttr(r, schema, 1, nullKey));
+	freeVal(nullKey);
+	ASSERT_EQUALS_INT(RC_NOT_NULL_VIOLATION, updateRecord(table, r), "NULL key attribute rejected on update");
+	freeRecord(r);
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(table), "no record with a NULL key");
+
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_STRING_VALUE(keys[0], "aaaa");
+	MAKE_VALUE(keys[1], DT_INT, 1);
+	TEST_CHECK(getRecordByKey(table, keys, r));
+	expected = fromTestRecord(schema, inserts[3]);
+	ASSERT_EQUALS_RECORDS(expected, r, schema, "record found by composite key");
+	freeRecord(expected);
+	freeVal(keys[0]);
+	freeVal(keys[1]);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_k"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(rids);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testIndexScans(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *names[] = {"aaaa", "bbbb", "cccc", "dddd", "eeee"};
+	int numInserts = 100, i, n, rc;
+	Record *r;
+	Schema *schema;
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	Expr *sel, *left, *right, *lower, *upper;
+	Value *v;
+	char *plan;
+	testName = "test scans choosing an index as access path";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_s", schema));
+	TEST_CHECK(openTable(table, "test_table_s"));
+
+	for (i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, names[i % 5], i % 7);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(createIndex(table, 1));
+	TEST_CHECK(createRecord(&r, schema));
+
+	// equality on the primary key
+	MAKE_CONS(left, stringToValue("i42"));
+	MAKE_ATTRREF(right, 0);
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(explainScan(sc, &plan));
+	ASSERT_EQUALS_STRING("KEY LOOKUP on a = 42", plan, "primary key lookup");
+	free(plan);
+	TEST_CHECK(next(sc, r));
+	getAttr(r, schema, 0, &v);
+	ASSERT_EQUALS_INT(42, v->v.intV, "key lookup returns the record");
+	freeVal(v);
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, next(sc, r), "key lookup returns one record");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// range on the primary key, a >= 50 AND a <= 59 is merged into BETWEEN
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i50"));
+	MAKE_BINOP_EXPR(lower, left, right, OP_COMP_GREATER_EQUAL);
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i59"));
+	MAKE_BINOP_EXPR(upper, left, right, OP_COMP_SMALLER_EQUAL);
+	MAKE_BINOP_EXPR(sel, lower, upper, OP_BOOL_AND);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(explainScan(sc, &plan));
+	ASSERT_EQUALS_STRING("INDEX RANGE SCAN on a [50, 59]", plan, "range scan on the key index");
+	free(plan);
+	n = 0;
+	while ((rc = next(sc, r)) == RC_OK)
+	{
+		getAttr(r, schema, 0, &v);
+		ASSERT_EQUALS_INT(50 + n, v->v.intV, "range scan returns keys in order");
+		freeVal(v);
+		n++;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "range scan ends");
+	ASSERT_EQUALS_INT(10, n, "range scan returns ten records");
+	TEST_CHECK(closeScan(sc));
+	ASSERT_TRUE(sel->expr.op->type == OP_BOOL_AND && sel->expr.op->args[0] == lower, "scan leaves the condition of the caller as it was");
+	freeExpr(sel);
+
+	// equality on a secondary index, combined with a residual predicate
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("scccc"));
+	MAKE_BINOP_EXPR(lower, left, right, OP_COMP_EQUAL);
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i2"));
+	MAKE_BINOP_EXPR(upper, left, right, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(sel, upper, lower, OP_BOOL_AND);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(explainScan(sc, &plan));
+	ASSERT_EQUALS_STRING("INDEX RANGE SCAN on b [cccc, cccc]", plan, "secondary index chosen");
+	free(plan);
+	n = 0;
+	while (next(sc, r) == RC_OK)
+	{
+		getAttr(r, schema, 0, &v);
+		ASSERT_TRUE(v->v.intV % 5 == 2 && v->v.intV % 7 == 2, "record satisfies both predicates");
+		freeVal(v);
+		n++;
+	}
+	ASSERT_EQUALS_INT(3, n, "b = cccc AND c = 2 matches 2, 37 and 72");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// a LIKE with a fixed prefix scans the range of the prefix on the secondary index
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("scc%"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_LIKE);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(explainScan(sc, &plan));
+	ASSERT_EQUALS_STRING("INDEX RANGE SCAN on b [cc, cd]", plan, "prefix LIKE uses the secondary index");
+	free(plan);
+	n = 0;
+	while (next(sc, r) == RC_OK)
+	{
+		getAttr(r, schema, 0, &v);
+		ASSERT_EQUALS_INT(2, v->v.intV % 5, "record matches the pattern");
+		freeVal(v);
+		n++;
+	}
+	ASSERT_EQUALS_INT(20, n, "b LIKE cc% matches every cccc");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// deleting every record an index scan returns does not make it skip the next ones
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i70"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_GREATER_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+	{
+		TEST_CHECK(deleteRecord(table, r->id));
+		n++;
+	}
+	ASSERT_EQUALS_INT(30, n, "key range scan returns every record while they are deleted");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("saaaa"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+	{
+		TEST_CHECK(deleteRecord(table, r->id));
+		n++;
+	}
+	ASSERT_EQUALS_INT(14, n, "secondary index scan returns every record while they are deleted");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(numInserts - 30 - 14, getNumTuples(table), "records deleted during the scans");
+
+	// no indexed attribute in the condition
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i2"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(explainScan(sc, &plan));
+	ASSERT_EQUALS_STRING("SEQUENTIAL SCAN", plan, "sequential scan without an index");
+	free(plan);
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_s"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(sc);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testHashIndex(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *names[] = {"aaaa", "bbbb", "cccc", "dddd", "eeee"};
+	int numInserts = 100, i, n;
+	Record *r, *expected;
+	RID *rids;
+	Schema *schema;
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	Expr *sel, *left, *right;
+	HashHandle *hash;
+	BTreeHandle *tree;
+	Value *key;
+	char *plan;
+	testName = "test hash indexes maintained by the table and used by scans";
+	schema = testSchema();
+	rids = (RID *)malloc(sizeof(RID) * numInserts);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_h", schema));
+	TEST_CHECK(openTable(table, "test_table_h"));
+
+	// half of the rows exist before the index and are loaded by createHashIndex
+	for (i = 0; i < numInserts; i++)
+	{
+		if (i == numInserts / 2)
+			TEST_CHECK(createHashIndex(table, 1));
+		r = testRecord(schema, i, names[i % 5], i % 7);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, createIndex(table, 1), "attribute already has a hash index");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getTableIndex(table, 1, &tree), "hash index is not a B+-tree");
+	TEST_CHECK(getTableHashIndex(table, 1, &hash));
+	TEST_CHECK(getHashNumEntries(hash, &n));
+	ASSERT_EQUALS_INT(numInserts, n, "hash index holds every record");
+
+	// equality scans are answered from the hash index
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("scccc"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	TEST_CHECK(explainScan(sc, &plan));
+	ASSERT_EQUALS_STRING("HASH LOOKUP on b = cccc", plan, "hash index chosen for equality");
+	free(plan);
+	TEST_CHECK(createRecord(&r, schema));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+	{
+		getAttr(r, schema, 0, &key);
+		ASSERT_TRUE(key->v.intV % 5 == 2, "hash lookup returns matching records");
+		freeVal(key);
+		n++;
+	}
+	ASSERT_EQUALS_INT(numInserts / 5, n, "hash lookup returns every match");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// deletes and updates keep the hash index in sync
+	TEST_CHECK(deleteRecord(table, rids[0]));
+	expected = testRecord(schema, 5, "zzzz", 5);
+	expected->id = rids[5];
+	TEST_CHECK(updateRecord(table, expected));
+	MAKE_STRING_VALUE(key, "zzzz");
+	TEST_CHECK(getRecordByValue(table, 1, key, r));
+	ASSERT_EQUALS_RECORDS(expected, r, schema, "updated record found by its new key");
+	freeVal(key);
+	freeRecord(expected);
+
+	// the index registry records the kind of index
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_h"));
+	TEST_CHECK(getTableHashIndex(table, 1, &hash));
+	TEST_CHECK(getHashNumEntries(hash, &n));
+	ASSERT_EQUALS_INT(numInserts - 1, n, "hash index reopened with the table");
+
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("saaaa"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(numInserts / 5 - 2, n, "deleted and updated records left the hash index");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	TEST_CHECK(dropIndex(table, 1));
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, getTableHashIndex(table, 1, &hash), "hash index dropped");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_h"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(sc);
+	free(rids);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testVariableLengthRecords(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *names[] = {"a", "b", "c"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_STRING};
+	int sizes[] = {0, 100, 6000};
+	int keys[] = {0};
+	int numInserts = 500, i, n, rc;
+	char *big = (char *)malloc(6001);
+	Record *r, *out;
+	RID *rids;
+	Schema *schema;
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	Value *v;
+	testName = "test variable-length records with overflow strings";
+	schema = createSchema(3, names, dt, sizes, 1, keys);
+	rids = (RID *)malloc(sizeof(RID) * numInserts);
+	memset(big, 'x', 6000);
+	big[6000] = '\0';
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_v", schema));
+	TEST_CHECK(openTable(table, "test_table_v"));
+
+	// short strings are stored without their padding, far more than PAGE_SIZE / getRecordSize fit on a page
+	TEST_CHECK(createRecord(&r, schema));
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, v));
+		freeVal(v);
+		MAKE_STRING_VALUE(v, i % 2 ? "ab" : "abcdefgh");
+		TEST_CHECK(setAttr(r, schema, 1, v));
+		freeVal(v);
+		MAKE_STRING_VALUE(v, "");
+		TEST_CHECK(setAttr(r, schema, 2, v));
+		freeVal(v);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+	}
+	ASSERT_TRUE(getRecordSize(schema) > PAGE_SIZE, "fixed-width record is larger than a page");
+	ASSERT_EQUALS_INT(1, rids[100].page, "over a hundred short records share the first page");
+
+	// a long string goes to an overflow chain and reads back whole
+	TEST_CHECK(createRecord(&out, schema));
+	MAKE_VALUE(v, DT_INT, 7);
+	TEST_CHECK(setAttr(r, schema, 0, v));
+	freeVal(v);
+	MAKE_STRING_VALUE(v, big);
+	TEST_CHECK(setAttr(r, schema, 2, v));
+	freeVal(v);
+	r->id = rids[7];
+	TEST_CHECK(updateRecord(table, r));
+	TEST_CHECK(getRecord(table, rids[7], out));
+	getAttr(out, schema, 2, &v);
+	ASSERT_TRUE(strcmp(big, v->v.stringV) == 0, "overflow string read back");
+	freeVal(v);
+	ASSERT_EQUALS_INT(rids[7].page, out->id.page, "updated record keeps its page");
+	ASSERT_EQUALS_INT(rids[7].slot, out->id.slot, "updated record keeps its slot");
+
+	// growing records on a full page keeps every RID valid
+	MAKE_STRING_VALUE(v, "a string of forty characters to grow rec");
+	TEST_CHECK(setAttr(r, schema, 1, v));
+	freeVal(v);
+	MAKE_STRING_VALUE(v, "");
+	TEST_CHECK(setAttr(r, schema, 2, v));
+	freeVal(v);
+	for (i = 0; i < 100; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, v));
+		freeVal(v);
+		r->id = rids[i];
+		TEST_CHECK(updateRecord(table, r));
+	}
+	for (i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(getRecord(table, rids[i], out));
+		getAttr(out, schema, 0, &v);
+		n = v->v.intV;
+		freeVal(v);
+		getAttr(out, schema, 1, &v);
+		rc = strcmp(v->v.stringV, i < 100 ? "a string of forty characters to grow rec" : (i % 2 ? "ab" : "abcdefgh"));
+		freeVal(v);
+		if (n != i || rc != 0)
+			break;
+	}
+	ASSERT_EQUALS_INT(numInserts, i, "every record readable at its RID after growing updates");
+
+	// deleted records leave their slots free and scans skip them
+	for (i = 0; i < numInserts; i += 2)
+		TEST_CHECK(deleteRecord(table, rids[i]));
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecord(table, rids[0], out), "deleted record is gone");
+
+	Expr *sel, *left, *right;
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("sab"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while ((rc = next(sc, out)) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ends");
+	ASSERT_EQUALS_INT(200, n, "scan returns the odd records that were not grown");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// freed space is reused by new inserts
+	MAKE_VALUE(v, DT_INT, numInserts);
+	TEST_CHECK(setAttr(r, schema, 0, v));
+	freeVal(v);
+	TEST_CHECK(insertRecord(table, r));
+	ASSERT_EQUALS_INT(rids[0].page, r->id.page, "insert reuses a freed slot");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_v"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(sc);
+	free(rids);
+	free(big);
+	freeRecord(r);
+	freeRecord(out);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testNulls(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *other = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *names[] = {"a", "b", "c", "d"};
+	DataType dt[] = {DT_INT, DT_STRING, DT_INT, DT_INT};
+	int sizes[] = {0, 10, 0, 0};
+	int keys[] = {0};
+	int numInserts = 120, i, n;
+	Record *r, *r2;
+	RID *rids;
+	Schema *schema, *nullable;
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	Expr *sel, *left, *right, *cmp;
+	BTreeHandle *tree;
+	Value *v, *nullInt;
+	testName = "test NULL attributes, NOT NULL and three-valued scans";
+	schema = createSchema(4, names, dt, sizes, 1, keys);
+	TEST_CHECK(setNotNull(schema, 3, TRUE));
+	ASSERT_EQUALS_INT(RC_ERROR, setNotNull(schema, 0, FALSE), "key attribute stays NOT NULL");
+	rids = (RID *)malloc(sizeof(RID) * numInserts);
+	nullInt = stringToValue("ni");
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_n", schema));
+	TEST_CHECK(openTable(table, "test_table_n"));
+
+	// b is always NULL, c only has a value for every fourth record
+	TEST_CHECK(createRecord(&r, schema));
+	v = stringToValue("ns");
+	TEST_CHECK(setAttr(r, schema, 1, v));
+	freeVal(v);
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, v));
+		TEST_CHECK(setAttr(r, schema, 3, v));
+		TEST_CHECK(setAttr(r, schema, 2, i % 4 == 0 ? v : nullInt));
+		freeVal(v);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+	}
+	ASSERT_EQUALS_INT(1, rids[numInserts - 1].page, "NULL attributes take no space on the page");
+
+	TEST_CHECK(getRecord(table, rids[5], r));
+	getAttr(r, schema, 1, &v);
+	ASSERT_TRUE(v->isNull && v->dt == DT_STRING, "NULL string read back");
+	freeVal(v);
+	getAttr(r, schema, 2, &v);
+	ASSERT_TRUE(v->isNull, "NULL int read back");
+	freeVal(v);
+	TEST_CHECK(getRecord(table, rids[8], r));
+	getAttr(r, schema, 2, &v);
+	ASSERT_TRUE(!v->isNull && v->v.intV == 8, "value next to NULLs read back");
+	freeVal(v);
+
+	// NOT NULL attributes and the key reject NULLs
+	TEST_CHECK(setAttr(r, schema, 3, nullInt));
+	ASSERT_EQUALS_INT(RC_NOT_NULL_VIOLATION, insertRecord(table, r), "NULL in NOT NULL attribute rejected");
+	ASSERT_EQUALS_INT(RC_NOT_NULL_VIOLATION, updateRecord(table, r), "update to NULL in NOT NULL attribute rejected");
+	MAKE_VALUE(v, DT_INT, 8);
+	TEST_CHECK(setAttr(r, schema, 3, v));
+	freeVal(v);
+	TEST_CHECK(setAttr(r, schema, 0, nullInt));
+	ASSERT_EQUALS_INT(RC_NOT_NULL_VIOLATION, insertRecord(table, r), "NULL key rejected");
+
+	// scans only keep records for which the condition is TRUE
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i8"));
+	MAKE_BINOP_EXPR(cmp, left, right, OP_COMP_EQUAL);
+	MAKE_UNOP_EXPR(sel, cmp, OP_BOOL_NOT);
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(numInserts / 4 - 1, n, "NOT (c = 8) skips the records where c is NULL");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	MAKE_ATTRREF(left, 2);
+	MAKE_UNOP_EXPR(sel, left, OP_IS_NULL);
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(numInserts - numInserts / 4, n, "c IS NULL");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// IS NULL on a NOT NULL attribute is folded away in the condition of the scan, not in that
+	// of the caller, which still holds for a table where the attribute is nullable
+	MAKE_ATTRREF(left, 3);
+	MAKE_UNOP_EXPR(sel, left, OP_IS_NULL);
+	TEST_CHECK(startScan(table, sc, sel));
+	ASSERT_TRUE(sel->type == EXPR_OP && sel->expr.op->type == OP_IS_NULL, "d IS NULL of the caller kept");
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, next(sc, r), "d IS NULL matches nothing");
+	TEST_CHECK(closeScan(sc));
+	nullable = createSchema(4, names, dt, sizes, 1, keys);
+	TEST_CHECK(createTable("test_table_n2", nullable));
+	TEST_CHECK(openTable(other, "test_table_n2"));
+	TEST_CHECK(createRecord(&r2, nullable));
+	for (i = 0; i < 5; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i);
+		TEST_CHECK(setAttr(r2, nullable, 0, v));
+		TEST_CHECK(setAttr(r2, nullable, 3, nullInt));
+		freeVal(v);
+		TEST_CHECK(insertRecord(other, r2));
+	}
+	TEST_CHECK(startScan(other, sc, sel));
+	n = 0;
+	while (next(sc, r2) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(5, n, "d IS NULL reused on a table where d is nullable");
+	TEST_CHECK(closeScan(sc));
+	TEST_CHECK(closeTable(other));
+	TEST_CHECK(deleteTable("test_table_n2"));
+	freeRecord(r2);
+	freeSchema(nullable);
+	freeExpr(sel);
+
+	// NULLs are not indexed, updates move records in and out of the index
+	TEST_CHECK(createIndex(table, 2));
+	TEST_CHECK(getTableIndex(table, 2, &tree));
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(numInserts / 4, n, "only non-NULL values indexed");
+	TEST_CHECK(getRecord(table, rids[1], r));
+	MAKE_VALUE(v, DT_INT, 1);
+	TEST_CHECK(setAttr(r, schema, 2, v));
+	freeVal(v);
+	TEST_CHECK(updateRecord(table, r));
+	TEST_CHECK(getRecord(table, rids[4], r));
+	TEST_CHECK(setAttr(r, schema, 2, nullInt));
+	TEST_CHECK(updateRecord(table, r));
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(numInserts / 4, n, "index follows NULL to value and value to NULL");
+	MAKE_VALUE(v, DT_INT, 1);
+	TEST_CHECK(getRecordByValue(table, 2, v, r));
+	ASSERT_EQUALS_INT(rids[1].slot, r->id.slot, "record found by its new value");
+	freeVal(v);
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecordByValue(table, 2, nullInt, r), "NULL never matches");
+
+	// NOT NULL declarations are part of the table
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_n"));
+	MAKE_VALUE(v, DT_INT, numInserts);
+	TEST_CHECK(setAttr(r, table->schema, 0, v));
+	freeVal(v);
+	TEST_CHECK(setAttr(r, table->schema, 3, nullInt));
+	ASSERT_EQUALS_INT(RC_NOT_NULL_VIOLATION, insertRecord(table, r), "NOT NULL survives reopening");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_n"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(other);
+	free(sc);
+	free(rids);
+	freeVal(nullInt);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testVacuum(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	char *names[] = {"a", "b"};
+	DataType dt[] = {DT_INT, DT_STRING};
+	int sizes[] = {0, 100};
+	int keys[] = {0};
+	int numInserts = 1000, numExtra = 300, i, n, calls, lastPage;
+	Record *r;
+	RID *rids;
+	Schema *schema;
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	RM_VacuumStats stats, total;
+	Expr *sel;
+	Value *v;
+	testName = "test incremental vacuum, free page list and tail truncation";
+	schema = createSchema(2, names, dt, sizes, 1, keys);
+	rids = (RID *)malloc(sizeof(RID) * (numInserts + numExtra));
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_vac", schema));
+	TEST_CHECK(openTable(table, "test_table_vac"));
+
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_STRING_VALUE(v, "a string of sixty characters that fills pages a bit faster");
+	TEST_CHECK(setAttr(r, schema, 1, v));
+	freeVal(v);
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, v));
+		freeVal(v);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+	}
+
+	// empty the first pages and the last ones, and thin out the middle
+	for (i = 0; i < numInserts; i++)
+		if (i < 300 || i >= 900 || (i < 700 && i % 2 == 0))
+			TEST_CHECK(deleteRecord(table, rids[i]));
+	lastPage = rids[899].page;
+
+	// a few pages per call until the pass over the file completes
+	memset(&total, 0, sizeof(total));
+	for (calls = 0; calls < 100; calls++)
+	{
+		TEST_CHECK(vacuumTable(table, 4, TRUE, &stats));
+		ASSERT_TRUE(stats.pagesVisited <= 4, "vacuum visits a bounded number of pages");
+		total.pagesCompacted += stats.pagesCompacted;
+		total.pagesFreed += stats.pagesFreed;
+		total.pagesTruncated += stats.pagesTruncated;
+		total.elapsedMs += stats.elapsedMs;
+		if (stats.passComplete)
+			break;
+	}
+	ASSERT_TRUE(calls > 1, "the pass took several calls");
+	ASSERT_TRUE(total.pagesFreed >= 5, "empty pages went to the free page list");
+	ASSERT_TRUE(total.pagesCompacted > 0, "thinned out pages were compacted");
+	ASSERT_TRUE(total.pagesTruncated > 0, "empty tail of the file cut off");
+	ASSERT_TRUE(total.elapsedMs >= 0, "time spent is reported");
+
+	// live records are untouched
+	sel = (Expr *)malloc(sizeof(Expr));
+	sel->type = EXPR_CONST;
+	sel->expr.cons = stringToValue("bt");
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(400, n, "scan returns every live record after vacuum");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+	for (i = 301; i < 900; i += (i < 700) ? 2 : 1)
+	{
+		if (getRecord(table, rids[i], r) != RC_OK)
+			break;
+		getAttr(r, schema, 0, &v);
+		n = v->v.intV;
+		freeVal(v);
+		if (n != i)
+			break;
+	}
+	ASSERT_EQUALS_INT(900, i, "every live record keeps its RID");
+
+	// the free page list survives reopening and new records reuse the reclaimed space
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_vac"));
+	for (i = numInserts; i < numInserts + numExtra; i++)
+	{
+		MAKE_VALUE(v, DT_INT, i);
+		TEST_CHECK(setAttr(r, schema, 0, v));
+		freeVal(v);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		if (r->id.page > lastPage)
+			break;
+	}
+	ASSERT_EQUALS_INT(numInserts + numExtra, i, "inserts reuse reclaimed pages before the file grows");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_vac"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(sc);
+	free(rids);
+	freeRecord(r);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testMultipleTables(void)
+{
+	int numTables = 12, numInserts = 50, i, k, n, found;
+	RM_TableData tables[12];
+	char tableNames[12][32], longName[CATALOG_NAME_LENGTH + 8], wideNames[60][32];
+	char **listed, *wideAttrs[60];
+	DataType wideTypes[60];
+	int wideSizes[60], wideKeys[] = {0};
+	Record *r;
+	RID rids[12];
+	Schema *schema, *wide;
+	Value *v;
+	testName = "test the catalog with many tables open at the same time";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	for (k = 0; k < numTables; k++)
+	{
+		sprintf(tableNames[k], "test_table_m%d", k);
+		TEST_CHECK(createTable(tableNames[k], schema));
+	}
+
+	// every created table is listed in the catalog
+	TEST_CHECK(getTableNames(&listed, &n));
+	found = 0;
+	for (i = 0; i < n; i++)
+	{
+		for (k = 0; k < numTables; k++)
+			if (strcmp(listed[i], tableNames[k]) == 0)
+				found++;
+		free(listed[i]);
+	}
+	free(listed);
+	ASSERT_EQUALS_INT(numTables, found, "catalog lists every table");
+
+	// open all tables at once, each one keeps its own records
+	for (k = 0; k < numTables; k++)
+		TEST_CHECK(openTable(&tables[k], tableNames[k]));
+	for (i = 0; i < numInserts; i++)
+		for (k = 0; k < numTables; k++)
+		{
+			r = testRecord(schema, i, "abcd", k);
+			TEST_CHECK(insertRecord(&tables[k], r));
+			if (i == numInserts / 2)
+				rids[k] = r->id;
+			freeRecord(r);
+		}
+
+	TEST_CHECK(createRecord(&r, schema));
+	for (k = 0; k < numTables; k++)
+	{
+		ASSERT_EQUALS_INT(numInserts, getNumTuples(&tables[k]), "tuple count of each table");
+		TEST_CHECK(getRecord(&tables[k], rids[k], r));
+		getAttr(r, schema, 2, &v);
+		n = v->v.intV;
+		freeVal(v);
+		if (n != k)
+			break;
+	}
+	ASSERT_EQUALS_INT(numTables, k, "records are read from the table they were inserted into");
+	freeRecord(r);
+
+	// closing one table leaves the others usable, the tuple count survives reopening
+	TEST_CHECK(closeTable(&tables[0]));
+	r = testRecord(schema, numInserts, "abcd", 1);
+	TEST_CHECK(insertRecord(&tables[1], r));
+	freeRecord(r);
+	TEST_CHECK(openTable(&tables[0], tableNames[0]));
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(&tables[0]), "tuple count persisted in the header");
+	ASSERT_EQUALS_INT(numInserts + 1, getNumTuples(&tables[1]), "other table kept working");
+
+	for (k = 0; k < numTables; k++)
+	{
+		TEST_CHECK(closeTable(&tables[k]));
+		TEST_CHECK(deleteTable(tableNames[k]));
+	}
+
+	// deleted tables are gone from the catalog
+	TEST_CHECK(getTableNames(&listed, &n));
+	found = 0;
+	for (i = 0; i < n; i++)
+	{
+		if (strncmp(listed[i], "test_table_m", strlen("test_table_m")) == 0)
+			found++;
+		free(listed[i]);
+	}
+	free(listed);
+	ASSERT_EQUALS_INT(0, found, "deleted tables are removed from the catalog");
+
+	// names and schemas the catalog would cut short are refused before any file is created
+	memset(longName, 'n', sizeof(longName) - 1);
+	longName[sizeof(longName) - 1] = '\0';
+	ASSERT_EQUALS_INT(RC_ERROR, createTable(longName, schema), "table name longer than the catalog keeps");
+	ASSERT_TRUE(access(longName, F_OK) != 0, "no page file for a refused name");
+	for (i = 0; i < 60; i++)
+	{
+		sprintf(wideNames[i], "a_rather_long_attribute_%d", i);
+		wideAttrs[i] = wideNames[i];
+		wideTypes[i] = DT_INT;
+		wideSizes[i] = 0;
+	}
+	wide = createSchema(60, wideAttrs, wideTypes, wideSizes, 1, wideKeys);
+	ASSERT_EQUALS_INT(RC_ERROR, createTable("test_table_wide", wide), "schema longer than the catalog keeps");
+	ASSERT_TRUE(access("test_table_wide", F_OK) != 0, "no page file for a refused schema");
+	freeSchema(wide);
+	TEST_CHECK(shutdownRecordManager());
+
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testSharedBufferPool(void)
+{
+	int numTables = 3, numInserts = 500, i, k, n, rc;
+	RM_Options options = {0, 10};
+	RM_TableData tables[3];
+	char tableNames[3][32];
+	RID rids[3][500];
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	Record *r;
+	Schema *schema;
+	Expr *sel, *left, *right;
+	Value *v;
+	testName = "test tables sharing one small buffer pool";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(&options));
+	for (k = 0; k < numTables; k++)
+	{
+		sprintf(tableNames[k], "test_table_s%d", k);
+		TEST_CHECK(createTable(tableNames[k], schema));
+		TEST_CHECK(openTable(&tables[k], tableNames[k]));
+	}
+
+	// interleaved inserts make the tables evict each other's pages
+	for (i = 0; i < numInserts; i++)
+		for (k = 0; k < numTables; k++)
+		{
+			r = testRecord(schema, i, "abcd", k);
+			TEST_CHECK(insertRecord(&tables[k], r));
+			rids[k][i] = r->id;
+			freeRecord(r);
+		}
+
+	TEST_CHECK(createRecord(&r, schema));
+	for (k = 0; k < numTables; k++)
+	{
+		for (i = 0; i < numInserts; i++)
+		{
+			TEST_CHECK(getRecord(&tables[k], rids[k][i], r));
+			getAttr(r, schema, 0, &v);
+			n = v->v.intV;
+			freeVal(v);
+			getAttr(r, schema, 2, &v);
+			rc = v->v.intV;
+			freeVal(v);
+			if (n != i || rc != k)
+				break;
+		}
+		if (i != numInserts)
+			break;
+	}
+	ASSERT_EQUALS_INT(numTables, k, "every record is read back through the shared pool");
+
+	// a scan of one table while the others hold pages of the pool
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i1"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(&tables[1], sc, sel));
+	n = 0;
+	while ((rc = next(sc, r)) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ends");
+	ASSERT_EQUALS_INT(numInserts, n, "scan sees only the records of its table");
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+	freeRecord(r);
+
+	for (k = 0; k < numTables; k++)
+		TEST_CHECK(closeTable(&tables[k]));
+	TEST_CHECK(openTable(&tables[2], tableNames[2]));
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(&tables[2]), "pages written back to the right file");
+	TEST_CHECK(closeTable(&tables[2]));
+
+	for (k = 0; k < numTables; k++)
+		TEST_CHECK(deleteTable(tableNames[k]));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(sc);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+typedef struct ScanThreadArg
+{
+	RM_TableData *table;
+	Schema *schema;
+	int c;
+	int count;
+	RC rc;
+} ScanThreadArg;
+
+static void *scanThread(void *data)
+{
+	ScanThreadArg *arg = (ScanThreadArg *)data;
+	RM_ScanHandle sc;
+	Record *r;
+	Expr *sel, *left, *right;
+	char cond[16];
+	int round;
+
+	createRecord(&r, arg->schema);
+	arg->count = 0;
+	for (round = 0; round < 3; round++)
+	{
+		sprintf(cond, "i%d", arg->c);
+		MAKE_ATTRREF(left, 2);
+		MAKE_CONS(right, stringToValue(cond));
+		MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+		if ((arg->rc = startScan(arg->table, &sc, sel)) != RC_OK)
+			break;
+		while ((arg->rc = next(&sc, r)) == RC_OK)
+			arg->count++;
+		closeScan(&sc);
+		freeExpr(sel);
+		if (arg->rc != RC_RM_NO_MORE_TUPLES)
+			break;
+	}
+	freeRecord(r);
+	return NULL;
+}
+
+void testConcurrentScans(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	int numInserts = 2000, numScans = 6, numThreads = 4, i, k, rc, done;
+	RM_ScanHandle scans[6];
+	int counts[6];
+	bool finished[6];
+	ScanThreadArg args[4];
+	pthread_t threads[4];
+	Record *r;
+	Schema *schema;
+	Expr *sels[6], *left, *right;
+	char cond[16];
+	testName = "test interleaved and concurrent scans with independent cursors";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_cs", schema));
+	TEST_CHECK(openTable(table, "test_table_cs"));
+	for (i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 5);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// scans on c = 0..4 and an index range scan on a < 100, advanced one record at a time each
+	for (k = 0; k < numScans; k++)
+	{
+		if (k < 5)
+		{
+			sprintf(cond, "i%d", k);
+			MAKE_ATTRREF(left, 2);
+			MAKE_CONS(right, stringToValue(cond));
+			MAKE_BINOP_EXPR(sels[k], left, right, OP_COMP_EQUAL);
+		}
+		else
+		{
+			MAKE_ATTRREF(left, 0);
+			MAKE_CONS(right, stringToValue("i100"));
+			MAKE_BINOP_EXPR(sels[k], left, right, OP_COMP_SMALLER);
+		}
+		TEST_CHECK(startScan(table, &scans[k], sels[k]));
+		counts[k] = 0;
+		finished[k] = false;
+	}
+	TEST_CHECK(createRecord(&r, schema));
+	do
+	{
+		done = 0;
+		for (k = 0; k < numScans; k++)
+		{
+			if (finished[k])
+			{
+				done++;
+				continue;
+			}
+			if ((rc = next(&scans[k], r)) == RC_OK)
+				counts[k]++;
+			else
+				finished[k] = true;
+		}
+	} while (done < numScans);
+	for (k = 0; k < 5; k++)
+		ASSERT_EQUALS_INT(numInserts / 5, counts[k], "interleaved scan returns its own matches");
+	ASSERT_EQUALS_INT(100, counts[5], "interleaved index scan returns its own matches");
+	for (k = 0; k < numScans; k++)
+	{
+		TEST_CHECK(closeScan(&scans[k]));
+		freeExpr(sels[k]);
+	}
+
+	// a scan closed before its end releases its page
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i1"));
+	MAKE_BINOP_EXPR(sels[0], left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(table, &scans[0], sels[0]));
+	TEST_CHECK(next(&scans[0], r));
+	TEST_CHECK(closeScan(&scans[0]));
+	freeExpr(sels[0]);
+	freeRecord(r);
+
+	// scans of the same table from several threads
+	for (k = 0; k < numThreads; k++)
+	{
+		args[k].table = table;
+		args[k].schema = schema;
+		args[k].c = k % 5;
+		pthread_create(&threads[k], NULL, scanThread, &args[k]);
+	}
+	for (k = 0; k < numThreads; k++)
+	{
+		pthread_join(threads[k], NULL);
+		ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, args[k].rc, "threaded scan ends");
+		ASSERT_EQUALS_INT(3 * numInserts / 5, args[k].count, "threaded scans return their matches");
+	}
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_cs"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+typedef struct ParallelTally
+{
+	pthread_mutex_t lock;
+	Schema *schema;
+	int count;
+	long sum;
+	int stopAfter;
+} ParallelTally;
+
+static RC tallyRecord(Record *record, int worker, void *context)
+{
+	ParallelTally *tally = (ParallelTally *)context;
+	Value *v;
+	RC rc = RC_OK;
+
+	(void)worker;
+	getAttr(record, tally->schema, 0, &v);
+	pthread_mutex_lock(&tally->lock);
+	tally->count++;
+	tally->sum += v->v.intV;
+	if (tally->stopAfter > 0 && tally->count >= tally->stopAfter)
+		rc = RC_ERROR;
+	pthread_mutex_unlock(&tally->lock);
+	freeVal(v);
+	return rc;
+}
+
+void testParallelScan(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	int numInserts = 5000, i, workers;
+	long expectedSum = 0;
+	ParallelTally tally;
+	RM_ParallelScanStats stats;
+	Record *r;
+	Schema *schema;
+	Expr *sel, *left, *right;
+	testName = "test parallel scans with work stealing";
+	schema = testSchema();
+	pthread_mutex_init(&tally.lock, NULL);
+	tally.schema = schema;
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_ps", schema));
+	TEST_CHECK(openTable(table, "test_table_ps"));
+	for (i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 5);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+		if (i % 5 == 2)
+			expectedSum += i;
+	}
+
+	// the same matches whatever the number of workers
+	for (workers = 1; workers <= 8; workers *= 2)
+	{
+		MAKE_ATTRREF(left, 2);
+		MAKE_CONS(right, stringToValue("i2"));
+		MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+		tally.count = 0;
+		tally.sum = 0;
+		tally.stopAfter = 0;
+		TEST_CHECK(parallelScan(table, sel, workers, tallyRecord, &tally, &stats));
+		freeExpr(sel);
+		ASSERT_EQUALS_INT(numInserts / 5, tally.count, "parallel scan finds every match");
+		ASSERT_TRUE(tally.sum == expectedSum, "each match is reported once");
+		ASSERT_EQUALS_INT(numInserts / 5, stats.numMatches, "matches counted in the stats");
+		ASSERT_EQUALS_INT(workers, stats.numWorkers, "workers counted in the stats");
+	}
+	ASSERT_TRUE(stats.pagesScanned > 1, "table spans several pages");
+
+	// no condition returns every record, and a callback can stop the scan
+	tally.count = 0;
+	tally.sum = 0;
+	TEST_CHECK(parallelScan(table, NULL, 4, tallyRecord, &tally, NULL));
+	ASSERT_EQUALS_INT(numInserts, tally.count, "parallel scan without a condition returns every record");
+	tally.count = 0;
+	tally.stopAfter = 10;
+	ASSERT_EQUALS_INT(RC_ERROR, parallelScan(table, NULL, 4, tallyRecord, &tally, NULL), "callback error stops the scan");
+	ASSERT_TRUE(tally.count < numInserts, "scan stopped early");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_ps"));
+	TEST_CHECK(shutdownRecordManager());
+
+	pthread_mutex_destroy(&tally.lock);
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testProjectedScan(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	int numInserts = 1000, i, found, attrs[] = {1, 0}, bad[] = {3};
+	Record *r;
+	Schema *schema, *projSchema;
+	Value *v;
+	Expr *sel, *left, *right;
+	testName = "test scans with a projection list";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_pj", schema));
+	TEST_CHECK(openTable(table, "test_table_pj"));
+	for (i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// the scan returns (b, a) for every record with c = 3, the condition is on an attribute left out
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i3"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	ASSERT_EQUALS_INT(RC_ERROR, startProjectedScan(table, sc, sel, 1, bad), "projection of a missing attribute is rejected");
+	TEST_CHECK(startProjectedScan(table, sc, sel, 2, attrs));
+	TEST_CHECK(getScanSchema(sc, &projSchema));
+	ASSERT_EQUALS_INT(2, projSchema->numAttr, "projection schema has the projected attributes");
+	ASSERT_TRUE(strcmp(projSchema->attrNames[0], "b") == 0 && strcmp(projSchema->attrNames[1], "a") == 0, "projection keeps the order of the list");
+	ASSERT_TRUE(getRecordSize(projSchema) < getRecordSize(schema), "projected records are smaller");
+
+	TEST_CHECK(createRecord(&r, projSchema));
+	found = 0;
+	while (next(sc, r) == RC_OK)
+	{
+		getAttr(r, projSchema, 0, &v);
+		if (strcmp(v->v.stringV, "abcd") != 0)
+			break;
+		freeVal(v);
+		getAttr(r, projSchema, 1, &v);
+		if (v->v.intV % 10 != 3 || r->id.page < 1)
+			break;
+		freeVal(v);
+		found++;
+	}
+	ASSERT_EQUALS_INT(numInserts / 10, found, "projected scan returns every match");
+	freeRecord(r);
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	// a primary key lookup projects its record the same way
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i500"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startProjectedScan(table, sc, sel, 1, attrs));
+	TEST_CHECK(getScanSchema(sc, &projSchema));
+	TEST_CHECK(createRecord(&r, projSchema));
+	TEST_CHECK(next(sc, r));
+	getAttr(r, projSchema, 0, &v);
+	ASSERT_TRUE(strcmp(v->v.stringV, "abcd") == 0, "key lookup returns the projected attribute");
+	freeVal(v);
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, next(sc, r), "key lookup finds one record");
+	freeRecord(r);
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_pj"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	free(sc);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+void testAggregates(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	int numInserts = 1000, i, g, workers, total;
+	long groupSums[3] = {0, 0, 0};
+	char name[4];
+	Record *r;
+	Schema *schema;
+	Value *nullInt;
+	Expr *sel, *left, *right;
+	RM_AggResult *res;
+	RM_Aggregate all[] = {{AGG_COUNT, -1}, {AGG_COUNT, 2}, {AGG_SUM, 0}, {AGG_MIN, 0}, {AGG_MAX, 1}, {AGG_AVG, 2}};
+	RM_Aggregate perGroup[] = {{AGG_COUNT, -1}, {AGG_SUM, 0}};
+	RM_Aggregate bad[] = {{AGG_SUM, 1}};
+	testName = "test aggregate scans with and without grouping";
+	schema = testSchema();
+	MAKE_NULL_VALUE(nullInt, DT_INT);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_ag", schema));
+	TEST_CHECK(openTable(table, "test_table_ag"));
+
+	// b is one of g0, g1, g2 and c is i % 10, NULL for every hundredth record
+	for (i = 0; i < numInserts; i++)
+	{
+		sprintf(name, "g%d", i % 3);
+		r = testRecord(schema, i, name, i % 10);
+		if (i % 100 == 0)
+			TEST_CHECK(setAttr(r, schema, 2, nullInt));
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+		groupSums[i % 3] += i;
+	}
+
+	// without grouping there is exactly one group
+	TEST_CHECK(aggregateScan(table, NULL, -1, 6, all, 1, &res));
+	ASSERT_EQUALS_INT(1, res->numGroups, "one group without GROUP BY");
+	ASSERT_TRUE(res->groups[0].key == NULL, "no key without GROUP BY");
+	ASSERT_EQUALS_INT(numInserts, res->groups[0].values[0]->v.intV, "COUNT(*) counts every record");
+	ASSERT_EQUALS_INT(numInserts - 10, res->groups[0].values[1]->v.intV, "COUNT(c) skips NULLs");
+	ASSERT_EQUALS_INT(499500, res->groups[0].values[2]->v.intV, "SUM(a)");
+	ASSERT_EQUALS_INT(0, res->groups[0].values[3]->v.intV, "MIN(a)");
+	ASSERT_TRUE(strcmp(res->groups[0].values[4]->v.stringV, "g2") == 0, "MAX(b) compares strings");
+	ASSERT_TRUE(res->groups[0].values[5]->dt == DT_FLOAT && res->groups[0].values[5]->v.floatV > 4.54f && res->groups[0].values[5]->v.floatV < 4.55f, "AVG(c) over the non-NULL values");
+	TEST_CHECK(freeAggResult(res));
+
+	// GROUP BY b gives the same groups whatever the number of workers
+	for (workers = 1; workers <= 4; workers *= 2)
+	{
+		TEST_CHECK(aggregateScan(table, NULL, 1, 2, perGroup, workers, &res));
+		ASSERT_EQUALS_INT(3, res->numGroups, "one group per value of b");
+		total = 0;
+		for (g = 0; g < res->numGroups; g++)
+		{
+			i = res->groups[g].key->v.stringV[1] - '0';
+			if (res->groups[g].values[1]->v.intV != groupSums[i])
+				break;
+			total += res->groups[g].values[0]->v.intV;
+		}
+		ASSERT_EQUALS_INT(res->numGroups, g, "SUM(a) of every group");
+		ASSERT_EQUALS_INT(numInserts, total, "every record is in one group");
+		TEST_CHECK(freeAggResult(res));
+	}
+
+	// NULLs of the grouping attribute form one group, the condition is applied first
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i500"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(aggregateScan(table, sel, 2, 1, perGroup, 2, &res));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(11, res->numGroups, "ten values of c and NULL");
+	for (g = 0; g < res->numGroups && !res->groups[g].key->isNull; g++)
+		;
+	ASSERT_TRUE(g < res->numGroups, "NULL group exists");
+	ASSERT_EQUALS_INT(5, res->groups[g].values[0]->v.intV, "NULL group counts the matching records with NULL c");
+	TEST_CHECK(freeAggResult(res));
+
+	// no match still gives one group without GROUP BY, with a zero COUNT and a NULL SUM
+	MAKE_ATTRREF(left, 0);
+	MAKE_CONS(right, stringToValue("i-1"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(aggregateScan(table, sel, -1, 2, perGroup, 1, &res));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(0, res->groups[0].values[0]->v.intV, "COUNT of no records is 0");
+	ASSERT_TRUE(res->groups[0].values[1]->isNull, "SUM of no records is NULL");
+	TEST_CHECK(freeAggResult(res));
+
+	ASSERT_EQUALS_INT(RC_TYPE_MISMATCH, aggregateScan(table, NULL, -1, 1, bad, 1, &res), "SUM of a string is rejected");
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_ag"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeVal(nullInt);
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// reads a join to the end, returns how many records it gave or -1 if one has keyA != keyB
+static int drainJoin(RM_JoinHandle *join, int keyA, int keyB)
+{
+	Schema *schema;
+	Record *r;
+	Value *a, *b;
+	int count = 0;
+
+	TEST_CHECK(getJoinSchema(join, &schema));
+	TEST_CHECK(createRecord(&r, schema));
+	while (count >= 0 && nextJoin(join, r) == RC_OK)
+	{
+		getAttr(r, schema, keyA, &a);
+		getAttr(r, schema, keyB, &b);
+		count = (a->isNull || b->isNull || a->v.intV != b->v.intV) ? -1 : count + 1;
+		freeVal(a);
+		freeVal(b);
+	}
+	freeRecord(r);
+	return count;
+}
+
+// a transaction on both tables of a join, left open while the join runs and aborted afterwards
+typedef struct JoinWriter
+{
+	RM_TableData *left;
+	RM_TableData *right;
+	Schema *schema;
+	int numLeft;
+	pthread_barrier_t *barrier;
+} JoinWriter;
+
+// inserts a left record matching right.a = 5, a right record matching the left record with
+// c = 600 and deletes the left record a = 3, then waits for the joins before aborting
+static void *writeBesideJoin(void *arg)
+{
+	JoinWriter *w = (JoinWriter *)arg;
+	Record *r;
+	Value *key;
+
+	TEST_CHECK(beginTransaction());
+	r = testRecord(w->schema, w->numLeft, "l", 5);
+	TEST_CHECK(insertRecord(w->left, r));
+	freeRecord(r);
+	r = testRecord(w->schema, 600, "r600", 0);
+	TEST_CHECK(insertRecord(w->right, r));
+	MAKE_VALUE(key, DT_INT, 3);
+	TEST_CHECK(getRecordByValue(w->left, 0, key, r));
+	TEST_CHECK(deleteRecord(w->left, r->id));
+	freeVal(key);
+	freeRecord(r);
+	pthread_barrier_wait(w->barrier);
+	pthread_barrier_wait(w->barrier);
+	TEST_CHECK(abortTransaction());
+	return NULL;
+}
+
+void testJoins(void)
+{
+	RM_TableData *left = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *right = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_JoinHandle join;
+	JoinMethod methods[] = {JOIN_INDEX_NESTED_LOOP, JOIN_HASH, JOIN_HASH};
+	int memoryPages[] = {0, 0, 1};
+	JoinWriter writer;
+	pthread_barrier_t barrier;
+	pthread_t thread;
+	int numLeft = 2000, numRight = 500, numNull = 0, count, i;
+	char name[8], *plan;
+	Record *r;
+	Schema *schema, *js;
+	Value *nullInt;
+	testName = "test hash joins and index nested loop joins";
+	schema = testSchema();
+	MAKE_NULL_VALUE(nullInt, DT_INT);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_jl", schema));
+	TEST_CHECK(openTable(left, "test_table_jl"));
+	TEST_CHECK(createTable("test_table_jr", schema));
+	TEST_CHECK(openTable(right, "test_table_jr"));
+
+	// left.c = right.a matches every left record with a non-NULL c exactly once
+	for (i = 0; i < numLeft; i++)
+	{
+		r = testRecord(schema, i, "l", i % numRight);
+		if (i % 250 == 7)
+		{
+			TEST_CHECK(setAttr(r, schema, 2, nullInt));
+			numNull++;
+		}
+		TEST_CHECK(insertRecord(left, r));
+		freeRecord(r);
+	}
+	for (i = 0; i < numRight; i++)
+	{
+		sprintf(name, "r%d", i);
+		r = testRecord(schema, i, name, 2 * i);
+		TEST_CHECK(insertRecord(right, r));
+		freeRecord(r);
+	}
+
+	// right.a is the primary key, so its index is used
+	TEST_CHECK(startJoin(left, 2, right, 0, JOIN_AUTO, 0, &join));
+	TEST_CHECK(getJoinSchema(&join, &js));
+	ASSERT_EQUALS_INT(6, js->numAttr, "joined records have the attributes of both tables");
+	ASSERT_TRUE(strcmp(js->attrNames[3], "test_table_jr.a") == 0, "joined attributes are qualified by their table");
+	TEST_CHECK(explainJoin(&join, &plan));
+	ASSERT_TRUE(strncmp(plan, "INDEX NESTED LOOP JOIN", 22) == 0, "indexed inner table uses an index nested loop join");
+	free(plan);
+	count = drainJoin(&join, 2, 3);
+	ASSERT_EQUALS_INT(numLeft - numNull, count, "index nested loop join finds every pair");
+	TEST_CHECK(closeJoin(&join));
+
+	// the hash join builds on the smaller table
+	TEST_CHECK(startJoin(left, 2, right, 0, JOIN_HASH, 0, &join));
+	TEST_CHECK(explainJoin(&join, &plan));
+	ASSERT_TRUE(strcmp(plan, "HASH JOIN on test_table_jl.c = test_table_jr.a building on test_table_jr in memory") == 0, "hash join builds on the smaller table");
+	free(plan);
+	count = drainJoin(&join, 2, 3);
+	ASSERT_EQUALS_INT(numLeft - numNull, count, "in-memory hash join finds every pair");
+	TEST_CHECK(closeJoin(&join));
+
+	// a budget of one page spills both tables into partitions
+	TEST_CHECK(startJoin(left, 2, right, 0, JOIN_HASH, 1, &join));
+	TEST_CHECK(explainJoin(&join, &plan));
+	ASSERT_TRUE(strstr(plan, "partitions on disk") != NULL, "hash join over its memory budget spills partitions");
+	free(plan);
+	count = drainJoin(&join, 2, 3);
+	ASSERT_EQUALS_INT(numLeft - numNull, count, "partitioned hash join finds every pair");
+	TEST_CHECK(closeJoin(&join));
+
+	// joins see neither the inserts nor the deletes of a transaction still running
+	r = testRecord(schema, numLeft + 1, "l", 600);
+	TEST_CHECK(insertRecord(left, r));
+	freeRecord(r);
+	pthread_barrier_init(&barrier, NULL, 2);
+	writer.left = left;
+	writer.right = right;
+	writer.schema = schema;
+	writer.numLeft = numLeft;
+	writer.barrier = &barrier;
+	pthread_create(&thread, NULL, writeBesideJoin, &writer);
+	pthread_barrier_wait(&barrier);
+	for (i = 0; i < 3; i++)
+	{
+		TEST_CHECK(startJoin(left, 2, right, 0, methods[i], memoryPages[i], &join));
+		count = drainJoin(&join, 2, 3);
+		ASSERT_EQUALS_INT(numLeft - numNull, count, "join reads the committed records only");
+		TEST_CHECK(closeJoin(&join));
+	}
+	pthread_barrier_wait(&barrier);
+	pthread_join(thread, NULL);
+	pthread_barrier_destroy(&barrier);
+
+	// several left records per key through a hash index on the inner table
+	TEST_CHECK(createHashIndex(left, 2));
+	TEST_CHECK(startJoin(right, 0, left, 2, JOIN_AUTO, 0, &join));
+	count = drainJoin(&join, 0, 5);
+	ASSERT_EQUALS_INT(numLeft - numNull, count, "index nested loop join over a hash index finds every pair");
+	TEST_CHECK(closeJoin(&join));
+
+	// a build table needing more than MAX_JOIN_PARTITIONS partitions of one page has them split again
+	for (i = 0; i < 8000; i++)
+	{
+		r = testRecord(schema, numLeft + 2 + i, "l", i % numRight);
+		TEST_CHECK(insertRecord(left, r));
+		freeRecord(r);
+		r = testRecord(schema, 10000 + i, "r", 0);
+		TEST_CHECK(insertRecord(right, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(startJoin(left, 2, right, 0, JOIN_HASH, 1, &join));
+	TEST_CHECK(explainJoin(&join, &plan));
+	ASSERT_TRUE(sscanf(strstr(plan, " in "), " in %d", &i) == 1 && i > 64, "partitions over the budget are split again");
+	free(plan);
+	count = drainJoin(&join, 2, 3);
+	ASSERT_EQUALS_INT(numLeft - numNull + 8000, count, "hash join over split partitions finds every pair");
+	TEST_CHECK(closeJoin(&join));
+
+	ASSERT_EQUALS_INT(RC_TYPE_MISMATCH, startJoin(left, 1, right, 0, JOIN_HASH, 0, &join), "join attributes must have the same type");
+	ASSERT_EQUALS_INT(RC_ERROR, startJoin(left, 0, right, 2, JOIN_INDEX_NESTED_LOOP, 0, &join), "index nested loop join needs an index");
+
+	TEST_CHECK(closeTable(left));
+	TEST_CHECK(closeTable(right));
+	TEST_CHECK(deleteTable("test_table_jl"));
+	TEST_CHECK(deleteTable("test_table_jr"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeVal(nullInt);
+	free(left);
+	free(right);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// reads a sort on (c ascending, a descending) to the end, returns how many records it gave
+// or -1 if one is out of order
+static int drainSort(RM_SortHandle *sort, Schema *schema)
+{
+	Record *r;
+	Value *a, *c;
+	int count = 0, prevA = 0, prevC = 0;
+	bool prevNull = true;
+
+	TEST_CHECK(createRecord(&r, schema));
+	while (count >= 0 && nextSorted(sort, r) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		getAttr(r, schema, 2, &c);
+		if (count > 0 && ((!prevNull && c->isNull) || (!prevNull && c->v.intV < prevC) ||
+				((prevNull ? c->isNull : c->v.intV == prevC) && a->v.intV > prevA)))
+			count = -1;
+		else
+			count++;
+		prevNull = c->isNull;
+		prevC = c->v.intV;
+		prevA = a->v.intV;
+		freeVal(a);
+		freeVal(c);
+	}
+	freeRecord(r);
+	return count;
+}
+
+void testSort(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_SortHandle sort;
+	RM_SortKey byCA[] = {{2, false}, {0, true}};
+	RM_SortKey byCDesc[] = {{2, true}};
+	int numInserts = 3000, i, count;
+	int top[] = {999, 999, 999, 998, 998, 998, 997, 997, 997, 996};
+	char *plan;
+	Record *r;
+	Schema *schema;
+	Value *v, *nullInt;
+	Expr *sel, *left, *right;
+	testName = "test external merge sort and top-N";
+	schema = testSchema();
+	MAKE_NULL_VALUE(nullInt, DT_INT);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_so", schema));
+	TEST_CHECK(openTable(table, "test_table_so"));
+
+	// c takes every value in 0..999 three times, a few records have a NULL c
+	for (i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "abcd", (i * 7) % 1000);
+		if (i % 1000 == 1)
+			TEST_CHECK(setAttr(r, schema, 2, nullInt));
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// one page of memory holds a few hundred records, the rest goes through runs on disk
+	TEST_CHECK(startSort(table, NULL, 2, byCA, 0, 1, &sort));
+	TEST_CHECK(explainSort(&sort, &plan));
+	ASSERT_TRUE(strncmp(plan, "EXTERNAL MERGE SORT of 3000 records", 35) == 0, "sort over its memory budget spills runs");
+	free(plan);
+	count = drainSort(&sort, schema);
+	ASSERT_EQUALS_INT(numInserts, count, "external sort returns every record in order");
+	TEST_CHECK(closeSort(&sort));
+
+	TEST_CHECK(startSort(table, NULL, 2, byCA, 0, 0, &sort));
+	TEST_CHECK(explainSort(&sort, &plan));
+	ASSERT_TRUE(strcmp(plan, "IN-MEMORY SORT of 3000 records") == 0, "sort within its memory budget stays in memory");
+	free(plan);
+	count = drainSort(&sort, schema);
+	ASSERT_EQUALS_INT(numInserts, count, "in-memory sort returns every record in order");
+	TEST_CHECK(closeSort(&sort));
+
+	// the condition filters before sorting
+	MAKE_ATTRREF(left, 2);
+	MAKE_CONS(right, stringToValue("i100"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+	TEST_CHECK(startSort(table, sel, 2, byCA, 0, 1, &sort));
+	freeExpr(sel);
+	count = drainSort(&sort, schema);
+	ASSERT_EQUALS_INT(297, count, "sort returns only the records satisfying the condition");
+	TEST_CHECK(closeSort(&sort));
+
+	// the ten largest values of c through a heap
+	TEST_CHECK(startSort(table, NULL, 1, byCDesc, 10, 0, &sort));
+	TEST_CHECK(explainSort(&sort, &plan));
+	ASSERT_TRUE(strcmp(plan, "TOP-N HEAP keeping 10 of 3000 records") == 0, "small limit uses a heap");
+	free(plan);
+	TEST_CHECK(createRecord(&r, schema));
+	for (i = 0; nextSorted(&sort, r) == RC_OK; i++)
+	{
+		getAttr(r, schema, 2, &v);
+		if (v->isNull || v->v.intV != top[i])
+			break;
+		freeVal(v);
+	}
+	ASSERT_EQUALS_INT(10, i, "top-N returns the largest values in order");
+	freeRecord(r);
+	TEST_CHECK(closeSort(&sort));
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_so"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeVal(nullInt);
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// a process that crashes: it inserts, updates and deletes through a pool of a few frames, so that
+// some changed pages reach the file and others do not, and exits without closing anything
+// every third record gets c = 1000 + a, every fifth of the others is deleted
+static void crashAfterWrites(Schema *schema, WalMode walMode, int numInserts, RM_TableOptions tableOptions)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_Options options = {8, 0, walMode, 0, 0, -1, -1, 0};
+	Record *r;
+	Value *v;
+	int i;
+
+	TEST_CHECK(initRecordManager(&options));
+	TEST_CHECK(createTableWithOptions("test_table_wal", schema, &tableOptions));
+	TEST_CHECK(openTable(table, "test_table_wal"));
+	TEST_CHECK(createHashIndex(table, 2));
+	TEST_CHECK(createRecord(&r, schema));
+	for (i = 0; i < numInserts; i++)
+	{
+		freeRecord(r);
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		if (i % 3 == 0)
+		{
+			MAKE_VALUE(v, DT_INT, 1000 + i);
+			TEST_CHECK(setAttr(r, schema, 2, v));
+			freeVal(v);
+			TEST_CHECK(updateRecord(table, r));
+		}
+		else if (i % 5 == 0)
+			TEST_CHECK(deleteRecord(table, r->id));
+	}
+	if (walMode == WAL_GROUP_COMMIT)
+		TEST_CHECK(syncLog());
+	_exit(0);
+}
+
+// checks the table left by crashAfterWrites after the record manager recovered it
+static void checkRecovered(Schema *schema, int numInserts, char *message)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_ScanHandle sc;
+	Record *r;
+	Value *a, *b, *c, *key;
+	Expr *all;
+	int i, count = 0, wrong = 0, wrongStrings = 0, expected = 0;
+
+	for (i = 0; i < numInserts; i++)
+		if (i % 3 == 0 || i % 5 != 0)
+			expected++;
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(openTable(table, "test_table_wal"));
+	i = getNumTuples(table);
+	ASSERT_EQUALS_INT(expected, i, message);
+
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_CONS(all, stringToValue("btrue"));
+	TEST_CHECK(startScan(table, &sc, all));
+	while (next(&sc, r) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		getAttr(r, schema, 1, &b);
+		getAttr(r, schema, 2, &c);
+		if (c->v.intV != (a->v.intV % 3 == 0 ? 1000 + a->v.intV : a->v.intV % 10) ||
+				(a->v.intV % 3 != 0 && a->v.intV % 5 == 0))
+			wrong++;
+		if (b->isNull || strcmp(b->v.stringV, "abcd") != 0)
+			wrongStrings++;
+		count++;
+		freeVal(a);
+		freeVal(b);
+		freeVal(c);
+	}
+	TEST_CHECK(closeScan(&sc));
+	freeExpr(all);
+	ASSERT_EQUALS_INT(expected, count, "every committed record is in the table after the crash");
+	ASSERT_EQUALS_INT(0, wrong, "updates and deletes survive the crash");
+	ASSERT_EQUALS_INT(0, wrongStrings, "strings survive the crash");
+
+	// the indexes are rebuilt from the recovered records
+	MAKE_VALUE(key, DT_INT, numInserts - 1);
+	TEST_CHECK(getRecordByValue(table, 0, key, r));
+	freeVal(key);
+	MAKE_VALUE(key, DT_INT, 1003);
+	TEST_CHECK(getRecordByValue(table, 2, key, r));
+	getAttr(r, schema, 0, &a);
+	ASSERT_EQUALS_INT(3, a->v.intV, "hash index finds an updated value");
+	freeVal(a);
+	freeVal(key);
+	freeRecord(r);
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_wal"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+}
+
+// appends to a log of its own until a write runs into the file size limit, then lifts the limit;
+// exits with 0 if the log goes on failing instead of syncing the records after the lost ones
+static void failLogWrite(void)
+{
+	struct rlimit limit, lifted;
+	struct stat st;
+	LogRecord record;
+	RC first, later;
+
+	signal(SIGXFSZ, SIG_IGN);
+	memset(&record, 0, sizeof(record));
+	record.type = LOG_COMMIT;
+	record.table = "";
+	if (openLog("test_table_log", -1, 0, 0) != RC_OK || appendLog(&record) != RC_OK || syncLog() != RC_OK ||
+	    stat("test_table_log", &st) != 0 || getrlimit(RLIMIT_FSIZE, &lifted) != 0)
+		_exit(2);
+	limit = lifted;
+	limit.rlim_cur = st.st_size;
+	setrlimit(RLIMIT_FSIZE, &limit);
+	appendLog(&record);
+	first = syncLog();
+	setrlimit(RLIMIT_FSIZE, &lifted);
+	appendLog(&record);
+	later = syncLog();
+	closeLog();
+	_exit(first == RC_WRITE_FAILED && later == RC_WRITE_FAILED ? 0 : 1);
+}
+
+void testRecovery(void)
+{
+	RM_TableOptions plain = {FALSE, TABLE_LAYOUT_ROWS};
+	RM_TableOptions compressed = {TRUE, TABLE_LAYOUT_ROWS};
+	RM_TableOptions pax = {FALSE, TABLE_LAYOUT_PAX};
+	bool encodedB[] = {FALSE, TRUE, FALSE};
+	RM_TableOptions dictionary = {FALSE, TABLE_LAYOUT_ROWS, encodedB};
+	Schema *schema;
+	FILE *log;
+	pid_t child;
+	int status, numInserts = 2000;
+	testName = "test write-ahead log and redo recovery after a crash";
+	schema = testSchema();
+
+	// every operation is on disk before it returns
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashAfterWrites(schema, WAL_SYNC, numInserts, plain);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process with synchronous log crashed");
+	checkRecovered(schema, numInserts, "tuple count recovered with synchronous log");
+
+	// the group commit syncs in the background, syncLog waits for it; a torn record at the end of the log is dropped
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashAfterWrites(schema, WAL_GROUP_COMMIT, numInserts, plain);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process with group commit crashed");
+	log = fopen(WAL_FILE, "ab");
+	fwrite("torn record", 1, 11, log);
+	fclose(log);
+	checkRecovered(schema, numInserts, "tuple count recovered with group commit");
+
+	// the page map of a compressed table on disk is the one it was created with, redo rebuilds the pages
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashAfterWrites(schema, WAL_SYNC, numInserts, compressed);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process with compressed table crashed");
+	checkRecovered(schema, numInserts, "tuple count recovered in a compressed table");
+
+	// PAX pages are redone like any other page
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashAfterWrites(schema, WAL_SYNC, numInserts, pax);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process with PAX table crashed");
+	checkRecovered(schema, numInserts, "tuple count recovered in a PAX table");
+
+	// dictionary entries are logged with the writes that add them
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashAfterWrites(schema, WAL_SYNC, numInserts, dictionary);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process with dictionary encoded table crashed");
+	checkRecovered(schema, numInserts, "tuple count recovered in a dictionary encoded table");
+
+	// records after a failed write of the log are never reported durable
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		failLogWrite();
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "log stays failed after a lost write");
+	unlink("test_table_log");
+
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// inserts, updates and deletes of a transaction on the records (i, "abcd", i % 10) for i < numRecords:
+// inserts numRecords more, moves c of every third record to 5000 + a and deletes every fifth of the others
+static void writeTransaction(RM_TableData *table, Schema *schema, int numRecords)
+{
+	Record *r;
+	Value *v, *key;
+	int i;
+
+	for (i = 0; i < numRecords; i++)
+	{
+		r = testRecord(schema, numRecords + i, "wxyz", 7);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(createRecord(&r, schema));
+	for (i = 0; i < numRecords; i++)
+	{
+		if (i % 3 != 0 && i % 5 != 0)
+			continue;
+		MAKE_VALUE(key, DT_INT, i);
+		TEST_CHECK(getRecordByValue(table, 0, key, r));
+		freeVal(key);
+		if (i % 3 == 0)
+		{
+			MAKE_VALUE(v, DT_INT, 5000 + i);
+			TEST_CHECK(setAttr(r, schema, 2, v));
+			freeVal(v);
+			TEST_CHECK(updateRecord(table, r));
+		}
+		else
+			TEST_CHECK(deleteRecord(table, r->id));
+	}
+	freeRecord(r);
+}
+
+// checks that the table holds the records (i, "abcd", i % 10) for i < numRecords and nothing else
+static void checkRolledBack(RM_TableData *table, Schema *schema, int numRecords, char *message)
+{
+	RM_ScanHandle sc;
+	Record *r;
+	Value *a, *c, *key;
+	Expr *all;
+	int count = 0, wrong = 0, tuples;
+
+	tuples = getNumTuples(table);
+	ASSERT_EQUALS_INT(numRecords, tuples, message);
+
+	TEST_CHECK(createRecord(&r, schema));
+	MAKE_CONS(all, stringToValue("btrue"));
+	TEST_CHECK(startScan(table, &sc, all));
+	while (next(&sc, r) == RC_OK)
+	{
+		getAttr(r, schema, 0, &a);
+		getAttr(r, schema, 2, &c);
+		if (a->v.intV >= numRecords || c->v.intV != a->v.intV % 10)
+			wrong++;
+		count++;
+		freeVal(a);
+		freeVal(c);
+	}
+	TEST_CHECK(closeScan(&sc));
+	freeExpr(all);
+	ASSERT_EQUALS_INT(numRecords, count, "deleted records are back, inserted ones gone");
+	ASSERT_EQUALS_INT(0, wrong, "updated records have their old values");
+
+	// the indexes follow the records back
+	MAKE_VALUE(key, DT_INT, 5003);
+	ASSERT_ERROR(getRecordByValue(table, 2, key, r), "hash index has no value of the rolled back update");
+	freeVal(key);
+	MAKE_VALUE(key, DT_INT, 5);
+	TEST_CHECK(getRecordByValue(table, 0, key, r));
+	freeVal(key);
+	MAKE_VALUE(key, DT_INT, numRecords + 1);
+	ASSERT_ERROR(getRecordByValue(table, 0, key, r), "primary key index has no rolled back insert");
+	freeVal(key);
+	freeRecord(r);
+}
+
+// inserts the record (5, "abcd", 5) outside of a transaction while another one deleted key 5
+typedef struct KeyInserter
+{
+	RM_TableData *table;
+	Schema *schema;
+	RC rc;
+} KeyInserter;
+
+static void *insertDeletedKey(void *arg)
+{
+	KeyInserter *k = (KeyInserter *)arg;
+	Record *r = testRecord(k->schema, 5, "abcd", 5);
+
+	k->rc = insertRecord(k->table, r);
+	freeRecord(r);
+	return NULL;
+}
+
+// commits the records (i, "abcd", i % 10) and crashes in the middle of a second transaction
+static void crashInTransaction(Schema *schema, int numRecords)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Record *r;
+	int i;
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_tx", schema));
+	TEST_CHECK(openTable(table, "test_table_tx"));
+	TEST_CHECK(createHashIndex(table, 2));
+	TEST_CHECK(beginTransaction());
+	for (i = 0; i < numRecords; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(commitTransaction());
+
+	TEST_CHECK(beginTransaction());
+	writeTransaction(table, schema, numRecords);
+	TEST_CHECK(syncLog());
+	_exit(0);
+}
+
+void testTransactions(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	KeyInserter inserter;
+	pthread_t thread;
+	Schema *schema;
+	Record *r;
+	Value *key;
+	pid_t child;
+	int i, status, numRecords = 600;
+	testName = "test transactions with commit, abort and rollback after a crash";
+	schema = testSchema();
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_tx", schema));
+	TEST_CHECK(openTable(table, "test_table_tx"));
+	TEST_CHECK(createHashIndex(table, 2));
+	ASSERT_EQUALS_INT(RC_TX_NOT_ACTIVE, commitTransaction(), "commit without a transaction");
+
+	TEST_CHECK(beginTransaction());
+	ASSERT_EQUALS_INT(RC_TX_ACTIVE, beginTransaction(), "one transaction per thread");
+	for (i = 0; i < numRecords; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+	TEST_CHECK(commitTransaction());
+
+	// abort takes back inserts, updates and deletes
+	TEST_CHECK(beginTransaction());
+	writeTransaction(table, schema, numRecords);
+	i = getNumTuples(table);
+	ASSERT_EQUALS_INT(2 * numRecords - (numRecords / 5 - numRecords / 15), i, "changes of the transaction are visible to it");
+	TEST_CHECK(abortTransaction());
+	checkRolledBack(table, schema, numRecords, "tuple count after abort");
+
+	// a batch that fails halfway is taken back as a whole
+	TEST_CHECK(beginTransaction());
+	r = testRecord(schema, numRecords + 1, "abcd", 1);
+	TEST_CHECK(insertRecord(table, r));
+	freeRecord(r);
+	r = testRecord(schema, 5, "abcd", 5);
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertRecord(table, r), "duplicate key fails the batch");
+	freeRecord(r);
+	TEST_CHECK(abortTransaction());
+	checkRolledBack(table, schema, numRecords, "tuple count after a failed batch");
+
+	// the key of a record a running transaction deleted stays taken until the transaction ends
+	inserter.table = table;
+	inserter.schema = schema;
+	for (i = 0; i < 2; i++)
+	{
+		TEST_CHECK(beginTransaction());
+		TEST_CHECK(createRecord(&r, schema));
+		MAKE_VALUE(key, DT_INT, 5);
+		TEST_CHECK(getRecordByValue(table, 0, key, r));
+		freeVal(key);
+		TEST_CHECK(deleteRecord(table, r->id));
+		freeRecord(r);
+		pthread_create(&thread, NULL, insertDeletedKey, &inserter);
+		usleep(50000);
+		if (i == 0)
+		{
+			TEST_CHECK(abortTransaction());
+		}
+		else
+		{
+			TEST_CHECK(commitTransaction());
+		}
+		pthread_join(thread, NULL);
+		if (i == 0)
+		{
+			ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, inserter.rc, "key of a rolled back delete is taken again");
+			checkRolledBack(table, schema, numRecords, "tuple count after a rolled back delete");
+		}
+		else
+		{
+			TEST_CHECK(inserter.rc);
+			checkRolledBack(table, schema, numRecords, "tuple count after a committed delete");
+		}
+	}
+
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_tx"));
+	TEST_CHECK(shutdownRecordManager());
+
+	// the transaction without a commit in the log is rolled back by the recovery
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashInTransaction(schema, numRecords);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process crashed in a transaction");
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(openTable(table, "test_table_tx"));
+	checkRolledBack(table, schema, numRecords, "tuple count after rolling back the crashed transaction");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_tx"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// crashAfterWrites with small log segments and a checkpoint halfway and one right before the crash,
+// the first drops the segments, after the second the page file has every change but the indexes
+// and the tuple count are stale
+static void crashAfterCheckpoints(Schema *schema, int numInserts)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_Options options = {8, 0, WAL_SYNC, 0, 0, -1, -1, 16 * 1024};
+	RM_CheckpointStats stats;
+	LogStats before, after;
+	Record *r;
+	Value *v;
+	int i;
+
+	TEST_CHECK(initRecordManager(&options));
+	TEST_CHECK(createTable("test_table_wal", schema));
+	TEST_CHECK(openTable(table, "test_table_wal"));
+	TEST_CHECK(createHashIndex(table, 2));
+	TEST_CHECK(createRecord(&r, schema));
+	for (i = 0; i < numInserts; i++)
+	{
+		if (i == numInserts / 2)
+		{
+			TEST_CHECK(getLogStats(&before));
+			TEST_CHECK(checkpoint(&stats));
+			TEST_CHECK(getLogStats(&after));
+			ASSERT_TRUE(before.segments > 0, "log grew past one segment");
+			ASSERT_EQUALS_INT(0, after.segments, "checkpoint drops every full segment");
+			ASSERT_TRUE(after.size < before.size && stats.logBytesDropped > 0, "checkpoint shrinks the log");
+			ASSERT_TRUE(stats.pagesWritten > 0 && stats.tables >= 2, "checkpoint writes the pages of the open tables");
+		}
+		freeRecord(r);
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		if (i % 3 == 0)
+		{
+			MAKE_VALUE(v, DT_INT, 1000 + i);
+			TEST_CHECK(setAttr(r, schema, 2, v));
+			freeVal(v);
+			TEST_CHECK(updateRecord(table, r));
+		}
+		else if (i % 5 == 0)
+			TEST_CHECK(deleteRecord(table, r->id));
+	}
+	TEST_CHECK(checkpoint(&stats));
+	_exit(0);
+}
+
+// inserts records and reads them back while a background checkpoint runs every few milliseconds
+static void writeDuringCheckpoints(Schema *schema, int numInserts)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_Options options = {16, 0, WAL_GROUP_COMMIT, 0, 0, 2, 64 * 1024, 16 * 1024};
+	Record *r, *back;
+	Value *c;
+	int i, wrong = 0, tuples;
+
+	TEST_CHECK(initRecordManager(&options));
+	TEST_CHECK(createTable("test_table_ckpt", schema));
+	TEST_CHECK(openTable(table, "test_table_ckpt"));
+	TEST_CHECK(createRecord(&back, schema));
+	for (i = 0; i < numInserts; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		TEST_CHECK(getRecord(table, r->id, back));
+		getAttr(back, schema, 2, &c);
+		if (c->v.intV != i % 10)
+			wrong++;
+		freeVal(c);
+		freeRecord(r);
+	}
+	freeRecord(back);
+	ASSERT_EQUALS_INT(0, wrong, "records read back during checkpoints");
+	tuples = getNumTuples(table);
+	ASSERT_EQUALS_INT(numInserts, tuples, "tuple count during checkpoints");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_ckpt"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+}
+
+void testCheckpoints(void)
+{
+	Schema *schema;
+	pid_t child;
+	int status, numInserts = 2000;
+	testName = "test fuzzy checkpoints and recovery from the last one";
+	schema = testSchema();
+
+	writeDuringCheckpoints(schema, 5000);
+
+	fflush(stdout);
+	if ((child = fork()) == 0)
+		crashAfterCheckpoints(schema, numInserts);
+	waitpid(child, &status, 0);
+	ASSERT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0, "process with checkpoints crashed");
+	checkRecovered(schema, numInserts, "tuple count recovered from a checkpoint");
+
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// an autocommit writer next to a transaction of the main thread
+typedef struct SnapshotWriter
+{
+	RM_TableData *table;
+	Schema *schema;
+	RID *rids;
+} SnapshotWriter;
+
+// updates record 1 and deletes record 2
+static void *writeBesideTransaction(void *arg)
+{
+	SnapshotWriter *w = (SnapshotWriter *)arg;
+	Record *r = testRecord(w->schema, 1, "abcd", 2000);
+
+	r->id = w->rids[1];
+	TEST_CHECK(updateRecord(w->table, r));
+	TEST_CHECK(deleteRecord(w->table, w->rids[2]));
+	freeRecord(r);
+	return NULL;
+}
+
+// counts the records left in a scan and those whose c was changed
+static int countScan(RM_ScanHandle *sc, Schema *schema, int *changed)
+{
+	Record *r;
+	Value *c;
+	int n = 0;
+	RC rc;
+
+	TEST_CHECK(createRecord(&r, schema));
+	*changed = 0;
+	while ((rc = next(sc, r)) == RC_OK)
+	{
+		getAttr(r, schema, 2, &c);
+		if (c->v.intV >= 1000)
+			(*changed)++;
+		freeVal(c);
+		n++;
+	}
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, rc, "scan ran to the end");
+	freeRecord(r);
+	return n;
+}
+
+void testSnapshots(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	RM_VacuumStats stats;
+	SnapshotWriter writer;
+	pthread_t thread;
+	Schema *schema;
+	Record *r, *back;
+	RID *rids;
+	Expr *all;
+	Value *v;
+	int i, n, changed, removed, numRecords = 500, numDeleted = 0;
+	testName = "test snapshot reads of scans and transactions";
+	schema = testSchema();
+	rids = (RID *)malloc(sizeof(RID) * numRecords);
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_mvcc", schema));
+	TEST_CHECK(openTable(table, "test_table_mvcc"));
+	for (i = 0; i < numRecords; i++)
+	{
+		r = testRecord(schema, i, "abcd", i % 10);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+
+	// a scan sees the table as it was when it started
+	MAKE_CONS(all, stringToValue("btrue"));
+	TEST_CHECK(startScan(table, sc, all));
+	for (i = 0; i < numRecords; i += 3)
+	{
+		r = testRecord(schema, i, "abcd", 1000 + i);
+		r->id = rids[i];
+		TEST_CHECK(updateRecord(table, r));
+		freeRecord(r);
+	}
+	for (i = 0; i < numRecords; i += 7)
+	{
+		TEST_CHECK(deleteRecord(table, rids[i]));
+		numDeleted++;
+	}
+	for (i = 0; i < 100; i++)
+	{
+		r = testRecord(schema, numRecords + i, "abcd", 1);
+		TEST_CHECK(insertRecord(table, r));
+		freeRecord(r);
+	}
+
+	// versions the scan still sees are kept by the vacuum
+	TEST_CHECK(vacuumTable(table, 0, FALSE, &stats));
+	ASSERT_EQUALS_INT(0, stats.versionsRemoved, "vacuum keeps the versions of the open scan");
+	n = countScan(sc, schema, &changed);
+	ASSERT_EQUALS_INT(numRecords, n, "scan sees neither inserts nor deletes made after it started");
+	ASSERT_EQUALS_INT(0, changed, "scan sees the records before their updates");
+	TEST_CHECK(closeScan(sc));
+
+	n = getNumTuples(table);
+	ASSERT_EQUALS_INT(numRecords - numDeleted + 100, n, "tuple count of the latest versions");
+	TEST_CHECK(startScan(table, sc, all));
+	n = countScan(sc, schema, &changed);
+	ASSERT_EQUALS_INT(numRecords - numDeleted + 100, n, "a new scan sees the changes");
+	ASSERT_TRUE(changed > 0, "a new scan sees the updates");
+	TEST_CHECK(closeScan(sc));
+
+	// a transaction sees the tables as they were when it began and its own changes
+	TEST_CHECK(createRecord(&back, schema));
+	TEST_CHECK(beginTransaction());
+	writer.table = table;
+	writer.schema = schema;
+	writer.rids = rids;
+	pthread_create(&thread, NULL, writeBesideTransaction, &writer);
+	pthread_join(thread, NULL);
+	TEST_CHECK(getRecord(table, rids[1], back));
+	getAttr(back, schema, 2, &v);
+	ASSERT_EQUALS_INT(1, v->v.intV, "update committed after the transaction began is not seen");
+	freeVal(v);
+	TEST_CHECK(getRecord(table, rids[2], back));
+	r = testRecord(schema, 4, "abcd", 3000);
+	r->id = rids[4];
+	TEST_CHECK(updateRecord(table, r));
+	freeRecord(r);
+	TEST_CHECK(getRecord(table, rids[4], back));
+	getAttr(back, schema, 2, &v);
+	ASSERT_EQUALS_INT(3000, v->v.intV, "transaction sees its own update");
+	freeVal(v);
+	TEST_CHECK(abortTransaction());
+
+	TEST_CHECK(getRecord(table, rids[4], back));
+	getAttr(back, schema, 2, &v);
+	ASSERT_EQUALS_INT(4, v->v.intV, "abort restores the version before the update");
+	freeVal(v);
+	TEST_CHECK(getRecord(table, rids[1], back));
+	getAttr(back, schema, 2, &v);
+	ASSERT_EQUALS_INT(2000, v->v.intV, "update of the other thread is seen once the transaction ended");
+	freeVal(v);
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, getRecord(table, rids[2], back), "delete of the other thread is seen");
+	freeRecord(back);
+
+	// with no snapshot left the vacuum drops every older version
+	removed = 0;
+	for (i = 0; i < 100; i++)
+	{
+		TEST_CHECK(vacuumTable(table, 0, FALSE, &stats));
+		removed += stats.versionsRemoved;
+		if (stats.passComplete)
+			break;
+	}
+	ASSERT_TRUE(removed >= numDeleted, "vacuum drops the versions no snapshot sees");
+	TEST_CHECK(vacuumTable(table, 0, FALSE, &stats));
+	ASSERT_EQUALS_INT(0, stats.versionsRemoved, "nothing is left to drop");
+
+	freeExpr(all);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_mvcc"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(rids);
+	free(sc);
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// threads writing the records of one table
+typedef struct LockWriter
+{
+	RM_TableData *table;
+	Schema *schema;
+	RID *rids;
+	int first;		// record the thread writes first
+	int numIncrements;
+	pthread_barrier_t *barrier;
+	RC result;
+	int retries;
+	volatile bool done;
+} LockWriter;
+
+// adds 1 to c of record 0 in transactions, retrying those that have to be aborted
+static void *incrementCounter(void *arg)
+{
+	LockWriter *w = (LockWriter *)arg;
+	Record *r;
+	Value *c;
+	RC rc;
+
+	TEST_CHECK(createRecord(&r, w->schema));
+	for (int i = 0; i < w->numIncrements;)
+	{
+		TEST_CHECK(beginTransaction());
+		TEST_CHECK(getRecord(w->table, w->rids[0], r));
+		getAttr(r, w->schema, 2, &c);
+		c->v.intV++;
+		setAttr(r, w->schema, 2, c);
+		freeVal(c);
+		rc = updateRecord(w->table, r);
+		if (rc == RC_OK)
+		{
+			TEST_CHECK(commitTransaction());
+			i++;
+			continue;
+		}
+		ASSERT_TRUE(rc == RC_TX_CONFLICT || rc == RC_LOCK_DEADLOCK, "increment fails only with a conflict");
+		TEST_CHECK(abortTransaction());
+		w->retries++;
+	}
+	freeRecord(r);
+	return NULL;
+}
+
+// writes record first, then the other one of records 0 and 1, in one transaction
+static void *writeBothRecords(void *arg)
+{
+	LockWriter *w = (LockWriter *)arg;
+	Record *r = testRecord(w->schema, w->first, "abcd", 100);
+
+	TEST_CHECK(beginTransaction());
+	r->id = w->rids[w->first];
+	TEST_CHECK(updateRecord(w->table, r));
+	pthread_barrier_wait(w->barrier);
+	freeRecord(r);
+	r = testRecord(w->schema, 1 - w->first, "abcd", 100);
+	r->id = w->rids[1 - w->first];
+	w->result = updateRecord(w->table, r);
+	if (w->result == RC_OK)
+	{
+		TEST_CHECK(commitTransaction());
+	}
+	else
+	{
+		TEST_CHECK(abortTransaction());
+	}
+	freeRecord(r);
+	return NULL;
+}
+
+// reads record first under an S lock, then updates it, in one transaction
+static void *upgradeRecord(void *arg)
+{
+	LockWriter *w = (LockWriter *)arg;
+	Record *r = testRecord(w->schema, w->first, "abcd", 300);
+
+	TEST_CHECK(beginTransaction());
+	r->id = w->rids[w->first];
+	TEST_CHECK(lockRecord(w->table, r->id, LOCK_S));
+	pthread_barrier_wait(w->barrier);
+	w->result = updateRecord(w->table, r);
+	if (w->result == RC_OK)
+	{
+		TEST_CHECK(commitTransaction());
+	}
+	else
+	{
+		TEST_CHECK(abortTransaction());
+	}
+	freeRecord(r);
+	return NULL;
+}
+
+// updates record first outside of transactions
+static void *writeRecord(void *arg)
+{
+	LockWriter *w = (LockWriter *)arg;
+	Record *r = testRecord(w->schema, w->first, "abcd", 200);
+
+	r->id = w->rids[w->first];
+	w->result = updateRecord(w->table, r);
+	w->done = true;
+	freeRecord(r);
+	return NULL;
+}
+
+void testLocking(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	LockWriter writers[4];
+	pthread_t threads[4];
+	pthread_barrier_t barrier;
+	RM_Options options;
+	LockStats stats;
+	Schema *schema;
+	Record *r;
+	Value *v;
+	RID rids[4];
+	int i, numDeadlocks, numThreads = 4, numIncrements = 50;
+	testName = "test record locks, write conflicts and deadlocks";
+	schema = testSchema();
+
+	memset(&options, 0, sizeof(RM_Options));
+	options.lockTimeoutMs = 200;
+	TEST_CHECK(initRecordManager(&options));
+	TEST_CHECK(createTable("test_table_locks", schema));
+	TEST_CHECK(openTable(table, "test_table_locks"));
+	for (i = 0; i < 4; i++)
+	{
+		r = testRecord(schema, i, "abcd", 0);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+		freeRecord(r);
+	}
+	memset(writers, 0, sizeof(writers));
+	for (i = 0; i < numThreads; i++)
+	{
+		writers[i].table = table;
+		writers[i].schema = schema;
+		writers[i].rids = rids;
+		writers[i].numIncrements = numIncrements;
+	}
+
+	// concurrent read-modify-write transactions lose no update
+	for (i = 0; i < numThreads; i++)
+		pthread_create(&threads[i], NULL, incrementCounter, &writers[i]);
+	for (i = 0; i < numThreads; i++)
+		pthread_join(threads[i], NULL);
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(getRecord(table, rids[0], r));
+	getAttr(r, schema, 2, &v);
+	ASSERT_EQUALS_INT(numThreads * numIncrements, v->v.intV, "every increment is kept");
+	freeVal(v);
+
+	// two transactions writing the same records in opposite order: one of them is refused
+	TEST_CHECK(getLockStats(&stats));
+	numDeadlocks = stats.deadlocks;
+	pthread_barrier_init(&barrier, NULL, 2);
+	for (i = 0; i < 2; i++)
+	{
+		writers[i].first = i;
+		writers[i].barrier = &barrier;
+		pthread_create(&threads[i], NULL, writeBothRecords, &writers[i]);
+	}
+	for (i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&barrier);
+	ASSERT_TRUE((writers[0].result == RC_LOCK_DEADLOCK) != (writers[1].result == RC_LOCK_DEADLOCK), "exactly one transaction is the victim");
+	ASSERT_TRUE(writers[0].result == RC_OK || writers[1].result == RC_OK, "the other transaction goes on");
+	TEST_CHECK(getLockStats(&stats));
+	ASSERT_EQUALS_INT(numDeadlocks + 1, stats.deadlocks, "one deadlock is counted");
+
+	// two transactions holding S on a record and both upgrading to X: one of them is refused
+	numDeadlocks = stats.deadlocks;
+	pthread_barrier_init(&barrier, NULL, 2);
+	for (i = 0; i < 2; i++)
+	{
+		writers[i].first = 0;
+		pthread_create(&threads[i], NULL, upgradeRecord, &writers[i]);
+	}
+	for (i = 0; i < 2; i++)
+		pthread_join(threads[i], NULL);
+	pthread_barrier_destroy(&barrier);
+	ASSERT_TRUE((writers[0].result == RC_LOCK_DEADLOCK) != (writers[1].result == RC_LOCK_DEADLOCK), "exactly one upgrade is the victim");
+	ASSERT_TRUE(writers[0].result == RC_OK || writers[1].result == RC_OK, "the other upgrade goes on");
+	TEST_CHECK(getLockStats(&stats));
+	ASSERT_EQUALS_INT(numDeadlocks + 1, stats.deadlocks, "one upgrade deadlock is counted");
+
+	// a table locked in S mode keeps writers out until the transaction ends, not readers
+	TEST_CHECK(beginTransaction());
+	TEST_CHECK(lockTable(table, LOCK_S));
+	writers[0].first = 2;
+	writers[0].done = false;
+	pthread_create(&threads[0], NULL, writeRecord, &writers[0]);
+	usleep(50000);
+	ASSERT_TRUE(!writers[0].done, "writer waits for the table lock");
+	TEST_CHECK(getRecord(table, rids[2], r));
+	TEST_CHECK(commitTransaction());
+	pthread_join(threads[0], NULL);
+	TEST_CHECK(writers[0].result);
+
+	// a locked record keeps writers out until they give up
+	TEST_CHECK(beginTransaction());
+	TEST_CHECK(lockRecord(table, rids[3], LOCK_X));
+	writers[0].first = 3;
+	pthread_create(&threads[0], NULL, writeRecord, &writers[0]);
+	pthread_join(threads[0], NULL);
+	ASSERT_EQUALS_INT(RC_LOCK_TIMEOUT, writers[0].result, "writer gives up waiting for the record lock");
+	TEST_CHECK(abortTransaction());
+	TEST_CHECK(getLockStats(&stats));
+	ASSERT_TRUE(stats.timeouts >= 1, "timeout is counted");
+
+	// a transaction cannot write a record changed after it began
+	TEST_CHECK(beginTransaction());
+	pthread_create(&threads[0], NULL, writeRecord, &writers[0]);
+	pthread_join(threads[0], NULL);
+	TEST_CHECK(writers[0].result);
+	ASSERT_EQUALS_INT(RC_TX_CONFLICT, deleteRecord(table, rids[3]), "first updater wins");
+	TEST_CHECK(abortTransaction());
+	TEST_CHECK(deleteRecord(table, rids[3]));
+	TEST_CHECK(beginTransaction());
+	ASSERT_EQUALS_INT(RC_RM_NO_MORE_TUPLES, lockRecord(table, rids[3], LOCK_S), "deleted record cannot be locked");
+	TEST_CHECK(commitTransaction());
+	ASSERT_EQUALS_INT(RC_TX_NOT_ACTIVE, lockTable(table, LOCK_S), "locks outside of transactions");
+
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_locks"));
+	TEST_CHECK(shutdownRecordManager());
+
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// a block on disk is a page and its checksum, after the header block
+#define TEST_BLOCK_SIZE (PAGE_SIZE + (int)sizeof(unsigned int))
+
+// flips one byte of the page file of a closed table
+static void flipByte(char *fileName, long offset)
+{
+	FILE *file = fopen(fileName, "r+b");
+	int c;
+
+	ASSERT_TRUE(file != NULL, "page file opened");
+	fseek(file, offset, SEEK_SET);
+	c = fgetc(file);
+	fseek(file, offset, SEEK_SET);
+	fputc(c ^ 0x5A, file);
+	fclose(file);
+}
+
+// reads the record at id of the table in a fresh record manager verifying pages as mode says
+static RC readWithVerify(Schema *schema, PageVerify mode, RID id)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_Options options;
+	Record *r;
+	RC rc;
+
+	memset(&options, 0, sizeof(RM_Options));
+	options.pageVerify = mode;
+	TEST_CHECK(initRecordManager(&options));
+	TEST_CHECK(openTable(table, "test_table_crc"));
+	TEST_CHECK(createRecord(&r, schema));
+	rc = getRecord(table, id, r);
+	freeRecord(r);
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	return rc;
+}
+
+void testPageChecksums(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	Schema *schema;
+	Record *r;
+	RID first, last;
+	int i, numRecords = 1000;
+	testName = "test page checksums and torn pages";
+	schema = testSchema();
+
+	ASSERT_EQUALS_INT((int)0xE3069283, (int)crc32c(0, "123456789", 9), "CRC32C check value");
+	ASSERT_EQUALS_INT((int)crc32c(0, "123456789", 9), (int)crc32c(crc32c(0, "1234", 4), "56789", 5), "CRC32C continues");
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_crc", schema));
+	TEST_CHECK(openTable(table, "test_table_crc"));
+	for (i = 0; i < numRecords; i++)
+	{
+		r = testRecord(schema, i, "abcd", i);
+		TEST_CHECK(insertRecord(table, r));
+		if (i == 0)
+			first = r->id;
+		last = r->id;
+		freeRecord(r);
+	}
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(shutdownRecordManager());
+	ASSERT_TRUE(first.page != last.page, "records span pages");
+	TEST_CHECK(readWithVerify(schema, PAGE_VERIFY_ALWAYS, first));
+
+	// a changed byte fails the check of its page, unless reads do not verify
+	flipByte("test_table_crc", (long)(first.page + 1) * TEST_BLOCK_SIZE + PAGE_SIZE / 2);
+	ASSERT_EQUALS_INT(RC_PAGE_CORRUPTED, readWithVerify(schema, PAGE_VERIFY_ALWAYS, first), "corrupted page is detected");
+	ASSERT_EQUALS_INT(RC_PAGE_CORRUPTED, readWithVerify(schema, PAGE_VERIFY_LAZY, first), "lazy verify checks the first read");
+	TEST_CHECK(readWithVerify(schema, PAGE_VERIFY_OFF, last));
+	flipByte("test_table_crc", (long)(first.page + 1) * TEST_BLOCK_SIZE + PAGE_SIZE / 2);
+	TEST_CHECK(readWithVerify(schema, PAGE_VERIFY_ALWAYS, first));
+
+	// a page cut short by a torn append is not read as zeros
+	TEST_CHECK(truncate("test_table_crc", (long)(last.page + 1) * TEST_BLOCK_SIZE + PAGE_SIZE / 2) == 0 ? RC_OK : RC_WRITE_FAILED);
+	ASSERT_EQUALS_INT(RC_PAGE_CORRUPTED, readWithVerify(schema, PAGE_VERIFY_OFF, last), "short read is detected");
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(deleteTable("test_table_crc"));
+	TEST_CHECK(shutdownRecordManager());
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+static long fileSize(char *fileName)
+{
+	struct stat st;
+	return stat(fileName, &st) == 0 ? (long)st.st_size : -1;
+}
+
+// copies a page file as it is on disk, as a crash would leave it
+static void copyFile(char *from, char *to)
+{
+	FILE *in = fopen(from, "rb"), *out = fopen(to, "wb");
+	char buffer[PAGE_SIZE];
+	size_t n;
+
+	ASSERT_TRUE(in != NULL && out != NULL, "page file copied");
+	while ((n = fread(buffer, 1, sizeof(buffer), in)) > 0)
+		fwrite(buffer, 1, n, out);
+	fclose(in);
+	fclose(out);
+}
+
+// the archive rows of testCompressedTables, a few strings padded to their length
+static void setArchiveRow(Record *r, Schema *schema, int i, char *region)
+{
+	char padded[64];
+	Value *v;
+
+	snprintf(padded, sizeof(padded), "%-63s", region);
+	MAKE_VALUE(v, DT_INT, i);
+	TEST_CHECK(setAttr(r, schema, 0, v));
+	freeVal(v);
+	MAKE_STRING_VALUE(v, padded);
+	TEST_CHECK(setAttr(r, schema, 1, v));
+	freeVal(v);
+}
+
+static char *archiveRegions[] = {"north archive", "south archive", "east archive", "west archive"};
+
+void testCompressedTables(void)
+{
+	RM_TableData *table = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_ScanHandle *sc = (RM_ScanHandle *)malloc(sizeof(RM_ScanHandle));
+	RM_TableOptions options = {TRUE};
+	RM_VacuumStats stats;
+	SM_FileHandle fh, crashed;
+	char *names[] = {"a", "b"};
+	DataType dt[] = {DT_INT, DT_STRING};
+	int sizes[] = {0, 63};
+	int keys[] = {0};
+	int numRecords = 3000, i, n, wrong;
+	char page[PAGE_SIZE], back[PAGE_SIZE];
+	long plainSize, compressedSize;
+	RID *rids;
+	Record *r;
+	Schema *schema;
+	Expr *sel;
+	Value *v;
+	testName = "test compressed tables";
+	schema = createSchema(2, names, dt, sizes, 1, keys);
+	rids = (RID *)malloc(sizeof(RID) * numRecords);
+
+	// pages that do not compress are stored as they are, pages never written read as zeros
+	TEST_CHECK(createCompressedPageFile("test_table_lz_pages"));
+	TEST_CHECK(openPageFile("test_table_lz_pages", &fh));
+	TEST_CHECK(ensureCapacity(3, &fh));
+	srand(42);
+	for (i = 0; i < PAGE_SIZE; i++)
+		page[i] = rand();
+	TEST_CHECK(writeBlock(1, &fh, page));
+	memset(back, 'x', PAGE_SIZE);
+	TEST_CHECK(writeBlock(2, &fh, back));
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(openPageFile("test_table_lz_pages", &fh));
+	ASSERT_EQUALS_INT(3, fh.totalNumPages, "page count kept in the page map");
+	TEST_CHECK(readBlock(1, &fh, back));
+	ASSERT_TRUE(memcmp(page, back, PAGE_SIZE) == 0, "incompressible page read back");
+	TEST_CHECK(readBlock(0, &fh, back));
+	ASSERT_TRUE(back[0] == 0 && memcmp(back, back + 1, PAGE_SIZE - 1) == 0, "blank page reads as zeros");
+	TEST_CHECK(truncatePageFile(1, &fh));
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(openPageFile("test_table_lz_pages", &fh));
+	ASSERT_EQUALS_INT(1, fh.totalNumPages, "truncation kept");
+	TEST_CHECK(closePageFile(&fh));
+	ASSERT_TRUE(fileSize("test_table_lz_pages") < 2 * TEST_BLOCK_SIZE, "extents of truncated pages cut off the file");
+
+	// a page rewritten since the last sync goes to a new extent, the one the map on disk points to is kept
+	TEST_CHECK(openPageFile("test_table_lz_pages", &fh));
+	memset(page, 'x', PAGE_SIZE);
+	TEST_CHECK(writeBlock(0, &fh, page));
+	TEST_CHECK(syncPageFile(&fh));
+	memset(page, 'y', PAGE_SIZE);
+	TEST_CHECK(writeBlock(0, &fh, page));
+	copyFile("test_table_lz_pages", "test_table_lz_crash");
+	TEST_CHECK(openPageFile("test_table_lz_crash", &crashed));
+	TEST_CHECK(readBlock(0, &crashed, back));
+	ASSERT_TRUE(back[0] == 'x' && memcmp(back, back + 1, PAGE_SIZE - 1) == 0, "page as of the last sync survives a crash");
+	TEST_CHECK(closePageFile(&crashed));
+	TEST_CHECK(destroyPageFile("test_table_lz_crash"));
+	TEST_CHECK(readBlock(0, &fh, back));
+	ASSERT_TRUE(memcmp(page, back, PAGE_SIZE) == 0, "rewritten page read back");
+	TEST_CHECK(closePageFile(&fh));
+	TEST_CHECK(destroyPageFile("test_table_lz_pages"));
+
+	// the same rows in a plain and a compressed table
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(createTable("test_table_plain", schema));
+	TEST_CHECK(createTableWithOptions("test_table_lz", schema, &options));
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(openTable(table, "test_table_plain"));
+	for (i = 0; i < numRecords; i++)
+	{
+		setArchiveRow(r, schema, i, archiveRegions[i % 4]);
+		TEST_CHECK(insertRecord(table, r));
+	}
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(openTable(table, "test_table_lz"));
+	for (i = 0; i < numRecords; i++)
+	{
+		setArchiveRow(r, schema, i, archiveRegions[i % 4]);
+		TEST_CHECK(insertRecord(table, r));
+		rids[i] = r->id;
+	}
+	TEST_CHECK(closeTable(table));
+	plainSize = fileSize("test_table_plain");
+	compressedSize = fileSize("test_table_lz");
+	ASSERT_TRUE(compressedSize > 0 && compressedSize * 4 < plainSize, "compressed table is several times smaller");
+
+	// changes after reopening, shrinking pages and moving them to other extents
+	TEST_CHECK(openTable(table, "test_table_lz"));
+	for (i = 0; i < numRecords; i++)
+	{
+		if (i % 3 == 0)
+		{
+			TEST_CHECK(deleteRecord(table, rids[i]));
+		}
+		else if (i % 3 == 1)
+		{
+			TEST_CHECK(getRecord(table, rids[i], r));
+			setArchiveRow(r, schema, i, "an updated row of the archive");
+			TEST_CHECK(updateRecord(table, r));
+		}
+	}
+	TEST_CHECK(vacuumTable(table, 0, TRUE, &stats));
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(shutdownRecordManager());
+
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(openTable(table, "test_table_lz"));
+	ASSERT_EQUALS_INT(numRecords - numRecords / 3, getNumTuples(table), "tuples after reopening");
+	sel = (Expr *)malloc(sizeof(Expr));
+	sel->type = EXPR_CONST;
+	sel->expr.cons = stringToValue("bt");
+	TEST_CHECK(startScan(table, sc, sel));
+	n = 0;
+	while (next(sc, r) == RC_OK)
+		n++;
+	TEST_CHECK(closeScan(sc));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(numRecords - numRecords / 3, n, "scan of the compressed table");
+	wrong = 0;
+	for (i = 0; i < numRecords; i++)
+	{
+		if (i % 3 == 0)
+		{
+			if (getRecord(table, rids[i], r) == RC_OK)
+				wrong++;
+			continue;
+		}
+		TEST_CHECK(getRecord(table, rids[i], r));
+		getAttr(r, schema, 1, &v);
+		if (strncmp(v->v.stringV, i % 3 == 1 ? "an updated row" : archiveRegions[i % 4], 12) != 0)
+			wrong++;
+		freeVal(v);
+	}
+	ASSERT_EQUALS_INT(0, wrong, "records read back from compressed pages");
+	TEST_CHECK(closeTable(table));
+	TEST_CHECK(deleteTable("test_table_lz"));
+	TEST_CHECK(deleteTable("test_table_plain"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(r);
+	free(rids);
+	free(sc);
+	free(table);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// true if two values are both NULL or equal
+static bool sameValue(Value *x, Value *y)
+{
+	Value *equal;
+	bool same;
+
+	if (x->isNull || y->isNull)
+		return x->isNull && y->isNull;
+	MAKE_VALUE(equal, DT_BOOL, FALSE);
+	same = valueEquals(x, y, equal) == RC_OK && equal->v.boolV;
+	freeVal(equal);
+	return same;
+}
+
+// true if two results of aggregateScan have the same groups with the same values, in any order
+static bool sameAggResults(RM_AggResult *x, RM_AggResult *y)
+{
+	int g, h, a;
+
+	if (x->numGroups != y->numGroups || x->numAggs != y->numAggs)
+		return false;
+	for (g = 0; g < x->numGroups; g++)
+	{
+		for (h = 0; h < y->numGroups; h++)
+			if (x->groups[g].key == NULL ? y->groups[h].key == NULL : y->groups[h].key != NULL && sameValue(x->groups[g].key, y->groups[h].key))
+				break;
+		if (h == y->numGroups)
+			return false;
+		for (a = 0; a < x->numAggs; a++)
+			if (!sameValue(x->groups[g].values[a], y->groups[h].values[a]))
+				return false;
+	}
+	return true;
+}
+
+// runs the same aggregateScan on a table of rows and a PAX table, true if the results agree
+static bool sameAggregates(RM_TableData *rows, RM_TableData *pax, int groupAttr, int numAggs, RM_Aggregate *aggs,
+		int maxA, int numWorkers)
+{
+	RM_AggResult *x, *y;
+	Expr *sel, *left, *right;
+	char bound[16];
+	bool same;
+	int i;
+
+	for (i = 0; i < 2; i++)
+	{
+		sel = NULL;
+		if (maxA >= 0)
+		{
+			sprintf(bound, "i%d", maxA);
+			MAKE_ATTRREF(left, 0);
+			MAKE_CONS(right, stringToValue(bound));
+			MAKE_BINOP_EXPR(sel, left, right, OP_COMP_SMALLER);
+		}
+		TEST_CHECK(aggregateScan(i == 0 ? rows : pax, sel, groupAttr, numAggs, aggs, numWorkers, i == 0 ? &x : &y));
+		if (sel != NULL)
+			freeExpr(sel);
+	}
+	same = sameAggResults(x, y);
+	TEST_CHECK(freeAggResult(x));
+	TEST_CHECK(freeAggResult(y));
+	return same;
+}
+
+void testPaxTables(void)
+{
+	RM_TableData *rows = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *pax = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableOptions options = {FALSE, TABLE_LAYOUT_PAX};
+	RM_Aggregate all[] = {{AGG_COUNT, -1}, {AGG_COUNT, 2}, {AGG_SUM, 0}, {AGG_MIN, 0}, {AGG_MAX, 1}, {AGG_AVG, 2}};
+	RM_Aggregate perGroup[] = {{AGG_COUNT, -1}, {AGG_SUM, 2}, {AGG_MIN, 1}};
+	RM_AggResult *before, *during;
+	RM_VacuumStats stats;
+	SnapshotWriter writer;
+	pthread_t thread;
+	char *wideNames[] = {"a", "b"};
+	DataType wideTypes[] = {DT_INT, DT_STRING};
+	int wideSizes[] = {0, PAGE_SIZE};
+	int wideKeys[] = {0};
+	int numInserts = 2000, i, workers, wrong;
+	char name[4];
+	RID *rowRids, *paxRids;
+	Record *r, *back;
+	Schema *schema, *wide;
+	Value *v, *nullInt;
+	testName = "test PAX tables";
+	schema = testSchema();
+	wide = createSchema(2, wideNames, wideTypes, wideSizes, 1, wideKeys);
+	rowRids = (RID *)malloc(sizeof(RID) * numInserts);
+	paxRids = (RID *)malloc(sizeof(RID) * numInserts);
+	MAKE_NULL_VALUE(nullInt, DT_INT);
+
+	TEST_CHECK(initRecordManager(NULL));
+	ASSERT_EQUALS_INT(RC_ERROR, createTableWithOptions("test_table_wide", wide, &options), "a record must fit on a PAX page");
+	TEST_CHECK(createTable("test_table_rows", schema));
+	TEST_CHECK(createTableWithOptions("test_table_pax", schema, &options));
+	TEST_CHECK(openTable(rows, "test_table_rows"));
+	TEST_CHECK(openTable(pax, "test_table_pax"));
+
+	// the same records in both tables, b is one of g0, g1, g2 and c is i % 10, NULL for every hundredth record
+	for (i = 0; i < numInserts; i++)
+	{
+		sprintf(name, "g%d", i % 3);
+		r = testRecord(schema, i, name, i % 10);
+		if (i % 100 == 0)
+			TEST_CHECK(setAttr(r, schema, 2, nullInt));
+		TEST_CHECK(insertRecord(rows, r));
+		rowRids[i] = r->id;
+		TEST_CHECK(insertRecord(pax, r));
+		paxRids[i] = r->id;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(numInserts, getNumTuples(pax), "tuples of the PAX table");
+
+	// records are put back together from the minipages
+	TEST_CHECK(createRecord(&back, schema));
+	TEST_CHECK(getRecord(pax, paxRids[700], back));
+	getAttr(back, schema, 1, &v);
+	ASSERT_EQUALS_STRING("g1", v->v.stringV, "string read from its minipage");
+	freeVal(v);
+	getAttr(back, schema, 2, &v);
+	ASSERT_TRUE(v->isNull, "NULL read from its minipage");
+	freeVal(v);
+
+	// the aggregates over the minipages are those over the records
+	for (workers = 1; workers <= 4; workers *= 2)
+	{
+		ASSERT_TRUE(sameAggregates(rows, pax, -1, 6, all, -1, workers), "aggregates without grouping");
+		ASSERT_TRUE(sameAggregates(rows, pax, 1, 3, perGroup, -1, workers), "aggregates grouped by a string");
+		ASSERT_TRUE(sameAggregates(rows, pax, 2, 3, perGroup, 500, workers), "aggregates with a condition grouped by an int");
+	}
+
+	// a transaction aggregates the versions it sees, also those only left in the version store
+	TEST_CHECK(aggregateScan(pax, NULL, -1, 6, all, 2, &before));
+	TEST_CHECK(beginTransaction());
+	writer.table = pax;
+	writer.schema = schema;
+	writer.rids = paxRids;
+	ASSERT_TRUE(pthread_create(&thread, NULL, writeBesideTransaction, &writer) == 0, "writer thread started");
+	pthread_join(thread, NULL);
+	TEST_CHECK(aggregateScan(pax, NULL, -1, 6, all, 2, &during));
+	ASSERT_TRUE(sameAggResults(before, during), "snapshot of the transaction aggregated");
+	TEST_CHECK(freeAggResult(during));
+	TEST_CHECK(commitTransaction());
+	TEST_CHECK(aggregateScan(pax, NULL, -1, 6, all, 2, &during));
+	ASSERT_TRUE(!sameAggResults(before, during), "changes aggregated after the transaction");
+	TEST_CHECK(freeAggResult(during));
+	TEST_CHECK(freeAggResult(before));
+	writer.table = rows;
+	writer.rids = rowRids;
+	writeBesideTransaction(&writer);
+
+	// updates in place and deletes, then an aborted transaction that takes its changes back
+	for (i = 3; i < numInserts; i++)
+	{
+		if (i % 3 == 0)
+		{
+			TEST_CHECK(getRecord(pax, paxRids[i], back));
+			MAKE_VALUE(v, DT_INT, 5000 + i);
+			TEST_CHECK(setAttr(back, schema, 2, v));
+			TEST_CHECK(updateRecord(pax, back));
+			back->id = rowRids[i];
+			TEST_CHECK(updateRecord(rows, back));
+			freeVal(v);
+		}
+		else if (i % 5 == 0)
+		{
+			TEST_CHECK(deleteRecord(pax, paxRids[i]));
+			TEST_CHECK(deleteRecord(rows, rowRids[i]));
+		}
+	}
+	TEST_CHECK(beginTransaction());
+	TEST_CHECK(deleteRecord(pax, paxRids[4]));
+	TEST_CHECK(getRecord(pax, paxRids[7], back));
+	TEST_CHECK(setAttr(back, schema, 2, nullInt));
+	TEST_CHECK(updateRecord(pax, back));
+	TEST_CHECK(abortTransaction());
+	TEST_CHECK(getRecord(pax, paxRids[4], back));
+	TEST_CHECK(getRecord(pax, paxRids[7], back));
+	getAttr(back, schema, 2, &v);
+	ASSERT_EQUALS_INT(7, v->v.intV, "aborted update taken back");
+	freeVal(v);
+	ASSERT_TRUE(sameAggregates(rows, pax, 1, 3, perGroup, -1, 2), "aggregates after updates and deletes");
+
+	// the second half of the table goes, vacuum frees its pages and new records reuse the slots
+	for (i = numInserts / 2; i < numInserts; i++)
+	{
+		if (i % 3 == 0 || i % 5 != 0)
+		{
+			TEST_CHECK(deleteRecord(pax, paxRids[i]));
+			TEST_CHECK(deleteRecord(rows, rowRids[i]));
+		}
+	}
+	TEST_CHECK(vacuumTable(pax, 0, TRUE, &stats));
+	ASSERT_TRUE(stats.pagesFreed + stats.pagesTruncated > 0, "emptied PAX pages reclaimed");
+	TEST_CHECK(vacuumTable(rows, 0, TRUE, &stats));
+	wrong = 0;
+	for (i = numInserts; i < numInserts + 300; i++)
+	{
+		r = testRecord(schema, i, "g9", i % 7);
+		TEST_CHECK(insertRecord(pax, r));
+		if (r->id.page >= paxRids[numInserts - 1].page)
+			wrong++;
+		TEST_CHECK(insertRecord(rows, r));
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(0, wrong, "new records fill the freed slots");
+
+	// the layout is kept in the table header
+	TEST_CHECK(closeTable(pax));
+	TEST_CHECK(openTable(pax, "test_table_pax"));
+	ASSERT_EQUALS_INT(getNumTuples(rows), getNumTuples(pax), "tuples after reopening");
+	ASSERT_TRUE(sameAggregates(rows, pax, -1, 6, all, -1, 4), "aggregates after reopening");
+	ASSERT_TRUE(sameAggregates(rows, pax, 1, 3, perGroup, 1500, 1), "grouped aggregates after reopening");
+	wrong = 0;
+	for (i = 0; i < numInserts / 2; i++)
+	{
+		if (i == 2 || (i % 3 != 0 && i % 5 == 0))
+			continue;
+		TEST_CHECK(getRecord(pax, paxRids[i], back));
+		getAttr(back, schema, 0, &v);
+		if (v->v.intV != i)
+			wrong++;
+		freeVal(v);
+	}
+	ASSERT_EQUALS_INT(0, wrong, "records kept their RIDs");
+
+	TEST_CHECK(closeTable(pax));
+	TEST_CHECK(closeTable(rows));
+	TEST_CHECK(deleteTable("test_table_pax"));
+	TEST_CHECK(deleteTable("test_table_rows"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(back);
+	freeVal(nullInt);
+	free(rowRids);
+	free(paxRids);
+	free(rows);
+	free(pax);
+	freeSchema(wide);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
+// ************************************************************
+// number of records of a scan of table with the condition "attr = value" on a string attribute
+static int countEqual(RM_TableData *table, Schema *schema, int attrNum, char *value)
+{
+	RM_ScanHandle sc;
+	Record *r;
+	Expr *sel, *left, *right;
+	char constant[64];
+	int count = 0;
+
+	sprintf(constant, "s%s", value);
+	MAKE_ATTRREF(left, attrNum);
+	MAKE_CONS(right, stringToValue(constant));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(createRecord(&r, schema));
+	TEST_CHECK(startScan(table, &sc, sel));
+	while (next(&sc, r) == RC_OK)
+		count++;
+	TEST_CHECK(closeScan(&sc));
+	freeRecord(r);
+	freeExpr(sel);
+	return count;
+}
+
+// number of records of rids whose b differs between the tables, records missing from both count as equal
+static int differentStrings(RM_TableData *x, RID *xRids, RM_TableData *y, RID *yRids, Schema *schema, int numRecords)
+{
+	Record *rx, *ry;
+	Value *vx, *vy;
+	int i, wrong = 0;
+
+	TEST_CHECK(createRecord(&rx, schema));
+	TEST_CHECK(createRecord(&ry, schema));
+	for (i = 0; i < numRecords; i++)
+	{
+		if ((getRecord(x, xRids[i], rx) == RC_OK) != (getRecord(y, yRids[i], ry) == RC_OK))
+		{
+			wrong++;
+			continue;
+		}
+		getAttr(rx, schema, 1, &vx);
+		getAttr(ry, schema, 1, &vy);
+		if (!sameValue(vx, vy))
+			wrong++;
+		freeVal(vx);
+		freeVal(vy);
+	}
+	freeRecord(rx);
+	freeRecord(ry);
+	return wrong;
+}
+
+void testDictionaryEncoding(void)
+{
+	RM_TableData *plain = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *rows = (RM_TableData *)malloc(sizeof(RM_TableData));
+	RM_TableData *pax = (RM_TableData *)malloc(sizeof(RM_TableData));
+	bool encodedA[] = {TRUE, FALSE, FALSE};
+	bool encodedB[] = {FALSE, TRUE, FALSE};
+	RM_TableOptions badOptions = {FALSE, TABLE_LAYOUT_ROWS, encodedA};
+	RM_TableOptions rowOptions = {FALSE, TABLE_LAYOUT_ROWS, encodedB};
+	RM_TableOptions paxOptions = {FALSE, TABLE_LAYOUT_PAX, encodedB};
+	RM_Aggregate perGroup[] = {{AGG_COUNT, -1}, {AGG_SUM, 2}, {AGG_MIN, 1}, {AGG_MAX, 1}};
+	RM_ScanHandle sc;
+	Expr *sel, *left, *right;
+	int numInserts = 3000, i, n, expected;
+	char name[8];
+	RID *plainRids, *rowRids, *paxRids;
+	Record *r, *back;
+	Schema *schema;
+	Value *v, *nullString;
+	testName = "test dictionary encoded strings";
+	schema = testSchema();
+	plainRids = (RID *)malloc(sizeof(RID) * (numInserts + 1));
+	rowRids = (RID *)malloc(sizeof(RID) * (numInserts + 1));
+	paxRids = (RID *)malloc(sizeof(RID) * (numInserts + 1));
+	MAKE_NULL_VALUE(nullString, DT_STRING);
+
+	TEST_CHECK(initRecordManager(NULL));
+	ASSERT_EQUALS_INT(RC_ERROR, createTableWithOptions("test_table_dbad", schema, &badOptions), "only strings are dictionary encoded");
+	TEST_CHECK(createTable("test_table_plain", schema));
+	TEST_CHECK(createTableWithOptions("test_table_drows", schema, &rowOptions));
+	TEST_CHECK(createTableWithOptions("test_table_dpax", schema, &paxOptions));
+	TEST_CHECK(openTable(plain, "test_table_plain"));
+	TEST_CHECK(openTable(rows, "test_table_drows"));
+	TEST_CHECK(openTable(pax, "test_table_dpax"));
+
+	// the same records in all tables, b is one of r0 .. r4, NULL for every fiftieth record
+	for (i = 0; i < numInserts; i++)
+	{
+		sprintf(name, "r%d", i % 5);
+		r = testRecord(schema, i, name, i % 10);
+		if (i % 50 == 1)
+			TEST_CHECK(setAttr(r, schema, 1, nullString));
+		TEST_CHECK(insertRecord(plain, r));
+		plainRids[i] = r->id;
+		TEST_CHECK(insertRecord(rows, r));
+		rowRids[i] = r->id;
+		TEST_CHECK(insertRecord(pax, r));
+		paxRids[i] = r->id;
+		freeRecord(r);
+	}
+	ASSERT_EQUALS_INT(0, differentStrings(plain, plainRids, rows, rowRids, schema, numInserts), "strings decoded from rows");
+	ASSERT_EQUALS_INT(0, differentStrings(plain, plainRids, pax, paxRids, schema, numInserts), "strings decoded from minipages");
+
+	// equalities are checked on the codes
+	expected = countEqual(plain, schema, 1, "r2");
+	ASSERT_TRUE(expected > 0, "plain table has r2");
+	ASSERT_EQUALS_INT(expected, countEqual(rows, schema, 1, "r2"), "equality scan of encoded rows");
+	ASSERT_EQUALS_INT(expected, countEqual(pax, schema, 1, "r2"), "equality scan of an encoded PAX table");
+	ASSERT_EQUALS_INT(0, countEqual(rows, schema, 1, "zz"), "a value the dictionary does not have matches nothing");
+	ASSERT_EQUALS_INT(0, countEqual(rows, schema, 1, "r2xxx"), "a value longer than the attribute matches nothing");
+	ASSERT_TRUE(sameAggregates(plain, rows, 1, 4, perGroup, -1, 1), "aggregates grouped by an encoded string");
+	ASSERT_TRUE(sameAggregates(plain, pax, 1, 4, perGroup, -1, 4), "parallel aggregates grouped by an encoded string");
+	ASSERT_TRUE(sameAggregates(plain, pax, 1, 4, perGroup, 1000, 2), "aggregates with a condition grouped by an encoded string");
+
+	// a scan started before a transaction adds a value sees the records of the transaction with it
+	TEST_CHECK(beginTransaction());
+	MAKE_ATTRREF(left, 1);
+	MAKE_CONS(right, stringToValue("snew"));
+	MAKE_BINOP_EXPR(sel, left, right, OP_COMP_EQUAL);
+	TEST_CHECK(startScan(rows, &sc, sel));
+	r = testRecord(schema, numInserts, "new", 1);
+	TEST_CHECK(insertRecord(rows, r));
+	TEST_CHECK(createRecord(&back, schema));
+	n = 0;
+	while (next(&sc, back) == RC_OK)
+		n++;
+	TEST_CHECK(closeScan(&sc));
+	freeExpr(sel);
+	ASSERT_EQUALS_INT(1, n, "scan sees a value added during it");
+	TEST_CHECK(abortTransaction());
+	ASSERT_EQUALS_INT(0, countEqual(rows, schema, 1, "new"), "aborted insert of a new value taken back");
+	TEST_CHECK(insertRecord(plain, r));
+	plainRids[numInserts] = r->id;
+	TEST_CHECK(insertRecord(rows, r));
+	rowRids[numInserts] = r->id;
+	TEST_CHECK(insertRecord(pax, r));
+	paxRids[numInserts] = r->id;
+	freeRecord(r);
+	ASSERT_EQUALS_INT(1, countEqual(pax, schema, 1, "new"), "new value after the abort");
+
+	// updates to new values and to NULL, enough distinct values to take several dictionary pages
+	for (i = 0; i < numInserts; i += 3)
+	{
+		sprintf(name, "u%d", i % 1200);
+		MAKE_STRING_VALUE(v, name);
+		if (i % 9 == 0)
+		{
+			freeVal(v);
+			MAKE_NULL_VALUE(v, DT_STRING);
+		}
+		TEST_CHECK(getRecord(plain, plainRids[i], back));
+		TEST_CHECK(setAttr(back, schema, 1, v));
+		TEST_CHECK(updateRecord(plain, back));
+		back->id = rowRids[i];
+		TEST_CHECK(updateRecord(rows, back));
+		back->id = paxRids[i];
+		TEST_CHECK(updateRecord(pax, back));
+		freeVal(v);
+	}
+	for (i = 5; i < numInserts; i += 10)
+	{
+		TEST_CHECK(deleteRecord(plain, plainRids[i]));
+		TEST_CHECK(deleteRecord(rows, rowRids[i]));
+		TEST_CHECK(deleteRecord(pax, paxRids[i]));
+	}
+	ASSERT_EQUALS_INT(countEqual(plain, schema, 1, "u6"), countEqual(pax, schema, 1, "u6"), "equality on an updated value");
+	ASSERT_TRUE(sameAggregates(plain, pax, 1, 4, perGroup, -1, 2), "aggregates after updates and deletes");
+
+	// the dictionaries are kept in the table files
+	TEST_CHECK(closeTable(rows));
+	TEST_CHECK(closeTable(pax));
+	TEST_CHECK(shutdownRecordManager());
+	TEST_CHECK(initRecordManager(NULL));
+	TEST_CHECK(openTable(rows, "test_table_drows"));
+	TEST_CHECK(openTable(pax, "test_table_dpax"));
+	ASSERT_EQUALS_INT(0, differentStrings(plain, plainRids, rows, rowRids, schema, numInserts + 1), "strings of rows after reopening");
+	ASSERT_EQUALS_INT(0, differentStrings(plain, plainRids, pax, paxRids, schema, numInserts + 1), "strings of minipages after reopening");
+	ASSERT_EQUALS_INT(countEqual(plain, schema, 1, "r4"), countEqual(rows, schema, 1, "r4"), "equality scan after reopening");
+	r = testRecord(schema, numInserts + 1, "last", 0);
+	TEST_CHECK(insertRecord(rows, r));
+	freeRecord(r);
+	TEST_CHECK(closeTable(rows));
+	TEST_CHECK(openTable(rows, "test_table_drows"));
+	ASSERT_EQUALS_INT(1, countEqual(rows, schema, 1, "last"), "value added after reopening kept");
+
+	TEST_CHECK(closeTable(plain));
+	TEST_CHECK(closeTable(rows));
+	TEST_CHECK(closeTable(pax));
+	TEST_CHECK(deleteTable("test_table_plain"));
+	TEST_CHECK(deleteTable("test_table_drows"));
+	TEST_CHECK(deleteTable("test_table_dpax"));
+	TEST_CHECK(shutdownRecordManager());
+
+	freeRecord(back);
+	freeVal(nullString);
+	free(plainRids);
+	free(rowRids);
+	free(paxRids);
+	free(plain);
+	free(rows);
+	free(pax);
+	freeSchema(schema);
+	TEST_DONE();
+}
+
 Schema *
 testSchema(void)
 {
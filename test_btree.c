@@ -0,0 +1,354 @@
+#include <stdlib.h>
+#include "dberror.h"
+#include "expr.h"
+#include "btree_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+#define INDEX_FILE "testidx"
+
+// test methods
+static void testInsertAndFind (void);
+static void testSplitsAndRangeScan (void);
+static void testDuplicatesAndDelete (void);
+static void testStringKeys (void);
+static void testReopen (void);
+
+// helper methods
+static Value **createValues (char **stringVals, int size);
+static void freeValues (Value **vals, int size);
+static int *createPermutation (int size);
+
+char *testName;
+
+// main method
+int
+main (void)
+{
+	initIndexManager(NULL);
+	testName = "";
+
+	testInsertAndFind();
+	testSplitsAndRangeScan();
+	testDuplicatesAndDelete();
+	testStringKeys();
+	testReopen();
+
+	shutdownIndexManager();
+	return 0;
+}
+
+// ************************************************************
+void
+testInsertAndFind (void)
+{
+	RID insert[] = {
+		{1,1}, {2,3}, {1,2}, {3,5}, {4,4}, {3,2},
+	};
+	int numInserts = 6;
+	Value **keys;
+	char *stringKeys[] = {
+		"i1", "i11", "i13", "i17", "i23", "i52"
+	};
+	testName = "test b-tree inserting and search";
+	int i, n;
+	BTreeHandle *tree = NULL;
+	RID rid;
+
+	keys = createValues(stringKeys, numInserts);
+
+	TEST_CHECK(createBtree(INDEX_FILE, DT_INT, 0, 2));
+	TEST_CHECK(openBtree(&tree, INDEX_FILE));
+
+	for (i = 0; i < numInserts; i++)
+		TEST_CHECK(insertKey(tree, keys[i], insert[i]));
+
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(numInserts, n, "number of entries in btree");
+	TEST_CHECK(getNumNodes(tree, &n));
+	ASSERT_TRUE(n > 1, "a fan-out of 2 forces splits");
+
+	for (i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(findKey(tree, keys[i], &rid));
+		ASSERT_EQUALS_INT(insert[i].page, rid.page, "found right page");
+		ASSERT_EQUALS_INT(insert[i].slot, rid.slot, "found right slot");
+	}
+
+	Value *missing = stringToValue("i12");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, missing, &rid), "missing key is not found");
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, insertKey(tree, keys[0], insert[0]), "same key and RID is rejected");
+	freeVal(missing);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree(INDEX_FILE));
+	freeValues(keys, numInserts);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testSplitsAndRangeScan (void)
+{
+	int numInserts = 2000;
+	int *permute = createPermutation(numInserts);
+	BTreeHandle *tree = NULL;
+	BT_ScanHandle *sc = NULL;
+	Value *key, *low, *high;
+	RID rid;
+	int i, n, rc;
+	testName = "test b-tree splits and range scans";
+
+	TEST_CHECK(createBtree(INDEX_FILE, DT_INT, 0, 4));
+	TEST_CHECK(openBtree(&tree, INDEX_FILE));
+
+	// insert in random order, the RID encodes the key
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(key, DT_INT, permute[i]);
+		rid.page = permute[i];
+		rid.slot = 0;
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(numInserts, n, "all entries are in the tree");
+
+	// a full scan returns every key in order
+	TEST_CHECK(openTreeScan(tree, &sc));
+	i = 0;
+	while ((rc = nextEntry(sc, &rid)) == RC_OK)
+	{
+		if (rid.page != i)
+			break;
+		i++;
+	}
+	ASSERT_EQUALS_INT(RC_IM_NO_MORE_ENTRIES, rc, "scan ends with no more entries");
+	ASSERT_EQUALS_INT(numInserts, i, "full scan returns the keys in order");
+	TEST_CHECK(closeTreeScan(sc));
+
+	// inclusive range scan
+	MAKE_VALUE(low, DT_INT, 500);
+	MAKE_VALUE(high, DT_INT, 749);
+	TEST_CHECK(openTreeRangeScan(tree, low, high, &sc));
+	i = 500;
+	while (nextEntry(sc, &rid) == RC_OK)
+	{
+		if (rid.page != i)
+			break;
+		i++;
+	}
+	ASSERT_EQUALS_INT(750, i, "range scan returns 500..749");
+	TEST_CHECK(closeTreeScan(sc));
+
+	// half-open range scan
+	TEST_CHECK(openTreeRangeScan(tree, NULL, low, &sc));
+	n = 0;
+	while (nextEntry(sc, &rid) == RC_OK)
+		n++;
+	ASSERT_EQUALS_INT(501, n, "range scan up to 500 returns 501 entries");
+	TEST_CHECK(closeTreeScan(sc));
+	freeVal(low);
+	freeVal(high);
+
+	// every key can still be found after the splits
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i);
+		TEST_CHECK(findKey(tree, key, &rid));
+		freeVal(key);
+		if (rid.page != i)
+			break;
+	}
+	ASSERT_EQUALS_INT(numInserts, i, "point lookups find every key");
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree(INDEX_FILE));
+	free(permute);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testDuplicatesAndDelete (void)
+{
+	BTreeHandle *tree = NULL;
+	BT_ScanHandle *sc = NULL;
+	Value *key;
+	RID rid;
+	int i, n;
+	testName = "test b-tree duplicate keys and deletes";
+
+	TEST_CHECK(createBtree(INDEX_FILE, DT_INT, 0, 3));
+	TEST_CHECK(openBtree(&tree, INDEX_FILE));
+
+	// 100 keys, each with 5 RIDs
+	for (i = 0; i < 500; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i % 100);
+		rid.page = i % 100;
+		rid.slot = i / 100;
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+
+	MAKE_VALUE(key, DT_INT, 42);
+	TEST_CHECK(openTreeRangeScan(tree, key, key, &sc));
+	n = 0;
+	while (nextEntry(sc, &rid) == RC_OK)
+	{
+		ASSERT_EQUALS_INT(42, rid.page, "duplicate belongs to key 42");
+		n++;
+	}
+	ASSERT_EQUALS_INT(5, n, "key 42 has five entries");
+	TEST_CHECK(closeTreeScan(sc));
+
+	// delete one duplicate by RID, then the remaining ones by key
+	rid.page = 42;
+	rid.slot = 3;
+	TEST_CHECK(deleteEntry(tree, key, rid));
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, deleteEntry(tree, key, rid), "entry is gone");
+	for (i = 0; i < 4; i++)
+		TEST_CHECK(deleteKey(tree, key));
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, findKey(tree, key, &rid), "key 42 is gone");
+	freeVal(key);
+
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(495, n, "five entries deleted");
+
+	// the neighbours are untouched
+	MAKE_VALUE(key, DT_INT, 43);
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(43, rid.page, "key 43 still found");
+	freeVal(key);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree(INDEX_FILE));
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeys (void)
+{
+	char *stringKeys[] = {
+		"spear", "sapple", "sfig", "sbanana", "sdate", "scherry", "sgrape"
+	};
+	char *sorted[] = {
+		"apple", "banana", "cherry", "date", "fig", "grape", "pear"
+	};
+	int numInserts = 7;
+	Value **keys = createValues(stringKeys, numInserts);
+	BTreeHandle *tree = NULL;
+	BT_ScanHandle *sc = NULL;
+	RID rid;
+	int i;
+	testName = "test b-tree with string keys";
+
+	TEST_CHECK(createBtree(INDEX_FILE, DT_STRING, 8, 2));
+	TEST_CHECK(openBtree(&tree, INDEX_FILE));
+
+	for (i = 0; i < numInserts; i++)
+	{
+		rid.page = i;
+		rid.slot = 0;
+		TEST_CHECK(insertKey(tree, keys[i], rid));
+	}
+
+	TEST_CHECK(openTreeScan(tree, &sc));
+	for (i = 0; i < numInserts; i++)
+	{
+		TEST_CHECK(nextEntry(sc, &rid));
+		ASSERT_EQUALS_STRING(sorted[i], keys[rid.page]->v.stringV, "string keys come back sorted");
+	}
+	TEST_CHECK(closeTreeScan(sc));
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree(INDEX_FILE));
+	freeValues(keys, numInserts);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testReopen (void)
+{
+	BTreeHandle *tree = NULL;
+	Value *key;
+	RID rid;
+	int i, n;
+	testName = "test b-tree persists across close and open";
+
+	TEST_CHECK(createBtree(INDEX_FILE, DT_FLOAT, 0, 0));
+	TEST_CHECK(openBtree(&tree, INDEX_FILE));
+	for (i = 0; i < 1000; i++)
+	{
+		MAKE_VALUE(key, DT_FLOAT, i * 0.5);
+		rid.page = i;
+		rid.slot = i;
+		TEST_CHECK(insertKey(tree, key, rid));
+		freeVal(key);
+	}
+	TEST_CHECK(closeBtree(tree));
+
+	TEST_CHECK(openBtree(&tree, INDEX_FILE));
+	TEST_CHECK(getNumEntries(tree, &n));
+	ASSERT_EQUALS_INT(1000, n, "entries survive reopening");
+
+	MAKE_VALUE(key, DT_FLOAT, 333.5);
+	TEST_CHECK(findKey(tree, key, &rid));
+	ASSERT_EQUALS_INT(667, rid.page, "key 333.5 found after reopening");
+	freeVal(key);
+
+	TEST_CHECK(closeBtree(tree));
+	TEST_CHECK(deleteBtree(INDEX_FILE));
+
+	TEST_DONE();
+}
+
+// ************************************************************
+Value **
+createValues (char **stringVals, int size)
+{
+	Value **result = (Value **) malloc(sizeof(Value *) * size);
+	int i;
+
+	for (i = 0; i < size; i++)
+		result[i] = stringToValue(stringVals[i]);
+
+	return result;
+}
+
+void
+freeValues (Value **vals, int size)
+{
+	while (--size >= 0)
+		freeVal(vals[size]);
+	free(vals);
+}
+
+int *
+createPermutation (int size)
+{
+	int *result = (int *) malloc(size * sizeof(int));
+	int i;
+
+	srand(42);
+	for (i = 0; i < size; i++)
+		result[i] = i;
+
+	for (i = size - 1; i > 0; i--)
+	{
+		int j = rand() % (i + 1);
+		int tmp = result[i];
+		result[i] = result[j];
+		result[j] = tmp;
+	}
+
+	return result;
+}
@@ -29,6 +29,10 @@
 static void testValueSerialize (void);
 static void testOperators (void);
 static void testExpressions (void);
+static void testRangeOperators (void);
+static void testNormalization (void);
+static void testShortCircuit (void);
+static void testThreeValuedLogic (void);
 
 char *testName;
 
@@ -41,6 +45,10 @@ main (void)
 	testValueSerialize();
 	testOperators();
 	testExpressions();
+	testRangeOperators();
+	testNormalization();
+	testShortCircuit();
+	testThreeValuedLogic();
 
 	return 0;
 }
@@ -78,6 +86,15 @@ testOperators (void)
 	// smaller
 	OP_TRUE(stringToValue("i3"),stringToValue("i10"), valueSmaller, "3 < 10");
 	OP_TRUE(stringToValue("f5.0"),stringToValue("f6.5"), valueSmaller, "5.0 < 6.5");
+	OP_TRUE(stringToValue("bf"),stringToValue("bt"), valueSmaller, "f < t");
+	OP_FALSE(stringToValue("bt"),stringToValue("bf"), valueSmaller, "t < f is false");
+	OP_TRUE(stringToValue("i10"),stringToValue("i10"), valueSmallerEqual, "10 <= 10");
+	OP_TRUE(stringToValue("i11"),stringToValue("i10"), valueGreater, "11 > 10");
+	OP_FALSE(stringToValue("i9"),stringToValue("i10"), valueGreaterEqual, "9 >= 10 is false");
+	OP_TRUE(stringToValue("sabc"),stringToValue("sabd"), valueNotEquals, "abc <> abd");
+	OP_TRUE(stringToValue("sabcdef"),stringToValue("sabc%"), valueLike, "abcdef LIKE abc%");
+	OP_TRUE(stringToValue("sabcdef"),stringToValue("sa_c%f"), valueLike, "abcdef LIKE a_c%f");
+	OP_FALSE(stringToValue("sxabc"),stringToValue("sabc%"), valueLike, "xabc NOT LIKE abc%");
 
 	// boolean
 	OP_TRUE(stringToValue("bt"),stringToValue("bt"), boolAnd, "t AND t = t");
@@ -123,3 +140,275 @@ testExpressions (void)
 
 	TEST_DONE();
 }
+
+// ************************************************************
+void
+testRangeOperators (void)
+{
+	Expr *op, *in, *l, *r;
+	Expr *list[3];
+	Value *res;
+	testName = "test BETWEEN and IN operators";
+
+	MAKE_CONS(in, stringToValue("i15"));
+	MAKE_CONS(l, stringToValue("i10"));
+	MAKE_CONS(r, stringToValue("i20"));
+	MAKE_BETWEEN_EXPR(op, in, l, r);
+	TEST_CHECK(evalExpr(NULL, NULL, op, &res));
+	OP_TRUE(stringToValue("bt"), res, valueEquals, "15 BETWEEN 10 AND 20");
+	freeVal(res);
+	freeExpr(op);
+
+	MAKE_CONS(in, stringToValue("i21"));
+	MAKE_CONS(l, stringToValue("i10"));
+	MAKE_CONS(r, stringToValue("i20"));
+	MAKE_BETWEEN_EXPR(op, in, l, r);
+	TEST_CHECK(evalExpr(NULL, NULL, op, &res));
+	OP_TRUE(stringToValue("bf"), res, valueEquals, "21 NOT BETWEEN 10 AND 20");
+	freeVal(res);
+	freeExpr(op);
+
+	MAKE_CONS(in, stringToValue("sbb"));
+	MAKE_CONS(list[0], stringToValue("saa"));
+	MAKE_CONS(list[1], stringToValue("sbb"));
+	MAKE_CONS(list[2], stringToValue("scc"));
+	MAKE_IN_EXPR(op, in, list, 3);
+	TEST_CHECK(evalExpr(NULL, NULL, op, &res));
+	OP_TRUE(stringToValue("bt"), res, valueEquals, "bb IN (aa, bb, cc)");
+	freeVal(res);
+	freeExpr(op);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testNormalization (void)
+{
+	Expr *op, *cmp, *low, *high, *l, *r;
+	testName = "test expression normalization";
+
+	// NOT (a < 5) => a >= 5
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i5"));
+	MAKE_BINOP_EXPR(cmp, l, r, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(op, cmp, OP_BOOL_NOT);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->type == EXPR_OP && op->expr.op->type == OP_COMP_GREATER_EQUAL, "NOT a < 5 => a >= 5");
+	freeExpr(op);
+
+	// 5 < a => a > 5
+	MAKE_CONS(l, stringToValue("i5"));
+	MAKE_ATTRREF(r, 0);
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->expr.op->type == OP_COMP_GREATER && op->expr.op->args[0]->type == EXPR_ATTRREF, "5 < a => a > 5");
+	freeExpr(op);
+
+	// (10 < 20) AND true => true
+	MAKE_CONS(l, stringToValue("i10"));
+	MAKE_CONS(r, stringToValue("i20"));
+	MAKE_BINOP_EXPR(cmp, l, r, OP_COMP_SMALLER);
+	MAKE_CONS(r, stringToValue("bt"));
+	MAKE_BINOP_EXPR(op, cmp, r, OP_BOOL_AND);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->type == EXPR_CONST, "constant expression folded");
+	OP_TRUE(stringToValue("bt"), op->expr.cons, valueEquals, "folded to true");
+	freeExpr(op);
+
+	// NOT (a < 10) AND NOT (a > 20) => a BETWEEN 10 AND 20
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i10"));
+	MAKE_BINOP_EXPR(cmp, l, r, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(low, cmp, OP_BOOL_NOT);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i20"));
+	MAKE_BINOP_EXPR(cmp, l, r, OP_COMP_GREATER);
+	MAKE_UNOP_EXPR(high, cmp, OP_BOOL_NOT);
+	MAKE_BINOP_EXPR(op, low, high, OP_BOOL_AND);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->type == EXPR_OP && op->expr.op->type == OP_COMP_BETWEEN, "range merged into BETWEEN");
+	ASSERT_EQUALS_INT(3, op->expr.op->numArgs, "BETWEEN has three arguments");
+	freeExpr(op);
+
+	// NOT (a = 1 OR a = 2) => a <> 1 AND a <> 2
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i1"));
+	MAKE_BINOP_EXPR(low, l, r, OP_COMP_EQUAL);
+	MAKE_ATTRREF(l, 0);
+	MAKE_CONS(r, stringToValue("i2"));
+	MAKE_BINOP_EXPR(high, l, r, OP_COMP_EQUAL);
+	MAKE_BINOP_EXPR(cmp, low, high, OP_BOOL_OR);
+	MAKE_UNOP_EXPR(op, cmp, OP_BOOL_NOT);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->expr.op->type == OP_BOOL_AND, "De Morgan turns OR into AND");
+	ASSERT_TRUE(op->expr.op->args[0]->expr.op->type == OP_COMP_NOT_EQUAL, "a = 1 negated into a <> 1");
+	freeExpr(op);
+
+	// b LIKE 'ab%' => b BETWEEN 'ab' AND 'ac' AND b LIKE 'ab%'
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sab%"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_LIKE);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->expr.op->type == OP_BOOL_AND, "prefix LIKE bounded by a range");
+	low = op->expr.op->args[0];
+	ASSERT_TRUE(low->expr.op->type == OP_COMP_BETWEEN && low->expr.op->args[0]->expr.attrRef == 1, "range on the LIKE attribute");
+	ASSERT_EQUALS_STRING("ab", low->expr.op->args[1]->expr.cons->v.stringV, "range starts at the prefix");
+	ASSERT_EQUALS_STRING("ac", low->expr.op->args[2]->expr.cons->v.stringV, "range ends after the prefix");
+	ASSERT_TRUE(op->expr.op->args[1]->expr.op->type == OP_COMP_LIKE && op->expr.op->args[1]->expr.op->args[1] == r, "LIKE kept as filter");
+	freeExpr(op);
+
+	// NOT (b LIKE 'ab%') is left as it is, the range only serves conjuncts
+	MAKE_ATTRREF(l, 1);
+	MAKE_CONS(r, stringToValue("sab%"));
+	MAKE_BINOP_EXPR(cmp, l, r, OP_COMP_LIKE);
+	MAKE_UNOP_EXPR(op, cmp, OP_BOOL_NOT);
+	TEST_CHECK(normalizeExpr(op));
+	ASSERT_TRUE(op->expr.op->type == OP_BOOL_NOT && op->expr.op->args[0] == cmp, "negated LIKE not rewritten");
+	freeExpr(op);
+
+	// normalizing a copy leaves the original as it was: NOT ('x' = b)
+	MAKE_CONS(l, stringToValue("sx"));
+	MAKE_ATTRREF(r, 1);
+	MAKE_BINOP_EXPR(cmp, l, r, OP_COMP_EQUAL);
+	MAKE_UNOP_EXPR(op, cmp, OP_BOOL_NOT);
+	TEST_CHECK(copyExpr(op, &low));
+	TEST_CHECK(normalizeExpr(low));
+	ASSERT_TRUE(low->expr.op->type == OP_COMP_NOT_EQUAL && low->expr.op->args[0]->type == EXPR_ATTRREF, "copy normalized");
+	ASSERT_TRUE(op->expr.op->type == OP_BOOL_NOT && op->expr.op->args[0] == cmp, "original untouched");
+	ASSERT_TRUE(cmp->expr.op->args[0] == l && strcmp(l->expr.cons->v.stringV, "x") == 0, "original operands kept");
+	freeExpr(low);
+	freeExpr(op);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testShortCircuit (void)
+{
+	Expr *op, *and, *bad, *l, *r, *lt, *gt;
+	Conjunction *conj;
+	Value *res;
+	bool b;
+	int i;
+	testName = "test short-circuit and adaptive conjunct ordering";
+
+	// the right operand would fail (int compared to string) but is never evaluated
+	MAKE_CONS(l, stringToValue("i1"));
+	MAKE_CONS(r, stringToValue("sx"));
+	MAKE_BINOP_EXPR(bad, l, r, OP_COMP_EQUAL);
+	MAKE_CONS(l, stringToValue("bf"));
+	MAKE_BINOP_EXPR(op, l, bad, OP_BOOL_AND);
+	TEST_CHECK(evalExpr(NULL, NULL, op, &res));
+	OP_TRUE(stringToValue("bf"), res, valueEquals, "false AND <error> = false");
+	freeVal(res);
+	op->expr.op->type = OP_BOOL_OR;
+	op->expr.op->args[0]->expr.cons->v.boolV = TRUE;
+	TEST_CHECK(evalExpr(NULL, NULL, op, &res));
+	OP_TRUE(stringToValue("bt"), res, valueEquals, "true OR <error> = true");
+	freeVal(res);
+	freeExpr(op);
+
+	// (1 < 2) AND (1 < 2) AND (1 > 2): the always-false conjunct moves to the front
+	MAKE_CONS(l, stringToValue("i1"));
+	MAKE_CONS(r, stringToValue("i2"));
+	MAKE_BINOP_EXPR(lt, l, r, OP_COMP_SMALLER);
+	MAKE_CONS(l, stringToValue("i1"));
+	MAKE_CONS(r, stringToValue("i2"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	MAKE_BINOP_EXPR(and, lt, op, OP_BOOL_AND);
+	MAKE_CONS(l, stringToValue("i1"));
+	MAKE_CONS(r, stringToValue("i2"));
+	MAKE_BINOP_EXPR(gt, l, r, OP_COMP_GREATER);
+	MAKE_BINOP_EXPR(op, and, gt, OP_BOOL_AND);
+
+	TEST_CHECK(buildConjunction(op, &conj));
+	ASSERT_EQUALS_INT(3, conj->numConjuncts, "AND-chain flattened");
+	ASSERT_TRUE(conj->conjuncts[2] == gt, "false conjunct starts last");
+	for (i = 0; i < 2 * conj->reorderInterval; i++)
+	{
+		TEST_CHECK(evalConjunction(NULL, NULL, conj, &b));
+		ASSERT_TRUE(!b, "conjunction is false");
+	}
+	ASSERT_TRUE(conj->conjuncts[0] == gt, "most selective conjunct moved first");
+	ASSERT_TRUE(conj->evaluations[1] == conj->reorderInterval, "other conjuncts are skipped once reordered");
+	freeConjunction(conj);
+	freeExpr(op);
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testThreeValuedLogic (void)
+{
+	Expr *op, *in, *l, *r;
+	Expr *list[2];
+	Value *res, *t, *f, *n;
+	testName = "test NULL values and three-valued logic";
+
+	ASSERT_EQUALS_STRING(serializeValue(stringToValue("ni")), "NULL", "create Value NULL");
+	t = stringToValue("bt");
+	f = stringToValue("bf");
+	n = stringToValue("nb");
+	MAKE_VALUE(res, DT_INT, -1);
+
+	// comparisons with NULL are unknown
+	TEST_CHECK(valueEquals(stringToValue("ni"), stringToValue("ni"), res));
+	ASSERT_TRUE(res->isNull, "NULL = NULL is NULL");
+	TEST_CHECK(valueSmaller(stringToValue("i1"), stringToValue("ni"), res));
+	ASSERT_TRUE(res->isNull, "1 < NULL is NULL");
+	TEST_CHECK(valueIsNull(stringToValue("ni"), res));
+	ASSERT_TRUE(!res->isNull && res->v.boolV, "NULL IS NULL");
+
+	// Kleene truth tables
+	TEST_CHECK(boolAnd(n, f, res));
+	ASSERT_TRUE(!res->isNull && !res->v.boolV, "NULL AND false = false");
+	TEST_CHECK(boolAnd(n, t, res));
+	ASSERT_TRUE(res->isNull, "NULL AND true = NULL");
+	TEST_CHECK(boolOr(n, t, res));
+	ASSERT_TRUE(!res->isNull && res->v.boolV, "NULL OR true = true");
+	TEST_CHECK(boolOr(f, n, res));
+	ASSERT_TRUE(res->isNull, "false OR NULL = NULL");
+	TEST_CHECK(boolNot(n, res));
+	ASSERT_TRUE(res->isNull, "NOT NULL = NULL");
+	free(res);
+
+	// a NULL left operand does not short-circuit: NULL OR true = true
+	MAKE_CONS(l, stringToValue("nb"));
+	MAKE_CONS(r, stringToValue("bt"));
+	MAKE_BINOP_EXPR(op, l, r, OP_BOOL_OR);
+	TEST_CHECK(evalExpr(NULL, NULL, op, &res));
+	ASSERT_TRUE(!res->isNull && res->v.boolV, "NULL OR true evaluates to true");
+	freeVal(res);
+	freeExpr(op);
+
+	// IN is NULL without a match if a candidate is NULL
+	MAKE_CONS(list[0], stringToValue("i1"));
+	MAKE_CONS(list[1], stringToValue("ni"));
+	MAKE_CONS(l, stringToValue("i3"));
+	MAKE_IN_EXPR(in, l, list, 2);
+	TEST_CHECK(evalExpr(NULL, NULL, in, &res));
+	ASSERT_TRUE(res->isNull, "3 IN (1, NULL) is NULL");
+	freeVal(res);
+	in->expr.op->args[0]->expr.cons->v.intV = 1;
+	TEST_CHECK(evalExpr(NULL, NULL, in, &res));
+	ASSERT_TRUE(!res->isNull && res->v.boolV, "1 IN (1, NULL) is true");
+	freeVal(res);
+	freeExpr(in);
+
+	// normalization keeps the NULL semantics: NOT (NULL < 5) folds to NULL
+	MAKE_CONS(l, stringToValue("ni"));
+	MAKE_CONS(r, stringToValue("i5"));
+	MAKE_BINOP_EXPR(op, l, r, OP_COMP_SMALLER);
+	MAKE_UNOP_EXPR(in, op, OP_BOOL_NOT);
+	TEST_CHECK(normalizeExpr(in));
+	ASSERT_TRUE(in->type == EXPR_CONST && in->expr.cons->isNull, "NOT (NULL < 5) folds to NULL");
+	freeExpr(in);
+
+	freeVal(t);
+	freeVal(f);
+	freeVal(n);
+	TEST_DONE();
+}
@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include "dberror.h"
+#include "expr.h"
+#include "hash_mgr.h"
+#include "tables.h"
+#include "test_helper.h"
+
+#define INDEX_FILE "testhidx"
+
+// test methods
+static void testInsertAndLookup (void);
+static void testBucketSplits (void);
+static void testDuplicatesAndOverflow (void);
+static void testStringKeysAndReopen (void);
+
+char *testName;
+
+// main method
+int
+main (void)
+{
+	testName = "";
+
+	testInsertAndLookup();
+	testBucketSplits();
+	testDuplicatesAndOverflow();
+	testStringKeysAndReopen();
+
+	return 0;
+}
+
+// ************************************************************
+void
+testInsertAndLookup (void)
+{
+	HashHandle *hash = NULL;
+	Value *key;
+	RID rid, *rids;
+	int i, n;
+	testName = "test hash inserting, lookup and delete";
+
+	TEST_CHECK(createHash(INDEX_FILE, DT_INT, 0));
+	TEST_CHECK(openHash(&hash, INDEX_FILE));
+
+	for (i = 0; i < 100; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i * 3);
+		rid.page = i;
+		rid.slot = i % 7;
+		TEST_CHECK(hashInsert(hash, key, rid));
+		freeVal(key);
+	}
+	TEST_CHECK(getHashNumEntries(hash, &n));
+	ASSERT_EQUALS_INT(100, n, "number of entries in hash");
+
+	MAKE_VALUE(key, DT_INT, 42);
+	TEST_CHECK(hashLookup(hash, key, &rids, &n));
+	ASSERT_EQUALS_INT(1, n, "one RID for key 42");
+	ASSERT_EQUALS_INT(14, rids[0].page, "found right page");
+	ASSERT_EQUALS_INT(0, rids[0].slot, "found right slot");
+	free(rids);
+
+	rid.page = 14;
+	rid.slot = 0;
+	ASSERT_EQUALS_INT(RC_IM_KEY_ALREADY_EXISTS, hashInsert(hash, key, rid), "same key and RID is rejected");
+	TEST_CHECK(hashDelete(hash, key, rid));
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, hashLookup(hash, key, &rids, &n), "deleted key is gone");
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, hashDelete(hash, key, rid), "entry can only be deleted once");
+	freeVal(key);
+
+	MAKE_VALUE(key, DT_INT, 43);
+	ASSERT_EQUALS_INT(RC_IM_KEY_NOT_FOUND, hashLookup(hash, key, &rids, &n), "missing key is not found");
+	freeVal(key);
+
+	TEST_CHECK(closeHash(hash));
+	TEST_CHECK(deleteHash(INDEX_FILE));
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testBucketSplits (void)
+{
+	int numInserts = 20000;
+	HashHandle *hash = NULL;
+	Value *key;
+	RID rid, *rids;
+	int i, n, buckets, depth;
+	testName = "test hash bucket splits and directory growth";
+
+	TEST_CHECK(createHash(INDEX_FILE, DT_INT, 0));
+	TEST_CHECK(openHash(&hash, INDEX_FILE));
+
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i);
+		rid.page = i;
+		rid.slot = 0;
+		TEST_CHECK(hashInsert(hash, key, rid));
+		freeVal(key);
+	}
+
+	TEST_CHECK(getHashNumBuckets(hash, &buckets));
+	TEST_CHECK(getHashGlobalDepth(hash, &depth));
+	ASSERT_TRUE(buckets > 1, "buckets were split");
+	ASSERT_TRUE(buckets <= (1 << depth), "directory covers every bucket");
+
+	for (i = 0; i < numInserts; i++)
+	{
+		MAKE_VALUE(key, DT_INT, i);
+		TEST_CHECK(hashLookup(hash, key, &rids, &n));
+		freeVal(key);
+		rid = rids[0];
+		free(rids);
+		if (n != 1 || rid.page != i)
+			break;
+	}
+	ASSERT_EQUALS_INT(numInserts, i, "every key is found after the splits");
+
+	TEST_CHECK(closeHash(hash));
+	TEST_CHECK(deleteHash(INDEX_FILE));
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testDuplicatesAndOverflow (void)
+{
+	HashHandle *hash = NULL;
+	Value *key;
+	RID rid, *rids;
+	int i, n, depth;
+	testName = "test hash with many RIDs under one key";
+
+	TEST_CHECK(createHash(INDEX_FILE, DT_INT, 0));
+	TEST_CHECK(openHash(&hash, INDEX_FILE));
+
+	// far more entries than a page holds, all with the same hash
+	MAKE_VALUE(key, DT_INT, 7);
+	for (i = 0; i < 2000; i++)
+	{
+		rid.page = i;
+		rid.slot = 1;
+		TEST_CHECK(hashInsert(hash, key, rid));
+	}
+
+	TEST_CHECK(getHashGlobalDepth(hash, &depth));
+	ASSERT_EQUALS_INT(0, depth, "equal keys chain overflow pages instead of splitting");
+
+	TEST_CHECK(hashLookup(hash, key, &rids, &n));
+	ASSERT_EQUALS_INT(2000, n, "all RIDs of the key are returned");
+	free(rids);
+
+	rid.page = 1234;
+	rid.slot = 1;
+	TEST_CHECK(hashDelete(hash, key, rid));
+	TEST_CHECK(hashLookup(hash, key, &rids, &n));
+	ASSERT_EQUALS_INT(1999, n, "one RID deleted");
+	for (i = 0; i < n; i++)
+		if (rids[i].page == 1234)
+			break;
+	ASSERT_EQUALS_INT(n, i, "the deleted RID is gone");
+	free(rids);
+	freeVal(key);
+
+	TEST_CHECK(closeHash(hash));
+	TEST_CHECK(deleteHash(INDEX_FILE));
+
+	TEST_DONE();
+}
+
+// ************************************************************
+void
+testStringKeysAndReopen (void)
+{
+	HashHandle *hash = NULL;
+	Value *key;
+	RID rid, *rids;
+	char buf[16];
+	int i, n;
+	testName = "test hash with string keys persists across close and open";
+
+	TEST_CHECK(createHash(INDEX_FILE, DT_STRING, 10));
+	TEST_CHECK(openHash(&hash, INDEX_FILE));
+	for (i = 0; i < 5000; i++)
+	{
+		sprintf(buf, "key%d", i);
+		MAKE_STRING_VALUE(key, buf);
+		rid.page = i;
+		rid.slot = 2;
+		TEST_CHECK(hashInsert(hash, key, rid));
+		freeVal(key);
+	}
+	TEST_CHECK(closeHash(hash));
+
+	TEST_CHECK(openHash(&hash, INDEX_FILE));
+	TEST_CHECK(getHashNumEntries(hash, &n));
+	ASSERT_EQUALS_INT(5000, n, "entries survive reopening");
+
+	for (i = 0; i < 5000; i += 7)
+	{
+		sprintf(buf, "key%d", i);
+		MAKE_STRING_VALUE(key, buf);
+		TEST_CHECK(hashLookup(hash, key, &rids, &n));
+		freeVal(key);
+		rid = rids[0];
+		free(rids);
+		if (rid.page != i)
+			break;
+	}
+	ASSERT_TRUE(i >= 5000, "string keys found after reopening");
+
+	TEST_CHECK(closeHash(hash));
+	TEST_CHECK(deleteHash(INDEX_FILE));
+
+	TEST_DONE();
+}